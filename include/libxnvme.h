@@ -72,6 +72,13 @@ struct xnvme_opts {
 	const char *subnqn;    ///< SPDK fabrics: Subsystem NQN
 	const char *hostnqn;   ///< SPDK fabrics: Host NQN
 	uint32_t spdk_fabrics; ///< Is assigned a value by backend if SPDK uses fabrics
+	struct {
+		uint32_t value : 31;
+		uint32_t given : 1;
+	} numa_node; ///< NUMA node for buffers and queue-threads; default is the node of the device
+	uint8_t split;        ///< Split reads and writes exceeding MDTS into multiple commands
+	uint8_t enum_sysfs;   ///< Linux enumerate: yield handles from sysfs, without opening
+	uint8_t async_helper; ///< Pass commands unsupported by async via a helper-thread
 };
 
 /**
@@ -135,9 +142,33 @@ struct xnvme_dev *
 xnvme_dev_open(const char *dev_uri, struct xnvme_opts *opts);
 
 /**
- * Destroy the given device handle (::xnvme_dev)
+ * Returns a device handle (::xnvme_dev) shared with other callers of xnvme_dev_open_shared()
  *
- * @param dev Device handle obtained with xnvme_dev_open()
+ * The first call opens the device, as xnvme_dev_open() does, and further calls, from any thread,
+ * with the same device-uri and options return the same handle, with its reference-count
+ * incremented. Interfaces and nsid not given by 'opts' match those of the opened handle. Each
+ * reference is dropped via xnvme_dev_close(), and the device is closed with the last of them.
+ *
+ * Each thread should set up its own queue, via xnvme_queue_init(), which is thread-safe on a
+ * shared handle. Readahead, see xnvme_file_readahead(), and the zone-state cache, see
+ * xnvme_znd_cache_enable(), keep unsynchronized state in the handle, thus, they are refused on
+ * shared handles.
+ *
+ * @param dev_uri File path "/dev/nvme0n1" or "0000:04.01"
+ * @param opts Options for library backend and system-interfaces
+ *
+ * @return On success, a handle to the device. On error, NULL is returned and `errno` set to
+ * indicate the error.
+ */
+struct xnvme_dev *
+xnvme_dev_open_shared(const char *dev_uri, struct xnvme_opts *opts);
+
+/**
+ * Destroy the given device handle (::xnvme_dev); for handles obtained with
+ * xnvme_dev_open_shared(), then this drops a reference, and the device is destroyed when it is
+ * the last
+ *
+ * @param dev Device handle obtained with xnvme_dev_open() or xnvme_dev_open_shared()
  */
 void
 xnvme_dev_close(struct xnvme_dev *dev);
@@ -93,6 +93,27 @@ xnvme_buf_vtophys(const struct xnvme_dev *dev, void *buf, uint64_t *phys);
 void *
 xnvme_buf_virt_alloc(size_t alignment, size_t nbytes);
 
+/**
+ * Re-allocate a buffer of virtual memory, preserving the given `alignment`
+ *
+ * The content of the buffer, up to the lesser of the old and new size, is preserved. The buffer
+ * grows in place when the allocation has room for it, otherwise it is moved.
+ *
+ * @note
+ * When `buf` is NULL, then this is equivalent to xnvme_buf_virt_alloc()
+ * @note
+ * You must use xnvme_buf_virt_free() to de-allocate the buffer
+ *
+ * @param buf Pointer to a buffer allocated with xnvme_buf_virt_alloc()
+ * @param alignment The alignment in bytes, must be the one used when allocating `buf`
+ * @param nbytes The new size of the buffer in bytes
+ *
+ * @return On success, a pointer to the re-allocated memory is returned. On error, NULL is
+ * returned, `errno` set to indicate the error, and `buf` is left untouched
+ */
+void *
+xnvme_buf_virt_realloc(void *buf, size_t alignment, size_t nbytes);
+
 /**
  * Free the given virtual memory buffer
  *
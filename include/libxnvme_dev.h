@@ -132,4 +132,17 @@ xnvme_dev_get_be_state(const struct xnvme_dev *dev);
 uint64_t
 xnvme_dev_get_ssw(const struct xnvme_dev *dev);
 
+/**
+ * Returns the NUMA node which the device is attached to
+ *
+ * Buffers allocated with xnvme_buf_alloc() and the resources of queues created with
+ * xnvme_queue_init() prefer this node, unless another is given via xnvme_opts.numa_node.
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ *
+ * @return On success, the NUMA node is returned. When the node is unknown, -1 is returned.
+ */
+int
+xnvme_dev_get_numa_node(const struct xnvme_dev *dev);
+
 #endif /* __LIBXNVME_NVM */
@@ -28,6 +28,48 @@ extern "C" {
 struct xnvme_dev *
 xnvme_file_open(const char *pathname, struct xnvme_opts *opts);
 
+/**
+ * Open the files identified by 'pathnames' for I/O operation, as a batch
+ *
+ * Regular files are opened as lightweight file-handles; that is, with the geometry derived from
+ * the size of the file, without identify and without looking up the NUMA node, and on Linux, with
+ * io_uring, when available, then the open() and statx() of the files are submitted as a batch.
+ * Thus, the cost of opening many small files is reduced to little more than the system-calls.
+ * Other paths, such as block-devices, are opened via xnvme_file_open().
+ *
+ * @note Lightweight file-handles do not carry identify data, use the geometry of the handle.
+ *
+ * @param pathnames Array of 'npaths' paths to open
+ * @param npaths Number of paths to open
+ * @param opts Options for opening files, see ::xnvme_opts, shared by all the files
+ * @param fhs Array of 'npaths' pointers, assigned the file-handles, or NULL for paths which
+ * failed to open
+ * @param errs Optional array of 'npaths' integers, assigned the negative `errno` of paths which
+ * failed to open, and 0 for the others
+ *
+ * @return On success, 0 is returned. On error, negative `errno` of the first path which failed to
+ * open is returned; the paths which did open are still returned in 'fhs'.
+ */
+int
+xnvme_file_open_batch(const char **pathnames, uint32_t npaths, struct xnvme_opts *opts,
+		      struct xnvme_dev **fhs, int *errs);
+
+/**
+ * Close the given file-handles, as a batch
+ *
+ * On Linux, with io_uring, when available, then the close() of the files are submitted as a
+ * batch. NULL entries of 'fhs' are skipped.
+ *
+ * @param fhs Array of 'nfhs' file-handles as obtained by ::xnvme_file_open_batch or
+ * ::xnvme_file_open
+ * @param nfhs Number of file-handles
+ *
+ * @return On success, 0 is returned. On error, negative `errno` of the first failing close is
+ * returned; all the handles are closed regardless.
+ */
+int
+xnvme_file_close_batch(struct xnvme_dev **fhs, uint32_t nfhs);
+
 /**
  * Close the file encapsulated by the given ::xnvme_dev handle
  *
@@ -56,6 +98,33 @@ xnvme_file_close(struct xnvme_dev *fh);
 int
 xnvme_file_pread(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offset);
 
+/**
+ * Enable, re-configure or disable readahead of xnvme_file_pread() on the given file-handle
+ *
+ * With readahead enabled, then xnvme_file_pread() with a synchronous context detects sequential
+ * reads, and when detected, keeps 'depth' reads of 'nbytes' each in flight on an internal queue,
+ * ahead of the stream. Sequential reads are then served from these windows, thus, e.g. a stream
+ * of 64K reads on a handle opened with 'opts.direct' is turned into large reads which overlap
+ * with the processing done by the reader. Any other read, and any write, fallocate or read past
+ * end-of-file, drops the windows and restarts the detection.
+ *
+ * The windows are read using the asynchronous interface of the handle, e.g. 'opts.async =
+ * "io_uring"' or "thrpool"; with the default "emu" then the windows are read, in bulk, when the
+ * stream waits for them. Reads with an asynchronous context are not served by the readahead.
+ *
+ * @note The readahead is not thread-safe; a file-handle with readahead must not be read by
+ * multiple threads concurrently, thus, it is refused on handles from xnvme_dev_open_shared()
+ *
+ * @param fh File-handle as obtained by with ::xnvme_file_open
+ * @param depth Number of windows to read ahead, a power of 2, 0 disables readahead
+ * @param nbytes Size of each window in bytes, 0 uses the maximum data-transfer-size of the device
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, -EINVAL for a handle
+ * obtained with xnvme_dev_open_shared().
+ */
+int
+xnvme_file_readahead(struct xnvme_dev *fh, uint32_t depth, size_t nbytes);
+
 /**
  * Perform a stateless write to the file or device encapsulated by 'ctx'
  *
@@ -75,6 +144,167 @@ xnvme_file_pread(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offse
 int
 xnvme_file_pwrite(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offset);
 
+/**
+ * Perform a stateless vectored read to the file or device encapsulated by 'ctx'
+ *
+ * Retrieve a synchronous context using ::xnvme_cmd_ctx_from_dev and an asynchronous context using
+ * ::xnvme_cmd_ctx_from_queue. The total number of bytes to read is the sum of the 'iov_len' of
+ * the elements in 'iov'.
+ *
+ * @param ctx Pointer to command context (::xnvme_cmd_ctx)
+ * @param iov Array of iovecs describing the data-payload
+ * @param iovcnt Number of elements in 'iov'
+ * @param offset The offset, in bytes, to start reading from
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_preadv(struct xnvme_cmd_ctx *ctx, struct iovec *iov, size_t iovcnt, off_t offset);
+
+/**
+ * Perform a stateless vectored write to the file or device encapsulated by 'ctx'
+ *
+ * Retrieve a synchronous context using ::xnvme_cmd_ctx_from_dev and an asynchronous context using
+ * ::xnvme_cmd_ctx_from_queue. The elements of 'iov' are written back-to-back starting at
+ * 'offset', e.g. a header and a payload in a single command.
+ *
+ * @param ctx Pointer to command context (::xnvme_cmd_ctx)
+ * @param iov Array of iovecs describing the data-payload
+ * @param iovcnt Number of elements in 'iov'
+ * @param offset The offset, in bytes, to start writing to
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_pwritev(struct xnvme_cmd_ctx *ctx, struct iovec *iov, size_t iovcnt, off_t offset);
+
+/**
+ * Allocate, or with XNVME_SPEC_FS_FALLOCATE_PUNCH_HOLE de-allocate, a range of the file
+ * encapsulated by 'ctx'
+ *
+ * @note The asynchronous interfaces "io_uring" and "emu"/"thrpool" support this, "libaio" and
+ * "posix" do not.
+ *
+ * @param ctx Pointer to command context (::xnvme_cmd_ctx)
+ * @param offset The offset, in bytes, of the range
+ * @param nbytes The length, in bytes, of the range
+ * @param mode Bitmask of ::xnvme_spec_fs_fallocate_mode, zero to allocate and extend the file
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_fallocate(struct xnvme_cmd_ctx *ctx, off_t offset, size_t nbytes, uint32_t mode);
+
+/**
+ * Set the size of the file encapsulated by 'ctx' to 'nbytes', like ftruncate()
+ *
+ * @param ctx Pointer to command context (::xnvme_cmd_ctx)
+ * @param nbytes The size of the file, in bytes
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_truncate(struct xnvme_cmd_ctx *ctx, off_t nbytes);
+
+/**
+ * Flush data and metadata of the file or device encapsulated by 'ctx', like fsync()
+ *
+ * Unlike xnvme_file_sync(), then this can be submitted on a queue, by using an asynchronous
+ * context from ::xnvme_cmd_ctx_from_queue, such that the durability barrier does not block.
+ *
+ * @param ctx Pointer to command context (::xnvme_cmd_ctx)
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_fsync(struct xnvme_cmd_ctx *ctx);
+
+/**
+ * Flush data of the file or device encapsulated by 'ctx', like fdatasync()
+ *
+ * Metadata is only flushed when needed to read back the data, e.g. a change of file-size, which
+ * makes it cheaper than xnvme_file_fsync() for overwrites. Can be submitted on a queue.
+ *
+ * @param ctx Pointer to command context (::xnvme_cmd_ctx)
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_fdatasync(struct xnvme_cmd_ctx *ctx);
+
+/**
+ * Opaque handle of a stream-writer, see xnvme_file_writer_open()
+ *
+ * @struct xnvme_file_writer
+ */
+struct xnvme_file_writer;
+
+/**
+ * Open a stream-writer appending to the given file-handle from 'offset'
+ *
+ * Appends are buffered into chunks of 'chunk_nbytes', and each chunk is written, when full, on an
+ * internal queue with up to 'depth' chunk-writes in flight. Thus, e.g. appends of a few hundred
+ * bytes to a handle opened with 'opts.direct' become large aligned writes. Use an asynchronous
+ * interface, such as "io_uring" or "thrpool", for the chunk-writes to overlap with the appends.
+ *
+ * @note The writer is not thread-safe, and the file must not be written by other means while the
+ * writer is open
+ *
+ * @param fh File-handle as obtained by with ::xnvme_file_open
+ * @param offset Offset, in bytes, of the first append; with 'opts.direct' it must be aligned to
+ * the logical block size
+ * @param depth Maximum number of chunk-writes in flight, a power of 2
+ * @param chunk_nbytes Size of each chunk in bytes, 0 uses the maximum data-transfer-size of the
+ * device
+ * @param writer Pointer-pointer to the ::xnvme_file_writer to initialize
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_writer_open(struct xnvme_dev *fh, off_t offset, uint32_t depth, size_t chunk_nbytes,
+		       struct xnvme_file_writer **writer);
+
+/**
+ * Append 'nbytes' from 'buf' to the stream
+ *
+ * The data is copied, thus 'buf' can be re-used when this returns, and the data is written when a
+ * chunk is full or by xnvme_file_writer_flush().
+ *
+ * @param writer Pointer to the ::xnvme_file_writer
+ * @param buf Pointer to the data to append
+ * @param nbytes Number of bytes to append
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, this includes errors
+ * of previously submitted chunk-writes.
+ */
+int
+xnvme_file_writer_append(struct xnvme_file_writer *writer, const void *buf, size_t nbytes);
+
+/**
+ * Write out all appended data and wait for the chunk-writes to complete
+ *
+ * With 'opts.direct', then a tail not aligned to the logical block size is written padded with
+ * the existing content of the file, or zeroes beyond its end. The padding is overwritten by
+ * following appends, and padding extending a regular file is removed when the writer is closed.
+ * Flushing does not make the data durable, for that, then follow it by xnvme_file_fdatasync().
+ *
+ * @param writer Pointer to the ::xnvme_file_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_writer_flush(struct xnvme_file_writer *writer);
+
+/**
+ * Flush and close the given stream-writer, the file-handle remains open
+ *
+ * @param writer Pointer to the ::xnvme_file_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_file_writer_close(struct xnvme_file_writer *writer);
+
 /**
  * Force a sync of the file or device encapsulated by 'fh'
  *
@@ -87,6 +317,100 @@ xnvme_file_pwrite(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offs
 int
 xnvme_file_sync(struct xnvme_dev *fh);
 
+/**
+ * Flags for xnvme_file_copy()
+ *
+ * @enum xnvme_file_copy_flags
+ */
+enum xnvme_file_copy_flags {
+	XNVME_FILE_COPY_NOOFFLOAD = 0x1, ///< Do not offload the copy to the kernel
+	XNVME_FILE_COPY_SYNC      = 0x2, ///< Read/write via the sync. interface, not a pipeline
+};
+
+/**
+ * Copy 'nbytes' from 'src' at 'src_offset' to 'dst' at 'dst_offset'
+ *
+ * When both file-handles are opened via the Linux backend, then the copy is offloaded to the
+ * kernel; as a reflink via FICLONE/FICLONERANGE when the file-system supports it, otherwise via
+ * copy_file_range(). Thus, avoiding moving the data through user-space. When offload is not
+ * available, or it fails, then the remainder is copied by pipelining reads from 'src' with writes
+ * to 'dst' using a queue of 'depth' on each, or, with ::XNVME_FILE_COPY_SYNC, then one chunk at
+ * a time via the sync. interface.
+ *
+ * Like cp, then the copy stops at end-of-file of 'src'.
+ *
+ * @param src File-handle to copy from
+ * @param src_offset Offset in bytes, in 'src', to copy from
+ * @param dst File-handle to copy to
+ * @param dst_offset Offset in bytes, in 'dst', to copy to
+ * @param nbytes The amount of bytes to copy
+ * @param depth Queue-depth of the read/write fallback, a power of 2 below 4096, 0 for the default
+ * @param chunk_nbytes Size of the reads and writes of the fallback, 0 for the default
+ * @param flags Bitmask of ::xnvme_file_copy_flags
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, -EINVAL when 'depth'
+ * is invalid.
+ */
+int
+xnvme_file_copy(struct xnvme_dev *src, off_t src_offset, struct xnvme_dev *dst, off_t dst_offset,
+		size_t nbytes, uint32_t depth, size_t chunk_nbytes, int flags);
+
+/**
+ * Callback of xnvme_file_read_range() and xnvme_file_write_range(), invoked with the 'nbytes' at
+ * 'offset' in 'buf'; a non-zero return value stops the range I/O, and is returned by it
+ */
+typedef int (*xnvme_file_range_cb)(void *buf, off_t offset, size_t nbytes, void *cb_arg);
+
+/**
+ * Read 'nbytes' at 'offset', using reads of 'io_nbytes' on an internal queue keeping up to 'depth'
+ * reads in flight, via the asynchronous interface of the file-handle
+ *
+ * When 'buf' is given, then the data is read into it, and 'cb', when given, is invoked as each
+ * read completes. Otherwise, the reads are done into internal buffers, and 'cb' is invoked with
+ * them, these are re-used when the callback returns. The callback is invoked in completion-order,
+ * which is not necessarily the order of the offsets. Reading stops at end-of-file, and 'cb' is
+ * invoked with the number of bytes actually read.
+ *
+ * @param fh File-handle as obtained by with ::xnvme_file_open
+ * @param offset Offset in bytes to start reading from
+ * @param nbytes The amount of bytes to read
+ * @param buf Buffer of at least 'nbytes', allocated with xnvme_buf_alloc(), or NULL
+ * @param cb Callback invoked with the data of each read, must be given when 'buf' is NULL
+ * @param cb_arg Argument passed to 'cb'
+ * @param io_nbytes Size of each read in bytes, 0 for the default
+ * @param depth Maximum number of reads in flight, a power of 2, 0 for the default
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, or the non-zero
+ * return-value of 'cb'.
+ */
+int
+xnvme_file_read_range(struct xnvme_dev *fh, off_t offset, size_t nbytes, void *buf,
+		      xnvme_file_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth);
+
+/**
+ * Write 'nbytes' at 'offset', using writes of 'io_nbytes' on an internal queue keeping up to
+ * 'depth' writes in flight, via the asynchronous interface of the file-handle
+ *
+ * When 'buf' is given, then the data is written from it, and 'cb', when given, is invoked before
+ * each write is submitted. Otherwise, the writes are done from internal buffers, and 'cb' is
+ * invoked to fill them, in the order of the offsets.
+ *
+ * @param fh File-handle as obtained by with ::xnvme_file_open
+ * @param offset Offset in bytes to start writing to
+ * @param nbytes The amount of bytes to write
+ * @param buf Buffer of at least 'nbytes', allocated with xnvme_buf_alloc(), or NULL
+ * @param cb Callback invoked to produce the data of each write, must be given when 'buf' is NULL
+ * @param cb_arg Argument passed to 'cb'
+ * @param io_nbytes Size of each write in bytes, 0 for the default
+ * @param depth Maximum number of writes in flight, a power of 2, 0 for the default
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, or the non-zero
+ * return-value of 'cb'.
+ */
+int
+xnvme_file_write_range(struct xnvme_dev *fh, off_t offset, size_t nbytes, const void *buf,
+		       xnvme_file_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth);
+
 /**
  * Returns a synchronous command-context for the given file-handle
  *
@@ -48,6 +48,44 @@ int
 xnvme_nvm_write(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t slba, uint16_t nlb,
 		const void *dbuf, const void *mbuf);
 
+/**
+ * Submit, and optionally wait for completion of, a Read of 'nlbas' LBAs; unlike xnvme_nvm_read(),
+ * 'nlbas' is not limited by the 16-bit NLB field of a single command. When 'nlbas' exceeds it,
+ * then the read is split into multiple commands, which requires the device to be opened with
+ * 'xnvme_opts.split', and the result of the completion is the sum of the results of the commands
+ *
+ * @param ctx Pointer to command context (::xnvme_cmd_ctx)
+ * @param nsid Namespace Identifier
+ * @param slba The LBA to start reading from
+ * @param nlbas The number of LBAs to read. NOTE: nlbas is NOT a zero-based value
+ * @param dbuf Pointer to data-payload
+ * @param mbuf Pointer to meta-payload
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, -EINVAL when 'nlbas'
+ * is 0, or exceeds a single command without 'xnvme_opts.split'.
+ */
+int
+xnvme_nvm_read_nlbas(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t slba, uint64_t nlbas,
+		     void *dbuf, void *mbuf);
+
+/**
+ * Submit, and optionally wait for completion of, a Write of 'nlbas' LBAs; see
+ * xnvme_nvm_read_nlbas()
+ *
+ * @param ctx Pointer to command context (::xnvme_cmd_ctx)
+ * @param nsid Namespace Identifier
+ * @param slba The LBA to start the write at
+ * @param nlbas The number of LBAs to write. NOTE: nlbas is NOT a zero-based value
+ * @param dbuf Pointer to buffer; Payload as indicated by 'ctx->opts'
+ * @param mbuf Pointer to buffer; Payload as indicated by 'ctx->opts'
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, -EINVAL when 'nlbas'
+ * is 0, or exceeds a single command without 'xnvme_opts.split'.
+ */
+int
+xnvme_nvm_write_nlbas(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t slba, uint64_t nlbas,
+		      const void *dbuf, const void *mbuf);
+
 /**
  * Submit a write uncorrected command
  *
@@ -111,6 +149,97 @@ xnvme_nvm_scopy(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t sdlba,
 		struct xnvme_spec_nvm_scopy_fmt_zero *ranges, uint8_t nr,
 		enum xnvme_nvm_scopy_fmt copy_fmt);
 
+/**
+ * Flags for xnvme_nvm_copy()
+ *
+ * @enum xnvme_nvm_copy_flags
+ */
+enum xnvme_nvm_copy_flags {
+	XNVME_NVM_COPY_NOOFFLOAD = 0x1, ///< Do not use Simple-Copy nor the kernel, only read/write
+};
+
+/**
+ * Copy the LBAs of the given source-ranges to the LBAs starting at 'sdlba', in order
+ *
+ * When the device supports the Simple-Copy-Command, then the copy is done using it; the ranges
+ * are split and batched into as few commands as the 'mssrl', 'msrc' and 'mcl' limits of the
+ * namespace allow. Otherwise, on files and block-devices opened via the Linux backend, then the
+ * copy is offloaded to the kernel via copy_file_range(). When neither is available, or they fail
+ * as not supported, then the remainder is copied by pipelining reads and writes using a queue of
+ * 'depth'; on zoned namespaces, then the writes are done one at a time.
+ *
+ * As with the Simple-Copy-Command, then the result of copying overlapping ranges is undefined.
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ * @param sdlba The Starting Destination LBA to start copying to
+ * @param ranges Array of source-ranges, the 'slba' and 'nlb' fields are used
+ * @param nranges Number of ranges in the given array, NOTE: not zero-based
+ * @param depth Queue-depth of the read/write emulation, a power of 2, 0 for the default
+ * @param flags Bitmask of ::xnvme_nvm_copy_flags
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_nvm_copy(struct xnvme_dev *dev, uint64_t sdlba,
+	       const struct xnvme_spec_nvm_scopy_fmt_zero *ranges, uint32_t nranges,
+	       uint32_t depth, int flags);
+
+/**
+ * Callback of xnvme_nvm_read_range() and xnvme_nvm_write_range(), invoked with the 'nlbas' LBAs
+ * starting at 'slba' in 'buf'; a non-zero return value stops the range I/O, and is returned by it
+ */
+typedef int (*xnvme_nvm_range_cb)(void *buf, uint64_t slba, uint32_t nlbas, void *cb_arg);
+
+/**
+ * Read the 'nlbas' LBAs starting at 'slba', using reads of 'io_nbytes' on an internal queue
+ * keeping up to 'depth' reads in flight, via the asynchronous interface of the device
+ *
+ * When 'buf' is given, then the LBAs are read into it, and 'cb', when given, is invoked as each
+ * read completes. Otherwise, the reads are done into internal buffers, and 'cb' is invoked with
+ * them, these are re-used when the callback returns. The callback is invoked in completion-order,
+ * which is not necessarily the order of the LBAs.
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ * @param slba The LBA to start reading from
+ * @param nlbas Number of LBAs to read, NOTE: not zero-based
+ * @param buf Buffer of at least 'nlbas' LBAs, allocated with xnvme_buf_alloc(), or NULL
+ * @param cb Callback invoked with the data of each read, must be given when 'buf' is NULL
+ * @param cb_arg Argument passed to 'cb'
+ * @param io_nbytes Size of each read in bytes, 0 for the default, limited by MDTS
+ * @param depth Maximum number of reads in flight, a power of 2, 0 for the default
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, or the non-zero
+ * return-value of 'cb'.
+ */
+int
+xnvme_nvm_read_range(struct xnvme_dev *dev, uint64_t slba, uint64_t nlbas, void *buf,
+		     xnvme_nvm_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth);
+
+/**
+ * Write the 'nlbas' LBAs starting at 'slba', using writes of 'io_nbytes' on an internal queue
+ * keeping up to 'depth' writes in flight, via the asynchronous interface of the device
+ *
+ * When 'buf' is given, then the LBAs are written from it, and 'cb', when given, is invoked before
+ * each write is submitted. Otherwise, the writes are done from internal buffers, and 'cb' is
+ * invoked to fill them, in the order of the LBAs. On zoned namespaces, then the writes are done
+ * one at a time.
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ * @param slba The LBA to start writing to
+ * @param nlbas Number of LBAs to write, NOTE: not zero-based
+ * @param buf Buffer of at least 'nlbas' LBAs, allocated with xnvme_buf_alloc(), or NULL
+ * @param cb Callback invoked to produce the data of each write, must be given when 'buf' is NULL
+ * @param cb_arg Argument passed to 'cb'
+ * @param io_nbytes Size of each write in bytes, 0 for the default, limited by MDTS
+ * @param depth Maximum number of writes in flight, a power of 2, 0 for the default
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, or the non-zero
+ * return-value of 'cb'.
+ */
+int
+xnvme_nvm_write_range(struct xnvme_dev *dev, uint64_t slba, uint64_t nlbas, const void *buf,
+		      xnvme_nvm_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth);
+
 /**
  * Deallocate or hint at read/write usage of a range.
  *
@@ -38,6 +38,7 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <libxnvme_util.h>
+#include <libxnvme_spec_fs.h>
 
 /**
  * NVMe PCIe BAR0 as-a-struct.
@@ -2464,6 +2465,7 @@ struct xnvme_spec_cmd {
 		struct xnvme_spec_nvm_write_zeroes write_zeroes;
 		struct xnvme_spec_znd_cmd znd;
 		struct xnvme_spec_io_mgmt_cmd mgmt;
+		struct xnvme_spec_fs_cmd fs;
 	};
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_spec_cmd) == 64, "Incorrect size")
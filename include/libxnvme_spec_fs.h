@@ -80,11 +80,40 @@ struct xnvme_spec_fs_idfy_ns {
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_spec_fs_idfy_ns) == 4096, "Incorrect size")
 
 enum xnvme_spec_fs_opcs {
-	XNVME_SPEC_FS_OPC_FLUSH = 0xAD,
-	XNVME_SPEC_FS_OPC_WRITE = 0xAC,
-	XNVME_SPEC_FS_OPC_READ  = 0xDC,
+	XNVME_SPEC_FS_OPC_FLUSH     = 0xAD,
+	XNVME_SPEC_FS_OPC_WRITE     = 0xAC,
+	XNVME_SPEC_FS_OPC_READ      = 0xDC,
+	XNVME_SPEC_FS_OPC_FDATASYNC = 0xAE, ///< Like FLUSH, but only the data and what is needed to read it
+	XNVME_SPEC_FS_OPC_FALLOCATE = 0xFA, ///< Allocate or de-allocate a range; see ::xnvme_spec_fs_cmd
+	XNVME_SPEC_FS_OPC_TRUNCATE  = 0xFB, ///< Set the size of the file to xnvme_spec_fs_cmd.offset
 };
 
+/**
+ * Modes of XNVME_SPEC_FS_OPC_FALLOCATE, these can be OR'ed together
+ *
+ * @enum xnvme_spec_fs_fallocate_mode
+ */
+enum xnvme_spec_fs_fallocate_mode {
+	XNVME_SPEC_FS_FALLOCATE_KEEP_SIZE  = 0x1, ///< Do not change the size of the file
+	XNVME_SPEC_FS_FALLOCATE_PUNCH_HOLE = 0x2, ///< De-allocate the range; implies KEEP_SIZE
+};
+
+/**
+ * Command accessor for the ::xnvme_spec_fs_opcs which take a byte-range
+ *
+ * @struct xnvme_spec_fs_cmd
+ */
+struct xnvme_spec_fs_cmd {
+	uint32_t cdw00_09[10]; ///< Command dword 0 to 9
+
+	uint64_t offset; ///< Offset in bytes; the same as xnvme_spec_cmd_nvm.slba
+	uint64_t nbytes; ///< Length of the range in bytes
+	uint32_t mode;   ///< For XNVME_SPEC_FS_OPC_FALLOCATE; see ::xnvme_spec_fs_fallocate_mode
+
+	uint32_t cdw15; ///< Command dword 15
+};
+XNVME_STATIC_ASSERT(sizeof(struct xnvme_spec_fs_cmd) == 64, "Incorrect size")
+
 #define XNVME_SPEC_CSI_FS 0x1F
 
 #endif /* __LIBXNVME_SPEC_FS_H */
@@ -182,6 +182,19 @@ XNVME_MAX(int x, int y)
 	return x > y ? x : y;
 }
 
+/**
+ * Calculate the maximum of the given `x` and `y`
+ *
+ * @param x
+ * @param y
+ * @return The maximum of `x` and `y`
+ */
+static inline int64_t
+XNVME_MAX_S64(int64_t x, int64_t y)
+{
+	return x > y ? x : y;
+}
+
 static inline uint64_t
 _xnvme_timer_clock_sample(void)
 {
@@ -146,6 +146,29 @@ xnvme_znd_mgmt_send(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t zslba, bo
 		    enum xnvme_spec_znd_cmd_mgmt_send_action action,
 		    enum xnvme_spec_znd_mgmt_send_action_so action_so, void *dbuf);
 
+/**
+ * Submit a Zone Management Send with the given 'action' for each of the zones in 'zslbas'
+ *
+ * The commands are submitted concurrently, with up to 'qdepth' in flight, on a queue of the given
+ * device; when the asynchronous interface cannot do Zone Management Send, e.g. "io_uring" or
+ * "libaio", then the commands are submitted one at a time via the synchronous interface.
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ * @param zslbas Array of the Start LBAs of the zones to manage
+ * @param nzones Number of entries in 'zslbas'
+ * @param action The ::xnvme_spec_znd_cmd_mgmt_send_action to perform on each zone
+ * @param qdepth Maximum number of commands in flight; must be a power of 2
+ * @param done Optional bitmap of at least ceil('nzones' / 8) bytes, bit 'i' is set when the
+ * command on 'zslbas[i]' completed successfully
+ *
+ * @return On success, 0 is returned. On error, negative `errno` of the first failure is returned,
+ * and 'done' tells which of the zones were managed.
+ */
+int
+xnvme_znd_mgmt_send_range(struct xnvme_dev *dev, const uint64_t *zslbas, uint64_t nzones,
+			  enum xnvme_spec_znd_cmd_mgmt_send_action action, uint32_t qdepth,
+			  uint8_t *done);
+
 /**
  * Submit, and optionally wait for completion of, a Zone Append
  *
@@ -272,6 +295,46 @@ xnvme_znd_report_pr(const struct xnvme_znd_report *report, int flags);
 struct xnvme_znd_report *
 xnvme_znd_report_from_dev(struct xnvme_dev *dev, uint64_t slba, size_t limit, uint8_t extended);
 
+/**
+ * Enable the zone-state cache of the given device, populated via a Zone Report
+ *
+ * When enabled, then the library updates the cached zone-descriptors on the completion of writes,
+ * appends and Zone Management Send commands submitted via the given device, and
+ * xnvme_znd_descr_from_dev(), xnvme_znd_descr_from_dev_in_state() and non-extended
+ * xnvme_znd_report_from_dev() are served from the cache instead of the device. Zones with a ZRWA,
+ * and zones of failed commands, are re-fetched from the device on the next lookup. Changes made
+ * by other hosts, or via other device handles, are picked up via xnvme_znd_cache_sync().
+ *
+ * The cache is enabled and disabled per handle, without synchronization with threads using the
+ * handle, thus, it is refused on handles from xnvme_dev_open_shared().
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, -EINVAL when the
+ * device is not zoned, or the handle is obtained with xnvme_dev_open_shared().
+ */
+int
+xnvme_znd_cache_enable(struct xnvme_dev *dev);
+
+/**
+ * Disable, and free, the zone-state cache of the given device; this is done by xnvme_dev_close()
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ */
+void
+xnvme_znd_cache_disable(struct xnvme_dev *dev);
+
+/**
+ * Re-fetch the zones listed in the Changed Zone List log of the given device, or all zones when
+ * the log is unavailable or has overflowed
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_cache_sync(struct xnvme_dev *dev);
+
 /**
  * Scan the 'report' for a zone in the given 'state' and store it in 'zlba'
  *
@@ -287,6 +350,402 @@ int
 xnvme_znd_report_find_arbitrary(const struct xnvme_znd_report *report,
 				enum xnvme_spec_znd_state state, uint64_t *zlba, int opts);
 
+/**
+ * Opaque handle of a zone write scheduler, see xnvme_znd_writer_open()
+ *
+ * @struct xnvme_znd_writer
+ */
+struct xnvme_znd_writer;
+
+/**
+ * Options for xnvme_znd_writer_open()
+ *
+ * @enum xnvme_znd_writer_flags
+ */
+enum xnvme_znd_writer_flags {
+	XNVME_ZND_WRITER_ZRWA = 0x1, ///< Open zones with a ZRWA and fill its window
+};
+
+/**
+ * Open a zone write scheduler over the empty zones in [slba, slba + nzones * zsze)
+ *
+ * Writes are assigned, in round-robin, to up to 'nactive' open zones, at the write pointer, thus
+ * the LBA of a write is known when it is submitted. Each zone has its writes queued in LBA order
+ * and dispatched with one write in flight per zone, or, with ::XNVME_ZND_WRITER_ZRWA, as many as
+ * fit in the ZRWA window, which is committed by explicit flushes as the writes complete. When a
+ * zone cannot fit a write, then it is finished once drained and replaced by the next empty zone.
+ *
+ * 'nactive' is bounded by the maximum open, active and ZRWA resources of the namespace, and by
+ * 'depth', the maximum number of writes queued or in flight.
+ *
+ * @note The writer is not thread-safe, and the zones must not be written by other means while the
+ * writer is open
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ * @param slba LBA of the first zone the writer may use
+ * @param nzones Number of zones the writer may use, when 0 then all zones from 'slba'
+ * @param nactive Number of zones to write in parallel
+ * @param depth Maximum number of writes queued or in flight; must be a power of 2
+ * @param flags Bitmask of ::xnvme_znd_writer_flags
+ * @param writer Pointer-pointer to the ::xnvme_znd_writer to initialize
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_writer_open(struct xnvme_dev *dev, uint64_t slba, uint64_t nzones, uint32_t nactive,
+		      uint32_t depth, int flags, struct xnvme_znd_writer **writer);
+
+/**
+ * Write 'nlb' + 1 LBAs from 'dbuf' to the next zone with room for it
+ *
+ * When 'depth' writes are queued or in flight, then this waits for one of them to complete. On
+ * completion, then 'cb' is invoked, if given, with the command-context of the write; the writer
+ * returns the command-context to its queue, thus 'cb' must not.
+ *
+ * @param writer Pointer to the ::xnvme_znd_writer
+ * @param dbuf Pointer to the data to write, it must remain valid until 'cb' is invoked
+ * @param nlb Zero-based number of LBAs to write
+ * @param slba Pointer to store the LBA assigned to the write; optional
+ * @param cb Callback invoked on completion; optional
+ * @param cb_arg Argument passed to 'cb'
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned; -ENOSPC when no zone
+ * has room for the write, or the first error of a previously completed command.
+ */
+int
+xnvme_znd_writer_write(struct xnvme_znd_writer *writer, const void *dbuf, uint16_t nlb,
+		       uint64_t *slba, xnvme_queue_cb cb, void *cb_arg);
+
+/**
+ * Process completions of the writer, without waiting for them
+ *
+ * @param writer Pointer to the ::xnvme_znd_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_writer_poke(struct xnvme_znd_writer *writer);
+
+/**
+ * Wait for all writes of the writer, and their zone finishes and ZRWA flushes, to complete
+ *
+ * With ZRWA, then LBAs beyond the last multiple of the flush granularity remain in the ZRWA of a
+ * zone which is not yet full.
+ *
+ * @param writer Pointer to the ::xnvme_znd_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_writer_drain(struct xnvme_znd_writer *writer);
+
+/**
+ * Drain and close the given writer; its zones which are not full remain open
+ *
+ * @param writer Pointer to the ::xnvme_znd_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_writer_close(struct xnvme_znd_writer *writer);
+
+/**
+ * Opaque handle of a ZRWA writer, see xnvme_znd_zrwa_writer_open()
+ *
+ * @struct xnvme_znd_zrwa_writer
+ */
+struct xnvme_znd_zrwa_writer;
+
+/**
+ * Options for xnvme_znd_zrwa_writer_open()
+ *
+ * @enum xnvme_znd_zrwa_writer_flags
+ */
+enum xnvme_znd_zrwa_writer_flags {
+	XNVME_ZND_ZRWA_WRITER_IMPLICIT = 0x1, ///< Advance the window by implicit flushes only
+};
+
+/**
+ * Open a writer of LBAs, in any order, within the Zone Random Write Area (ZRWA) of a zone
+ *
+ * The zone at 'zslba' is opened with a ZRWA when it is empty, or used as is when it already has
+ * one. Writes, and re-writes, to LBAs within the window of 'zrwas' LBAs from the write pointer of
+ * the zone are submitted right away, in the order given, with up to 'depth' in flight. The writer
+ * tracks the contiguous prefix of completed writes from the write pointer, and a write beyond the
+ * window waits until the prefix covers the LBAs which must be committed to make room for it. The
+ * window is then advanced, by the least multiple of the flush granularity, via an explicit ZRWA
+ * flush, or, with ::XNVME_ZND_ZRWA_WRITER_IMPLICIT, by submitting the write into the implicit
+ * flush region. Thus, LBAs remain in the ZRWA, open for updates, for as long as possible.
+ *
+ * @note The writer is not thread-safe, and the zone must not be written by other means while the
+ * writer is open
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ * @param zslba Start LBA of the zone to write
+ * @param depth Maximum number of writes in flight; must be a power of 2
+ * @param flags Bitmask of ::xnvme_znd_zrwa_writer_flags
+ * @param writer Pointer-pointer to the ::xnvme_znd_zrwa_writer to initialize
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_zrwa_writer_open(struct xnvme_dev *dev, uint64_t zslba, uint32_t depth, int flags,
+			   struct xnvme_znd_zrwa_writer **writer);
+
+/**
+ * Write 'nlb' + 1 LBAs from 'dbuf' to 'slba' within the zone of the writer
+ *
+ * When 'depth' writes are in flight, or the write is beyond the window, then this waits for
+ * completions. On completion, then 'cb' is invoked, if given, with the command-context of the
+ * write; the writer returns the command-context to its queue, thus 'cb' must not.
+ *
+ * @param writer Pointer to the ::xnvme_znd_zrwa_writer
+ * @param slba The first LBA to write; it must not be below the write pointer of the zone
+ * @param nlb Zero-based number of LBAs to write; at most the size of the ZRWA
+ * @param dbuf Pointer to the data to write, it must remain valid until 'cb' is invoked
+ * @param cb Callback invoked on completion; optional
+ * @param cb_arg Argument passed to 'cb'
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned; -EINVAL when the
+ * LBAs are committed or outside the zone, -EAGAIN when the write is beyond the window and the LBAs
+ * below it are not written, or the first error of a previously completed command.
+ */
+int
+xnvme_znd_zrwa_writer_write(struct xnvme_znd_zrwa_writer *writer, uint64_t slba, uint16_t nlb,
+			    const void *dbuf, xnvme_queue_cb cb, void *cb_arg);
+
+/**
+ * Process completions of the writer, without waiting for them
+ *
+ * @param writer Pointer to the ::xnvme_znd_zrwa_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_zrwa_writer_poke(struct xnvme_znd_zrwa_writer *writer);
+
+/**
+ * Wait for all writes, and ZRWA flushes, of the writer to complete
+ *
+ * @param writer Pointer to the ::xnvme_znd_zrwa_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_zrwa_writer_drain(struct xnvme_znd_zrwa_writer *writer);
+
+/**
+ * Drain the writer and commit the contiguous prefix of written LBAs via an explicit ZRWA flush
+ *
+ * The prefix is committed in multiples of the flush granularity, or in full when it reaches the
+ * end of the zone.
+ *
+ * @param writer Pointer to the ::xnvme_znd_zrwa_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned; -ENOTSUP when the
+ * namespace does not support explicit ZRWA flush.
+ */
+int
+xnvme_znd_zrwa_writer_commit(struct xnvme_znd_zrwa_writer *writer);
+
+/**
+ * Returns the write pointer of the zone of the writer, that is, the LBAs below it are committed
+ *
+ * @param writer Pointer to the ::xnvme_znd_zrwa_writer
+ *
+ * @return The write pointer of the zone
+ */
+uint64_t
+xnvme_znd_zrwa_writer_get_wp(const struct xnvme_znd_zrwa_writer *writer);
+
+/**
+ * Drain and close the given writer; the uncommitted LBAs remain in the ZRWA of the zone
+ *
+ * @param writer Pointer to the ::xnvme_znd_zrwa_writer
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_zrwa_writer_close(struct xnvme_znd_zrwa_writer *writer);
+
+/**
+ * Opaque handle of an append-only log over zones, see xnvme_znd_log_open()
+ *
+ * @struct xnvme_znd_log
+ */
+struct xnvme_znd_log;
+
+/**
+ * Callback invoked by xnvme_znd_log_append() when the number of empty zones of the log is below
+ * the watermark given by ::xnvme_znd_log_opts, e.g. to reclaim zones via xnvme_znd_log_victim()
+ * and xnvme_znd_log_reclaim()
+ */
+typedef int (*xnvme_znd_log_reclaim_cb)(struct xnvme_znd_log *log, void *cb_arg);
+
+/**
+ * Options for xnvme_znd_log_open()
+ *
+ * @struct xnvme_znd_log_opts
+ */
+struct xnvme_znd_log_opts {
+	uint64_t slba;   ///< LBA of the first zone of the log
+	uint64_t nzones; ///< Number of zones of the log, when 0 then all zones from 'slba'
+
+	uint32_t nactive; ///< Number of zones appended to in parallel
+	uint32_t depth;   ///< Maximum number of appends in flight; must be a power of 2
+
+	xnvme_znd_log_reclaim_cb reclaim; ///< Reclamation callback; optional
+	void *reclaim_arg;                ///< Argument passed to 'reclaim'
+	uint64_t reclaim_nfree;           ///< Invoke 'reclaim' when fewer zones are empty
+};
+
+/**
+ * Open an append-only log of keyed records over the zones given by 'opts'
+ *
+ * Records are framed with a header, carrying the key, a sequence number and a CRC32C of the
+ * record, and appended, via Zone Append, to up to 'nactive' zones in parallel. An in-memory index
+ * maps each key to the location of its latest record. It is built at open, by scanning the
+ * written zones of the log concurrently; the scan of a zone stops at the first record which is
+ * not intact, e.g. torn by a crash, and such a zone is not appended to again.
+ *
+ * @note The log is not thread-safe, and the zones must not be written by other means while the
+ * log is open
+ *
+ * @param dev Device handle obtained with xnvme_dev_open()
+ * @param opts Pointer to ::xnvme_znd_log_opts
+ * @param log Pointer-pointer to the ::xnvme_znd_log to initialize
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_log_open(struct xnvme_dev *dev, const struct xnvme_znd_log_opts *opts,
+		   struct xnvme_znd_log **log);
+
+/**
+ * Append a record of 'nbytes' from 'buf' with the given 'key'
+ *
+ * The record is copied, thus 'buf' can be re-used on return. The index is updated when the append
+ * completes, e.g. via xnvme_znd_log_drain(); until then, then lookups return the previous record
+ * of the key, if any.
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ * @param key The key of the record
+ * @param buf Pointer to the payload of the record
+ * @param nbytes Size of the payload, at most xnvme_znd_log_get_nbytes_max()
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned; -ENOSPC when no zone
+ * has room for the record, or the first error of a previously completed append.
+ */
+int
+xnvme_znd_log_append(struct xnvme_znd_log *log, uint64_t key, const void *buf, uint32_t nbytes);
+
+/**
+ * Delete the given 'key', by appending a tombstone record for it
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ * @param key The key to delete
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_log_delete(struct xnvme_znd_log *log, uint64_t key);
+
+/**
+ * Wait for all appends of the log to complete
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_log_drain(struct xnvme_znd_log *log);
+
+/**
+ * Lookup the location of the latest record of the given 'key'
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ * @param key The key to lookup
+ * @param lba Pointer to store the first LBA of the record; optional
+ * @param nlbas Pointer to store the number of LBAs of the record; optional
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned; -ENOENT when the key
+ * is not in the log.
+ */
+int
+xnvme_znd_log_lookup(struct xnvme_znd_log *log, uint64_t key, uint64_t *lba, uint32_t *nlbas);
+
+/**
+ * Read the payload of the latest record of the given 'key' into 'buf'
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ * @param key The key to read
+ * @param buf Pointer to the buffer to read into
+ * @param buf_nbytes Size of 'buf', when smaller than the payload, then it is truncated
+ * @param nbytes Pointer to store the size of the payload; optional
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned; -ENOENT when the key
+ * is not in the log, -EIO when the record is not intact.
+ */
+int
+xnvme_znd_log_read(struct xnvme_znd_log *log, uint64_t key, void *buf, uint32_t buf_nbytes,
+		   uint32_t *nbytes);
+
+/**
+ * Returns the maximum size, in bytes, of the payload of a record
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ *
+ * @return The maximum size of the payload of a record
+ */
+uint32_t
+xnvme_znd_log_get_nbytes_max(const struct xnvme_znd_log *log);
+
+/**
+ * Returns the number of empty zones of the log
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ *
+ * @return The number of empty zones
+ */
+uint64_t
+xnvme_znd_log_get_nfree(const struct xnvme_znd_log *log);
+
+/**
+ * Find the zone, no longer appended to, with the fewest LBAs of live records
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ * @param zslba Pointer to store the start LBA of the zone
+ * @param nlive Pointer to store the number of LBAs of live records in the zone; optional
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned; -ENOENT when no zone
+ * can be reclaimed.
+ */
+int
+xnvme_znd_log_victim(struct xnvme_znd_log *log, uint64_t *zslba, uint64_t *nlive);
+
+/**
+ * Reclaim the zone at 'zslba', by re-appending its live records to other zones and resetting it
+ *
+ * Tombstones are re-appended as well, unless no zone holds records older than them.
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ * @param zslba Start LBA of a zone which is no longer appended to
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_log_reclaim(struct xnvme_znd_log *log, uint64_t zslba);
+
+/**
+ * Drain and close the given log; its zones which are not full remain open
+ *
+ * @param log Pointer to the ::xnvme_znd_log
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_log_close(struct xnvme_znd_log *log);
+
 #ifdef __cplusplus
 }
 #endif
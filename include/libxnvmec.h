@@ -156,6 +156,7 @@ struct xnvmec_args {
 	uint32_t nlb;
 	uint64_t slba;
 	uint64_t elba;
+	uint64_t nzones;
 
 	uint32_t uuid;
 	uint32_t nsid;
@@ -231,6 +232,9 @@ struct xnvmec_args {
 	uint32_t poll_sq;
 	uint32_t register_files;
 	uint32_t register_buffers;
+	uint32_t split;
+	uint32_t enum_sysfs;
+	uint32_t async_helper;
 
 	uint32_t truncate;
 	uint32_t rdonly;
@@ -255,6 +259,8 @@ struct xnvmec_args {
 	uint32_t nsr;
 	uint32_t lsi;
 	uint32_t pid;
+
+	uint32_t offload;
 };
 
 void
@@ -410,7 +416,13 @@ enum xnvmec_opt {
 
 	XNVMEC_OPT_LSI = 112, ///< XNVMEC_OPT_LSI
 	XNVMEC_OPT_PID = 113, ///< XNVMEC_OPT_PID
-	XNVMEC_OPT_END = 114, ///< XNVMEC_OPT_END
+
+	XNVMEC_OPT_NZONES       = 114, ///< XNVMEC_OPT_NZONES
+	XNVMEC_OPT_SPLIT        = 115, ///< XNVMEC_OPT_SPLIT
+	XNVMEC_OPT_ENUM_SYSFS   = 116, ///< XNVMEC_OPT_ENUM_SYSFS
+	XNVMEC_OPT_ASYNC_HELPER = 117, ///< XNVMEC_OPT_ASYNC_HELPER
+	XNVMEC_OPT_OFFLOAD      = 118, ///< XNVMEC_OPT_OFFLOAD
+	XNVMEC_OPT_END          = 119, ///< XNVMEC_OPT_END
 };
 
 /**
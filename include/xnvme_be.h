@@ -52,6 +52,65 @@ struct xnvme_be_async {
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_be_async) == XNVME_BE_ASYNC_NBYTES, "Incorrect size")
 
+/**
+ * Dispatch of the async. io path; with the 'async_pinned' build-option, then the async. interface
+ * is fixed at compile-time and these are direct calls, which can be inlined with LTO, otherwise
+ * they are indirect calls via the async. mixin of the device
+ */
+#ifdef XNVME_BE_ASYNC_PINNED_ENABLED
+#define XNVME_BE_ASYNC_CMD_IO(dev, ...)  xnvme_be_async_pinned_cmd_io(__VA_ARGS__)
+#define XNVME_BE_ASYNC_CMD_IOV(dev, ...) xnvme_be_async_pinned_cmd_iov(__VA_ARGS__)
+#define XNVME_BE_ASYNC_POKE(dev, ...)    xnvme_be_async_pinned_poke(__VA_ARGS__)
+#else
+#define XNVME_BE_ASYNC_CMD_IO(dev, ...)  (dev)->be.async.cmd_io(__VA_ARGS__)
+#define XNVME_BE_ASYNC_CMD_IOV(dev, ...) (dev)->be.async.cmd_iov(__VA_ARGS__)
+#define XNVME_BE_ASYNC_POKE(dev, ...)    (dev)->be.async.poke(__VA_ARGS__)
+#endif
+
+/**
+ * Define the pinned async. interface, that is, the mixin and its io path; this is used by the
+ * async. interface selected via the 'async_pinned' build-option
+ */
+#define XNVME_BE_ASYNC_PINNED_DEFINE(mixin, cmd_io, cmd_iov, poke)                              \
+	struct xnvme_be_async *const xnvme_be_async_pinned = &mixin;                            \
+                                                                                                \
+	int                                                                                     \
+	xnvme_be_async_pinned_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, \
+				     void *mbuf, size_t mbuf_nbytes)                            \
+	{                                                                                       \
+		return cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);                       \
+	}                                                                                       \
+                                                                                                \
+	int                                                                                     \
+	xnvme_be_async_pinned_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec,            \
+				      size_t dvec_cnt, size_t dvec_nbytes, struct iovec *mvec,  \
+				      size_t mvec_cnt, size_t mvec_nbytes)                      \
+	{                                                                                       \
+		return cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mvec, mvec_cnt, mvec_nbytes);  \
+	}                                                                                       \
+                                                                                                \
+	int                                                                                     \
+	xnvme_be_async_pinned_poke(struct xnvme_queue *queue, uint32_t max)                     \
+	{                                                                                       \
+		return poke(queue, max);                                                        \
+	}
+
+#ifdef XNVME_BE_ASYNC_PINNED_ENABLED
+extern struct xnvme_be_async *const xnvme_be_async_pinned;
+
+int
+xnvme_be_async_pinned_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			     size_t mbuf_nbytes);
+
+int
+xnvme_be_async_pinned_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+			      size_t dvec_nbytes, struct iovec *mvec, size_t mvec_cnt,
+			      size_t mvec_nbytes);
+
+int
+xnvme_be_async_pinned_poke(struct xnvme_queue *queue, uint32_t max);
+#endif
+
 struct xnvme_be_sync {
 	/**
 	 * Pass a NVMe I/O Command Through to the device with minimal driver
@@ -213,6 +272,14 @@ xnvme_be_id2name(int bid);
 int
 xnvme_be_name2id(const char *bname);
 
+/**
+ * Set up the mixins of the given backend, matching the mixins named in 'opts' when given
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_be_setup_mixins(struct xnvme_be *be, struct xnvme_opts *opts);
+
 /**
  * Instantiate a backend instance for the given device
  */
@@ -234,6 +301,23 @@ xnvme_be_dev_derive_geometry(struct xnvme_dev *dev);
 int
 xnvme_be_dev_idfy(struct xnvme_dev *dev);
 
+/**
+ * Identify controller and namespace, deferring the command-set specific identify until first
+ * use, via xnvme_be_dev_idfy_css(); for backends which know the command-set of the namespace to
+ * be NVM, e.g. via the OS, thus sparing the open of the identify-commands probing it
+ */
+int
+xnvme_be_dev_idfy_defer(struct xnvme_dev *dev);
+
+/**
+ * Do the command-set specific identify, when deferred by xnvme_be_dev_idfy_defer(), at most once
+ * per device; this is a no-op when it is already done. On failure, then it is retried on next use
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_be_dev_idfy_css(struct xnvme_dev *dev);
+
 int
 xnvme_ident_yaml(FILE *stream, const struct xnvme_ident *ident, int indent, const char *sep,
 		 int head);
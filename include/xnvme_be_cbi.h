@@ -5,7 +5,9 @@
 struct xnvme_be_cbi_state {
 	int fd;
 
-	uint8_t _rsvd[124];
+	uint8_t _rsvd[120];
+
+	uint32_t dio_align; ///< Alignment required by O_DIRECT, 0 when the fd is not O_DIRECT
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_be_cbi_state) == XNVME_BE_STATE_NBYTES, "Incorrect size");
 
@@ -26,4 +28,65 @@ xnvme_be_cbi_sync_psync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, s
 				size_t dvec_nbytes, struct iovec *mvec, size_t mvec_cnt,
 				size_t mvec_nbytes);
 
+/**
+ * Queue-pair of the thread-pool, the threads execute the commands via the sync. interface of the
+ * device of the command; used by the thrpool async. interface, and by the helper of a queue, see
+ * xnvme_queue_helper_pass()
+ */
+struct xnvme_be_cbi_async_thrpool_qp;
+
+/**
+ * Allocate a queue-pair of 'capacity' entries, and start 'nthreads' threads processing it
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_be_cbi_async_thrpool_qp_init(struct xnvme_be_cbi_async_thrpool_qp **qp,
+				   struct xnvme_dev *dev, uint32_t capacity, int nthreads);
+
+/**
+ * Stop the threads and free the queue-pair; commands not yet completed are dropped
+ */
+void
+xnvme_be_cbi_async_thrpool_qp_term(struct xnvme_be_cbi_async_thrpool_qp *qp);
+
+/**
+ * Submit the given command to the threads; besides the queue-pair itself, the command is accounted
+ * on the counter 'outstanding', e.g. that of the queue of the command, unless it is NULL
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned, -EBUSY when all
+ * entries of the queue-pair are in use.
+ */
+int
+xnvme_be_cbi_async_thrpool_qp_submit(struct xnvme_be_cbi_async_thrpool_qp *qp,
+				     struct xnvme_cmd_ctx *ctx, void *data, size_t data_vec_cnt,
+				     size_t data_nbytes, void *meta, size_t meta_vec_cnt,
+				     size_t meta_nbytes, bool is_vectored, uint32_t *outstanding);
+
+/**
+ * Invoke the callbacks of at most 'max' completed commands, all when 'max' is 0, and decrement
+ * the counter given at submission, 'outstanding', for each of them
+ *
+ * @return On success, the number of completed commands is returned. On error, negative `errno`
+ * is returned.
+ */
+int
+xnvme_be_cbi_async_thrpool_qp_reap(struct xnvme_be_cbi_async_thrpool_qp *qp, uint32_t max,
+				   uint32_t *outstanding);
+
+/**
+ * Block until a command of the queue-pair has completed, that is, until it can be reaped, or
+ * return right away when nothing is outstanding
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_be_cbi_async_thrpool_qp_wait(struct xnvme_be_cbi_async_thrpool_qp *qp);
+
+/**
+ * Returns the number of commands submitted to the queue-pair and not yet reaped
+ */
+uint32_t
+xnvme_be_cbi_async_thrpool_qp_outstanding(struct xnvme_be_cbi_async_thrpool_qp *qp);
+
 #endif /* __INTERNAL_XNVME_BE_CBI_H */
@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: Apache-2.0
 #ifndef __INTERNAL_XNVME_BE_LINUX_H
 #define __INTERNAL_XNVME_BE_LINUX_H
+#include <pthread.h>
+#include <sys/stat.h>
 #include <xnvme_dev.h>
 
 #ifndef LINUX_BLOCK_SSW
@@ -14,6 +16,8 @@
 #define XNVME_LINUX_CTRLR_FMT _PATH_DEV "nvme%1u"
 #define XNVME_LINUX_NS_FMT    _PATH_DEV "nvme%1un%1u"
 
+struct xnvme_be_linux_block_zappend;
+
 /**
  * Internal representation of XNVME_BE_LINUX state
  *
@@ -26,7 +30,13 @@ struct xnvme_be_linux_state {
 	uint8_t poll_io;
 	uint8_t poll_sq;
 
-	uint8_t _rsvd[121];
+	uint8_t _rsvd[105];
+
+	struct xnvme_be_linux_block_zappend *zappend; ///< Zone Append emulation of zoned block dev.
+
+	uint8_t _rsvd2[4];
+
+	uint32_t dio_align; ///< Alignment required by O_DIRECT, 0 when the fd is not O_DIRECT
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_be_linux_state) == XNVME_BE_STATE_NBYTES, "Incorrect size")
 
@@ -55,6 +65,79 @@ xnvme_be_linux_sysfs_dev_attr_to_num(struct xnvme_dev *dev, const char *attr, ui
 int
 xnvme_be_linux_uapi_ver_fpr(FILE *stream, enum xnvme_pr opts);
 
+/**
+ * Free the state of the Zone Append emulation of a zoned block device
+ */
+void
+xnvme_be_linux_block_zappend_term(struct xnvme_be_linux_state *state);
+
+/**
+ * Returns the NUMA node of the device described by 'dev_stat', that is, the node of the PCIe
+ * function behind a block/char device, or behind the block-device a regular file resides on
+ *
+ * @return On success, the NUMA node is returned. When it cannot be determined, -1 is returned.
+ */
+int
+xnvme_be_linux_numa_node(const struct stat *dev_stat);
+
+/**
+ * Set the memory-policy of the pages entirely covered by [addr, addr + nbytes) to prefer 'node'
+ *
+ * @return On success, 0 is returned. On error, negative errno is returned.
+ */
+int
+xnvme_be_linux_numa_mbind(void *addr, size_t nbytes, int node);
+
+/**
+ * Returns the first CPU local to the given NUMA 'node'
+ *
+ * @return On success, the CPU is returned. On error, negative errno is returned.
+ */
+int
+xnvme_be_linux_numa_cpu(int node);
+
+/**
+ * Set the CPU-affinity of 'thread' to the CPUs local to the given NUMA 'node'
+ *
+ * @return On success, 0 is returned. On error, negative errno is returned.
+ */
+int
+xnvme_be_linux_numa_bind_thread(pthread_t thread, int node);
+
+/**
+ * Copy 'nbytes' from 'src' to 'dst' by sharing extents via FICLONE/FICLONERANGE, when the
+ * file-system supports it, otherwise via copy_file_range(), that is, without passing the data
+ * through user space. The copy stops at end-of-file of 'src'.
+ *
+ * @return On success, 0 is returned. On error, negative errno is returned, and 'ncopied' is the
+ * number of bytes copied before the error e.g. when the files are on different file-systems.
+ */
+int
+xnvme_be_linux_file_copy(struct xnvme_dev *src, off_t src_offset, struct xnvme_dev *dst,
+			 off_t dst_offset, size_t nbytes, size_t *ncopied);
+
+/**
+ * Open the given paths as lightweight file-handles; with io_uring, when available, then the
+ * open() and statx() of all paths are submitted as a batch. Paths which are not regular files, or
+ * fail to open, are opened via xnvme_file_open().
+ *
+ * @return On success, 0 is returned. On error, negative errno of the first failing path is
+ * returned, and the error of each path is returned in 'errs' when given.
+ */
+int
+xnvme_be_linux_file_open_batch(const char **pathnames, uint32_t npaths, struct xnvme_opts *opts,
+			       struct xnvme_dev **fhs, int *errs);
+
+/**
+ * Close the given file-handles; with io_uring, when available, then the close() of all the
+ * file-descriptors are submitted as a batch
+ *
+ * @return On success, 0 is returned. On error, negative errno of the first failing close is
+ * returned.
+ */
+int
+xnvme_be_linux_file_close_batch(struct xnvme_dev **fhs, uint32_t nfhs);
+
 /**
  * Implementations of the memory management interface using hugepages
  */
@@ -20,9 +20,24 @@ struct xnvme_queue_liburing {
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_liburing) == XNVME_BE_QUEUE_STATE_NBYTES,
 		    "Incorrect size")
 
+/**
+ * Check whether the Kernel supports the io_uring opcodes used by the io_uring async. interface;
+ * the probe is done once per process
+ *
+ * @return 1 when supported, 0 otherwise
+ */
 int
 xnvme_be_linux_liburing_check_support(void);
 
+/**
+ * Check whether the Kernel supports the io_uring passthru command used by the io_uring_cmd async.
+ * interface; the probe is done once per process
+ *
+ * @return 1 when supported, 0 otherwise
+ */
+int
+xnvme_be_linux_ucmd_check_support(void);
+
 int
 xnvme_be_linux_liburing_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
 			       void *mbuf, size_t mbuf_nbytes);
@@ -3,6 +3,8 @@
 #ifndef __INTERNAL_XNVME_CMD_H
 #define __INTERNAL_XNVME_CMD_H
 
+#include <libxnvme.h>
+
 /**
  * Enumeration of `xnvme_cmd` options
  *
@@ -23,4 +25,45 @@ enum xnvme_cmd_opts {
 #define XNVME_CMD_DEF_IOMD XNVME_CMD_SYNC
 #define XNVME_CMD_DEF_UPLD (0x0)
 
+/**
+ * Determine whether the given command must be split, that is, a read or write exceeding the MDTS
+ * of the device; only called when splitting is enabled via 'xnvme_opts.split'
+ *
+ * @return The number of LBAs of the command when it must be split, 0 otherwise
+ */
+uint64_t
+xnvme_cmd_split_nlbas(struct xnvme_cmd_ctx *ctx);
+
+/**
+ * Pass the 'nlbas' LBAs of the command as multiple commands each within MDTS; 'nlbas' is given
+ * explicitly, since it can exceed what the NLB field of the command can hold
+ *
+ * For synchronous commands, then the commands are passed one after the other, stopping at the
+ * first failure. For asynchronous commands, then the commands are submitted as the queue has room
+ * for them, any remaining are submitted by xnvme_queue_poke(), and the callback of 'ctx' is
+ * invoked once all of them have completed. The status of the completion is that of the first
+ * failed command, otherwise the last, and the result is the sum of the results of the commands.
+ */
+int
+xnvme_cmd_split_pass(struct xnvme_cmd_ctx *ctx, void *dbuf, void *mbuf, uint64_t nlbas);
+
+/**
+ * Vectored version of xnvme_cmd_split_pass()
+ */
+int
+xnvme_cmd_split_passv(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+		      struct iovec *mvec, size_t mvec_cnt, uint64_t nlbas);
+
+/**
+ * Submit remaining commands of splits on the given queue, and complete those which are done
+ */
+void
+xnvme_cmd_split_resume(struct xnvme_queue *queue);
+
+/**
+ * Release the splits of the given queue which have children remaining to be submitted
+ */
+void
+xnvme_cmd_split_term(struct xnvme_queue *queue);
+
 #endif /* __INTERNAL_XNVME_CMD_H */
@@ -3,6 +3,7 @@
 #ifndef __INTERNAL_XNVME_DEV_H
 #define __INTERNAL_XNVME_DEV_H
 
+#include <sys/queue.h>
 #include <libxnvme.h>
 #include <xnvme_be.h>
 
@@ -15,12 +16,21 @@ enum xnvme_dev_type {
 	XNVME_DEV_TYPE_RAMDISK,
 };
 
+enum xnvme_dev_idcss_state {
+	XNVME_DEV_IDCSS_DONE    = 0, ///< Command-set specific identify is done, or not applicable
+	XNVME_DEV_IDCSS_PENDING = 1, ///< Deferred until first use, see xnvme_be_dev_idfy_defer()
+	XNVME_DEV_IDCSS_LOADING = 2, ///< Being done by xnvme_be_dev_idfy_css()
+};
+
+struct xnvme_file_ra;
+struct xnvme_znd_cache;
+
 struct xnvme_dev {
 	struct xnvme_geo geo;     ///< Device geometry
 	struct xnvme_be be;       ///< Backend interface
 	struct xnvme_ident ident; ///< Device identifier
 
-	uint8_t _pad[4];
+	int32_t numa_node; ///< NUMA node of the device, -1 when unknown
 
 	struct {
 		struct xnvme_spec_idfy_ctrlr ctrlr; ///< NVMe id-ctrlr
@@ -31,15 +41,66 @@ struct xnvme_dev {
 		struct xnvme_spec_idfy_ctrlr ctrlr; ///< NVMe id-ctrlr
 		struct xnvme_spec_idfy_ns ns;       ///< NVMe id-ns
 	} idcss;                                    ///< Command Set Specific
+	uint8_t idcss_state; ///< See enum xnvme_dev_idcss_state
 
 	struct xnvme_opts opts; ///< Options
+
+	struct xnvme_file_ra *file_ra;     ///< Readahead of xnvme_file_pread(), NULL when disabled
+	struct xnvme_znd_cache *znd_cache; ///< Zone-state cache, NULL when disabled
+	struct xnvme_queue *znd_queue;     ///< Queue of zone-report fetches, kept for re-use
+
+	uint32_t refcount;             ///< References via xnvme_dev_open_shared(), 0 if not shared
+	struct xnvme_opts shared_opts; ///< The opts given to xnvme_dev_open_shared(), normalized
+	SLIST_ENTRY(xnvme_dev) shared; ///< Link in the list of shared devices
 };
 // XNVME_STATIC_ASSERT(sizeof(struct xnvme_ident) == 768, "Incorrect size")
 
 int
 xnvme_dev_alloc(struct xnvme_dev **dev);
 
+/**
+ * Tear down the state of the given device which is not owned by the backend, that is, everything
+ * done by xnvme_dev_close() besides be.dev.dev_close() and free(). Returns 1 when other references
+ * to the shared device remain, then the device must be left open, and 0 otherwise
+ */
+int
+xnvme_dev_teardown(struct xnvme_dev *dev);
+
 int
 xnvme_dev_be_init(struct xnvme_dev *dev, struct xnvme_be *be, const char *uri);
 
+/**
+ * Returns the NUMA node on which memory and threads for the given device should be placed, that
+ * is, the node given via opts.numa_node, otherwise the node of the device, -1 for no preference
+ */
+static inline int
+xnvme_dev_numa_node_pref(const struct xnvme_dev *dev)
+{
+	return dev->opts.numa_node.given ? (int)dev->opts.numa_node.value : dev->numa_node;
+}
+
+/**
+ * Prefer the NUMA node of the given device for the memory at [addr, addr + nbytes); this is a
+ * no-op when the device has no NUMA node or when the platform does not support it
+ */
+void
+xnvme_dev_numa_bind(const struct xnvme_dev *dev, void *addr, size_t nbytes);
+
+/**
+ * Allocate 'nbytes' of zeroed memory preferring the NUMA node of the given device; on Linux, it is
+ * a private mapping, such that the binding does not affect other users of the heap. Free it with
+ * xnvme_dev_numa_free() of the same 'nbytes'.
+ *
+ * @return On success, a pointer to the memory is returned. On error, NULL is returned and `errno`
+ * set to indicate the error.
+ */
+void *
+xnvme_dev_numa_zalloc(const struct xnvme_dev *dev, size_t nbytes);
+
+/**
+ * Free memory allocated with xnvme_dev_numa_zalloc()
+ */
+void
+xnvme_dev_numa_free(void *addr, size_t nbytes);
+
 #endif /* __INTERNAL_XNVME_DEV_H */
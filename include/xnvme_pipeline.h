@@ -0,0 +1,78 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#ifndef __INTERNAL_XNVME_PIPELINE_H
+#define __INTERNAL_XNVME_PIPELINE_H
+
+#include <libxnvme.h>
+
+#define XNVME_PIPELINE_STAGES_MAX 2
+
+enum xnvme_pipeline_slot_state {
+	XNVME_PIPELINE_SLOT_IDLE,
+	XNVME_PIPELINE_SLOT_INFLIGHT,
+	XNVME_PIPELINE_SLOT_DONE,
+};
+
+/**
+ * A unit of work of the pipeline; assigned by 'fill', and carried through the stages, one command
+ * per stage, before it is idle again. The meaning of the positions, and of the length, is up to
+ * the user of the pipeline, except that a 'len' of 0 means that the slot carries no work
+ */
+struct xnvme_pipeline_slot {
+	void *buf;       ///< Internal buffer of 'buf_nbytes', NULL when none are requested
+	void *payload;   ///< Buffer of the command in-flight, assigned by 'fill'
+	uint64_t pos;    ///< Position, in LBAs or bytes, of the source
+	uint64_t dpos;   ///< Position, in LBAs or bytes, of the destination, with two stages
+	uint64_t len;    ///< Length, in LBAs or bytes
+	uint32_t result; ///< Completion-result of the command of the stage, e.g. bytes transferred
+	uint32_t stage;  ///< Index of the stage, in 'ops->stages'
+	enum xnvme_pipeline_slot_state state;
+};
+
+/**
+ * The functions of a pipeline; they are all invoked from the submission-loop, never from the
+ * completion-callbacks, thus, they can be any function
+ */
+struct xnvme_pipeline_ops {
+	/**
+	 * Assign the next unit of work to the given idle 'slot', a 'len' of 0 when there is none
+	 *
+	 * @return On success, 0 is returned. On error, non-zero is returned.
+	 */
+	int (*fill)(struct xnvme_pipeline_slot *slot, void *arg);
+
+	/**
+	 * Submit the command of the stage of the 'slot' using the given 'ctx'
+	 *
+	 * @return On success, 0 is returned. On error, non-zero is returned.
+	 */
+	int (*submit)(struct xnvme_cmd_ctx *ctx, struct xnvme_pipeline_slot *slot, void *arg);
+
+	/**
+	 * Consume the successful completion of the stage of the 'slot', e.g. verify its 'result';
+	 * the slot continues to the next stage, if any, unless 'len' is set to 0. Optional.
+	 *
+	 * @return On success, 0 is returned. On error, non-zero is returned.
+	 */
+	int (*complete)(struct xnvme_pipeline_slot *slot, void *arg);
+};
+
+/**
+ * Run a pipeline of 'depth' slots, with a queue of 'depth' for each of the 'nstages' stages, on
+ * the device of the stage, until 'fill' has no more work, or an error occurs
+ *
+ * @param devs Device of each stage, the slot-buffers are allocated using the first
+ * @param nstages Number of stages, at most XNVME_PIPELINE_STAGES_MAX
+ * @param ops The functions of the pipeline, invoked with 'arg'
+ * @param arg Argument passed to the functions of 'ops'
+ * @param depth Number of slots, and capacity of each queue, a power of 2
+ * @param buf_nbytes Size of the internal buffer of each slot, 0 for none
+ *
+ * @return On success, 0 is returned. On error, the first error of a command, or returned by
+ * 'ops', as negative `errno`, or a non-zero user-defined return-value of the functions of 'ops'.
+ */
+int
+xnvme_pipeline_run(struct xnvme_dev **devs, uint32_t nstages, const struct xnvme_pipeline_ops *ops,
+		   void *arg, uint32_t depth, size_t buf_nbytes);
+
+#endif /* __INTERNAL_XNVME_PIPELINE_H */
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #ifndef __INTERNAL_XNVME_QUEUE_H
 #define __INTERNAL_XNVME_QUEUE_H
+#include <stddef.h>
 #include <sys/queue.h>
 
 /**
@@ -39,13 +40,73 @@ struct xnvme_queue_base {
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_base) == 24, "Incorrect size")
 
+struct xnvme_be_cbi_async_thrpool_qp;
+struct xnvme_cmd_split;
+struct xnvme_znd_cache_tracks;
+
 struct xnvme_queue {
 	struct xnvme_queue_base base;
 
 	uint8_t be_rsvd[232]; ///< Auxilary backend data
 
+	struct xnvme_be_cbi_async_thrpool_qp *helper; ///< See xnvme_queue_helper_pass()
+
+	TAILQ_HEAD(, xnvme_cmd_split) splits; ///< MDTS-splits with children awaiting submission
+
+	struct xnvme_znd_cache_tracks *znd_tracks; ///< See xnvme_znd_cache_track()
+
 	struct xnvme_cmd_ctx_entry pool_storage[];
 };
-XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue) == XNVME_BE_QUEUE_STATE_NBYTES, "Incorrect size")
+XNVME_STATIC_ASSERT(offsetof(struct xnvme_queue, helper) == XNVME_BE_QUEUE_STATE_NBYTES,
+		    "Incorrect size")
+
+/**
+ * Submit the command via the helper-thread of the queue, that is, via the sync. interface of the
+ * device; the helper-thread is started on first use. This is used with opts.async_helper, when
+ * the async. interface returns -ENOSYS for a command. The command is completed, and its callback
+ * invoked, by xnvme_queue_poke(), just like commands submitted via the async. interface.
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_helper_pass(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			size_t mbuf_nbytes);
+
+/**
+ * Vectored version of xnvme_queue_helper_pass()
+ */
+int
+xnvme_queue_helper_passv(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+			 size_t dvec_nbytes, struct iovec *mvec, size_t mvec_cnt, size_t mvec_nbytes);
+
+/**
+ * Returns the number of commands outstanding on the helper-thread of the queue; these are not
+ * included in 'queue->base.outstanding', see xnvme_queue_get_outstanding() for the sum
+ */
+uint32_t
+xnvme_queue_helper_outstanding(struct xnvme_queue *queue);
+
+/**
+ * Reap at most 'max' completions of the helper-thread, invoking their callbacks, 0 means all
+ *
+ * @return On success, number of completions processed. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_helper_poke(struct xnvme_queue *queue, uint32_t max);
+
+/**
+ * Block until a command on the helper-thread of the queue has completed, returns right away when
+ * none are outstanding
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_helper_wait(struct xnvme_queue *queue);
+
+/**
+ * Stop the helper-thread of the queue, if started, and release its resources
+ */
+void
+xnvme_queue_helper_term(struct xnvme_queue *queue);
 
 #endif /* __INTERNAL_XNVME_QUEUE_H */
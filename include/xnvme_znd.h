@@ -0,0 +1,44 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#ifndef __INTERNAL_XNVME_ZND_H
+#define __INTERNAL_XNVME_ZND_H
+
+#include <libxnvme.h>
+
+/**
+ * Update the zone-state cache of the device of the given command-context with the completion of
+ * a synchronous command; 'err' is the return-value of the submission
+ */
+void
+xnvme_znd_cache_cpl(struct xnvme_cmd_ctx *ctx, int err);
+
+/**
+ * Wrap the callback of the given asynchronous command, such that the zone-state cache is updated
+ * on completion, before invoking the callback of the user; the tracking-state is taken from the
+ * queue of the command, -EBUSY is returned when it is exhausted
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_znd_cache_track(struct xnvme_cmd_ctx *ctx);
+
+/**
+ * Undo xnvme_znd_cache_track(), for a command which failed submission
+ */
+void
+xnvme_znd_cache_untrack(struct xnvme_cmd_ctx *ctx);
+
+/**
+ * Tear down the queue kept by the device for fetching zone-reports, see
+ * xnvme_znd_report_from_dev()
+ */
+void
+xnvme_znd_report_queue_term(struct xnvme_dev *dev);
+
+/**
+ * Free the tracking-state of the given queue, see xnvme_znd_cache_track()
+ */
+void
+xnvme_znd_cache_track_term(struct xnvme_queue *queue);
+
+#endif /* __INTERNAL_XNVME_ZND_H */
@@ -1,5 +1,6 @@
 // Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
 // SPDX-License-Identifier: Apache-2.0
+#include <sched.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -238,11 +239,17 @@ _zoned_geometry(struct xnvme_dev *dev)
 	struct xnvme_spec_idfy_ns *nvm = (void *)xnvme_dev_get_ns(dev);
 	struct xnvme_spec_lbaf *lbaf = &nvm->lbaf[nvm->flbas.format];
 	struct xnvme_spec_znd_idfy_ns *zns = (void *)xnvme_dev_get_ns_css(dev);
-	struct xnvme_spec_znd_idfy_lbafe *lbafe = &zns->lbafe[nvm->flbas.format];
+	struct xnvme_spec_znd_idfy_lbafe *lbafe;
 	struct xnvme_geo *geo = &dev->geo;
 	uint64_t nzones;
 	int err;
 
+	if (!zns) {
+		XNVME_DEBUG("FAILED: xnvme_dev_get_ns_css(), errno: %d", errno);
+		return -errno;
+	}
+	lbafe = &zns->lbafe[nvm->flbas.format];
+
 	if (!zns->lbafe[0].zsze) {
 		XNVME_DEBUG("FAILED: !zns.lbafe[0].zsze");
 		return -EINVAL;
@@ -306,6 +313,11 @@ _fs_geometry(struct xnvme_dev *dev)
 	const struct xnvme_spec_fs_idfy_ns *ns = (void *)xnvme_dev_get_ns_css(dev);
 	struct xnvme_geo *geo = &dev->geo;
 
+	if (!ns) {
+		XNVME_DEBUG("FAILED: xnvme_dev_get_ns_css(), errno: %d", errno);
+		return -errno;
+	}
+
 	geo->type = XNVME_GEO_CONVENTIONAL;
 
 	geo->npugrp = 1;
@@ -413,62 +425,17 @@ xnvme_be_dev_derive_geometry(struct xnvme_dev *dev)
 	return 0;
 }
 
-int
-xnvme_be_dev_idfy(struct xnvme_dev *dev)
+/**
+ * Command-set specific identify controller / namespace, using the given buffers; the command-set
+ * is assumed to be NVM when neither Zoned nor FS identify gives a positive response
+ */
+static int
+_idfy_css(struct xnvme_dev *dev, struct xnvme_spec_idfy *idfy_ctrlr,
+	  struct xnvme_spec_idfy *idfy_ns)
 {
 	struct xnvme_cmd_ctx ctx = {0};
-	struct xnvme_spec_idfy *idfy_ctrlr = NULL, *idfy_ns = NULL;
 	int err;
 
-	//
-	// Identify controller and namespace
-	//
-
-	// Allocate buffers for idfy
-	idfy_ctrlr = xnvme_buf_alloc(dev, sizeof(*idfy_ctrlr));
-	if (!idfy_ctrlr) {
-		XNVME_DEBUG("FAILED: xnvme_buf_alloc()");
-		err = -errno;
-		goto exit;
-	}
-	idfy_ns = xnvme_buf_alloc(dev, sizeof(*idfy_ns));
-	if (!idfy_ns) {
-		XNVME_DEBUG("FAILED: xnvme_buf_alloc()");
-		err = -errno;
-		goto exit;
-	}
-
-	// Retrieve idfy-ctrlr
-	memset(idfy_ctrlr, 0, sizeof(*idfy_ctrlr));
-	ctx = xnvme_cmd_ctx_from_dev(dev);
-	err = xnvme_adm_idfy_ctrlr(&ctx, idfy_ctrlr);
-	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
-		err = err ? err : -EIO;
-		XNVME_DEBUG("FAILED: xnvme_adm_idfy_ctrlr(), err: %d", err);
-		goto exit;
-	}
-
-	// Retrieve idfy-ns
-	memset(idfy_ns, 0, sizeof(*idfy_ns));
-	ctx = xnvme_cmd_ctx_from_dev(dev);
-	err = xnvme_adm_idfy_ns(&ctx, dev->ident.nsid, idfy_ns);
-	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
-		err = err ? err : -EIO;
-		XNVME_DEBUG("FAILED: xnvme_adm_idfy_ns(), err: %d", err);
-		goto exit;
-	}
-
-	// Store subnqn in device-identifier
-	memcpy(dev->ident.subnqn, idfy_ctrlr->ctrlr.subnqn, sizeof(dev->ident.subnqn));
-
-	// Store idfy-ctrlr and idfy-ns in device instance
-	memcpy(&dev->id.ctrlr, idfy_ctrlr, sizeof(*idfy_ctrlr));
-	memcpy(&dev->id.ns, idfy_ns, sizeof(*idfy_ns));
-
-	//
-	// Command-set specific identify controller / namespace
-	//
-
 	// Attempt to identify Zoned Namespace
 	{
 		struct xnvme_spec_znd_idfy_ns *zns = (void *)idfy_ns;
@@ -498,7 +465,7 @@ xnvme_be_dev_idfy(struct xnvme_dev *dev)
 		dev->ident.csi = XNVME_SPEC_CSI_ZONED;
 
 		XNVME_DEBUG("INFO: looks like csi(ZNS)");
-		goto exit;
+		return 0;
 
 not_zns:
 		XNVME_DEBUG("INFO: no positive response to idfy(ZNS)");
@@ -537,7 +504,7 @@ not_zns:
 
 		XNVME_DEBUG("INFO: looks like csi(FS)");
 		dev->ident.csi = XNVME_SPEC_CSI_FS;
-		goto exit;
+		return 0;
 
 not_fs:
 		XNVME_DEBUG("INFO: no positive response to idfy(FS)");
@@ -550,11 +517,73 @@ not_fs:
 	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
 		XNVME_DEBUG("INFO: not csi-specific id-NVM");
 		XNVME_DEBUG("INFO: falling back to NVM assumption");
-		err = 0;
-		goto exit;
+		return 0;
 	}
 	memcpy(&dev->idcss.ns, idfy_ns, sizeof(*idfy_ns));
 
+	return 0;
+}
+
+static int
+_idfy(struct xnvme_dev *dev, int defer)
+{
+	struct xnvme_cmd_ctx ctx = {0};
+	struct xnvme_spec_idfy *idfy_ctrlr = NULL, *idfy_ns = NULL;
+	int err;
+
+	//
+	// Identify controller and namespace
+	//
+
+	// Allocate buffers for idfy
+	idfy_ctrlr = xnvme_buf_alloc(dev, sizeof(*idfy_ctrlr));
+	if (!idfy_ctrlr) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc()");
+		err = -errno;
+		goto exit;
+	}
+	idfy_ns = xnvme_buf_alloc(dev, sizeof(*idfy_ns));
+	if (!idfy_ns) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc()");
+		err = -errno;
+		goto exit;
+	}
+
+	// Retrieve idfy-ctrlr
+	memset(idfy_ctrlr, 0, sizeof(*idfy_ctrlr));
+	ctx = xnvme_cmd_ctx_from_dev(dev);
+	err = xnvme_adm_idfy_ctrlr(&ctx, idfy_ctrlr);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		err = err ? err : -EIO;
+		XNVME_DEBUG("FAILED: xnvme_adm_idfy_ctrlr(), err: %d", err);
+		goto exit;
+	}
+
+	// Retrieve idfy-ns
+	memset(idfy_ns, 0, sizeof(*idfy_ns));
+	ctx = xnvme_cmd_ctx_from_dev(dev);
+	err = xnvme_adm_idfy_ns(&ctx, dev->ident.nsid, idfy_ns);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		err = err ? err : -EIO;
+		XNVME_DEBUG("FAILED: xnvme_adm_idfy_ns(), err: %d", err);
+		goto exit;
+	}
+
+	// Store subnqn in device-identifier
+	memcpy(dev->ident.subnqn, idfy_ctrlr->ctrlr.subnqn, sizeof(dev->ident.subnqn));
+
+	// Store idfy-ctrlr and idfy-ns in device instance
+	memcpy(&dev->id.ctrlr, idfy_ctrlr, sizeof(*idfy_ctrlr));
+	memcpy(&dev->id.ns, idfy_ns, sizeof(*idfy_ns));
+
+	if (defer) {
+		XNVME_DEBUG("INFO: deferring command-set specific identify");
+		__atomic_store_n(&dev->idcss_state, XNVME_DEV_IDCSS_PENDING, __ATOMIC_RELEASE);
+		goto exit;
+	}
+
+	err = _idfy_css(dev, idfy_ctrlr, idfy_ns);
+
 exit:
 	xnvme_buf_free(dev, idfy_ctrlr);
 	xnvme_buf_free(dev, idfy_ns);
@@ -562,6 +591,81 @@ exit:
 	return err;
 }
 
+int
+xnvme_be_dev_idfy(struct xnvme_dev *dev)
+{
+	return _idfy(dev, 0);
+}
+
+int
+xnvme_be_dev_idfy_defer(struct xnvme_dev *dev)
+{
+	return _idfy(dev, 1);
+}
+
+int
+xnvme_be_dev_idfy_css(struct xnvme_dev *dev)
+{
+	struct xnvme_spec_idfy *idfy_ctrlr = NULL, *idfy_ns = NULL;
+	uint8_t state = XNVME_DEV_IDCSS_PENDING;
+	int err;
+
+	// Wait while another thread is loading; when it failed, then the state is pending again
+	while (!__atomic_compare_exchange_n(&dev->idcss_state, &state, XNVME_DEV_IDCSS_LOADING, 0,
+					    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+		if (state == XNVME_DEV_IDCSS_DONE) {
+			return 0;
+		}
+		sched_yield();
+		state = XNVME_DEV_IDCSS_PENDING;
+	}
+
+	idfy_ctrlr = xnvme_buf_alloc(dev, sizeof(*idfy_ctrlr));
+	idfy_ns = xnvme_buf_alloc(dev, sizeof(*idfy_ns));
+	if (!idfy_ctrlr || !idfy_ns) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc()");
+		err = errno ? -errno : -ENOMEM;
+		state = XNVME_DEV_IDCSS_PENDING;
+		goto exit;
+	}
+
+	err = _idfy_css(dev, idfy_ctrlr, idfy_ns);
+	state = err ? XNVME_DEV_IDCSS_PENDING : XNVME_DEV_IDCSS_DONE;
+
+exit:
+	xnvme_buf_free(dev, idfy_ctrlr);
+	xnvme_buf_free(dev, idfy_ns);
+	__atomic_store_n(&dev->idcss_state, state, __ATOMIC_RELEASE);
+
+	return err;
+}
+
+/**
+ * Returns true when the given async. 'mixin' matches 'opts'. With the 'async_pinned' build-option,
+ * then only the pinned mixin is eligible, and "auto" selects it
+ */
+static bool
+_async_eligible(const struct xnvme_be_mixin *mixin, const struct xnvme_opts *opts)
+{
+	const char *async = opts ? opts->async : NULL;
+
+#ifdef XNVME_BE_ASYNC_PINNED_ENABLED
+	if (mixin->async != xnvme_be_async_pinned) {
+		XNVME_DEBUG("INFO: skipping async: '%s'; not pinned", mixin->name);
+		return false;
+	}
+	if (async && !strcmp(async, "auto")) {
+		return true;
+	}
+#endif
+	if (async && strcmp(async, mixin->name)) {
+		XNVME_DEBUG("INFO: skipping async: '%s' != '%s'", mixin->name, async);
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * Set up mixin of 'be' of the given 'mtype' and matching 'opts' when provided
  */
@@ -577,9 +681,7 @@ be_setup(struct xnvme_be *be, enum xnvme_be_mixin_type mtype, struct xnvme_opts
 
 		switch (mtype) {
 		case XNVME_BE_ASYNC:
-			if ((opts) && (opts->async) && strcmp(opts->async, mixin->name)) {
-				XNVME_DEBUG("INFO: skipping async: '%s' != '%s'", mixin->name,
-					    opts->async);
+			if (!_async_eligible(mixin, opts)) {
 				continue;
 			}
 			be->async = *mixin->async;
@@ -631,6 +733,32 @@ be_setup(struct xnvme_be *be, enum xnvme_be_mixin_type mtype, struct xnvme_opts
 	return -ENOSYS;
 }
 
+int
+xnvme_be_setup_mixins(struct xnvme_be *be, struct xnvme_opts *opts)
+{
+	int setup = 0;
+	int err = 0;
+
+	for (int j = 0; j < 5; ++j) {
+		int mtype = 1 << j;
+
+		err = be_setup(be, mtype, opts);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: be_setup(%s); err: %d", be->attr.name, err);
+			continue;
+		}
+
+		setup |= err;
+	}
+
+	if (setup != XNVME_BE_CONFIGURED) {
+		XNVME_DEBUG("INFO: !configured be(%s); err: %d", be->attr.name, err);
+		return err < 0 ? err : -ENOSYS;
+	}
+
+	return 0;
+}
+
 int
 xnvme_be_factory(struct xnvme_dev *dev, struct xnvme_opts *opts)
 {
@@ -638,7 +766,6 @@ xnvme_be_factory(struct xnvme_dev *dev, struct xnvme_opts *opts)
 
 	for (int i = 0; (i < g_xnvme_be_count) && g_xnvme_be_registry[i]; ++i) {
 		struct xnvme_be be = *g_xnvme_be_registry[i];
-		int setup = 0;
 		XNVME_DEBUG("INFO: checking be: '%s'", be.attr.name);
 
 		if (!be.attr.enabled) {
@@ -650,20 +777,8 @@ xnvme_be_factory(struct xnvme_dev *dev, struct xnvme_opts *opts)
 			continue;
 		}
 
-		for (int j = 0; j < 5; ++j) {
-			int mtype = 1 << j;
-
-			err = be_setup(&be, mtype, opts);
-			if (err < 0) {
-				XNVME_DEBUG("FAILED: be_setup(%s); err: %d", be.attr.name, err);
-				continue;
-			}
-
-			setup |= err;
-		}
-
-		if (setup != XNVME_BE_CONFIGURED) {
-			XNVME_DEBUG("INFO: !configured be(%s); err: %d", be.attr.name, err);
+		err = xnvme_be_setup_mixins(&be, opts);
+		if (err) {
 			continue;
 		}
 
@@ -676,6 +791,10 @@ xnvme_be_factory(struct xnvme_dev *dev, struct xnvme_opts *opts)
 		switch (err < 0 ? -err : err) {
 		case 0:
 			XNVME_DEBUG("INFO: obtained device handle");
+#ifdef XNVME_BE_ASYNC_PINNED_ENABLED
+			// The dev_open() of a backend may pick its default async. interface
+			dev->be.async = *xnvme_be_async_pinned;
+#endif
 			dev->opts.be = be.attr.name;
 			dev->opts.admin = dev->be.admin.id;
 			dev->opts.sync = dev->be.sync.id;
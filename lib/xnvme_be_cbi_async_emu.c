@@ -235,3 +235,7 @@ struct xnvme_be_async g_xnvme_be_cbi_async_emu = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_CBI_ASYNC_EMU_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_cbi_async_emu, emu_cmd_io, emu_cmd_iov, emu_poke)
+#endif
@@ -100,3 +100,8 @@ struct xnvme_be_async g_xnvme_be_cbi_async_nil = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_CBI_ASYNC_NIL_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_cbi_async_nil, nil_cmd_io, xnvme_be_nosys_queue_cmd_iov,
+			     nil_poke)
+#endif
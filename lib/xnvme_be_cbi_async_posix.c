@@ -9,6 +9,7 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <aio.h>
+#include <fcntl.h>
 #include <libxnvme_spec_fs.h>
 #include <xnvme_queue.h>
 #include <xnvme_dev.h>
@@ -179,8 +180,12 @@ posix_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mb
 
 	case XNVME_SPEC_NVM_OPC_FLUSH:
 	case XNVME_SPEC_FS_OPC_FLUSH:
-		// TODO: should this be handled by calling aio_fsync()?
-		// err = aio_fsync(_, &aiocb);
+		err = aio_fsync(O_SYNC, aiocb);
+		break;
+
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
+		err = aio_fsync(O_DSYNC, aiocb);
+		break;
 
 	default:
 		XNVME_DEBUG("FAILED: unsupported opcode: %d", ctx->cmd.common.opcode);
@@ -188,7 +193,7 @@ posix_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mb
 	}
 
 	if (err) {
-		XNVME_DEBUG("FAILED: {aio_write(),aio_read()}: err: %d", errno)
+		XNVME_DEBUG("FAILED: {aio_write(),aio_read(),aio_fsync()}: err: %d", errno)
 		return -errno;
 	}
 
@@ -219,3 +224,8 @@ struct xnvme_be_async g_xnvme_be_cbi_async_posix = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_CBI_ASYNC_POSIX_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_cbi_async_posix, posix_cmd_io,
+			     xnvme_be_nosys_queue_cmd_iov, posix_poke)
+#endif
@@ -1,14 +1,13 @@
+#include <errno.h>
+#include <pthread.h>
 #include <xnvme_be.h>
+#include <xnvme_be_cbi.h>
 #include <xnvme_be_nosys.h>
-#ifdef XNVME_BE_CBI_ASYNC_THRPOOL_ENABLED
-#include <errno.h>
 #include <xnvme_queue.h>
 #include <xnvme_dev.h>
-#include <pthread.h>
-
-// Environment variable used to configure the number of threads in thrpool
-static const char *g_nthreads_env = "XNVME_BE_CBI_ASYNC_THRPOOL_NTHREADS";
-static const int g_nthreads_def = 4;
+#ifdef XNVME_BE_LINUX_ENABLED
+#include <xnvme_be_linux.h>
+#endif
 
 struct _thrpool_entry {
 	struct xnvme_dev *dev;
@@ -25,7 +24,13 @@ struct _thrpool_entry {
 	STAILQ_ENTRY(_thrpool_entry) link;
 };
 
-struct _thrpool_qp {
+/**
+ * Commands are submitted by the owner of the queue, executed via the sync. interface by the
+ * threads, and completed by the owner of the queue on reap. The 'rp' and 'outstanding' are only
+ * touched by the owner of the queue, 'sq' under 'sq_mutex', and 'cq' under 'cq_mutex'; the
+ * threads signal 'cq_cond' when they put a command on the 'cq'.
+ */
+struct xnvme_be_cbi_async_thrpool_qp {
 	STAILQ_HEAD(, _thrpool_entry) rp; ///< Request pool
 
 	pthread_mutex_t sq_mutex;
@@ -34,84 +39,21 @@ struct _thrpool_qp {
 
 	pthread_mutex_t cq_mutex;
 	STAILQ_HEAD(, _thrpool_entry) cq; ///< Completion queue
-
-	uint32_t capacity;
-	struct _thrpool_entry elm[];
-};
-
-struct xnvme_queue_thrpool {
-	struct xnvme_queue_base base;
-
-	struct _thrpool_qp *qp;
+	pthread_cond_t cq_cond;
 
 	bool threads_stop;
 	int nthreads;
 	pthread_t *threads;
 
-	uint8_t _rsvd[204];
+	uint32_t outstanding;
+	uint32_t capacity;
+	struct _thrpool_entry elm[];
 };
-XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_thrpool) == XNVME_BE_QUEUE_STATE_NBYTES,
-		    "Incorrect size")
-
-static int
-_thrpool_qp_term(struct _thrpool_qp *qp)
-{
-	// NOTE: assumes that no thread holds any of the locks
-	pthread_mutex_destroy(&qp->sq_mutex);
-	pthread_mutex_destroy(&qp->cq_mutex);
-
-	free(qp);
 
-	return 0;
-}
-
-static int
-_thrpool_qp_alloc(struct _thrpool_qp **qp, uint32_t capacity)
-{
-	const size_t nbytes = sizeof(**qp) + capacity * sizeof(*(*qp)->elm);
-	int err;
-
-	(*qp) = malloc(nbytes);
-	if (!(*qp)) {
-		return -errno;
-	}
-	memset((*qp), 0, nbytes);
-
-	STAILQ_INIT(&(*qp)->sq);
-	STAILQ_INIT(&(*qp)->cq);
-	STAILQ_INIT(&(*qp)->rp);
-
-	err = pthread_cond_init(&(*qp)->sq_cond, NULL);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_cond_init(sq_cond), err: %d", err);
-		return -err;
-	}
-
-	err = pthread_mutex_init(&(*qp)->sq_mutex, NULL);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_mutex_init(sq_mutex), err: %d", err);
-		return -err;
-	}
-	err = pthread_mutex_init(&(*qp)->cq_mutex, NULL);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_mutex_init(cq_mutex), err: %d", err);
-		return -err;
-	}
-
-	(*qp)->capacity = capacity;
-
-	for (uint32_t i = 0; i < (*qp)->capacity; ++i) {
-		STAILQ_INSERT_HEAD(&(*qp)->rp, &(*qp)->elm[i], link);
-	}
-
-	return 0;
-}
-
-static int
+static void *
 _thrpool_thread_loop(void *arg)
 {
-	struct xnvme_queue_thrpool *queue = arg;
-	struct _thrpool_qp *qp = queue->qp;
+	struct xnvme_be_cbi_async_thrpool_qp *qp = arg;
 
 	while (true) {
 		struct _thrpool_entry *entry;
@@ -120,20 +62,20 @@ _thrpool_thread_loop(void *arg)
 		err = pthread_mutex_lock(&qp->sq_mutex);
 		if (err) {
 			XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
-			return -err;
+			return NULL;
 		}
 
 		entry = STAILQ_FIRST(&qp->sq);
-		while (!entry && !queue->threads_stop) {
+		while (!entry && !qp->threads_stop) {
 			pthread_cond_wait(&qp->sq_cond, &qp->sq_mutex);
 			entry = STAILQ_FIRST(&qp->sq);
 		}
 
-		if (queue->threads_stop) {
+		if (qp->threads_stop) {
 			if (pthread_mutex_unlock(&qp->sq_mutex)) {
 				XNVME_DEBUG("FAILED: pthread_mutex_unlock()");
 			}
-			return 0;
+			return NULL;
 		}
 
 		STAILQ_REMOVE_HEAD(&qp->sq, link);
@@ -142,13 +84,13 @@ _thrpool_thread_loop(void *arg)
 		}
 
 		err = entry->is_vectored
-			      ? queue->base.dev->be.sync.cmd_iov(
-					entry->ctx, entry->data, entry->data_vec_cnt,
-					entry->data_nbytes, entry->meta, entry->meta_vec_cnt,
-					entry->meta_nbytes)
-			      : queue->base.dev->be.sync.cmd_io(entry->ctx, entry->data,
-								entry->data_nbytes, entry->meta,
-								entry->meta_nbytes);
+			      ? entry->dev->be.sync.cmd_iov(entry->ctx, entry->data,
+							    entry->data_vec_cnt, entry->data_nbytes,
+							    entry->meta, entry->meta_vec_cnt,
+							    entry->meta_nbytes)
+			      : entry->dev->be.sync.cmd_io(entry->ctx, entry->data,
+							   entry->data_nbytes, entry->meta,
+							   entry->meta_nbytes);
 		///< On submission-error; ctx.cpl is not filled, thus assigned below
 		if (err) {
 			entry->ctx->cpl.status.sc =
@@ -159,124 +101,223 @@ _thrpool_thread_loop(void *arg)
 		err = pthread_mutex_lock(&qp->cq_mutex);
 		if (err) {
 			XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
-			return -err;
+			return NULL;
 		}
 
 		STAILQ_INSERT_TAIL(&qp->cq, entry, link);
 
+		if (pthread_cond_signal(&qp->cq_cond)) {
+			XNVME_DEBUG("FAILED: pthread_cond_signal()");
+		}
 		if (pthread_mutex_unlock(&qp->cq_mutex)) {
 			XNVME_DEBUG("FAILED: pthread_mutex_unlock()");
 		}
 	}
 
-	return 0;
+	return NULL;
 }
 
-static int
-cbi_async_thrpool_term(struct xnvme_queue *q)
+void
+xnvme_be_cbi_async_thrpool_qp_term(struct xnvme_be_cbi_async_thrpool_qp *qp)
 {
-	struct xnvme_queue_thrpool *queue = (void *)q;
-	struct _thrpool_qp *qp = queue->qp;
-	int err, err_lock;
+	int err;
 
-	err_lock = pthread_mutex_lock(&qp->sq_mutex);
-	if (err_lock) {
-		XNVME_DEBUG("FAILED: pthread_mutex_lock(), err_lock: %d", err_lock);
-		return -err_lock;
+	if (!qp) {
+		return;
 	}
 
-	queue->threads_stop = true;
-
+	err = pthread_mutex_lock(&qp->sq_mutex);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
+	}
+	qp->threads_stop = true;
 	err = pthread_cond_broadcast(&qp->sq_cond);
 	if (err) {
 		XNVME_DEBUG("FAILED: pthread_cond_broadcast(), err: %d", err);
-
-		err_lock = pthread_mutex_unlock(&qp->sq_mutex);
-		if (err_lock) {
-			XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err_lock: %d", err_lock);
-		}
-
-		return -err;
 	}
-	err_lock = pthread_mutex_unlock(&qp->sq_mutex);
-	if (err_lock) {
-		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err_lock: %d", err_lock);
+	err = pthread_mutex_unlock(&qp->sq_mutex);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err: %d", err);
 	}
 
-	for (int i = 0; queue->threads && i < queue->nthreads; i++) {
-		pthread_join(queue->threads[i], NULL);
+	for (int i = 0; qp->threads && i < qp->nthreads; i++) {
+		pthread_join(qp->threads[i], NULL);
 	}
-	free(queue->threads);
+	free(qp->threads);
 
-	err = _thrpool_qp_term(queue->qp);
-	if (err) {
-		XNVME_DEBUG("FAILED: _thrpool_qp_term(queue->qp), err: %d", err);
-	}
+	// NOTE: assumes that no thread holds any of the locks
+	pthread_cond_destroy(&qp->sq_cond);
+	pthread_mutex_destroy(&qp->sq_mutex);
+	pthread_cond_destroy(&qp->cq_cond);
+	pthread_mutex_destroy(&qp->cq_mutex);
 
-	return err;
+	free(qp);
 }
 
-static int
-cbi_async_thrpool_init(struct xnvme_queue *q, int XNVME_UNUSED(opts))
+int
+xnvme_be_cbi_async_thrpool_qp_init(struct xnvme_be_cbi_async_thrpool_qp **qp,
+				   struct xnvme_dev *dev, uint32_t capacity, int nthreads)
 {
-	struct xnvme_queue_thrpool *queue = (void *)q;
-	char *env;
-	int nthreads;
+	const size_t nbytes = sizeof(**qp) + capacity * sizeof(*(*qp)->elm);
+#ifdef XNVME_BE_LINUX_ENABLED
+	int node;
+#endif
 	int err;
 
-	err = _thrpool_qp_alloc(&queue->qp, queue->base.capacity);
+	(*qp) = calloc(1, nbytes);
+	if (!(*qp)) {
+		XNVME_DEBUG("FAILED: calloc(qp), errno: %d", errno);
+		return -errno;
+	}
+
+	STAILQ_INIT(&(*qp)->sq);
+	STAILQ_INIT(&(*qp)->cq);
+	STAILQ_INIT(&(*qp)->rp);
+
+	err = pthread_cond_init(&(*qp)->sq_cond, NULL);
 	if (err) {
-		XNVME_DEBUG("FAILED: _thrpool_qp_alloc(); err: %d", err);
-		goto failed;
+		XNVME_DEBUG("FAILED: pthread_cond_init(sq_cond), err: %d", err);
+		free(*qp);
+		*qp = NULL;
+		return -err;
+	}
+	err = pthread_mutex_init(&(*qp)->sq_mutex, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_init(sq_mutex), err: %d", err);
+		pthread_cond_destroy(&(*qp)->sq_cond);
+		free(*qp);
+		*qp = NULL;
+		return -err;
+	}
+	err = pthread_cond_init(&(*qp)->cq_cond, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_cond_init(cq_cond), err: %d", err);
+		pthread_mutex_destroy(&(*qp)->sq_mutex);
+		pthread_cond_destroy(&(*qp)->sq_cond);
+		free(*qp);
+		*qp = NULL;
+		return -err;
+	}
+	err = pthread_mutex_init(&(*qp)->cq_mutex, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_init(cq_mutex), err: %d", err);
+		pthread_cond_destroy(&(*qp)->cq_cond);
+		pthread_mutex_destroy(&(*qp)->sq_mutex);
+		pthread_cond_destroy(&(*qp)->sq_cond);
+		free(*qp);
+		*qp = NULL;
+		return -err;
 	}
 
-	nthreads = (env = getenv(g_nthreads_env)) ? atoi(env) : g_nthreads_def;
-	if (nthreads <= 0 || nthreads >= 1024) {
-		XNVME_DEBUG("FAILED: invalid nthreads: %d", nthreads);
-		err = EINVAL;
-		goto failed;
+	(*qp)->capacity = capacity;
+
+	for (uint32_t i = 0; i < (*qp)->capacity; ++i) {
+		STAILQ_INSERT_HEAD(&(*qp)->rp, &(*qp)->elm[i], link);
 	}
-	XNVME_DEBUG("INFO: nthreads: %d", nthreads);
 
-	queue->threads = calloc(nthreads, sizeof(pthread_t));
-	if (!queue->threads) {
+	(*qp)->threads = calloc(nthreads, sizeof(pthread_t));
+	if (!(*qp)->threads) {
 		XNVME_DEBUG("FAILED: calloc(nthreads)");
 		err = -errno;
 		goto failed;
 	}
 
-	queue->threads_stop = false;
+#ifdef XNVME_BE_LINUX_ENABLED
+	node = xnvme_dev_numa_node_pref(dev);
+#else
+	(void)dev;
+#endif
 	for (int i = 0; i < nthreads; i++) {
 		XNVME_DEBUG("Starting thread %d", i);
 
-		err = pthread_create(&queue->threads[i], NULL, (void *)_thrpool_thread_loop,
-				     queue);
+		err = pthread_create(&(*qp)->threads[i], NULL, _thrpool_thread_loop, *qp);
 		if (err) {
 			XNVME_DEBUG("pthread_create() %d", err);
 			err = -err;
 			goto failed;
 		}
+#ifdef XNVME_BE_LINUX_ENABLED
+		if (node >= 0) {
+			xnvme_be_linux_numa_bind_thread((*qp)->threads[i], node);
+		}
+#endif
 
-		++(queue->nthreads);
+		++((*qp)->nthreads);
 	}
 
 	return 0;
 
 failed:
-	cbi_async_thrpool_term(q);
+	xnvme_be_cbi_async_thrpool_qp_term(*qp);
+	*qp = NULL;
+
 	return err;
 }
 
-static int
-cbi_async_thrpool_poke(struct xnvme_queue *q, uint32_t max)
+int
+xnvme_be_cbi_async_thrpool_qp_submit(struct xnvme_be_cbi_async_thrpool_qp *qp,
+				     struct xnvme_cmd_ctx *ctx, void *data, size_t data_vec_cnt,
+				     size_t data_nbytes, void *meta, size_t meta_vec_cnt,
+				     size_t meta_nbytes, bool is_vectored, uint32_t *outstanding)
+{
+	struct _thrpool_entry *entry = NULL;
+	int err;
+
+	entry = STAILQ_FIRST(&qp->rp);
+	if (!entry) {
+		return -EBUSY;
+	}
+	STAILQ_REMOVE_HEAD(&qp->rp, link);
+
+	entry->dev = ctx->dev;
+	entry->ctx = ctx;
+
+	entry->data = data;
+	entry->data_nbytes = data_nbytes;
+	entry->data_vec_cnt = data_vec_cnt;
+	entry->meta = meta;
+	entry->meta_nbytes = meta_nbytes;
+	entry->meta_vec_cnt = meta_vec_cnt;
+	entry->is_vectored = is_vectored;
+
+	err = pthread_mutex_lock(&qp->sq_mutex);
+	if (err) {
+		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
+		XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
+		return -err;
+	}
+
+	STAILQ_INSERT_TAIL(&qp->sq, entry, link);
+	qp->outstanding += 1;
+	if (outstanding) {
+		*outstanding += 1;
+	}
+
+	err = pthread_mutex_unlock(&qp->sq_mutex);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err: %d", err);
+	}
+	err = pthread_cond_signal(&qp->sq_cond);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_cond_signal(), err: %d", err);
+		return -err;
+	}
+
+	return 0;
+}
+
+int
+xnvme_be_cbi_async_thrpool_qp_reap(struct xnvme_be_cbi_async_thrpool_qp *qp, uint32_t max,
+				   uint32_t *outstanding)
 {
-	struct xnvme_queue_thrpool *queue = (void *)q;
-	struct _thrpool_qp *qp = queue->qp;
 	unsigned completed = 0;
 	int err;
 
-	max = max ? max : queue->base.outstanding;
-	max = max > queue->base.outstanding ? queue->base.outstanding : max;
+	max = max ? max : qp->outstanding;
+	max = max > qp->outstanding ? qp->outstanding : max;
+	if (!max) {
+		return 0;
+	}
 
 	struct _thrpool_entry *entries[max];
 
@@ -304,115 +345,133 @@ cbi_async_thrpool_poke(struct xnvme_queue *q, uint32_t max)
 	}
 
 	for (unsigned i = 0; i < completed; i++) {
-		struct _thrpool_entry *entry = entries[i];
-		entry->ctx->async.cb(entry->ctx, entry->ctx->async.cb_arg);
-		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
-	}
+		struct xnvme_cmd_ctx *ctx = entries[i]->ctx;
 
-	queue->base.outstanding -= completed;
+		STAILQ_INSERT_TAIL(&qp->rp, entries[i], link);
+		qp->outstanding -= 1;
+		if (outstanding) {
+			*outstanding -= 1;
+		}
+
+		ctx->async.cb(ctx, ctx->async.cb_arg);
+	}
 
 	return completed;
 }
 
-static inline int
-cbi_async_thrpool_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
-			 size_t mbuf_nbytes)
+int
+xnvme_be_cbi_async_thrpool_qp_wait(struct xnvme_be_cbi_async_thrpool_qp *qp)
 {
-	struct xnvme_queue_thrpool *queue = (void *)ctx->async.queue;
-	struct _thrpool_qp *qp = queue->qp;
-	struct _thrpool_entry *entry = NULL;
 	int err;
 
-	entry = STAILQ_FIRST(&qp->rp);
-	if (!entry) {
-		return -EBUSY;
-	}
-	STAILQ_REMOVE_HEAD(&qp->rp, link);
-
-	entry->dev = ctx->dev;
-	entry->ctx = ctx;
-
-	entry->data = dbuf;
-	entry->data_nbytes = dbuf_nbytes;
-	entry->data_vec_cnt = 0;
-	entry->meta = mbuf;
-	entry->meta_nbytes = mbuf_nbytes;
-	entry->meta_vec_cnt = 0;
-	entry->is_vectored = false;
-
-	err = pthread_mutex_lock(&qp->sq_mutex);
+	err = pthread_mutex_lock(&qp->cq_mutex);
 	if (err) {
-		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
 		XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
 		return -err;
 	}
 
-	STAILQ_INSERT_TAIL(&qp->sq, entry, link);
-	ctx->async.queue->base.outstanding += 1;
-
-	err = pthread_mutex_unlock(&qp->sq_mutex);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err: %d", err);
+	while (qp->outstanding && STAILQ_EMPTY(&qp->cq)) {
+		err = pthread_cond_wait(&qp->cq_cond, &qp->cq_mutex);
+		if (err) {
+			XNVME_DEBUG("FAILED: pthread_cond_wait(), err: %d", err);
+			break;
+		}
 	}
-	err = pthread_cond_signal(&qp->sq_cond);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_cond_signal(), err: %d", err);
-		return -err;
+
+	if (pthread_mutex_unlock(&qp->cq_mutex)) {
+		XNVME_DEBUG("FAILED: pthread_mutex_unlock()");
 	}
 
-	return 0;
+	return -err;
 }
 
-static inline int
-cbi_async_thrpool_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
-			  size_t dvec_nbytes, struct iovec *mvec, size_t mvec_cnt,
-			  size_t mvec_nbytes)
+uint32_t
+xnvme_be_cbi_async_thrpool_qp_outstanding(struct xnvme_be_cbi_async_thrpool_qp *qp)
 {
-	struct xnvme_queue_thrpool *queue = (void *)ctx->async.queue;
-	struct _thrpool_qp *qp = queue->qp;
-	struct _thrpool_entry *entry = NULL;
-	int err;
+	return qp->outstanding;
+}
 
-	entry = STAILQ_FIRST(&qp->rp);
-	if (!entry) {
-		return -EBUSY;
-	}
-	STAILQ_REMOVE_HEAD(&qp->rp, link);
+#ifdef XNVME_BE_CBI_ASYNC_THRPOOL_ENABLED
+// Environment variable used to configure the number of threads in thrpool
+static const char *g_nthreads_env = "XNVME_BE_CBI_ASYNC_THRPOOL_NTHREADS";
+static const int g_nthreads_def = 4;
 
-	entry->dev = ctx->dev;
-	entry->ctx = ctx;
+struct xnvme_queue_thrpool {
+	struct xnvme_queue_base base;
 
-	entry->data = dvec;
-	entry->data_nbytes = dvec_nbytes;
-	entry->data_vec_cnt = dvec_cnt;
-	entry->meta = mvec;
-	entry->meta_nbytes = mvec_nbytes;
-	entry->meta_vec_cnt = mvec_cnt;
-	entry->is_vectored = true;
+	struct xnvme_be_cbi_async_thrpool_qp *qp;
 
-	err = pthread_mutex_lock(&qp->sq_mutex);
-	if (err) {
-		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
-		XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
-		return -err;
-	}
+	uint8_t _rsvd[224];
+};
+XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_thrpool) == XNVME_BE_QUEUE_STATE_NBYTES,
+		    "Incorrect size")
 
-	STAILQ_INSERT_TAIL(&qp->sq, entry, link);
-	ctx->async.queue->base.outstanding += 1;
+static int
+cbi_async_thrpool_term(struct xnvme_queue *q)
+{
+	struct xnvme_queue_thrpool *queue = (void *)q;
 
-	err = pthread_mutex_unlock(&qp->sq_mutex);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err: %d", err);
+	xnvme_be_cbi_async_thrpool_qp_term(queue->qp);
+	queue->qp = NULL;
+
+	return 0;
+}
+
+static int
+cbi_async_thrpool_init(struct xnvme_queue *q, int XNVME_UNUSED(opts))
+{
+	struct xnvme_queue_thrpool *queue = (void *)q;
+	char *env;
+	int nthreads;
+	int err;
+
+	nthreads = (env = getenv(g_nthreads_env)) ? atoi(env) : g_nthreads_def;
+	if (nthreads <= 0 || nthreads >= 1024) {
+		XNVME_DEBUG("FAILED: invalid nthreads: %d", nthreads);
+		return -EINVAL;
 	}
-	err = pthread_cond_signal(&qp->sq_cond);
+	XNVME_DEBUG("INFO: nthreads: %d", nthreads);
+
+	err = xnvme_be_cbi_async_thrpool_qp_init(&queue->qp, queue->base.dev, queue->base.capacity,
+						 nthreads);
 	if (err) {
-		XNVME_DEBUG("FAILED: pthread_cond_signal(), err: %d", err);
-		return -err;
+		XNVME_DEBUG("FAILED: xnvme_be_cbi_async_thrpool_qp_init(); err: %d", err);
+		return err;
 	}
 
 	return 0;
 }
 
+static int
+cbi_async_thrpool_poke(struct xnvme_queue *q, uint32_t max)
+{
+	struct xnvme_queue_thrpool *queue = (void *)q;
+
+	return xnvme_be_cbi_async_thrpool_qp_reap(queue->qp, max, &q->base.outstanding);
+}
+
+static inline int
+cbi_async_thrpool_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			 size_t mbuf_nbytes)
+{
+	struct xnvme_queue_thrpool *queue = (void *)ctx->async.queue;
+
+	return xnvme_be_cbi_async_thrpool_qp_submit(queue->qp, ctx, dbuf, 0, dbuf_nbytes, mbuf, 0,
+						    mbuf_nbytes, false, &queue->base.outstanding);
+}
+
+static inline int
+cbi_async_thrpool_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+			  size_t dvec_nbytes, struct iovec *mvec, size_t mvec_cnt,
+			  size_t mvec_nbytes)
+{
+	struct xnvme_queue_thrpool *queue = (void *)ctx->async.queue;
+
+	return xnvme_be_cbi_async_thrpool_qp_submit(queue->qp, ctx, dvec, dvec_cnt, dvec_nbytes,
+						    mvec, mvec_cnt, mvec_nbytes, true,
+						    &queue->base.outstanding);
+}
+
 #endif // XNVME_BE_CBI_ASYNC_THRPOOL_ENABLED
 
 struct xnvme_be_async g_xnvme_be_cbi_async_thrpool = {
@@ -433,3 +492,8 @@ struct xnvme_be_async g_xnvme_be_cbi_async_thrpool = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_CBI_ASYNC_THRPOOL_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_cbi_async_thrpool, cbi_async_thrpool_cmd_io,
+			     cbi_async_thrpool_cmd_iov, cbi_async_thrpool_poke)
+#endif
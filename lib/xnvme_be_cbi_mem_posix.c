@@ -3,14 +3,114 @@
 #ifndef _XOPEN_SOURCE
 #define _XOPEN_SOURCE 700
 #endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <xnvme_be.h>
 #include <xnvme_be_nosys.h>
 #ifdef XNVME_BE_CBI_MEM_POSIX_ENABLED
 #include <unistd.h>
 #include <errno.h>
+#include <xnvme_dev.h>
+#ifdef XNVME_BE_LINUX_ENABLED
+#include <malloc.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/queue.h>
+
+// Buffers of at least this size are mapped individually, such that they can grow via mremap()
+static const size_t g_map_nbytes_min = 2 << 20;
+
+/**
+ * Returns whether a buffer of 'nbytes' for 'dev' is mapped individually; that is, when it is large,
+ * or when it is bound to the NUMA node of the device, as binding memory of the heap would affect
+ * its other users
+ */
+static int
+_map_use(const struct xnvme_dev *dev, size_t nbytes)
+{
+	return (nbytes >= g_map_nbytes_min) || (dev && (xnvme_dev_numa_node_pref(dev) >= 0));
+}
+
+struct posix_map {
+	void *addr;
+	size_t nbytes;
+
+	SLIST_ENTRY(posix_map) link;
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	SLIST_HEAD(, posix_map) maps;
+} g_posix = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * Returns the mapping starting at 'buf'; the caller must hold the mutex
+ */
+static struct posix_map *
+_map_find(void *buf)
+{
+	struct posix_map *map;
+
+	for (map = SLIST_FIRST(&g_posix.maps); map; map = SLIST_NEXT(map, link)) {
+		if (map->addr == buf) {
+			return map;
+		}
+	}
+
+	return NULL;
+}
 
 static void *
-buf_alloc(const struct xnvme_dev *XNVME_UNUSED(dev), size_t nbytes, uint64_t *XNVME_UNUSED(phys))
+_map_alloc(const struct xnvme_dev *dev, size_t nbytes)
+{
+	struct posix_map *map;
+
+	map = malloc(sizeof(*map));
+	if (!map) {
+		XNVME_DEBUG("FAILED: malloc(map), errno: %d", errno);
+		return NULL;
+	}
+	map->addr = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map->addr == MAP_FAILED) {
+		XNVME_DEBUG("FAILED: mmap(), errno: %d", errno);
+		free(map);
+		return NULL;
+	}
+	map->nbytes = nbytes;
+
+	xnvme_dev_numa_bind(dev, map->addr, map->nbytes);
+
+	pthread_mutex_lock(&g_posix.mutex);
+	SLIST_INSERT_HEAD(&g_posix.maps, map, link);
+	pthread_mutex_unlock(&g_posix.mutex);
+
+	return map->addr;
+}
+
+/**
+ * Grow or shrink the mapping without copying its content; the caller must hold the mutex
+ */
+static void *
+_map_realloc(struct posix_map *map, size_t nbytes)
+{
+	void *addr;
+
+	addr = mremap(map->addr, map->nbytes, nbytes, MREMAP_MAYMOVE);
+	if (addr == MAP_FAILED) {
+		XNVME_DEBUG("FAILED: mremap(), errno: %d", errno);
+		return NULL;
+	}
+	map->addr = addr;
+	map->nbytes = nbytes;
+
+	return addr;
+}
+#endif
+
+static void *
+buf_alloc(const struct xnvme_dev *dev, size_t nbytes, uint64_t *XNVME_UNUSED(phys))
 {
 	long sz = sysconf(_SC_PAGESIZE);
 
@@ -19,21 +119,87 @@ buf_alloc(const struct xnvme_dev *XNVME_UNUSED(dev), size_t nbytes, uint64_t *XN
 		return NULL;
 	}
 
+#ifdef XNVME_BE_LINUX_ENABLED
+	if (_map_use(dev, nbytes)) {
+		return _map_alloc(dev, (1 + ((nbytes - 1) / sz)) * sz);
+	}
+#else
+	(void)dev;
+#endif
+
 	return xnvme_buf_virt_alloc(sz, nbytes);
 }
 
 static void *
-buf_realloc(const struct xnvme_dev *XNVME_UNUSED(dev), void *XNVME_UNUSED(buf),
-	    size_t XNVME_UNUSED(nbytes), uint64_t *XNVME_UNUSED(phys))
+buf_realloc(const struct xnvme_dev *dev, void *buf, size_t nbytes, uint64_t *phys)
 {
-	XNVME_DEBUG("FAILED: _posix: does not support realloc");
-	errno = ENOSYS;
-	return NULL;
+	long sz = sysconf(_SC_PAGESIZE);
+
+	if (!buf) {
+		return buf_alloc(dev, nbytes, phys);
+	}
+	if (sz == -1) {
+		XNVME_DEBUG("FAILED: sysconf(), errno: %d", errno);
+		return NULL;
+	}
+	if (!nbytes) {
+		XNVME_DEBUG("FAILED: invalid value for nbytes: '%zu')", nbytes);
+		errno = EINVAL;
+		return NULL;
+	}
+
+#ifdef XNVME_BE_LINUX_ENABLED
+	{
+		size_t map_nbytes = (1 + ((nbytes - 1) / sz)) * sz;
+		struct posix_map *map;
+		void *new;
+
+		pthread_mutex_lock(&g_posix.mutex);
+		map = _map_find(buf);
+		new = map ? _map_realloc(map, map_nbytes) : NULL;
+		pthread_mutex_unlock(&g_posix.mutex);
+		if (map) {
+			return new;
+		}
+
+		// Growing beyond the threshold, or bound to a NUMA node; move it to a mapping, which
+		// then grows via mremap()
+		if (_map_use(dev, map_nbytes)) {
+			new = _map_alloc(dev, map_nbytes);
+			if (!new) {
+				return NULL;
+			}
+			memcpy(new, buf, XNVME_MIN_U64(malloc_usable_size(buf), map_nbytes));
+			xnvme_buf_virt_free(buf);
+
+			return new;
+		}
+	}
+#endif
+
+	return xnvme_buf_virt_realloc(buf, sz, nbytes);
 }
 
 static void
 buf_free(const struct xnvme_dev *XNVME_UNUSED(dev), void *buf)
 {
+#ifdef XNVME_BE_LINUX_ENABLED
+	struct posix_map *map;
+
+	pthread_mutex_lock(&g_posix.mutex);
+	map = _map_find(buf);
+	if (map) {
+		SLIST_REMOVE(&g_posix.maps, map, posix_map, link);
+	}
+	pthread_mutex_unlock(&g_posix.mutex);
+
+	if (map) {
+		munmap(map->addr, map->nbytes);
+		free(map);
+		return;
+	}
+#endif
+
 	xnvme_buf_virt_free(buf);
 }
 
@@ -6,40 +6,400 @@
 #ifndef _DEFAULT_SOURCE
 #define _DEFAULT_SOURCE
 #endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <xnvme_be.h>
 #include <xnvme_be_nosys.h>
 #ifdef XNVME_BE_CBI_SYNC_PSYNC_ENABLED
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#ifdef XNVME_BE_LINUX_ENABLED
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
 #include <libxnvme_spec_fs.h>
 #include <xnvme_dev.h>
 #include <xnvme_be_cbi.h>
 
+static ssize_t
+_psync_fdatasync(int fd)
+{
+#ifdef XNVME_BE_MACOS_ENABLED
+	return fsync(fd);
+#else
+	return fdatasync(fd);
+#endif
+}
+
+#if defined(XNVME_BE_LINUX_ENABLED)
+static ssize_t
+_psync_fallocate(int fd, const struct xnvme_spec_fs_cmd *cmd)
+{
+	int mode = 0;
+
+	mode |= (cmd->mode & XNVME_SPEC_FS_FALLOCATE_KEEP_SIZE) ? FALLOC_FL_KEEP_SIZE : 0;
+	mode |= (cmd->mode & XNVME_SPEC_FS_FALLOCATE_PUNCH_HOLE)
+			? (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE)
+			: 0;
+
+	return fallocate(fd, mode, cmd->offset, cmd->nbytes);
+}
+#elif defined(XNVME_BE_FBSD_ENABLED)
+static ssize_t
+_psync_fallocate(int fd, const struct xnvme_spec_fs_cmd *cmd)
+{
+	int err;
+
+	if (cmd->mode) {
+		errno = ENOSYS;
+		return -1;
+	}
+	err = posix_fallocate(fd, cmd->offset, cmd->nbytes);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	return 0;
+}
+#else
+static ssize_t
+_psync_fallocate(int XNVME_UNUSED(fd), const struct xnvme_spec_fs_cmd *XNVME_UNUSED(cmd))
+{
+	errno = ENOSYS;
+	return -1;
+}
+#endif
+
+#ifdef XNVME_BE_LINUX_ENABLED
+/**
+ * Deallocate, or with 'zero' zero, 'nbytes' at 'offset' without writing data; for block-devices
+ * via BLKDISCARD or BLKZEROOUT, and for regular files by punching a hole or zeroing the range
+ */
+static ssize_t
+_psync_deallocate(int fd, off_t offset, size_t nbytes, int zero)
+{
+	struct stat fd_stat;
+
+	if (fstat(fd, &fd_stat)) {
+		return -1;
+	}
+	if (S_ISBLK(fd_stat.st_mode)) {
+		uint64_t range[2] = {offset, nbytes};
+
+		return ioctl(fd, zero ? BLKZEROOUT : BLKDISCARD, range);
+	}
+	if (!zero) {
+		return fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, nbytes);
+	}
+	if (!fallocate(fd, FALLOC_FL_ZERO_RANGE, offset, nbytes)) {
+		return 0;
+	}
+	if (errno != EOPNOTSUPP) {
+		return -1;
+	}
+
+	// E.g. tmpfs can punch holes but not zero ranges; holes, and a file extension, read as zero
+	if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, nbytes)) {
+		return -1;
+	}
+	if (fd_stat.st_size < (off_t)(offset + nbytes)) {
+		return ftruncate(fd, offset + nbytes);
+	}
+
+	return 0;
+}
+#else
+static ssize_t
+_psync_deallocate(int XNVME_UNUSED(fd), off_t XNVME_UNUSED(offset), size_t XNVME_UNUSED(nbytes),
+		  int XNVME_UNUSED(zero))
+{
+	errno = ENOSYS;
+	return -1;
+}
+#endif
+
+#define PSYNC_BOUNCE_POOL_NITEMS 8
+
+/**
+ * Aligned buffers for reads and writes which do not satisfy the alignment of O_DIRECT, these are
+ * kept for re-use, since the async. interfaces "thrpool" and "emu" also end here
+ */
+struct psync_bounce {
+	void *buf;
+	size_t nbytes;
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	struct psync_bounce items[PSYNC_BOUNCE_POOL_NITEMS];
+	int nitems;
+} g_bounce = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static int
+_bounce_get(struct psync_bounce *bounce, size_t nbytes, uint32_t align)
+{
+	pthread_mutex_lock(&g_bounce.mutex);
+	for (int i = 0; i < g_bounce.nitems; ++i) {
+		if ((g_bounce.items[i].nbytes >= nbytes) &&
+		    !((uintptr_t)g_bounce.items[i].buf % align)) {
+			*bounce = g_bounce.items[i];
+			g_bounce.items[i] = g_bounce.items[--g_bounce.nitems];
+			pthread_mutex_unlock(&g_bounce.mutex);
+			return 0;
+		}
+	}
+	pthread_mutex_unlock(&g_bounce.mutex);
+
+	bounce->nbytes = nbytes;
+	return posix_memalign(&bounce->buf, XNVME_MAX(align, sizeof(void *)), nbytes);
+}
+
+static void
+_bounce_put(struct psync_bounce *bounce)
+{
+	pthread_mutex_lock(&g_bounce.mutex);
+	if (g_bounce.nitems < PSYNC_BOUNCE_POOL_NITEMS) {
+		g_bounce.items[g_bounce.nitems++] = *bounce;
+		bounce->buf = NULL;
+	}
+	pthread_mutex_unlock(&g_bounce.mutex);
+
+	free(bounce->buf);
+}
+
+static int
+_is_aligned(uint32_t align, const struct iovec *dvec, size_t dvec_cnt, off_t offset)
+{
+	if (offset % align) {
+		return 0;
+	}
+	for (size_t i = 0; i < dvec_cnt; ++i) {
+		if (((uintptr_t)dvec[i].iov_base % align) || (dvec[i].iov_len % align)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void
+_iov_copy(const struct iovec *dvec, size_t dvec_cnt, uint8_t *buf, size_t nbytes, int to_iov)
+{
+	for (size_t i = 0; (i < dvec_cnt) && nbytes; ++i) {
+		size_t len = XNVME_MIN_U64(dvec[i].iov_len, nbytes);
+
+		if (to_iov) {
+			memcpy(dvec[i].iov_base, buf, len);
+		} else {
+			memcpy(buf, dvec[i].iov_base, len);
+		}
+		buf += len;
+		nbytes -= len;
+	}
+}
+
+#ifdef XNVME_BE_LINUX_ENABLED
+/**
+ * Open the file of the O_DIRECT 'fd' for buffered writes, via its magic link in procfs
+ */
+static int
+_psync_open_buffered(int fd)
+{
+	char path[32];
+
+	snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+
+	return open(path, O_WRONLY | O_CLOEXEC);
+}
+#else
+static int
+_psync_open_buffered(int XNVME_UNUSED(fd))
+{
+	errno = EINVAL;
+	return -1;
+}
+#endif
+
+/**
+ * Read or write 'nbytes' at 'offset' via an aligned bounce-buffer spanning the blocks covered by
+ * the range. For writes, then an unaligned head or tail block is read first, and preserved, that
+ * is, a read-modify-write, which is not atomic with respect to other writers of the same block.
+ *
+ * An unaligned tail-block beyond end-of-file of a regular file cannot be written in full, since
+ * the padding would extend the file; the blocks before it are written via 'fd', and the data of
+ * the tail-block via a buffered fd of the file, opened for the write.
+ */
+static ssize_t
+_psync_bounce(int fd, uint32_t align, int write, const struct iovec *dvec, size_t dvec_cnt,
+	      size_t nbytes, off_t offset)
+{
+	const off_t begin = offset - (offset % align);
+	const off_t end = ((offset + nbytes + align - 1) / align) * align;
+	const size_t ofz = offset - begin;
+	const int head = ofz != 0;
+	int tail = ((offset + nbytes) % align) != 0;
+	struct psync_bounce bounce = {0};
+	struct stat fd_stat = {0};
+	off_t dend = end;
+	ssize_t res;
+	int err;
+
+	err = _bounce_get(&bounce, end - begin, align);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	if (!write) {
+		res = pread(fd, bounce.buf, end - begin, begin);
+		if (res > 0) {
+			res = res > (ssize_t)ofz ? XNVME_MIN_U64(res - ofz, nbytes) : 0;
+			_iov_copy(dvec, dvec_cnt, (uint8_t *)bounce.buf + ofz, res, 1);
+		}
+		goto exit;
+	}
+
+	if (tail && fstat(fd, &fd_stat)) {
+		res = -1;
+		goto exit;
+	}
+	if (tail && S_ISREG(fd_stat.st_mode) && (fd_stat.st_size < end)) {
+		dend = end - align;
+		tail = 0;
+	}
+
+	// Blocks beyond end-of-file read as zeroes
+	memset(bounce.buf, 0, end - begin);
+
+	if (head && (begin < dend) && (pread(fd, bounce.buf, align, begin) < 0)) {
+		res = -1;
+		goto exit;
+	}
+	if (tail && !(head && ((end - align) == begin)) &&
+	    (pread(fd, (uint8_t *)bounce.buf + (end - align - begin), align, end - align) < 0)) {
+		res = -1;
+		goto exit;
+	}
+
+	_iov_copy(dvec, dvec_cnt, (uint8_t *)bounce.buf + ofz, nbytes, 0);
+
+	if (begin < dend) {
+		res = pwrite(fd, bounce.buf, dend - begin, begin);
+		if (res != (dend - begin)) {
+			errno = (res < 0) ? errno : EIO;
+			res = -1;
+			goto exit;
+		}
+	}
+	if (dend < end) {
+		const off_t tbegin = XNVME_MAX_S64(dend, offset);
+		const size_t tnbytes = (offset + nbytes) - tbegin;
+		int wrfd = _psync_open_buffered(fd);
+
+		if (wrfd < 0) {
+			res = -1;
+			goto exit;
+		}
+		res = pwrite(wrfd, (uint8_t *)bounce.buf + (tbegin - begin), tnbytes, tbegin);
+		err = (res < 0) ? errno : EIO;
+		close(wrfd);
+		if (res != (ssize_t)tnbytes) {
+			errno = err;
+			res = -1;
+			goto exit;
+		}
+	}
+	res = nbytes;
+
+exit:
+	_bounce_put(&bounce);
+
+	return res;
+}
+
+static ssize_t
+_psync_rw(struct xnvme_be_cbi_state *state, int write, struct iovec *dvec, size_t dvec_cnt,
+	  size_t dvec_nbytes, off_t offset)
+{
+	if (state->dio_align && !_is_aligned(state->dio_align, dvec, dvec_cnt, offset)) {
+		return _psync_bounce(state->fd, state->dio_align, write, dvec, dvec_cnt, dvec_nbytes,
+				     offset);
+	}
+
+	return write ? pwritev(state->fd, dvec, dvec_cnt, offset)
+		     : preadv(state->fd, dvec, dvec_cnt, offset);
+}
+
+/**
+ * Deallocate the ranges of a Dataset Management command; without the deallocate attribute, then
+ * the command is only a hint, which is ignored. The number of ranges is bounded by the payload.
+ */
+static ssize_t
+_psync_dsm(int fd, uint64_t ssw, const struct xnvme_spec_cmd_dsm *cmd,
+	   const struct xnvme_spec_dsm_range *ranges, size_t ranges_nbytes)
+{
+	uint64_t nranges = XNVME_MIN_U64(cmd->nr + 1, ranges_nbytes / sizeof(*ranges));
+
+	if (!cmd->ad) {
+		return 0;
+	}
+	for (uint64_t i = 0; i < nranges; ++i) {
+		if (_psync_deallocate(fd, ranges[i].slba << ssw, (size_t)ranges[i].nlb << ssw, 0)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Returns the status-code of a transfer expected to be of 'nbytes', a short transfer is an error
+ */
+static inline uint8_t
+_psync_sc_xfer(ssize_t res, size_t nbytes)
+{
+	if (res == (ssize_t)nbytes) {
+		return 0;
+	}
+
+	return ((res < 0) && errno) ? errno : EIO;
+}
+
 int
 xnvme_be_cbi_sync_psync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
 			       void *XNVME_UNUSED(mbuf), size_t XNVME_UNUSED(mbuf_nbytes))
 {
 	struct xnvme_be_cbi_state *state = (void *)ctx->dev->be.state;
 	const uint64_t ssw = ctx->dev->geo.ssw;
+	struct iovec dvec = {.iov_base = dbuf, .iov_len = dbuf_nbytes};
 	ssize_t res;
 	uint8_t sc;
 
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
 		res = pwrite(state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba << ssw);
-		sc = res != (ssize_t)dbuf_nbytes ? errno : 0;
+		sc = _psync_sc_xfer(res, dbuf_nbytes);
 		break;
 	case XNVME_SPEC_NVM_OPC_READ:
 		res = pread(state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba << ssw);
-		sc = res != (ssize_t)dbuf_nbytes ? errno : 0;
+		sc = _psync_sc_xfer(res, dbuf_nbytes);
 		break;
 	case XNVME_SPEC_FS_OPC_WRITE:
-		res = pwrite(state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba);
-		sc = res != (ssize_t)dbuf_nbytes ? errno : 0;
+		res = _psync_rw(state, 1, &dvec, 1, dbuf_nbytes, ctx->cmd.nvm.slba);
+		sc = _psync_sc_xfer(res, dbuf_nbytes);
 		break;
 	case XNVME_SPEC_FS_OPC_READ:
-		res = pread(state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba);
-		sc = res != (ssize_t)dbuf_nbytes ? errno : 0;
+		res = _psync_rw(state, 0, &dvec, 1, dbuf_nbytes, ctx->cmd.nvm.slba);
+		sc = res < 0 ? errno : 0;
 		break;
 
 	case XNVME_SPEC_NVM_OPC_FLUSH:
@@ -48,6 +408,32 @@ xnvme_be_cbi_sync_psync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbu
 		sc = res ? errno : 0;
 		break;
 
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
+		res = _psync_fdatasync(state->fd);
+		sc = res ? errno : 0;
+		break;
+
+	case XNVME_SPEC_FS_OPC_FALLOCATE:
+		res = _psync_fallocate(state->fd, &ctx->cmd.fs);
+		sc = res ? errno : 0;
+		break;
+
+	case XNVME_SPEC_FS_OPC_TRUNCATE:
+		res = ftruncate(state->fd, ctx->cmd.fs.offset);
+		sc = res ? errno : 0;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		res = _psync_deallocate(state->fd, ctx->cmd.write_zeroes.slba << ssw,
+					((size_t)ctx->cmd.write_zeroes.nlb + 1) << ssw, 1);
+		sc = res ? errno : 0;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT:
+		res = _psync_dsm(state->fd, ssw, &ctx->cmd.dsm, dbuf, dbuf_nbytes);
+		sc = res ? errno : 0;
+		break;
+
 	default:
 		sc = res = ENOSYS;
 		break;
@@ -55,7 +441,7 @@ xnvme_be_cbi_sync_psync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbu
 
 	ctx->cpl.result = res;
 	if (sc) {
-		XNVME_DEBUG("FAILED: OPC(%d){pread,pwrite,fsync}(), errno: %d",
+		XNVME_DEBUG("FAILED: OPC(%d){pread,pwrite,fsync,fallocate,ftruncate}(), errno: %d",
 			    ctx->cmd.common.opcode, sc);
 		ctx->cpl.result = 0;
 		ctx->cpl.status.sc = sc;
@@ -79,22 +465,22 @@ xnvme_be_cbi_sync_psync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, s
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
 		res = pwritev(state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba << ssw);
-		sc = res != (ssize_t)dvec_nbytes ? errno : 0;
+		sc = _psync_sc_xfer(res, dvec_nbytes);
 		break;
 
 	case XNVME_SPEC_NVM_OPC_READ:
 		res = preadv(state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba << ssw);
-		sc = res != (ssize_t)dvec_nbytes ? errno : 0;
+		sc = _psync_sc_xfer(res, dvec_nbytes);
 		break;
 
 	case XNVME_SPEC_FS_OPC_WRITE:
-		res = pwritev(state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba);
-		sc = res != (ssize_t)dvec_nbytes ? errno : 0;
+		res = _psync_rw(state, 1, dvec, dvec_cnt, dvec_nbytes, ctx->cmd.nvm.slba);
+		sc = _psync_sc_xfer(res, dvec_nbytes);
 		break;
 
 	case XNVME_SPEC_FS_OPC_READ:
-		res = preadv(state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba);
-		sc = res != (ssize_t)dvec_nbytes ? errno : 0;
+		res = _psync_rw(state, 0, dvec, dvec_cnt, dvec_nbytes, ctx->cmd.nvm.slba);
+		sc = res < 0 ? errno : 0;
 		break;
 
 	case XNVME_SPEC_NVM_OPC_FLUSH:
@@ -103,6 +489,21 @@ xnvme_be_cbi_sync_psync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, s
 		sc = res ? errno : 0;
 		break;
 
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
+		res = _psync_fdatasync(state->fd);
+		sc = res ? errno : 0;
+		break;
+
+	case XNVME_SPEC_FS_OPC_FALLOCATE:
+		res = _psync_fallocate(state->fd, &ctx->cmd.fs);
+		sc = res ? errno : 0;
+		break;
+
+	case XNVME_SPEC_FS_OPC_TRUNCATE:
+		res = ftruncate(state->fd, ctx->cmd.fs.offset);
+		sc = res ? errno : 0;
+		break;
+
 	default:
 		sc = res = ENOSYS;
 		break;
@@ -110,7 +511,7 @@ xnvme_be_cbi_sync_psync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, s
 
 	ctx->cpl.result = res;
 	if (sc) {
-		XNVME_DEBUG("FAILED: OPC(%d){pread,pwrite,fsync}(), errno: %d",
+		XNVME_DEBUG("FAILED: OPC(%d){pread,pwrite,fsync,fallocate,ftruncate}(), errno: %d",
 			    ctx->cmd.common.opcode, sc);
 		ctx->cpl.result = 0;
 		ctx->cpl.status.sc = sc;
@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <linux/fs.h>
 #include <linux/version.h>
@@ -64,6 +65,66 @@ xnvme_file_opts_to_linux(struct xnvme_opts *opts)
 	return flags;
 }
 
+int
+xnvme_be_linux_file_copy(struct xnvme_dev *src, off_t src_offset, struct xnvme_dev *dst,
+			 off_t dst_offset, size_t nbytes, size_t *ncopied)
+{
+	struct xnvme_be_linux_state *src_state = (void *)src->be.state;
+	struct xnvme_be_linux_state *dst_state = (void *)dst->be.state;
+	struct stat src_stat;
+
+	*ncopied = 0;
+
+	if (fstat(src_state->fd, &src_stat)) {
+		return -errno;
+	}
+	if (S_ISREG(src_stat.st_mode)) {
+		if (src_offset >= src_stat.st_size) {
+			return 0;
+		}
+		nbytes = XNVME_MIN_S64(nbytes, src_stat.st_size - src_offset);
+
+		if (!src_offset && !dst_offset && (nbytes == (size_t)src_stat.st_size)) {
+			if (!ioctl(dst_state->fd, FICLONE, src_state->fd)) {
+				*ncopied = nbytes;
+				return 0;
+			}
+		} else {
+			struct file_clone_range range = {
+				.src_fd = src_state->fd,
+				.src_offset = src_offset,
+				.src_length = nbytes,
+				.dest_offset = dst_offset,
+			};
+
+			if (!ioctl(dst_state->fd, FICLONERANGE, &range)) {
+				*ncopied = nbytes;
+				return 0;
+			}
+		}
+		XNVME_DEBUG("INFO: FICLONE{RANGE}, errno: %d; trying copy_file_range()", errno);
+	}
+
+	while (*ncopied < nbytes) {
+		loff_t off_in = src_offset + *ncopied;
+		loff_t off_out = dst_offset + *ncopied;
+		ssize_t res;
+
+		res = copy_file_range(src_state->fd, &off_in, dst_state->fd, &off_out,
+				      nbytes - *ncopied, 0);
+		if (res < 0) {
+			XNVME_DEBUG("FAILED: copy_file_range(), errno: %d", errno);
+			return -errno;
+		}
+		if (!res) {
+			break;
+		}
+		*ncopied += res;
+	}
+
+	return 0;
+}
+
 static struct xnvme_be_mixin g_xnvme_be_mixin_linux[] = {
 	{
 		.mtype = XNVME_BE_MEM,
@@ -75,11 +136,18 @@ static struct xnvme_be_mixin g_xnvme_be_mixin_linux[] = {
 	{
 		.mtype = XNVME_BE_MEM,
 		.name = "hugepage",
-		.descr = "Allocate buffers using hugepages via mmap on hugetlbfs",
+		.descr = "Sub-allocate buffers from an arena of hugepages",
 		.mem = &g_xnvme_be_linux_mem_hugepage,
 		.check_support = xnvme_be_supported,
 	},
 
+	{
+		.mtype = XNVME_BE_ASYNC,
+		.name = "auto",
+		.descr = "Select io_uring_cmd, io_uring, libaio or thrpool by device and kernel",
+		.async = &g_xnvme_be_cbi_async_emu,
+		.check_support = xnvme_be_supported,
+	},
 	{
 		.mtype = XNVME_BE_ASYNC,
 		.name = "emu",
@@ -134,7 +134,14 @@ _linux_libaio_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
 		io_prep_pread(iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba);
 		break;
 
-		// TODO: determine how to handle fsync
+	case XNVME_SPEC_NVM_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FLUSH:
+		io_prep_fsync(iocb, state->fd);
+		break;
+
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
+		io_prep_fdsync(iocb, state->fd);
+		break;
 
 	default:
 		XNVME_DEBUG("FAILED: unsupported opcode: %d", ctx->cmd.common.opcode);
@@ -233,3 +240,8 @@ struct xnvme_be_async g_xnvme_be_linux_async_libaio = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_LINUX_LIBAIO_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_linux_async_libaio, _linux_libaio_cmd_io,
+			     _linux_libaio_cmd_iov, _linux_libaio_poke)
+#endif
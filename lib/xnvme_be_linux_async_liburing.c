@@ -8,6 +8,7 @@
 #ifdef XNVME_BE_LINUX_LIBURING_ENABLED
 #include <pthread.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <liburing.h>
 #include <libxnvme_spec_fs.h>
 #include <xnvme_queue.h>
@@ -42,13 +43,14 @@ static struct sqpoll_wq {
 };
 
 /**
- * Check whether the Kernel supports the io_uring features used by xNVMe
- *
- * @return On success, 0 is returned. On error, negative errno is returned,
- * specifically -ENOSYS;
+ * Result of probing the Kernel for the io_uring opcodes used by xNVMe; 0 when not yet probed,
+ * 1 when supported, and -1 when not supported. The probe sets up, and tears down, a ring, thus,
+ * it is done once per process instead of on every device-open
  */
-int
-_linux_liburing_supported(struct xnvme_dev *XNVME_UNUSED(dev), uint32_t XNVME_UNUSED(opts))
+static int g_linux_liburing_probed;
+
+static int
+_linux_liburing_probe(void)
 {
 	struct io_uring_probe *probe;
 	int err = 0;
@@ -72,7 +74,25 @@ _linux_liburing_supported(struct xnvme_dev *XNVME_UNUSED(dev), uint32_t XNVME_UN
 exit:
 	free(probe);
 
-	return err ? 0 : 1;
+	return err ? -1 : 1;
+}
+
+/**
+ * Check whether the Kernel supports the io_uring features used by xNVMe
+ *
+ * @return 1 when supported, 0 otherwise
+ */
+int
+xnvme_be_linux_liburing_check_support(void)
+{
+	int probed = __atomic_load_n(&g_linux_liburing_probed, __ATOMIC_RELAXED);
+
+	if (!probed) {
+		probed = _linux_liburing_probe();
+		__atomic_store_n(&g_linux_liburing_probed, probed, __ATOMIC_RELAXED);
+	}
+
+	return probed > 0;
 }
 
 int
@@ -96,6 +116,32 @@ retry:
 	return 0;
 }
 
+/**
+ * Pin the SQPOLL thread to the CPU given by XNVME_QUEUE_SQPOLL_CPU, otherwise to the first CPU of
+ * the NUMA node preferred by the device, when it has one
+ */
+static void
+_sqpoll_aff(struct xnvme_dev *dev, struct io_uring_params *params)
+{
+	int node = xnvme_dev_numa_node_pref(dev);
+	char *env;
+	int cpu;
+
+	env = getenv("XNVME_QUEUE_SQPOLL_CPU");
+	if (env) {
+		params->flags |= IORING_SETUP_SQ_AFF;
+		params->sq_thread_cpu = atoi(env);
+		return;
+	}
+
+	cpu = (node < 0) ? -1 : xnvme_be_linux_numa_cpu(node);
+	if (cpu >= 0) {
+		XNVME_DEBUG("INFO: sq_thread_cpu: %d, numa_node: %d", cpu, node);
+		params->flags |= IORING_SETUP_SQ_AFF;
+		params->sq_thread_cpu = cpu;
+	}
+}
+
 int
 xnvme_be_linux_liburing_init(struct xnvme_queue *q, int opts)
 {
@@ -130,11 +176,7 @@ xnvme_be_linux_liburing_init(struct xnvme_queue *q, int opts)
 			if (!g_sqpoll_wq.is_initialized) {
 				struct io_uring_params sqpoll_wq_params = {0};
 
-				env = getenv("XNVME_QUEUE_SQPOLL_CPU");
-				if (env) {
-					sqpoll_wq_params.flags |= IORING_SETUP_SQ_AFF;
-					sqpoll_wq_params.sq_thread_cpu = atoi(env);
-				}
+				_sqpoll_aff(queue->base.dev, &sqpoll_wq_params);
 				sqpoll_wq_params.flags |= IORING_SETUP_SQPOLL;
 				sqpoll_wq_params.flags |= IORING_SETUP_SINGLE_ISSUER;
 
@@ -155,6 +197,8 @@ xnvme_be_linux_liburing_init(struct xnvme_queue *q, int opts)
 			g_sqpoll_wq.refcount += 1;
 			ring_params.wq_fd = g_sqpoll_wq.ring.ring_fd;
 			ring_params.flags |= IORING_SETUP_ATTACH_WQ;
+		} else {
+			_sqpoll_aff(queue->base.dev, &ring_params);
 		}
 		ring_params.flags |= IORING_SETUP_SQPOLL;
 		ring_params.flags |= IORING_SETUP_SINGLE_ISSUER;
@@ -229,6 +273,24 @@ exit:
 	return err;
 }
 
+/**
+ * Zeroing a range via fallocate() is not supported by e.g. tmpfs, then the write-zeroes is done
+ * via the sync. interface, which falls back to punching a hole, like it does for sync. commands
+ */
+static void
+_write_zeroes_fallback(struct xnvme_cmd_ctx *ctx)
+{
+	int err;
+
+	memset(&ctx->cpl, 0, sizeof(ctx->cpl));
+	err = ctx->dev->be.sync.cmd_io(ctx, NULL, 0, NULL, 0);
+	if (err) {
+		XNVME_DEBUG("FAILED: sync.cmd_io(WRITE_ZEROES), err: %d", err);
+		ctx->cpl.status.sc = ctx->cpl.status.sc ? ctx->cpl.status.sc : -err;
+		ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+	}
+}
+
 int
 xnvme_be_linux_liburing_poke(struct xnvme_queue *q, uint32_t max)
 {
@@ -275,7 +337,10 @@ xnvme_be_linux_liburing_poke(struct xnvme_queue *q, uint32_t max)
 		}
 
 		ctx->cpl.result = cqe->res;
-		if (cqe->res < 0) {
+		if ((cqe->res == -EOPNOTSUPP) &&
+		    (ctx->cmd.common.opcode == XNVME_SPEC_NVM_OPC_WRITE_ZEROES)) {
+			_write_zeroes_fallback(ctx);
+		} else if (cqe->res < 0) {
 			ctx->cpl.result = 0;
 			ctx->cpl.status.sc = -cqe->res;
 			ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
@@ -329,6 +394,32 @@ xnvme_be_linux_liburing_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbu
 		opcode = IORING_OP_READ;
 		break;
 
+	case XNVME_SPEC_NVM_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
+		opcode = IORING_OP_FSYNC;
+		break;
+
+	case XNVME_SPEC_FS_OPC_FALLOCATE:
+		opcode = IORING_OP_FALLOCATE;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		ssw = queue->base.dev->geo.ssw;
+		opcode = IORING_OP_FALLOCATE;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT:
+		// A single range is a single fallocate(), without deallocate, then it is a hint
+		if (XNVME_MIN_U64(ctx->cmd.dsm.nr + 1,
+				  dbuf_nbytes / sizeof(struct xnvme_spec_dsm_range)) != 1) {
+			XNVME_DEBUG("FAILED: unsupported DSM nr: %u for async", ctx->cmd.dsm.nr);
+			return -ENOSYS;
+		}
+		ssw = queue->base.dev->geo.ssw;
+		opcode = ctx->cmd.dsm.ad ? IORING_OP_FALLOCATE : IORING_OP_NOP;
+		break;
+
 	default:
 		XNVME_DEBUG("FAILED: unsupported opcode: %d for async", ctx->cmd.common.opcode);
 		return -ENOSYS;
@@ -350,6 +441,49 @@ xnvme_be_linux_liburing_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbu
 	sqe->fd = queue->poll_sq ? 0 : state->fd;
 	sqe->rw_flags = 0;
 	sqe->user_data = (unsigned long)ctx;
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FLUSH:
+		sqe->off = 0;
+		break;
+
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
+		sqe->off = 0;
+		sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+		break;
+
+	case XNVME_SPEC_FS_OPC_FALLOCATE:
+		// The io_uring encoding of fallocate(); mode in 'len' and length in 'addr'
+		sqe->addr = ctx->cmd.fs.nbytes;
+		sqe->len = 0;
+		sqe->len |= (ctx->cmd.fs.mode & XNVME_SPEC_FS_FALLOCATE_KEEP_SIZE)
+				    ? FALLOC_FL_KEEP_SIZE
+				    : 0;
+		sqe->len |= (ctx->cmd.fs.mode & XNVME_SPEC_FS_FALLOCATE_PUNCH_HOLE)
+				    ? (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE)
+				    : 0;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		sqe->off = ctx->cmd.write_zeroes.slba << ssw;
+		sqe->addr = ((uint64_t)ctx->cmd.write_zeroes.nlb + 1) << ssw;
+		sqe->len = FALLOC_FL_ZERO_RANGE;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT: {
+		const struct xnvme_spec_dsm_range *range = dbuf;
+
+		if (!ctx->cmd.dsm.ad) {
+			break;
+		}
+		// On block-devices, then the kernel does this by zeroing with unmap
+		sqe->off = range->slba << ssw;
+		sqe->addr = (uint64_t)range->nlb << ssw;
+		sqe->len = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+		break;
+	}
+	}
 	// sqe->__pad2[0] = sqe->__pad2[1] = sqe->__pad2[2] = 0;
 
 	err = io_uring_submit(&queue->ring);
@@ -449,3 +583,8 @@ struct xnvme_be_async g_xnvme_be_linux_async_liburing = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_LINUX_LIBURING_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_linux_async_liburing, xnvme_be_linux_liburing_cmd_io,
+			     xnvme_be_linux_liburing_cmd_iov, xnvme_be_linux_liburing_poke)
+#endif
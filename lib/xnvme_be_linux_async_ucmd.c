@@ -23,11 +23,21 @@ static int g_linux_liburing_optional[] = {
 static int g_linux_liburing_noptional =
 	sizeof g_linux_liburing_optional / sizeof(*g_linux_liburing_optional);
 
+/**
+ * Number of optional opcodes not supported by the Kernel, plus one, such that 0 means not yet
+ * probed; the probe is done once per process instead of on every queue-init
+ */
+static int g_linux_liburing_noptional_probed;
+
 static int
 _linux_liburing_noptional_missing(void)
 {
 	struct io_uring_probe *probe;
-	int missing = 0;
+	int missing = __atomic_load_n(&g_linux_liburing_noptional_probed, __ATOMIC_RELAXED);
+
+	if (missing) {
+		return missing - 1;
+	}
 
 	probe = io_uring_get_probe();
 	if (!probe) {
@@ -43,9 +53,17 @@ _linux_liburing_noptional_missing(void)
 
 	io_uring_free_probe(probe);
 
+	__atomic_store_n(&g_linux_liburing_noptional_probed, missing + 1, __ATOMIC_RELAXED);
+
 	return missing;
 }
 
+int
+xnvme_be_linux_ucmd_check_support(void)
+{
+	return xnvme_be_linux_liburing_check_support() && !_linux_liburing_noptional_missing();
+}
+
 int
 xnvme_be_linux_ucmd_init(struct xnvme_queue *q, int opts)
 {
@@ -276,3 +294,8 @@ struct xnvme_be_async g_xnvme_be_linux_async_ucmd = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_LINUX_UCMD_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_linux_async_ucmd, xnvme_be_linux_ucmd_io,
+			     xnvme_be_linux_ucmd_iov, xnvme_be_linux_ucmd_poke)
+#endif
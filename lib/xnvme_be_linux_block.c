@@ -8,6 +8,9 @@
 #include <xnvme_be_nosys.h>
 #ifdef XNVME_BE_LINUX_BLOCK_ENABLED
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <libxnvme_znd.h>
@@ -386,25 +389,292 @@ exit:
 	return err;
 }
 
+/**
+ * Value of 'rsvd' of a zone, whose state is not loaded from the device
+ */
+#define XNVME_BE_LINUX_BLOCK_ZAPPEND_INVALID UINT64_MAX
+
+/**
+ * A zone of the Zone Append emulation; appenders reserve LBAs by atomically advancing 'rsvd', and
+ * write them in the order of reservation, by waiting for 'wp' to reach their reservation, thus,
+ * the writes arrive at the device in write-pointer order. Reservations never exceed 'zelba'.
+ */
+struct xnvme_be_linux_block_zappend_zone {
+	uint64_t rsvd;  ///< Next LBA to reserve, the INVALID value above when not loaded
+	uint64_t wp;    ///< Start of the oldest reservation not yet written
+	uint64_t zelba; ///< First LBA beyond the capacity of the zone
+	uint32_t err;   ///< Whether a write failed, thus 'wp' no longer matches the device
+};
+
+struct xnvme_be_linux_block_zappend {
+	pthread_mutex_t lock; ///< Serializes the loading of zones from the device
+	uint64_t nzones;
+	struct xnvme_be_linux_block_zappend_zone zones[];
+};
+
+void
+xnvme_be_linux_block_zappend_term(struct xnvme_be_linux_state *state)
+{
+	if (!state->zappend) {
+		return;
+	}
+
+	pthread_mutex_destroy(&state->zappend->lock);
+	free(state->zappend);
+	state->zappend = NULL;
+}
+
+static struct xnvme_be_linux_block_zappend *
+_zappend_get(struct xnvme_dev *dev)
+{
+	struct xnvme_be_linux_state *state = (void *)dev->be.state;
+	struct xnvme_be_linux_block_zappend *zappend, *expected = NULL;
+
+	zappend = __atomic_load_n(&state->zappend, __ATOMIC_ACQUIRE);
+	if (zappend) {
+		return zappend;
+	}
+
+	zappend = calloc(1, sizeof(*zappend) + dev->geo.nzone * sizeof(*zappend->zones));
+	if (!zappend) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return NULL;
+	}
+	pthread_mutex_init(&zappend->lock, NULL);
+	zappend->nzones = dev->geo.nzone;
+	for (uint64_t zidx = 0; zidx < zappend->nzones; ++zidx) {
+		zappend->zones[zidx].rsvd = XNVME_BE_LINUX_BLOCK_ZAPPEND_INVALID;
+	}
+
+	if (!__atomic_compare_exchange_n(&state->zappend, &expected, zappend, false,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_destroy(&zappend->lock);
+		free(zappend);
+		return expected;
+	}
+
+	return zappend;
+}
+
+/**
+ * Load the write pointer, and capacity, of the zone from the device, unless already loaded; the
+ * state is published by the store of 'rsvd'
+ */
+static int
+_zappend_zone_load(struct xnvme_dev *dev, struct xnvme_be_linux_block_zappend *zappend,
+		   uint64_t zidx)
+{
+	struct xnvme_be_linux_block_zappend_zone *zone = &zappend->zones[zidx];
+	struct blk_zone_report *rprt = NULL;
+	struct xnvme_spec_znd_descr zdescr = {0};
+	int err;
+
+	pthread_mutex_lock(&zappend->lock);
+	if (__atomic_load_n(&zone->rsvd, __ATOMIC_ACQUIRE) !=
+	    XNVME_BE_LINUX_BLOCK_ZAPPEND_INVALID) {
+		pthread_mutex_unlock(&zappend->lock);
+		return 0;
+	}
+
+	err = _lzbd_ioctl_rprt_alloc(1, &rprt);
+	if (err) {
+		XNVME_DEBUG("FAILED: _lzbd_ioctl_rprt_alloc(), err: %d", err);
+		err = -ENOMEM;
+		goto exit;
+	}
+	err = _lzbd_ioctl_rprt(dev, zidx * dev->geo.nsect, 1, rprt);
+	if (err || (rprt->nr_zones != 1)) {
+		XNVME_DEBUG("FAILED: _lzbd_ioctl_rprt(), err: %d, errno: %d", err, errno);
+		err = -EIO;
+		goto exit;
+	}
+	_lzbd_ioctl_zblk_to_descr(dev, rprt, &rprt->zones[0], &zdescr);
+
+	__atomic_store_n(&zone->wp, zdescr.wp, __ATOMIC_RELAXED);
+	__atomic_store_n(&zone->zelba, zdescr.zslba + zdescr.zcap, __ATOMIC_RELAXED);
+	__atomic_store_n(&zone->err, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&zone->rsvd, zdescr.wp, __ATOMIC_RELEASE);
+
+exit:
+	pthread_mutex_unlock(&zappend->lock);
+	free(rprt);
+
+	return err;
+}
+
+/**
+ * Drop the loaded state of the zones in [zslba, zslba + nzones), such that it is re-loaded by the
+ * next append; this is done when the write pointer is moved by other means than append
+ */
+static void
+_zappend_invalidate(struct xnvme_dev *dev, uint64_t zslba, uint64_t nzones)
+{
+	struct xnvme_be_linux_state *state = (void *)dev->be.state;
+	struct xnvme_be_linux_block_zappend *zappend;
+	const uint64_t zidx = zslba / dev->geo.nsect;
+
+	zappend = __atomic_load_n(&state->zappend, __ATOMIC_ACQUIRE);
+	if (!zappend) {
+		return;
+	}
+
+	for (uint64_t i = zidx; (i < zidx + nzones) && (i < zappend->nzones); ++i) {
+		struct xnvme_be_linux_block_zappend_zone *zone = &zappend->zones[i];
+		uint64_t wp = __atomic_load_n(&zone->wp, __ATOMIC_ACQUIRE);
+
+		// Only when no appends are in flight, that is, nothing is reserved beyond 'wp';
+		// otherwise the state is kept, as the reservations are written from it
+		__atomic_compare_exchange_n(&zone->rsvd, &wp, XNVME_BE_LINUX_BLOCK_ZAPPEND_INVALID,
+					    false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	}
+}
+
+/**
+ * Reserve 'nlbas' LBAs of the zone, loading its state when needed
+ *
+ * @return On success, 0 is returned and the first LBA is assigned to 'lba'. On error, negative
+ * `errno` is returned, -ENOSPC when the reservation exceeds the capacity of the zone.
+ */
+static int
+_zappend_reserve(struct xnvme_dev *dev, struct xnvme_be_linux_block_zappend *zappend,
+		 uint64_t zidx, uint64_t nlbas, uint64_t *lba)
+{
+	struct xnvme_be_linux_block_zappend_zone *zone = &zappend->zones[zidx];
+	uint64_t rsvd;
+
+	for (;;) {
+		rsvd = __atomic_load_n(&zone->rsvd, __ATOMIC_ACQUIRE);
+		if (rsvd == XNVME_BE_LINUX_BLOCK_ZAPPEND_INVALID) {
+			int err = _zappend_zone_load(dev, zappend, zidx);
+			if (err) {
+				XNVME_DEBUG("FAILED: _zappend_zone_load(), err: %d", err);
+				return err;
+			}
+			continue;
+		}
+		if ((rsvd + nlbas) > __atomic_load_n(&zone->zelba, __ATOMIC_RELAXED)) {
+			return -ENOSPC;
+		}
+		if (__atomic_compare_exchange_n(&zone->rsvd, &rsvd, rsvd + nlbas, false,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			break;
+		}
+	}
+
+	*lba = rsvd;
+
+	return 0;
+}
+
+/**
+ * Emulate Zone Append by a write at an LBA reserved from the write pointer kept by the library,
+ * the LBA is returned in the completion-result, as it would be by Zone Append
+ */
+static int
+_lzbd_zone_append(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	const uint64_t nlbas = (uint64_t)ctx->cmd.znd.append.nlb + 1;
+	const uint64_t zidx = ctx->cmd.znd.append.zslba / ctx->dev->geo.nsect;
+	struct xnvme_be_linux_block_zappend_zone *zone;
+	struct xnvme_be_linux_block_zappend *zappend;
+	struct xnvme_spec_cmd cmd = ctx->cmd;
+	uint64_t lba;
+	int err;
+
+	if ((ctx->dev->geo.type != XNVME_GEO_ZONED) ||
+	    (ctx->cmd.znd.append.zslba % ctx->dev->geo.nsect)) {
+		XNVME_DEBUG("FAILED: zslba: 0x%" PRIx64, ctx->cmd.znd.append.zslba);
+		return -EINVAL;
+	}
+	zappend = _zappend_get(ctx->dev);
+	if (!zappend) {
+		return -errno;
+	}
+	if (zidx >= zappend->nzones) {
+		XNVME_DEBUG("FAILED: zidx: %" PRIu64 " >= nzones: %" PRIu64, zidx, zappend->nzones);
+		return -EINVAL;
+	}
+	zone = &zappend->zones[zidx];
+
+	// Nothing is reserved when the zone is full, thus, 'wp' is left as is
+	err = _zappend_reserve(ctx->dev, zappend, zidx, nlbas, &lba);
+	if (err) {
+		XNVME_DEBUG("FAILED: _zappend_reserve(), nlbas: %" PRIu64 ", err: %d", nlbas, err);
+		if (err == -ENOSPC) {
+			ctx->cpl.status.sc = XNVME_SPEC_ZND_SC_IS_FULL;
+			ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_CMDSPEC;
+			err = -EIO;
+		}
+		ctx->cpl.result = 0;
+		return err;
+	}
+
+	// Wait for the preceding reservations to be written
+	while (__atomic_load_n(&zone->wp, __ATOMIC_ACQUIRE) != lba) {
+		sched_yield();
+	}
+
+	if (__atomic_load_n(&zone->err, __ATOMIC_ACQUIRE)) {
+		XNVME_DEBUG("FAILED: lba: 0x%" PRIx64 ", nlbas: %" PRIu64 ", zone->err: %u", lba,
+			    nlbas, zone->err);
+		ctx->cpl.status.sc = XNVME_SPEC_ZND_SC_INVALID_WRITE;
+		ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_CMDSPEC;
+		err = -EIO;
+	} else {
+		ctx->cmd.common.opcode = XNVME_SPEC_NVM_OPC_WRITE;
+		ctx->cmd.nvm.slba = lba;
+		err = xnvme_be_cbi_sync_psync_cmd_io(ctx, dbuf, dbuf_nbytes, NULL, 0);
+		ctx->cmd = cmd;
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_be_cbi_sync_psync_cmd_io(), err: %d", err);
+			__atomic_store_n(&zone->err, 1, __ATOMIC_RELEASE);
+		}
+	}
+	ctx->cpl.result = err ? 0 : lba;
+
+	// The reservation is within the capacity of the zone, thus, so is 'wp'
+	__atomic_store_n(&zone->wp, lba + nlbas, __ATOMIC_RELEASE);
+
+	return err;
+}
+
 int
 xnvme_be_linux_block_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
 			    size_t mbuf_nbytes)
 {
+	int err;
+
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		err = xnvme_be_cbi_sync_psync_cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+		if (ctx->dev->geo.type == XNVME_GEO_ZONED) {
+			_zappend_invalidate(ctx->dev, ctx->cmd.nvm.slba, 1);
+		}
+		return err;
+
 	case XNVME_SPEC_NVM_OPC_READ:
 	case XNVME_SPEC_FS_OPC_WRITE:
 	case XNVME_SPEC_FS_OPC_READ:
 	case XNVME_SPEC_NVM_OPC_FLUSH:
 	case XNVME_SPEC_FS_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
+	case XNVME_SPEC_FS_OPC_FALLOCATE:
+	case XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT:
 		return xnvme_be_cbi_sync_psync_cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
 
 	case XNVME_SPEC_ZND_OPC_MGMT_SEND:
-		return _lzbd_zone_mgmt_send(ctx);
+		err = _lzbd_zone_mgmt_send(ctx);
+		_zappend_invalidate(ctx->dev, ctx->cmd.znd.mgmt_send.slba,
+				    ctx->cmd.znd.mgmt_send.select_all ? ctx->dev->geo.nzone : 1);
+		return err;
 
 	case XNVME_SPEC_ZND_OPC_MGMT_RECV:
 		return _lzbd_zone_mgmt_recv(ctx, dbuf, dbuf_nbytes);
 
+	case XNVME_SPEC_ZND_OPC_APPEND:
+		return _lzbd_zone_append(ctx, dbuf, dbuf_nbytes);
+
 	default:
 		XNVME_DEBUG("FAILED: nosys opcode: %d", ctx->cmd.common.opcode);
 		return -ENOSYS;
@@ -10,12 +10,19 @@
 #include <dirent.h>
 #include <paths.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <linux/fs.h>
 #include <linux/version.h>
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+#include <liburing.h>
+#endif
 #include <libxnvme_file.h>
 #include <libxnvme_spec_fs.h>
 #include <libxnvme_adm.h>
@@ -24,6 +31,27 @@
 #include <xnvme_be_cbi.h>
 #include <xnvme_be_linux.h>
 #include <xnvme_be_linux_nvme.h>
+#include <xnvme_be_registry.h>
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+#include <xnvme_queue.h>
+#include <xnvme_be_linux_liburing.h>
+#endif
+
+/**
+ * Tear down the state besides the file-descriptor, which is returned for the caller to close
+ */
+static inline int
+_be_linux_state_release(struct xnvme_be_linux_state *state)
+{
+	int fd = state->fd;
+
+#ifdef XNVME_BE_LINUX_BLOCK_ENABLED
+	xnvme_be_linux_block_zappend_term(state);
+#endif
+	state->fd = 0;
+
+	return fd;
+}
 
 static inline void
 _be_linux_state_term(struct xnvme_be_linux_state *state)
@@ -32,8 +60,414 @@ _be_linux_state_term(struct xnvme_be_linux_state *state)
 		return;
 	}
 
-	close(state->fd);
-	state->fd = 0;
+	close(_be_linux_state_release(state));
+}
+
+/**
+ * Returns the alignment which O_DIRECT requires of offsets, lengths and buffers, or 0 when 'fd'
+ * is not opened with O_DIRECT e.g. when the open() fell back to buffered I/O
+ */
+static uint32_t
+_dio_align(int fd, const struct stat *dev_stat)
+{
+	int flags = fcntl(fd, F_GETFL);
+	int nbytes;
+
+	if ((flags == -1) || !(flags & O_DIRECT)) {
+		return 0;
+	}
+
+#ifdef STATX_DIOALIGN
+	{
+		struct statx stx = {0};
+
+		if (!statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) &&
+		    (stx.stx_mask & STATX_DIOALIGN) && stx.stx_dio_offset_align) {
+			return XNVME_MAX(stx.stx_dio_offset_align, stx.stx_dio_mem_align);
+		}
+	}
+#endif
+
+	if (S_ISBLK(dev_stat->st_mode) && !ioctl(fd, BLKSSZGET, &nbytes) && (nbytes > 0)) {
+		return nbytes;
+	}
+
+	// The block-size of the file-system is a multiple of the logical block-size of the device
+	return dev_stat->st_blksize > 0 ? dev_stat->st_blksize : 4096;
+}
+
+/**
+ * Set the LBA-size of the geometry of a regular file to the alignment which O_DIRECT requires of
+ * it, at least 512 bytes, such that reads and writes of whole LBAs satisfy it; the MDTS is that of
+ * a regular file, capped at 127 LBAs, as for other devices
+ */
+static void
+_file_geo_lba(struct xnvme_geo *geo, uint32_t dio_align)
+{
+	geo->lba_nbytes = XNVME_MAX(dio_align, 512);
+	geo->mdts_nbytes = XNVME_MIN_U64(1 << 20, (uint64_t)geo->lba_nbytes * 127);
+	geo->ssw = XNVME_ILOG2(geo->lba_nbytes);
+}
+
+/**
+ * Read the sysfs attribute 'attr' of the block-device 'blk' into 'buf', without trailing newline
+ */
+static int
+_sysfs_read(const char *blk, const char *attr, char *buf, size_t nbytes)
+{
+	char path[PATH_MAX];
+	ssize_t len;
+	int fd;
+
+	snprintf(path, sizeof(path), "/sys/block/%s/%s", blk, attr);
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -errno;
+	}
+	len = read(fd, buf, nbytes - 1);
+	if (len < 0) {
+		int err = -errno;
+
+		close(fd);
+		return err;
+	}
+	close(fd);
+
+	while (len && ((buf[len - 1] == '\n') || (buf[len - 1] == ' '))) {
+		len -= 1;
+	}
+	buf[len] = '\0';
+
+	return 0;
+}
+
+static int
+_sysfs_u64(const char *blk, const char *attr, uint64_t *val)
+{
+	char buf[32];
+	char *end;
+	int err;
+
+	err = _sysfs_read(blk, attr, buf, sizeof(buf));
+	if (err) {
+		return err;
+	}
+	*val = strtoull(buf, &end, 10);
+
+	return (end == buf) ? -EINVAL : 0;
+}
+
+/**
+ * Get the name of the block-device in sysfs of the given NVMe device-path, that is, "nvme0n1"
+ * for both "/dev/nvme0n1" and its generic char-device "/dev/ng0n1"
+ */
+static int
+_sysfs_blk(const char *uri, char *blk, size_t nbytes)
+{
+	const char *name = strrchr(uri, '/') ? strrchr(uri, '/') + 1 : uri;
+	int ctrl, ns;
+
+	if (sscanf(name, "ng%dn%d", &ctrl, &ns) == 2) {
+		snprintf(blk, nbytes, "nvme%dn%d", ctrl, ns);
+		return 0;
+	}
+	if (strncmp(name, "nvme", 4)) {
+		return -EINVAL;
+	}
+	snprintf(blk, nbytes, "%s", name);
+
+	return 0;
+}
+
+#define XNVME_BE_LINUX_IDFY_CACHE_ENV     "XNVME_IDFY_CACHE_DIR"
+#define XNVME_BE_LINUX_IDFY_CACHE_MAGIC   0x79666469
+#define XNVME_BE_LINUX_IDFY_CACHE_VERSION 2
+
+/**
+ * The identify-data of a namespace, as stored in the identify-cache; fields which change at
+ * runtime, that is, the utilization of the namespace and the unallocated capacity of the
+ * controller, are not stored, they are zero when loaded from the cache
+ */
+struct _idfy_cache_entry {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t csi;
+	uint32_t rsvd;
+	struct xnvme_spec_idfy_ctrlr ctrlr;
+	struct xnvme_spec_idfy_ns ns;
+	struct xnvme_spec_idfy_ctrlr ctrlr_css;
+	struct xnvme_spec_idfy_ns ns_css;
+};
+
+static void
+_idfy_cache_sanitize(char *str)
+{
+	for (; *str; ++str) {
+		int valid = ((*str >= '0') && (*str <= '9')) || ((*str >= 'a') && (*str <= 'z')) ||
+			    ((*str >= 'A') && (*str <= 'Z')) || (*str == '.') || (*str == '-');
+
+		*str = valid ? *str : '_';
+	}
+}
+
+/**
+ * The format and size of a namespace, as reported by sysfs, used as part of the key of an entry
+ * in the identify-cache, and for validating the entry on load
+ */
+struct _idfy_cache_key {
+	uint64_t lbsz;  ///< Logical block size in bytes
+	uint64_t ms;    ///< Metadata bytes per logical block
+	uint64_t nsect; ///< Size of the namespace in 512-byte sectors
+};
+
+/**
+ * Get the path of the entry of the namespace in the identify-cache; the entry is keyed by the
+ * serial and firmware-revision of the controller, the namespace-identifier, and the format and
+ * size of the namespace, as reported by sysfs and returned in 'key'
+ */
+static int
+_idfy_cache_path(const struct xnvme_dev *dev, char *path, size_t nbytes,
+		 struct _idfy_cache_key *key)
+{
+	const char *dir = getenv(XNVME_BE_LINUX_IDFY_CACHE_ENV);
+	char blk[64], sn[64], fr[32];
+
+	if (!dir || !dir[0]) {
+		return -ENOENT;
+	}
+	if (_sysfs_blk(dev->ident.uri, blk, sizeof(blk)) ||
+	    _sysfs_read(blk, "device/serial", sn, sizeof(sn)) ||
+	    _sysfs_read(blk, "device/firmware_rev", fr, sizeof(fr)) ||
+	    _sysfs_u64(blk, "queue/logical_block_size", &key->lbsz) ||
+	    _sysfs_u64(blk, "size", &key->nsect)) {
+		XNVME_DEBUG("INFO: no sysfs-attributes for the identify-cache of: %s",
+			    dev->ident.uri);
+		return -ENOENT;
+	}
+	key->ms = 0;
+	_sysfs_u64(blk, "metadata_bytes", &key->ms);
+
+	_idfy_cache_sanitize(sn);
+	_idfy_cache_sanitize(fr);
+	snprintf(path, nbytes, "%s/%s-%s-%u-%" PRIu64 "-%" PRIu64 "-%" PRIu64 ".idfy", dir, sn, fr,
+		 dev->ident.nsid, key->lbsz, key->ms, key->nsect);
+
+	return 0;
+}
+
+/**
+ * Check that the identify-namespace of an entry agrees with the format and size of the namespace
+ * reported by sysfs; 0 when it does, -EINVAL otherwise
+ */
+static int
+_idfy_cache_check(const struct xnvme_spec_idfy_ns *ns, const struct _idfy_cache_key *key)
+{
+	const struct xnvme_spec_lbaf *lbaf;
+	uint8_t fmt = ns->flbas.format | (ns->flbas.format_msb << 4);
+
+	if ((fmt > ns->nlbaf) || (fmt >= 64)) {
+		return -EINVAL;
+	}
+	lbaf = &ns->lbaf[fmt];
+
+	if ((lbaf->ds >= 32) || ((1ULL << lbaf->ds) != key->lbsz) || (lbaf->ms != key->ms) ||
+	    ((ns->nsze << lbaf->ds) >> 9 != key->nsect)) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int
+_idfy_cache_load(struct xnvme_dev *dev, const char *path, const struct _idfy_cache_key *key)
+{
+	struct _idfy_cache_entry *entry;
+	ssize_t nbytes;
+	int fd, err = 0;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -errno;
+	}
+	entry = malloc(sizeof(*entry));
+	if (!entry) {
+		err = -errno;
+		close(fd);
+		return err;
+	}
+
+	nbytes = read(fd, entry, sizeof(*entry));
+	if ((nbytes != sizeof(*entry)) || (entry->magic != XNVME_BE_LINUX_IDFY_CACHE_MAGIC) ||
+	    (entry->version != XNVME_BE_LINUX_IDFY_CACHE_VERSION) ||
+	    _idfy_cache_check(&entry->ns, key)) {
+		XNVME_DEBUG("INFO: invalid identify-cache entry: %s", path);
+		err = -EINVAL;
+		goto exit;
+	}
+
+	dev->ident.csi = entry->csi;
+	memcpy(&dev->id.ctrlr, &entry->ctrlr, sizeof(dev->id.ctrlr));
+	memcpy(&dev->id.ns, &entry->ns, sizeof(dev->id.ns));
+	memcpy(&dev->idcss.ctrlr, &entry->ctrlr_css, sizeof(dev->idcss.ctrlr));
+	memcpy(&dev->idcss.ns, &entry->ns_css, sizeof(dev->idcss.ns));
+	memcpy(dev->ident.subnqn, dev->id.ctrlr.subnqn, sizeof(dev->ident.subnqn));
+
+exit:
+	free(entry);
+	close(fd);
+
+	return err;
+}
+
+/**
+ * Store the identify-data of 'dev' in the identify-cache; the entry is written to a temporary
+ * file which is then renamed, thus, concurrent readers never see a partial entry
+ */
+static void
+_idfy_cache_store(const struct xnvme_dev *dev, const char *path)
+{
+	struct _idfy_cache_entry *entry;
+	char tmp[PATH_MAX + 8];
+	int fd;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry) {
+		return;
+	}
+	entry->magic = XNVME_BE_LINUX_IDFY_CACHE_MAGIC;
+	entry->version = XNVME_BE_LINUX_IDFY_CACHE_VERSION;
+	entry->csi = dev->ident.csi;
+	memcpy(&entry->ctrlr, &dev->id.ctrlr, sizeof(entry->ctrlr));
+	memcpy(&entry->ns, &dev->id.ns, sizeof(entry->ns));
+	memcpy(&entry->ctrlr_css, &dev->idcss.ctrlr, sizeof(entry->ctrlr_css));
+	memcpy(&entry->ns_css, &dev->idcss.ns, sizeof(entry->ns_css));
+	entry->ns.nuse = 0;
+	memset(entry->ctrlr.unvmcap, 0, sizeof(entry->ctrlr.unvmcap));
+
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+	fd = mkstemp(tmp);
+	if (fd < 0) {
+		XNVME_DEBUG("INFO: mkstemp(%s), errno: %d", tmp, errno);
+		free(entry);
+		return;
+	}
+	if ((write(fd, entry, sizeof(*entry)) != sizeof(*entry)) || rename(tmp, path)) {
+		XNVME_DEBUG("INFO: failed storing identify-cache entry: %s", path);
+		unlink(tmp);
+	}
+	close(fd);
+	free(entry);
+}
+
+/**
+ * Returns 1 when the kernel reports the NVMe namespace as a non-zoned block-device, that is, the
+ * command-set is known to be NVM, 0 otherwise
+ */
+static int
+_csi_nvm_known(const struct xnvme_dev *dev)
+{
+	char blk[64], zoned[32];
+
+	if (_sysfs_blk(dev->ident.uri, blk, sizeof(blk)) ||
+	    _sysfs_read(blk, "queue/zoned", zoned, sizeof(zoned))) {
+		return 0;
+	}
+
+	return !strcmp(zoned, "none");
+}
+
+/**
+ * Identify the device, via the identify-cache for NVMe namespaces when it is enabled, by setting
+ * the environment variable XNVME_IDFY_CACHE_DIR to an existing directory. Without the cache, then
+ * the command-set specific identify of NVM namespaces is deferred until first use.
+ */
+static int
+_idfy(struct xnvme_dev *dev)
+{
+	struct _idfy_cache_key key;
+	char path[PATH_MAX];
+	int err;
+
+	if (dev->ident.dtype != XNVME_DEV_TYPE_NVME_NAMESPACE) {
+		return xnvme_be_dev_idfy(dev);
+	}
+	if (_idfy_cache_path(dev, path, sizeof(path), &key)) {
+		return _csi_nvm_known(dev) ? xnvme_be_dev_idfy_defer(dev) : xnvme_be_dev_idfy(dev);
+	}
+	if (!_idfy_cache_load(dev, path, &key)) {
+		XNVME_DEBUG("INFO: identify-cache hit: %s", path);
+		return 0;
+	}
+
+	err = xnvme_be_dev_idfy(dev);
+	if (!err) {
+		_idfy_cache_store(dev, path);
+	}
+
+	return err;
+}
+
+static int
+_async_liburing_supported(void)
+{
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+	return xnvme_be_linux_liburing_check_support();
+#else
+	return 0;
+#endif
+}
+
+static int
+_async_ucmd_supported(void)
+{
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+	return xnvme_be_linux_ucmd_check_support();
+#else
+	return 0;
+#endif
+}
+
+static int
+_async_libaio_supported(void)
+{
+#ifdef XNVME_BE_LINUX_LIBAIO_ENABLED
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Select the asynchronous interface of 'dev', when none, or "auto", is given. The fastest one
+ * that the kernel supports is preferred: io_uring_cmd for NVMe char-devices, and io_uring, then
+ * libaio, for block-devices and regular files. Otherwise thrpool, which, like emu, carries every
+ * command via the sync. interface, but with commands in flight. Thus, also zoned namespaces, and
+ * namespaces with metadata, via the block-device use thrpool, as io_uring and libaio carry
+ * neither zone-management nor metadata. With the 'async_pinned' build-option, then it is the
+ * pinned interface. The caller enables 'async_helper', such that commands which the selected
+ * interface does not carry, e.g. write-zeroes and DSM via libaio, are carried via sync.
+ */
+static struct xnvme_be_async
+_async_auto(const struct xnvme_ident *ident, const struct xnvme_geo *geo, mode_t fmt)
+{
+	int nvme_chr = (fmt == S_IFCHR) && (ident->dtype == XNVME_DEV_TYPE_NVME_NAMESPACE);
+	int broad = (ident->csi == XNVME_SPEC_CSI_ZONED) || geo->nbytes_oob;
+
+#ifdef XNVME_BE_ASYNC_PINNED_ENABLED
+	return *xnvme_be_async_pinned;
+#endif
+	if (nvme_chr && _async_ucmd_supported()) {
+		return g_xnvme_be_linux_async_ucmd;
+	}
+	if (!nvme_chr && !broad && _async_liburing_supported()) {
+		return g_xnvme_be_linux_async_liburing;
+	}
+	if (!nvme_chr && !broad && (fmt != S_IFCHR) && _async_libaio_supported()) {
+		return g_xnvme_be_linux_async_libaio;
+	}
+
+	return g_xnvme_be_cbi_async_thrpool;
 }
 
 int
@@ -71,6 +505,9 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 		XNVME_DEBUG("FAILED: open() : fstat() : err: %d, errno: %d", err, errno);
 		return -errno;
 	}
+	dev->numa_node = xnvme_be_linux_numa_node(&dev_stat);
+	state->dio_align = _dio_align(state->fd, &dev_stat);
+	XNVME_DEBUG("INFO: open() : dio_align: %u", state->dio_align);
 
 	// Change {async,sync,admin} based on file unless one was explicitly requested
 	switch (dev_stat.st_mode & S_IFMT) {
@@ -85,9 +522,6 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 		if (!opts->sync) {
 			dev->be.sync = g_xnvme_be_cbi_sync_psync;
 		}
-		if (!opts->async) {
-			dev->be.async = g_xnvme_be_cbi_async_emu;
-		}
 		break;
 
 	case S_IFBLK:
@@ -102,9 +536,6 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 		if (!opts->sync) {
 			dev->be.sync = g_xnvme_be_linux_sync_block;
 		}
-		if (!opts->async) {
-			dev->be.async = g_xnvme_be_cbi_async_emu;
-		}
 
 		err = xnvme_be_linux_nvme_dev_nsid(dev);
 		if (err < 1) {
@@ -123,9 +554,6 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 		if (!opts->sync) {
 			dev->be.sync = g_xnvme_be_linux_sync_nvme;
 		}
-		if (!opts->async) {
-			dev->be.async = g_xnvme_be_cbi_async_emu;
-		}
 		break;
 
 	case S_IFCHR:
@@ -139,9 +567,6 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 		if (!opts->sync) {
 			dev->be.sync = g_xnvme_be_cbi_sync_psync;
 		}
-		if (!opts->async) {
-			dev->be.async = g_xnvme_be_cbi_async_emu;
-		}
 
 		err = xnvme_be_linux_nvme_dev_nsid(dev);
 		if (err < 1) {
@@ -160,9 +585,6 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 		if (!opts->sync) {
 			dev->be.sync = g_xnvme_be_linux_sync_nvme;
 		}
-		if (!opts->async) {
-			dev->be.async = g_xnvme_be_cbi_async_emu;
-		}
 		break;
 
 	default:
@@ -170,9 +592,9 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 		return -EINVAL;
 	}
 
-	err = xnvme_be_dev_idfy(dev);
+	err = _idfy(dev);
 	if (err) {
-		XNVME_DEBUG("FAILED: open() : xnvme_be_dev_idfy()");
+		XNVME_DEBUG("FAILED: open() : _idfy()");
 		_be_linux_state_term((void *)dev->be.state);
 		return err;
 	}
@@ -187,6 +609,15 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 	if ((dev->geo.mdts_nbytes / dev->geo.lba_nbytes) > 127) {
 		dev->geo.mdts_nbytes = dev->geo.lba_nbytes * 127;
 	}
+	if (dev->ident.dtype == XNVME_DEV_TYPE_FS_FILE) {
+		_file_geo_lba(&dev->geo, state->dio_align);
+	}
+
+	if (!opts->async || !strcmp(opts->async, "auto")) {
+		dev->be.async = _async_auto(&dev->ident, &dev->geo, dev_stat.st_mode & S_IFMT);
+		opts->async_helper = 1;
+	}
+	XNVME_DEBUG("INFO: open() : async: %s", dev->be.async.id);
 
 	state->poll_io = opts->poll_io;
 	state->poll_sq = opts->poll_sq;
@@ -210,6 +641,395 @@ xnvme_be_linux_dev_close(struct xnvme_dev *dev)
 	memset(&dev->be, 0, sizeof(dev->be));
 }
 
+#define XNVME_BE_LINUX_BATCH_NPATHS 128
+#define XNVME_BE_LINUX_BATCH_STATX  (STATX_TYPE | STATX_SIZE)
+
+/**
+ * Result of opening and statx()'ing one of the paths of a batch
+ */
+struct _batch_entry {
+	int fd;    ///< The file-descriptor or negative errno of the open()
+	int err;   ///< Negative errno of the statx(), 0 on success
+	struct statx stx;
+};
+
+/**
+ * Set up the backend, and options, which are shared by the lightweight handles of a batch, that
+ * is, the mixins used by xnvme_be_linux_dev_open() for regular files
+ */
+static int
+_batch_be(struct xnvme_be *be, struct xnvme_opts *opts)
+{
+	int err;
+
+	*be = xnvme_be_linux;
+
+	err = xnvme_be_setup_mixins(be, opts);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_be_setup_mixins(), err: %d", err);
+		return err;
+	}
+	if (!opts->admin) {
+		be->admin = g_xnvme_be_cbi_admin_shim;
+	}
+	if (!opts->sync) {
+		be->sync = g_xnvme_be_cbi_sync_psync;
+	}
+	if (!opts->async || !strcmp(opts->async, "auto")) {
+		const struct xnvme_ident ident = {.dtype = XNVME_DEV_TYPE_FS_FILE};
+		const struct xnvme_geo geo = {0};
+
+		be->async = _async_auto(&ident, &geo, S_IFREG);
+	}
+
+	opts->be = be->attr.name;
+	opts->admin = be->admin.id;
+	opts->sync = be->sync.id;
+	opts->async = be->async.id;
+	opts->mem = be->mem.id;
+	opts->dev = "FIX-ID-VS-MIXIN-NAME";
+
+	return 0;
+}
+
+/**
+ * Set up 'dev' as a lightweight handle of the regular file opened as 'fd'; the geometry is
+ * derived from 'stx', as xnvme_be_linux_dev_open() does via identify and the O_DIRECT alignment,
+ * and the NUMA node is not looked up
+ */
+static void
+_batch_dev_setup(struct xnvme_dev *dev, const struct xnvme_be *be, const struct xnvme_opts *opts,
+		 int fd, const struct statx *stx)
+{
+	struct xnvme_be_linux_state *state;
+	struct xnvme_geo *geo = &dev->geo;
+
+	dev->be = *be;
+	dev->opts = *opts;
+
+	state = (void *)dev->be.state;
+	state->fd = fd;
+	state->poll_io = opts->poll_io;
+	state->poll_sq = opts->poll_sq;
+	state->dio_align = opts->direct ? XNVME_MAX(stx->stx_blksize, 512) : 0;
+#ifdef STATX_DIOALIGN
+	if (opts->direct && (stx->stx_mask & STATX_DIOALIGN) && stx->stx_dio_offset_align) {
+		state->dio_align = XNVME_MAX(stx->stx_dio_offset_align, stx->stx_dio_mem_align);
+	}
+#endif
+
+	dev->ident.dtype = XNVME_DEV_TYPE_FS_FILE;
+	dev->ident.csi = XNVME_SPEC_CSI_FS;
+	dev->ident.nsid = 1;
+
+	geo->type = XNVME_GEO_CONVENTIONAL;
+	geo->npugrp = 1;
+	geo->npunit = 1;
+	geo->nzone = 1;
+	geo->nsect = 1;
+	geo->nbytes = 1;
+	geo->tbytes = stx->stx_size;
+	_file_geo_lba(geo, state->dio_align);
+}
+
+static void
+_batch_open_psync(struct xnvme_dev **devs, uint32_t ndevs, int flags, unsigned int mask,
+		  struct xnvme_opts *opts, struct _batch_entry *entries)
+{
+	for (uint32_t i = 0; i < ndevs; ++i) {
+		struct _batch_entry *entry = &entries[i];
+
+		if (!devs[i]) {
+			continue;
+		}
+
+		entry->fd = open(devs[i]->ident.uri, flags, opts->create_mode);
+		if (entry->fd < 0) {
+			entry->fd = -errno;
+			continue;
+		}
+		entry->err = statx(entry->fd, "", AT_EMPTY_PATH, mask, &entry->stx) ? -errno : 0;
+	}
+}
+
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+/**
+ * Open and statx() the given devices via io_uring; the statx() of a path is linked to its open,
+ * thus it is done once the open has completed, and is cancelled when the open fails
+ */
+static int
+_batch_open_iou(struct io_uring *ring, struct xnvme_dev **devs, uint32_t ndevs, int flags,
+		unsigned int mask, struct xnvme_opts *opts, struct _batch_entry *entries)
+{
+	uint32_t nsubmitted = 0;
+	int err;
+
+	for (uint32_t i = 0; i < ndevs; ++i) {
+		struct io_uring_sqe *sqe;
+
+		if (!devs[i]) {
+			continue;
+		}
+
+		sqe = io_uring_get_sqe(ring);
+		io_uring_prep_openat(sqe, AT_FDCWD, devs[i]->ident.uri, flags, opts->create_mode);
+		io_uring_sqe_set_data(sqe, &entries[i].fd);
+		sqe->flags |= IOSQE_IO_LINK;
+
+		sqe = io_uring_get_sqe(ring);
+		io_uring_prep_statx(sqe, AT_FDCWD, devs[i]->ident.uri, 0, mask, &entries[i].stx);
+		io_uring_sqe_set_data(sqe, &entries[i].err);
+
+		nsubmitted += 2;
+	}
+
+	err = io_uring_submit(ring);
+	if (err < 0) {
+		XNVME_DEBUG("FAILED: io_uring_submit(), err: %d", err);
+		return err;
+	}
+
+	for (uint32_t ncompleted = 0; ncompleted < nsubmitted; ++ncompleted) {
+		struct io_uring_cqe *cqe;
+
+		err = io_uring_wait_cqe(ring, &cqe);
+		if (err) {
+			XNVME_DEBUG("FAILED: io_uring_wait_cqe(), err: %d", err);
+			return err;
+		}
+		*(int *)io_uring_cqe_get_data(cqe) = cqe->res;
+		io_uring_cqe_seen(ring, cqe);
+	}
+
+	return 0;
+}
+#endif
+
+int
+xnvme_be_linux_file_open_batch(const char **pathnames, uint32_t npaths,
+			       struct xnvme_opts *opts, struct xnvme_dev **fhs, int *errs)
+{
+	const uint32_t nentries = XNVME_MIN(npaths, XNVME_BE_LINUX_BATCH_NPATHS);
+	const unsigned int mask =
+#ifdef STATX_DIOALIGN
+		XNVME_BE_LINUX_BATCH_STATX | (opts->direct ? STATX_DIOALIGN : 0);
+#else
+		XNVME_BE_LINUX_BATCH_STATX;
+#endif
+	const int flags = xnvme_file_opts_to_linux(opts);
+	struct _batch_entry *entries = NULL;
+	struct xnvme_opts be_opts = *opts;
+	struct xnvme_be be;
+	int err_first = 0;
+	int err;
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+	struct io_uring ring;
+	int ring_ok = 0;
+#endif
+
+	err = _batch_be(&be, &be_opts);
+	if (err) {
+		return err;
+	}
+	entries = calloc(nentries, sizeof(*entries));
+	if (!entries) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+	err = io_uring_queue_init(2 * nentries, &ring, 0);
+	if (err) {
+		XNVME_DEBUG("INFO: io_uring_queue_init(), err: %d; using open()/statx()", err);
+	}
+	ring_ok = !err;
+#endif
+
+	for (uint32_t base = 0; base < npaths; base += nentries) {
+		uint32_t n = XNVME_MIN(nentries, npaths - base);
+		struct xnvme_dev **devs = &fhs[base];
+
+		for (uint32_t i = 0; i < n; ++i) {
+			entries[i].fd = -EBADF;
+			entries[i].err = 0;
+
+			devs[i] = NULL;
+			err = xnvme_dev_alloc(&devs[i]);
+			if (!err) {
+				err = xnvme_ident_from_uri(pathnames[base + i], &devs[i]->ident);
+			}
+			if (err) {
+				free(devs[i]);
+				devs[i] = NULL;
+				entries[i].fd = err;
+			}
+		}
+
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+		if (ring_ok && _batch_open_iou(&ring, devs, n, flags, mask, opts, entries)) {
+			// The ring is in an unknown state; close what it opened and redo the window
+			for (uint32_t i = 0; i < n; ++i) {
+				if (entries[i].fd >= 0) {
+					close(entries[i].fd);
+				}
+				entries[i].fd = devs[i] ? -EBADF : entries[i].fd;
+				entries[i].err = 0;
+			}
+			io_uring_queue_exit(&ring);
+			ring_ok = 0;
+		}
+		if (!ring_ok) {
+			_batch_open_psync(devs, n, flags, mask, opts, entries);
+		}
+#else
+		_batch_open_psync(devs, n, flags, mask, opts, entries);
+#endif
+
+		for (uint32_t i = 0; i < n; ++i) {
+			struct _batch_entry *entry = &entries[i];
+
+			if (devs[i] && (entry->fd >= 0) && !entry->err &&
+			    S_ISREG(entry->stx.stx_mode)) {
+				_batch_dev_setup(devs[i], &be, &be_opts, entry->fd, &entry->stx);
+				if (errs) {
+					errs[base + i] = 0;
+				}
+				continue;
+			}
+
+			// Not a regular file, or O_DIRECT is not supported; do a regular open to
+			// handle e.g. block-devices and the fallback from O_DIRECT
+			if (entry->fd >= 0) {
+				close(entry->fd);
+			}
+			free(devs[i]);
+			devs[i] = NULL;
+
+			if (entry->fd >= 0 || (opts->direct && (entry->fd == -EINVAL))) {
+				devs[i] = xnvme_file_open(pathnames[base + i], opts);
+				err = devs[i] ? 0 : -errno;
+			} else {
+				err = entry->fd;
+			}
+			if (errs) {
+				errs[base + i] = err;
+			}
+			err_first = err_first ? err_first : err;
+		}
+	}
+
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+	if (ring_ok) {
+		io_uring_queue_exit(&ring);
+	}
+#endif
+	free(entries);
+
+	return err_first;
+}
+
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+static int
+_batch_close_iou(struct io_uring *ring, int *fds, uint32_t nfds)
+{
+	int err_first = 0;
+	int err;
+
+	for (uint32_t i = 0; i < nfds; ++i) {
+		struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+
+		io_uring_prep_close(sqe, fds[i]);
+		io_uring_sqe_set_data(sqe, &fds[i]);
+	}
+
+	err = io_uring_submit(ring);
+	if (err < 0) {
+		XNVME_DEBUG("FAILED: io_uring_submit(), err: %d", err);
+		return err;
+	}
+
+	for (uint32_t ncompleted = 0; ncompleted < nfds; ++ncompleted) {
+		struct io_uring_cqe *cqe;
+		int *fd;
+
+		err = io_uring_wait_cqe(ring, &cqe);
+		if (err) {
+			XNVME_DEBUG("FAILED: io_uring_wait_cqe(), err: %d", err);
+			return err;
+		}
+		fd = io_uring_cqe_get_data(cqe);
+
+		// IORING_OP_CLOSE is not supported by the kernel, then fall back to close()
+		if (((cqe->res == -EINVAL) || (cqe->res == -EOPNOTSUPP)) && close(*fd)) {
+			err_first = err_first ? err_first : -errno;
+		} else if (cqe->res < 0) {
+			err_first = err_first ? err_first : cqe->res;
+		}
+		io_uring_cqe_seen(ring, cqe);
+	}
+
+	return err_first;
+}
+#endif
+
+int
+xnvme_be_linux_file_close_batch(struct xnvme_dev **fhs, uint32_t nfhs)
+{
+	const uint32_t nentries = XNVME_MIN(nfhs, XNVME_BE_LINUX_BATCH_NPATHS);
+	int fds[XNVME_BE_LINUX_BATCH_NPATHS];
+	int err_first = 0;
+	int err;
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+	struct io_uring ring;
+	int ring_ok;
+
+	ring_ok = nentries && !io_uring_queue_init(nentries, &ring, 0);
+#endif
+
+	for (uint32_t base = 0; base < nfhs; base += nentries) {
+		uint32_t n = XNVME_MIN(nentries, nfhs - base);
+		uint32_t nfds = 0;
+
+		for (uint32_t i = base; i < base + n; ++i) {
+			struct xnvme_dev *fh = fhs[i];
+
+			if (!fh) {
+				continue;
+			}
+			if (strcmp(fh->be.attr.name, "linux")) {
+				xnvme_dev_close(fh);
+				continue;
+			}
+			if (xnvme_dev_teardown(fh)) {
+				continue;
+			}
+
+			fds[nfds++] = _be_linux_state_release((void *)fh->be.state);
+			memset(&fh->be, 0, sizeof(fh->be));
+			free(fh);
+		}
+
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+		if (ring_ok) {
+			err = _batch_close_iou(&ring, fds, nfds);
+			err_first = err_first ? err_first : err;
+			continue;
+		}
+#endif
+		for (uint32_t i = 0; i < nfds; ++i) {
+			err = close(fds[i]) ? -errno : 0;
+			err_first = err_first ? err_first : err;
+		}
+	}
+
+#ifdef XNVME_BE_LINUX_LIBURING_ENABLED
+	if (ring_ok) {
+		io_uring_queue_exit(&ring);
+	}
+#endif
+
+	return err_first;
+}
+
 int
 xnvme_path_nvme_filter(const struct dirent *d)
 {
@@ -267,12 +1087,204 @@ xnvme_path_ng_filter(const struct dirent *d)
 	return 0;
 }
 
+#define XNVME_BE_LINUX_ENUM_NTHREADS 8
+
+/**
+ * Open 'uri' as a handle populated from sysfs alone, that is, without opening the device-file and
+ * without issuing identify; the handle carries ident, geometry and NUMA node for inspection, but
+ * not a file-descriptor, thus commands submitted via it fail
+ */
+static struct xnvme_dev *
+_sysfs_dev_open(const char *uri, struct xnvme_opts *opts)
+{
+	struct xnvme_be_linux_state *state;
+	struct xnvme_dev *dev = NULL;
+	struct xnvme_geo *geo;
+	struct xnvme_be be;
+	struct stat dev_stat;
+	char blk[64], zoned[32] = {0};
+	uint64_t nsid, lbsz, nsect, max_kb = 0, ms = 0;
+	mode_t fmt = 0;
+	int err;
+
+	err = _sysfs_blk(uri, blk, sizeof(blk));
+	if (!err) {
+		err = _sysfs_u64(blk, "nsid", &nsid);
+	}
+	if (!err) {
+		err = _sysfs_u64(blk, "queue/logical_block_size", &lbsz);
+	}
+	if (!err) {
+		err = _sysfs_u64(blk, "size", &nsect);
+	}
+	if (err || !lbsz) {
+		XNVME_DEBUG("FAILED: sysfs-attributes of uri: %s, err: %d", uri, err);
+		errno = err ? -err : EINVAL;
+		return NULL;
+	}
+	_sysfs_u64(blk, "queue/max_hw_sectors_kb", &max_kb);
+	_sysfs_u64(blk, "metadata_bytes", &ms);
+	_sysfs_read(blk, "queue/zoned", zoned, sizeof(zoned));
+
+	be = xnvme_be_linux;
+	err = xnvme_be_setup_mixins(&be, opts);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_be_setup_mixins(), err: %d", err);
+		errno = -err;
+		return NULL;
+	}
+	if (!opts->admin) {
+		be.admin = g_xnvme_be_linux_admin_nvme;
+	}
+	if (!opts->sync) {
+		be.sync = g_xnvme_be_linux_sync_nvme;
+	}
+
+	err = xnvme_dev_alloc(&dev);
+	if (!err) {
+		err = xnvme_ident_from_uri(uri, &dev->ident);
+	}
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_dev_alloc()/xnvme_ident_from_uri(), err: %d", err);
+		free(dev);
+		errno = -err;
+		return NULL;
+	}
+
+	dev->be = be;
+	dev->opts = *opts;
+	dev->opts.be = be.attr.name;
+	dev->opts.admin = be.admin.id;
+	dev->opts.sync = be.sync.id;
+	dev->opts.async = be.async.id;
+	dev->opts.mem = be.mem.id;
+	dev->opts.dev = "FIX-ID-VS-MIXIN-NAME";
+
+	state = (void *)dev->be.state;
+	state->fd = -1;
+
+	if (!stat(uri, &dev_stat)) {
+		dev->numa_node = xnvme_be_linux_numa_node(&dev_stat);
+		fmt = dev_stat.st_mode & S_IFMT;
+	}
+
+	dev->ident.dtype = XNVME_DEV_TYPE_NVME_NAMESPACE;
+	dev->ident.nsid = nsid;
+	dev->ident.csi = strcmp(zoned, "host-managed") ? XNVME_SPEC_CSI_NVM : XNVME_SPEC_CSI_ZONED;
+
+	geo = &dev->geo;
+	geo->type = XNVME_GEO_CONVENTIONAL;
+	geo->npugrp = 1;
+	geo->npunit = 1;
+	geo->nzone = 1;
+	geo->lba_nbytes = lbsz;
+	geo->nbytes = lbsz;
+	geo->nbytes_oob = ms;
+	geo->tbytes = nsect << 9;
+	geo->nsect = geo->tbytes / lbsz;
+	if (dev->ident.csi == XNVME_SPEC_CSI_ZONED) {
+		uint64_t nzone = 0, chunk = 0;
+
+		_sysfs_u64(blk, "queue/nr_zones", &nzone);
+		_sysfs_u64(blk, "queue/chunk_sectors", &chunk);
+		if (nzone && chunk) {
+			geo->type = XNVME_GEO_ZONED;
+			geo->nzone = nzone;
+			geo->nsect = (chunk << 9) / lbsz;
+		}
+	}
+	geo->mdts_nbytes = XNVME_MIN_U64(max_kb << 10, lbsz * 127);
+	geo->mdts_nbytes = geo->mdts_nbytes ? geo->mdts_nbytes : lbsz;
+	geo->ssw = XNVME_ILOG2(lbsz);
+
+	// The same default as xnvme_be_linux_dev_open(), such that the handle reports what it would
+	if (!opts->async || !strcmp(opts->async, "auto")) {
+		dev->be.async = _async_auto(&dev->ident, geo, fmt);
+		dev->opts.async = dev->be.async.id;
+		dev->opts.async_helper = 1;
+	}
+
+	return dev;
+}
+
+/**
+ * Shared state of the threads opening the devices found by enumeration
+ */
+struct _enum_job {
+	const struct xnvme_opts *opts;
+	char (*uris)[XNVME_IDENT_URI_LEN];
+	struct xnvme_dev **devs;
+	int *errs;
+	uint32_t nuris;
+	uint32_t next; ///< Index of the next uri to open, claimed atomically by the threads
+};
+
+static void *
+_enum_worker(void *arg)
+{
+	struct _enum_job *job = arg;
+
+	for (;;) {
+		uint32_t idx = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+		struct xnvme_opts opts;
+
+		if (idx >= job->nuris) {
+			break;
+		}
+
+		opts = *job->opts;
+		job->devs[idx] = opts.enum_sysfs ? _sysfs_dev_open(job->uris[idx], &opts)
+						 : xnvme_dev_open(job->uris[idx], &opts);
+		job->errs[idx] = job->devs[idx] ? 0 : -errno;
+		if (!job->devs[idx]) {
+			XNVME_DEBUG("FAILED: open(%s), errno: %d", job->uris[idx], errno);
+		}
+	}
+
+	return NULL;
+}
+
+static int
+_enum_uris(const char *dir, int (*filter)(const struct dirent *),
+	   char (**uris)[XNVME_IDENT_URI_LEN], uint32_t *nuris)
+{
+	struct dirent **ns = NULL;
+	int nns;
+
+	nns = scandir(dir, &ns, filter, alphasort);
+	if (nns < 0) {
+		return 0;
+	}
+	if (nns) {
+		void *tmp = realloc(*uris, (*nuris + nns) * sizeof(**uris));
+
+		if (!tmp) {
+			nns = -errno;
+		} else {
+			*uris = tmp;
+		}
+	}
+	for (int ni = 0; ni < nns; ++ni) {
+		snprintf((*uris)[*nuris], XNVME_IDENT_URI_LEN, _PATH_DEV "%s", ns[ni]->d_name);
+		*nuris += 1;
+	}
+	for (int ni = 0; ni < XNVME_MAX(nns, 0); ++ni) {
+		free(ns[ni]);
+	}
+	free(ns);
+
+	return XNVME_MIN(nns, 0);
+}
+
 /**
  * Scanning /sys/class/nvme can give device names, such as "nvme0c65n1", which
  * are linked as virtual devices to the block device. So instead of scanning
  * that dir, then instead /sys/block/ is scanned under the assumption that
  * block-devices with "nvme" in them are NVMe devices with namespaces attached
  *
+ * The devices are opened by a handful of threads, since opening means issuing identify to each
+ * of them, and the callback is then invoked, by the calling thread, in the order of the scan
+ *
  * TODO: add enumeration of NS vs CTRLR, actually, replace this with the libnvme
  * topology functions
  */
@@ -280,56 +1292,73 @@ int
 xnvme_be_linux_enumerate(const char *sys_uri, struct xnvme_opts *opts, xnvme_enumerate_cb cb_func,
 			 void *cb_args)
 {
-	struct dirent **ns = NULL;
-	int nns = 0;
+	pthread_t threads[XNVME_BE_LINUX_ENUM_NTHREADS - 1];
+	struct _enum_job job = {0};
+	struct xnvme_opts tmp_opts = *opts;
+	char(*uris)[XNVME_IDENT_URI_LEN] = NULL;
+	uint32_t nuris = 0, nthreads = 0, nworkers;
+	int err;
 
 	if (sys_uri) {
 		XNVME_DEBUG("FAILED: sys_uri: %s is not supported", sys_uri);
 		return -ENOSYS;
 	}
 
-	struct xnvme_opts tmp_opts = *opts;
 	tmp_opts.be = xnvme_be_linux.attr.name;
 
-	nns = scandir("/sys/block", &ns, xnvme_path_nvme_filter, alphasort);
-	for (int ni = 0; ni < nns; ++ni) {
-		char uri[XNVME_IDENT_URI_LEN] = {0};
-		struct xnvme_dev *dev = NULL;
+	err = _enum_uris("/sys/block", xnvme_path_nvme_filter, &uris, &nuris);
+	if (!err) {
+		err = _enum_uris("/dev", xnvme_path_ng_filter, &uris, &nuris);
+	}
+	if (err || !nuris) {
+		free(uris);
+		return err;
+	}
 
-		snprintf(uri, XNVME_IDENT_URI_LEN - 1, _PATH_DEV "%s", ns[ni]->d_name);
+	job.opts = &tmp_opts;
+	job.uris = uris;
+	job.nuris = nuris;
+	job.devs = calloc(nuris, sizeof(*job.devs));
+	job.errs = calloc(nuris, sizeof(*job.errs));
+	if (!job.devs || !job.errs) {
+		err = -errno;
+		XNVME_DEBUG("FAILED: calloc(), err: %d", err);
+		goto exit;
+	}
 
-		dev = xnvme_dev_open(uri, &tmp_opts);
-		if (!dev) {
-			XNVME_DEBUG("xnvme_dev_open(): %d", errno);
-			return -errno;
-		}
-		if (cb_func(dev, cb_args)) {
-			xnvme_dev_close(dev);
+	nworkers = XNVME_MIN_U64(nuris, XNVME_BE_LINUX_ENUM_NTHREADS);
+	for (uint32_t i = 0; i < nworkers - 1; ++i) {
+		if (pthread_create(&threads[i], NULL, _enum_worker, &job)) {
+			XNVME_DEBUG("INFO: pthread_create(), continuing with: %u threads", i + 1);
+			break;
 		}
+		nthreads += 1;
+	}
+	_enum_worker(&job);
+	for (uint32_t i = 0; i < nthreads; ++i) {
+		pthread_join(threads[i], NULL);
 	}
-	nns = scandir("/dev", &ns, xnvme_path_ng_filter, alphasort);
-	for (int ni = 0; ni < nns; ++ni) {
-		char uri[XNVME_IDENT_URI_LEN] = {0};
-		struct xnvme_dev *dev = NULL;
-
-		snprintf(uri, XNVME_IDENT_URI_LEN - 1, _PATH_DEV "%s", ns[ni]->d_name);
 
-		dev = xnvme_dev_open(uri, &tmp_opts);
-		if (!dev) {
-			XNVME_DEBUG("xnvme_dev_open(): %d", errno);
-			return -errno;
+	for (uint32_t i = 0; i < nuris; ++i) {
+		if (err) {
+			xnvme_dev_close(job.devs[i]);
+			continue;
 		}
-		if (cb_func(dev, cb_args)) {
-			xnvme_dev_close(dev);
+		if (!job.devs[i]) {
+			err = job.errs[i];
+			continue;
+		}
+		if (cb_func(job.devs[i], cb_args)) {
+			xnvme_dev_close(job.devs[i]);
 		}
 	}
 
-	for (int ni = 0; ni < nns; ++ni) {
-		free(ns[ni]);
-	}
-	free(ns);
+exit:
+	free(job.devs);
+	free(job.errs);
+	free(uris);
 
-	return 0;
+	return err;
 }
 #endif
 
@@ -1,38 +1,95 @@
 // Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
 // SPDX-License-Identifier: Apache-2.0
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <xnvme_be.h>
 #include <xnvme_be_nosys.h>
 #ifdef XNVME_BE_LINUX_ENABLED
 #include <xnvme_dev.h>
+#include <xnvme_be_linux.h>
 #include <errno.h>
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/queue.h>
 #include <linux/limits.h>
 
-struct huge_alloc {
-	char path[PATH_MAX];
-	int fd;
-	void *addr;
-	size_t len;
+// Environment variable pointing to a hugetlbfs mount, when not set anonymous hugepages are used
+static const char *g_hugetlb_path_env = "XNVME_HUGETLB_PATH";
+
+// Environment variable used to configure the size of the regions reserved by the arena
+static const char *g_arena_nbytes_env = "XNVME_HUGETLB_ARENA_NBYTES";
+static const size_t g_arena_nbytes_def = 32 << 20;
+
+// Fallback when the hugepage size cannot be read from /proc/meminfo
+static const size_t g_hugepage_nbytes_def = 2 << 20;
+
+#define HUGE_BLOCK_SHIFT 12 ///< Smallest sub-allocation is a 4K block
+#define HUGE_BLOCK_NBYTES (1ULL << HUGE_BLOCK_SHIFT)
+#define HUGE_ORDER_MAX 40
+
+#define HUGE_BLOCK_FREE 0x80 ///< First block of a free buddy
+#define HUGE_BLOCK_USED 0x40 ///< First block of an allocated buddy
+#define HUGE_BLOCK_ORDER_MASK 0x3F
+
+enum huge_backing {
+	HUGE_BACKING_HUGETLBFS = 0x1, ///< mmap() of a file on a hugetlbfs mount
+	HUGE_BACKING_ANON = 0x2,      ///< mmap() with MAP_HUGETLB
+	HUGE_BACKING_THP = 0x3,       ///< mmap() with madvise(MADV_HUGEPAGE)
+};
 
-	SLIST_ENTRY(huge_alloc) link;
+/**
+ * Free-list node, stored in the first bytes of the free buddy itself
+ */
+struct huge_block {
+	LIST_ENTRY(huge_block) link;
 };
 
-SLIST_HEAD(huge_alloc_slist, huge_alloc);
-struct huge_alloc_slist huge_alloc_head;
+/**
+ * A mapping of hugepages, either sub-allocated using a binary buddy allocator, or dedicated to a
+ * single allocation which is larger than the arena-region size
+ */
+struct huge_region {
+	uint8_t *addr;
+	size_t nbytes;
+	enum huge_backing backing;
+	uint32_t order;  ///< nbytes == HUGE_BLOCK_NBYTES << order
+	bool dedicated;  ///< Region is a single allocation; no buddy bookkeeping
+	int node;        ///< Preferred NUMA node of the region, -1 for none
+	uint8_t *blocks; ///< State of each block: HUGE_BLOCK_{FREE,USED} | order
 
-size_t
-get_hugepage_size()
+	LIST_HEAD(, huge_block) free[HUGE_ORDER_MAX + 1];
+
+	SLIST_ENTRY(huge_region) link;
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	bool initialized;
+	size_t hugepage_nbytes;
+	size_t region_nbytes;
+	uint32_t nempty;     ///< Number of sub-allocated regions with no allocations
+	char path[PATH_MAX]; ///< Template for mkstemp() on hugetlbfs, empty when not given
+
+	SLIST_HEAD(, huge_region) regions;
+} g_arena = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static size_t
+_hugepage_nbytes(void)
 {
 	FILE *fp;
 	char line[128] = {'\0'};
 	size_t hugepage_size = 0;
 
 	fp = fopen("/proc/meminfo", "r");
+	if (!fp) {
+		XNVME_DEBUG("FAILED: fopen(/proc/meminfo), errno: %d", errno);
+		return 0;
+	}
 
 	while (fgets(line, 128, fp)) {
 		if (sscanf(line, "Hugepagesize: %16lu kB", &hugepage_size)) {
@@ -47,124 +104,541 @@ get_hugepage_size()
 	return 0;
 }
 
-bool
-verify_hugetlbfs_path(char *path)
+static bool
+_hugetlbfs_mounted(const char *path)
 {
 	char line[PATH_MAX];
 	char search_str[PATH_MAX];
 	FILE *fp;
 
 	fp = fopen("/proc/mounts", "r");
+	if (!fp) {
+		return false;
+	}
 
 	strncpy(search_str, path, sizeof(search_str) - 1);
+	search_str[sizeof(search_str) - 1] = '\0';
 	strncat(search_str, " hugetlbfs", sizeof(search_str) - strlen(search_str) - 1);
 
 	while (fgets(line, sizeof(line), fp)) {
 		if (strstr(line, search_str)) {
 			fclose(fp);
-			return 1;
+			return true;
 		}
 	}
 	fclose(fp);
-	return 0;
+	return false;
 }
 
-void *
-xnvme_be_linux_mem_hugepage_buf_alloc(const struct xnvme_dev *XNVME_UNUSED(dev), size_t nbytes,
-				      uint64_t *XNVME_UNUSED(phys))
+static uint32_t
+_nbytes_to_order(size_t nbytes)
 {
-	void *buf;
-	int hugepage_fd;
-	struct huge_alloc *entry;
-	size_t hugepage_size;
-	char *env_hugepage_path;
-	char hugepage_path[PATH_MAX] = {'\0'};
-
-	env_hugepage_path = getenv("XNVME_HUGETLB_PATH");
-	if (env_hugepage_path == NULL) {
-		XNVME_DEBUG("ERROR: XNVME_HUGETLB_PATH env var not defined");
-		errno = ENOMEM;
+	size_t nblocks = (nbytes + HUGE_BLOCK_NBYTES - 1) >> HUGE_BLOCK_SHIFT;
+	uint32_t order = 0;
+
+	while (((size_t)1 << order) < nblocks) {
+		++order;
+	}
+
+	return order;
+}
+
+/**
+ * Read the system configuration once; hugepage size, hugetlbfs mount and arena-region size
+ */
+static void
+_arena_init(void)
+{
+	const char *env;
+
+	if (g_arena.initialized) {
+		return;
+	}
+
+	g_arena.hugepage_nbytes = _hugepage_nbytes();
+	if (!g_arena.hugepage_nbytes) {
+		g_arena.hugepage_nbytes = g_hugepage_nbytes_def;
+	}
+
+	env = getenv(g_hugetlb_path_env);
+	if (env) {
+		if (!_hugetlbfs_mounted(env)) {
+			XNVME_DEBUG("WARNING: Hugetlbfs is not mounted at: %s", env);
+		}
+		strncpy(g_arena.path, env, sizeof(g_arena.path) - 1);
+		strncat(g_arena.path, "/xnvme_XXXXXX",
+			sizeof(g_arena.path) - strlen(g_arena.path) - 1);
+	}
+
+	env = getenv(g_arena_nbytes_env);
+	g_arena.region_nbytes = env ? strtoull(env, NULL, 0) : g_arena_nbytes_def;
+	if (g_arena.region_nbytes < g_arena.hugepage_nbytes) {
+		g_arena.region_nbytes = g_arena.hugepage_nbytes;
+	}
+	g_arena.region_nbytes = HUGE_BLOCK_NBYTES << _nbytes_to_order(g_arena.region_nbytes);
+
+	XNVME_DEBUG("INFO: hugepage_nbytes: %zu, region_nbytes: %zu, path: '%s'",
+		    g_arena.hugepage_nbytes, g_arena.region_nbytes, g_arena.path);
+
+	SLIST_INIT(&g_arena.regions);
+	g_arena.initialized = true;
+}
+
+/**
+ * Map 'nbytes' of hugepages; trying hugetlbfs, then MAP_HUGETLB, then transparent hugepages
+ */
+static void *
+_region_map(size_t nbytes, enum huge_backing *backing)
+{
+	size_t align = g_arena.hugepage_nbytes;
+	uint8_t *raw, *addr;
+
+	if (g_arena.path[0]) {
+		char path[PATH_MAX];
+		int fd;
+
+		memcpy(path, g_arena.path, sizeof(path));
+
+		fd = mkstemp(path);
+		if (fd != -1) {
+			addr = MAP_FAILED;
+			if (!ftruncate(fd, nbytes)) {
+				addr = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			}
+			// The mapping keeps the pages alive; no need for the file beyond this point
+			close(fd);
+			remove(path);
+
+			if (addr != MAP_FAILED) {
+				*backing = HUGE_BACKING_HUGETLBFS;
+				return addr;
+			}
+		}
+		XNVME_DEBUG("INFO: hugetlbfs(%s) failed, errno: %d; trying MAP_HUGETLB", path,
+			    errno);
+	}
+
+	addr = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+		    -1, 0);
+	if (addr != MAP_FAILED) {
+		*backing = HUGE_BACKING_ANON;
+		return addr;
+	}
+	XNVME_DEBUG("INFO: mmap(MAP_HUGETLB) failed, errno: %d; trying THP", errno);
+
+	// Over-map by a hugepage, then trim, such that the region is hugepage-aligned
+	raw = mmap(NULL, nbytes + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+		   0);
+	if (raw == MAP_FAILED) {
+		XNVME_DEBUG("FAILED: mmap(), errno: %d", errno);
 		return NULL;
 	}
+	addr = (uint8_t *)(((uintptr_t)raw + align - 1) & ~((uintptr_t)align - 1));
+	if (addr > raw) {
+		munmap(raw, addr - raw);
+	}
+	if ((raw + nbytes + align) > (addr + nbytes)) {
+		munmap(addr + nbytes, (raw + nbytes + align) - (addr + nbytes));
+	}
+	if (madvise(addr, nbytes, MADV_HUGEPAGE)) {
+		XNVME_DEBUG("INFO: madvise(MADV_HUGEPAGE) failed, errno: %d", errno);
+	}
 
-	strncpy(hugepage_path, env_hugepage_path, sizeof(hugepage_path) - 1);
+	*backing = HUGE_BACKING_THP;
+	return addr;
+}
+
+static inline uint8_t *
+_block_addr(struct huge_region *region, size_t idx)
+{
+	return region->addr + (idx << HUGE_BLOCK_SHIFT);
+}
+
+static inline void
+_region_free_insert(struct huge_region *region, size_t idx, uint32_t order)
+{
+	region->blocks[idx] = HUGE_BLOCK_FREE | order;
+	LIST_INSERT_HEAD(&region->free[order], (struct huge_block *)_block_addr(region, idx), link);
+}
+
+static inline bool
+_region_is_empty(struct huge_region *region)
+{
+	return !region->dedicated && (region->blocks[0] == (HUGE_BLOCK_FREE | region->order));
+}
 
-	if (!verify_hugetlbfs_path(hugepage_path)) {
-		XNVME_DEBUG("WARNING: Hugetlbfs is not mounted at: %s", hugepage_path);
+static void
+_region_term(struct huge_region *region)
+{
+	SLIST_REMOVE(&g_arena.regions, region, huge_region, link);
+	munmap(region->addr, region->nbytes);
+	free(region->blocks);
+	free(region);
+}
+
+static struct huge_region *
+_region_alloc(size_t nbytes, bool dedicated, int node)
+{
+	struct huge_region *region;
+
+	region = calloc(1, sizeof(*region));
+	if (!region) {
+		XNVME_DEBUG("FAILED: calloc(region), errno: %d", errno);
+		return NULL;
 	}
+	region->nbytes = nbytes;
+	region->dedicated = dedicated;
+	region->node = node;
 
-	hugepage_size = get_hugepage_size();
-	if (!hugepage_size) {
-		XNVME_DEBUG("Hugepage size not valid: %lu", hugepage_size);
+	if (!dedicated) {
+		region->order = _nbytes_to_order(nbytes);
+		region->blocks = calloc(nbytes >> HUGE_BLOCK_SHIFT, sizeof(*region->blocks));
+		if (!region->blocks) {
+			XNVME_DEBUG("FAILED: calloc(blocks), errno: %d", errno);
+			free(region);
+			return NULL;
+		}
+	}
+
+	region->addr = _region_map(nbytes, &region->backing);
+	if (!region->addr) {
+		free(region->blocks);
+		free(region);
 		errno = ENOMEM;
 		return NULL;
 	}
+	if (node >= 0) {
+		xnvme_be_linux_numa_mbind(region->addr, region->nbytes, node);
+	}
 
-	// nbytes has to be a multiple of alignment. Therefore, we round up to the nearest
-	// multiple.
-	nbytes = (1 + ((nbytes - 1) / hugepage_size)) * (hugepage_size);
+	if (!dedicated) {
+		for (uint32_t order = 0; order <= HUGE_ORDER_MAX; ++order) {
+			LIST_INIT(&region->free[order]);
+		}
+		_region_free_insert(region, 0, region->order);
+		g_arena.nempty += 1;
+	}
 
-	// Map a Huge page
-	strncat(hugepage_path, "/xnvme_XXXXXX", sizeof(hugepage_path) - strlen(hugepage_path) - 1);
-	hugepage_fd = mkstemp(hugepage_path);
-	if (hugepage_fd == -1) {
-		XNVME_DEBUG("Failed to open hugepage file. %s", hugepage_path);
-		errno = ENOMEM;
+	XNVME_DEBUG("INFO: region: {addr: %p, nbytes: %zu, backing: %d, dedicated: %d, node: %d}",
+		    (void *)region->addr, region->nbytes, region->backing, region->dedicated,
+		    region->node);
+
+	SLIST_INSERT_HEAD(&g_arena.regions, region, link);
+
+	return region;
+}
+
+static void *
+_region_buddy_alloc(struct huge_region *region, uint32_t order)
+{
+	struct huge_block *block;
+	uint32_t cur = order;
+	size_t idx;
+
+	while ((cur <= region->order) && LIST_EMPTY(&region->free[cur])) {
+		++cur;
+	}
+	if (cur > region->order) {
 		return NULL;
 	}
 
-	if (ftruncate(hugepage_fd, nbytes)) {
-		XNVME_DEBUG("Failed to truncate hugepage file. %s, %lu", hugepage_path, nbytes);
-		perror("hugetlb ftruncate()");
+	if (_region_is_empty(region)) {
+		g_arena.nempty -= 1;
+	}
+
+	block = LIST_FIRST(&region->free[cur]);
+	LIST_REMOVE(block, link);
+	idx = ((uint8_t *)block - region->addr) >> HUGE_BLOCK_SHIFT;
+
+	// Split the buddy until it matches the requested order, freeing the upper halves
+	while (cur > order) {
+		--cur;
+		_region_free_insert(region, idx + ((size_t)1 << cur), cur);
+	}
+	region->blocks[idx] = HUGE_BLOCK_USED | order;
+
+	return block;
+}
+
+static void
+_region_buddy_free(struct huge_region *region, uint8_t *buf)
+{
+	size_t idx = (buf - region->addr) >> HUGE_BLOCK_SHIFT;
+	uint32_t order;
+
+	if ((buf != _block_addr(region, idx)) || !(region->blocks[idx] & HUGE_BLOCK_USED)) {
+		XNVME_DEBUG("FAILED: buf: %p is not an allocation in region: %p", (void *)buf,
+			    (void *)region->addr);
+		return;
+	}
+	order = region->blocks[idx] & HUGE_BLOCK_ORDER_MASK;
+	region->blocks[idx] = 0;
+
+	// Coalesce with the buddy for as long as it is free and of the same order
+	while (order < region->order) {
+		size_t buddy = idx ^ ((size_t)1 << order);
+
+		if (region->blocks[buddy] != (HUGE_BLOCK_FREE | order)) {
+			break;
+		}
+		LIST_REMOVE((struct huge_block *)_block_addr(region, buddy), link);
+		region->blocks[buddy] = 0;
+
+		idx &= ~((size_t)1 << order);
+		++order;
+	}
+	_region_free_insert(region, idx, order);
+
+	// Keep one empty region around for re-use, release the rest
+	if (_region_is_empty(region)) {
+		if (g_arena.nempty) {
+			_region_term(region);
+		} else {
+			g_arena.nempty += 1;
+		}
+	}
+}
+
+/**
+ * Grow or shrink the sub-allocation at 'idx' in place to the given 'order'
+ *
+ * Growing is possible when the buddies making up the larger allocation are all free; shrinking
+ * always is, the upper halves are returned to the free-lists.
+ *
+ * @return true when the allocation now has the given order, false otherwise
+ */
+static bool
+_region_buddy_resize(struct huge_region *region, size_t idx, uint32_t order)
+{
+	uint32_t cur = region->blocks[idx] & HUGE_BLOCK_ORDER_MASK;
+
+	if ((order > region->order) || (idx & (((size_t)1 << order) - 1))) {
+		return false;
+	}
+
+	for (uint32_t ord = cur; ord < order; ++ord) {
+		if (region->blocks[idx + ((size_t)1 << ord)] != (HUGE_BLOCK_FREE | ord)) {
+			return false;
+		}
+	}
+	for (uint32_t ord = cur; ord < order; ++ord) {
+		size_t buddy = idx + ((size_t)1 << ord);
+
+		LIST_REMOVE((struct huge_block *)_block_addr(region, buddy), link);
+		region->blocks[buddy] = 0;
+	}
+	while (cur > order) {
+		--cur;
+		_region_free_insert(region, idx + ((size_t)1 << cur), cur);
+	}
+	region->blocks[idx] = HUGE_BLOCK_USED | order;
+
+	return true;
+}
+
+static struct huge_region *
+_arena_region(void *buf)
+{
+	struct huge_region *region;
+
+	for (region = SLIST_FIRST(&g_arena.regions); region; region = SLIST_NEXT(region, link)) {
+		if (((uint8_t *)buf >= region->addr) &&
+		    ((uint8_t *)buf < (region->addr + region->nbytes))) {
+			return region;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Allocate 'nbytes' from the arena; the caller must hold the arena mutex
+ */
+static void *
+_arena_alloc(size_t nbytes, int node)
+{
+	struct huge_region *region;
+	uint32_t order;
+	void *buf;
+
+	order = _nbytes_to_order(nbytes);
+	if ((HUGE_BLOCK_NBYTES << order) > g_arena.region_nbytes) {
+		size_t align = g_arena.hugepage_nbytes;
+
+		region = _region_alloc(((nbytes + align - 1) / align) * align, true, node);
+		return region ? region->addr : NULL;
+	}
+
+	for (region = SLIST_FIRST(&g_arena.regions); region; region = SLIST_NEXT(region, link)) {
+		if (region->dedicated || (region->node != node)) {
+			continue;
+		}
+		buf = _region_buddy_alloc(region, order);
+		if (buf) {
+			return buf;
+		}
+	}
+
+	region = _region_alloc(g_arena.region_nbytes, false, node);
+
+	return region ? _region_buddy_alloc(region, order) : NULL;
+}
+
+/**
+ * Return 'buf' to the arena; the caller must hold the arena mutex
+ */
+static void
+_arena_free(void *buf)
+{
+	struct huge_region *region = _arena_region(buf);
+
+	if (!region) {
+		XNVME_DEBUG("FAILED: buf: %p was not allocated by the hugepage arena", buf);
+		return;
+	}
+
+	if (region->dedicated) {
+		_region_term(region);
+	} else {
+		_region_buddy_free(region, buf);
+	}
+}
+
+/**
+ * Resize 'buf' in place when possible, otherwise move it; the caller must hold the arena mutex
+ */
+static void *
+_arena_realloc(struct huge_region *region, void *buf, size_t nbytes, int node)
+{
+	size_t buf_nbytes;
+	void *new;
+
+	if (region->dedicated) {
+		size_t align = g_arena.hugepage_nbytes;
+
+		nbytes = ((nbytes + align - 1) / align) * align;
+		if (nbytes <= region->nbytes) {
+			return buf;
+		}
+
+		// Grow the mapping itself, unless backed by a file, as it is not grown along with it.
+		// Note that mremap() of MAP_HUGETLB mappings requires Linux v5.17+.
+		new = MAP_FAILED;
+		if (region->backing != HUGE_BACKING_HUGETLBFS) {
+			new = mremap(region->addr, region->nbytes, nbytes, MREMAP_MAYMOVE);
+		}
+		if (new != MAP_FAILED) {
+			region->addr = new;
+			region->nbytes = nbytes;
+			if (region->node >= 0) {
+				xnvme_be_linux_numa_mbind(region->addr, region->nbytes, region->node);
+			}
+			return new;
+		}
+
+		buf_nbytes = region->nbytes;
+	} else {
+		size_t idx = ((uint8_t *)buf - region->addr) >> HUGE_BLOCK_SHIFT;
+		uint32_t order = _nbytes_to_order(nbytes);
+
+		if (((HUGE_BLOCK_NBYTES << order) <= g_arena.region_nbytes) &&
+		    _region_buddy_resize(region, idx, order)) {
+			return buf;
+		}
+
+		buf_nbytes = HUGE_BLOCK_NBYTES << (region->blocks[idx] & HUGE_BLOCK_ORDER_MASK);
+	}
+
+	new = _arena_alloc(nbytes, node);
+	if (!new) {
 		return NULL;
 	}
+	memcpy(new, buf, XNVME_MIN_U64(buf_nbytes, nbytes));
+	_arena_free(buf);
+
+	return new;
+}
 
-	buf = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, hugepage_fd, 0);
-	if (buf == MAP_FAILED) {
-		XNVME_DEBUG("mmap failed on hugepage file");
+void *
+xnvme_be_linux_mem_hugepage_buf_alloc(const struct xnvme_dev *dev, size_t nbytes,
+				      uint64_t *XNVME_UNUSED(phys))
+{
+	int node = dev ? xnvme_dev_numa_node_pref(dev) : -1;
+	void *buf;
+
+	if (!nbytes) {
+		XNVME_DEBUG("FAILED: invalid value for nbytes: '%zu')", nbytes);
+		errno = EINVAL;
 		return NULL;
 	}
 
-	// Appending allocated hugepage to linked-list for use during free
-	entry = malloc(sizeof(struct huge_alloc));
-	entry->fd = hugepage_fd;
-	strncpy(entry->path, hugepage_path, sizeof(entry->path) - 1);
-	entry->path[sizeof(entry->path) - 1] = '\0';
-	entry->addr = buf;
-	entry->len = nbytes;
-	SLIST_INSERT_HEAD(&huge_alloc_head, entry, link);
+	pthread_mutex_lock(&g_arena.mutex);
+
+	_arena_init();
+	buf = _arena_alloc(nbytes, node);
+
+	pthread_mutex_unlock(&g_arena.mutex);
+
+	if (!buf) {
+		XNVME_DEBUG("FAILED: no hugepage memory for nbytes: %zu", nbytes);
+		errno = ENOMEM;
+	}
 
 	return buf;
 }
 
-void
-xnvme_be_linux_mem_hugepage_buf_free(const struct xnvme_dev *XNVME_UNUSED(dev), void *buf)
+void *
+xnvme_be_linux_mem_hugepage_buf_realloc(const struct xnvme_dev *dev, void *buf, size_t nbytes,
+					uint64_t *phys)
 {
-	struct huge_alloc *entry;
+	int node = dev ? xnvme_dev_numa_node_pref(dev) : -1;
+	struct huge_region *region;
+	void *new = NULL;
 
 	if (!buf) {
-		return;
+		return xnvme_be_linux_mem_hugepage_buf_alloc(dev, nbytes, phys);
+	}
+	if (!nbytes) {
+		XNVME_DEBUG("FAILED: invalid value for nbytes: '%zu')", nbytes);
+		errno = EINVAL;
+		return NULL;
 	}
 
-	// Iterate through linked-list to find the entry from *buf
-	entry = SLIST_FIRST(&huge_alloc_head);
-	while (entry != NULL) {
-		if (entry->addr == buf) {
-			break;
-		}
-		entry = SLIST_NEXT(entry, link);
+	pthread_mutex_lock(&g_arena.mutex);
+
+	_arena_init();
+	region = _arena_region(buf);
+	if (region) {
+		new = _arena_realloc(region, buf, nbytes, node);
+	}
+
+	pthread_mutex_unlock(&g_arena.mutex);
+
+	if (!region) {
+		XNVME_DEBUG("FAILED: buf: %p was not allocated by the hugepage arena", buf);
+		errno = EINVAL;
+		return NULL;
 	}
+	if (!new) {
+		XNVME_DEBUG("FAILED: no hugepage memory for nbytes: %zu", nbytes);
+		errno = ENOMEM;
+	}
+
+	return new;
+}
 
-	if (!entry) {
-		XNVME_DEBUG("huge_alloc_table_reset: Entry %p not found!", buf);
+void
+xnvme_be_linux_mem_hugepage_buf_free(const struct xnvme_dev *XNVME_UNUSED(dev), void *buf)
+{
+	if (!buf) {
+		return;
 	}
 
-	// Clean up all the files, buffers etc. for the hugepage
-	munmap(buf, entry->len);
-	close(entry->fd);
-	remove(entry->path);
-	SLIST_REMOVE(&huge_alloc_head, entry, huge_alloc, link);
-	free(entry);
+	pthread_mutex_lock(&g_arena.mutex);
+
+	_arena_free(buf);
+
+	pthread_mutex_unlock(&g_arena.mutex);
 }
 
 #endif
@@ -173,7 +647,7 @@ struct xnvme_be_mem g_xnvme_be_linux_mem_hugepage = {
 	.id = "hugepage",
 #ifdef XNVME_BE_LINUX_ENABLED
 	.buf_alloc = xnvme_be_linux_mem_hugepage_buf_alloc,
-	.buf_realloc = xnvme_be_nosys_buf_realloc,
+	.buf_realloc = xnvme_be_linux_mem_hugepage_buf_realloc,
 	.buf_free = xnvme_be_linux_mem_hugepage_buf_free,
 	.buf_vtophys = xnvme_be_nosys_buf_vtophys,
 #else
@@ -0,0 +1,182 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <xnvme_be.h>
+#include <xnvme_be_nosys.h>
+#ifdef XNVME_BE_LINUX_ENABLED
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <linux/mempolicy.h>
+#include <xnvme_be_linux.h>
+
+#define NUMA_NODES_MAX 1024
+
+/**
+ * Attributes, relative to /sys/dev/{block,char}/<major>:<minor>, which can carry the NUMA node
+ * of the device. The first is the PCIe function of a namespace, the second the controller of a
+ * namespace, the remaining are the same for a partition.
+ */
+static const char *g_numa_attrs[] = {
+	"device/numa_node",
+	"device/device/numa_node",
+	"../device/numa_node",
+	"../device/device/numa_node",
+};
+static const int g_numa_attrs_nitems = sizeof g_numa_attrs / sizeof *g_numa_attrs;
+
+int
+xnvme_be_linux_numa_node(const struct stat *dev_stat)
+{
+	const char *dclass = S_ISCHR(dev_stat->st_mode) ? "char" : "block";
+	dev_t devno = dev_stat->st_rdev;
+	char path[128];
+
+	// For a regular file use the block-device which the file-system resides on
+	if (S_ISREG(dev_stat->st_mode)) {
+		devno = dev_stat->st_dev;
+	}
+
+	for (int i = 0; i < g_numa_attrs_nitems; ++i) {
+		FILE *fp;
+		int node;
+		int nitems;
+
+		snprintf(path, sizeof(path), "/sys/dev/%s/%u:%u/%s", dclass, major(devno),
+			 minor(devno), g_numa_attrs[i]);
+
+		fp = fopen(path, "r");
+		if (!fp) {
+			continue;
+		}
+		nitems = fscanf(fp, "%d", &node);
+		fclose(fp);
+
+		if ((nitems == 1) && (node >= 0) && (node < NUMA_NODES_MAX)) {
+			XNVME_DEBUG("INFO: numa_node: %d, via: '%s'", node, path);
+			return node;
+		}
+	}
+
+	return -1;
+}
+
+int
+xnvme_be_linux_numa_mbind(void *addr, size_t nbytes, int node)
+{
+	unsigned long nodemask[NUMA_NODES_MAX / (8 * sizeof(unsigned long))] = {0};
+	const size_t nbits = sizeof(unsigned long) * 8;
+	long pagesize = sysconf(_SC_PAGESIZE);
+	uintptr_t begin, end;
+
+	if ((node < 0) || (node >= NUMA_NODES_MAX)) {
+		return -EINVAL;
+	}
+	if (pagesize == -1) {
+		return -errno;
+	}
+
+	// Only the pages entirely covered by [addr, addr + nbytes) are bound
+	begin = ((uintptr_t)addr + pagesize - 1) & ~((uintptr_t)pagesize - 1);
+	end = ((uintptr_t)addr + nbytes) & ~((uintptr_t)pagesize - 1);
+	if (end <= begin) {
+		return 0;
+	}
+
+	nodemask[node / nbits] = 1UL << (node % nbits);
+
+	if (syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED, nodemask, NUMA_NODES_MAX + 1,
+		    0)) {
+		XNVME_DEBUG("FAILED: mbind(node: %d), errno: %d", node, errno);
+		return -errno;
+	}
+
+	return 0;
+}
+
+static int
+_numa_cpuset(int node, cpu_set_t *cpuset)
+{
+	char path[128];
+	FILE *fp;
+	int first, last;
+	int ncpus = 0;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		XNVME_DEBUG("FAILED: fopen('%s'), errno: %d", path, errno);
+		return -errno;
+	}
+
+	// The cpulist is formatted as comma-separated ranges e.g. "0-7,16-23" or "3"
+	CPU_ZERO(cpuset);
+	while (fscanf(fp, "%d", &first) == 1) {
+		int sep = fgetc(fp);
+
+		last = first;
+		if ((sep == '-') && (fscanf(fp, "%d", &last) == 1)) {
+			sep = fgetc(fp);
+		}
+		for (int cpu = first; (cpu <= last) && (cpu < CPU_SETSIZE); ++cpu) {
+			CPU_SET(cpu, cpuset);
+			++ncpus;
+		}
+		if (sep != ',') {
+			break;
+		}
+	}
+	fclose(fp);
+
+	return ncpus ? 0 : -ENOENT;
+}
+
+int
+xnvme_be_linux_numa_cpu(int node)
+{
+	cpu_set_t cpuset;
+	int err;
+
+	err = _numa_cpuset(node, &cpuset);
+	if (err) {
+		return err;
+	}
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (CPU_ISSET(cpu, &cpuset)) {
+			return cpu;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int
+xnvme_be_linux_numa_bind_thread(pthread_t thread, int node)
+{
+	cpu_set_t cpuset;
+	int err;
+
+	err = _numa_cpuset(node, &cpuset);
+	if (err) {
+		return err;
+	}
+
+	err = pthread_setaffinity_np(thread, sizeof(cpuset), &cpuset);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_setaffinity_np(node: %d), err: %d", node, err);
+		return -err;
+	}
+
+	return 0;
+}
+#endif
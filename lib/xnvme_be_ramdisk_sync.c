@@ -44,6 +44,14 @@ xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_
 
 	case XNVME_SPEC_NVM_OPC_FLUSH:
 	case XNVME_SPEC_FS_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
+		break;
+
+	case XNVME_SPEC_FS_OPC_FALLOCATE:
+		// The ramdisk is always fully allocated, a punched hole must read back as zeroes
+		if (ctx->cmd.fs.mode & XNVME_SPEC_FS_FALLOCATE_PUNCH_HOLE) {
+			memset(offset + ctx->cmd.fs.offset, 0, ctx->cmd.fs.nbytes);
+		}
 		break;
 
 	case XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT:
@@ -100,6 +108,7 @@ xnvme_be_ramdisk_sync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, siz
 
 	case XNVME_SPEC_NVM_OPC_FLUSH:
 	case XNVME_SPEC_FS_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FDATASYNC:
 		break;
 
 	default:
@@ -164,3 +164,8 @@ struct xnvme_be_async g_xnvme_be_spdk_async = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_SPDK_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_spdk_async, xnvme_be_spdk_async_cmd_io,
+			     xnvme_be_nosys_queue_cmd_iov, xnvme_be_spdk_queue_poke)
+#endif
@@ -169,3 +169,8 @@ struct xnvme_be_async g_xnvme_be_vfio_async = {
 	.term = xnvme_be_nosys_queue_term,
 #endif
 };
+
+#ifdef XNVME_BE_LINUX_VFIO_PINNED
+XNVME_BE_ASYNC_PINNED_DEFINE(g_xnvme_be_vfio_async, xnvme_be_vfio_async_cmd_io,
+			     xnvme_be_nosys_queue_cmd_iov, xnvme_be_vfio_queue_poke)
+#endif
@@ -4,10 +4,32 @@
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#if defined(XNVME_BE_MACOS_ENABLED)
+#include <malloc/malloc.h>
+#elif defined(XNVME_BE_FBSD_ENABLED)
+#include <malloc_np.h>
+#elif !defined(WIN32)
+#include <malloc.h>
+#endif
 #include <libxnvme.h>
 #include <xnvme_dev.h>
 #include <xnvme_be.h>
 
+#ifndef WIN32
+/**
+ * Returns the usable size of an allocation obtained from the C library allocator
+ */
+static size_t
+_buf_virt_nbytes(void *buf)
+{
+#if defined(XNVME_BE_MACOS_ENABLED)
+	return malloc_size(buf);
+#else
+	return malloc_usable_size(buf);
+#endif
+}
+#endif
+
 void *
 xnvme_buf_virt_alloc(size_t alignment, size_t nbytes)
 {
@@ -27,11 +49,41 @@ xnvme_buf_virt_alloc(size_t alignment, size_t nbytes)
 }
 
 void *
-xnvme_buf_virt_realloc(void *XNVME_UNUSED(buf), size_t XNVME_UNUSED(alignment),
-		       size_t XNVME_UNUSED(nbytes))
+xnvme_buf_virt_realloc(void *buf, size_t alignment, size_t nbytes)
 {
-	errno = ENOSYS;
-	return NULL;
+#ifndef WIN32
+	size_t buf_nbytes;
+	void *new;
+#endif
+
+	if (!buf) {
+		return xnvme_buf_virt_alloc(alignment, nbytes);
+	}
+	if (!nbytes) {
+		errno = EINVAL;
+		XNVME_DEBUG("FAILED: invalid value for nbytes: '%zu')", nbytes);
+		return NULL;
+	}
+	nbytes = (1 + ((nbytes - 1) / alignment)) * (alignment);
+#ifdef WIN32
+	return _aligned_realloc(buf, nbytes, alignment);
+#else
+	// realloc() does not preserve the alignment; grow into the slack of the allocation when
+	// possible, otherwise move the content to a new aligned allocation
+	buf_nbytes = _buf_virt_nbytes(buf);
+	if (nbytes <= buf_nbytes) {
+		return buf;
+	}
+
+	new = xnvme_buf_virt_alloc(alignment, nbytes);
+	if (!new) {
+		return NULL;
+	}
+	memcpy(new, buf, buf_nbytes);
+	xnvme_buf_virt_free(buf);
+
+	return new;
+#endif
 }
 
 void
@@ -6,6 +6,7 @@
 #include <xnvme_cmd.h>
 #include <xnvme_dev.h>
 #include <xnvme_queue.h>
+#include <xnvme_znd.h>
 
 void
 xnvme_cmd_ctx_pr(const struct xnvme_cmd_ctx *ctx, int XNVME_UNUSED(opts))
@@ -46,17 +47,44 @@ xnvme_cmd_pass(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *
 	       size_t mbuf_nbytes)
 {
 	const int cmd_opts = ctx->opts & XNVME_CMD_MASK;
+	uint64_t nlbas;
+	int err;
+
+	if (ctx->dev->opts.split) {
+		nlbas = xnvme_cmd_split_nlbas(ctx);
+		if (nlbas) {
+			return xnvme_cmd_split_pass(ctx, dbuf, mbuf, nlbas);
+		}
+	}
 
 	switch (cmd_opts & XNVME_CMD_MASK_IOMD) {
 	case XNVME_CMD_ASYNC:
-		if (ctx->async.queue->base.outstanding == ctx->async.queue->base.capacity) {
+		if (xnvme_queue_get_outstanding(ctx->async.queue) ==
+		    ctx->async.queue->base.capacity) {
 			XNVME_DEBUG("FAILED: queue is full; returning -EBUSY");
 			return -EBUSY;
 		}
-		return ctx->dev->be.async.cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+		if (ctx->dev->znd_cache) {
+			err = xnvme_znd_cache_track(ctx);
+			if (err) {
+				return err;
+			}
+		}
+		err = XNVME_BE_ASYNC_CMD_IO(ctx->dev, ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+		if ((err == -ENOSYS) && ctx->dev->opts.async_helper) {
+			err = xnvme_queue_helper_pass(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+		}
+		if (err && ctx->dev->znd_cache) {
+			xnvme_znd_cache_untrack(ctx);
+		}
+		return err;
 
 	case XNVME_CMD_SYNC:
-		return ctx->dev->be.sync.cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+		err = ctx->dev->be.sync.cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+		if (ctx->dev->znd_cache) {
+			xnvme_znd_cache_cpl(ctx, err);
+		}
+		return err;
 
 	default:
 		XNVME_DEBUG("FAILED: command-mode not provided");
@@ -69,18 +97,46 @@ xnvme_cmd_passv(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
 		struct iovec *mvec, size_t mvec_cnt, size_t mvec_nbytes)
 {
 	const int cmd_opts = ctx->opts & XNVME_CMD_MASK;
+	uint64_t nlbas;
+	int err;
+
+	if (ctx->dev->opts.split) {
+		nlbas = xnvme_cmd_split_nlbas(ctx);
+		if (nlbas) {
+			return xnvme_cmd_split_passv(ctx, dvec, dvec_cnt, mvec, mvec_cnt, nlbas);
+		}
+	}
 
 	switch (cmd_opts & XNVME_CMD_MASK_IOMD) {
 	case XNVME_CMD_ASYNC:
-		if (ctx->async.queue->base.outstanding == ctx->async.queue->base.capacity) {
+		if (xnvme_queue_get_outstanding(ctx->async.queue) ==
+		    ctx->async.queue->base.capacity) {
 			XNVME_DEBUG("FAILED: queue is full; returning -EBUSY");
 			return -EBUSY;
 		}
-		return ctx->dev->be.async.cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mvec, mvec_cnt,
-						  mvec_nbytes);
+		if (ctx->dev->znd_cache) {
+			err = xnvme_znd_cache_track(ctx);
+			if (err) {
+				return err;
+			}
+		}
+		err = XNVME_BE_ASYNC_CMD_IOV(ctx->dev, ctx, dvec, dvec_cnt, dvec_nbytes, mvec,
+					     mvec_cnt, mvec_nbytes);
+		if ((err == -ENOSYS) && ctx->dev->opts.async_helper) {
+			err = xnvme_queue_helper_passv(ctx, dvec, dvec_cnt, dvec_nbytes, mvec,
+						       mvec_cnt, mvec_nbytes);
+		}
+		if (err && ctx->dev->znd_cache) {
+			xnvme_znd_cache_untrack(ctx);
+		}
+		return err;
 	case XNVME_CMD_SYNC:
-		return ctx->dev->be.sync.cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mvec, mvec_cnt,
-						 mvec_nbytes);
+		err = ctx->dev->be.sync.cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mvec, mvec_cnt,
+						mvec_nbytes);
+		if (ctx->dev->znd_cache) {
+			xnvme_znd_cache_cpl(ctx, err);
+		}
+		return err;
 	default:
 		XNVME_DEBUG("FAILED: command-mode not provided");
 		return -EINVAL;
@@ -0,0 +1,409 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/queue.h>
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#include <xnvme_cmd.h>
+#include <xnvme_dev.h>
+#include <xnvme_queue.h>
+
+struct xnvme_cmd_split;
+
+/**
+ * A child command of a split, with its own command-context, such that splitting does not consume
+ * the command-contexts of the queue; these are for the user of the queue
+ */
+struct xnvme_cmd_split_child {
+	struct xnvme_cmd_ctx ctx;
+	struct xnvme_cmd_split *split;
+	size_t dvec_cnt;
+	size_t mvec_cnt;
+	struct iovec *vecs; ///< 'dvec_cnt' data iovecs followed by 'mvec_cnt' meta iovecs
+
+	SLIST_ENTRY(xnvme_cmd_split_child) link;
+};
+
+/**
+ * A read or write exceeding the MDTS of the device, split into child commands; the children are
+ * submitted as the queue has room for them, and their completions are aggregated into the parent
+ */
+struct xnvme_cmd_split {
+	struct xnvme_cmd_ctx *parent;
+
+	uint8_t *dbuf;
+	uint8_t *mbuf;
+	struct iovec *dvec;
+	size_t dvec_cnt;
+	struct iovec *mvec;
+	size_t mvec_cnt;
+
+	uint64_t nlbas;      ///< Number of LBAs of the parent
+	uint64_t nsubmitted; ///< Number of LBAs submitted via children
+	uint32_t chunk;      ///< Maximum number of LBAs of a child
+	uint32_t noutstanding;
+	int queued; ///< Whether the split is on the list of the queue, awaiting submission
+	int failed;
+	struct xnvme_spec_cpl cpl; ///< Completion of the first failed child, otherwise the last
+	uint64_t result;           ///< Sum of the completion-results of the children
+
+	TAILQ_ENTRY(xnvme_cmd_split) link;
+
+	SLIST_HEAD(, xnvme_cmd_split_child) children; ///< Children which are not in flight
+	struct xnvme_cmd_split_child child_storage[];
+};
+
+uint64_t
+xnvme_cmd_split_nlbas(struct xnvme_cmd_ctx *ctx)
+{
+	const struct xnvme_geo *geo = &ctx->dev->geo;
+	uint64_t nlbas, chunk;
+
+	if (ctx->opts & XNVME_CMD_MASK_UPLD) {
+		return 0;
+	}
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_READ:
+	case XNVME_SPEC_NVM_OPC_WRITE:
+		break;
+
+	default:
+		return 0;
+	}
+	if (!geo->lba_nbytes || (geo->mdts_nbytes < geo->lba_nbytes)) {
+		return 0;
+	}
+
+	nlbas = (uint64_t)ctx->cmd.nvm.nlb + 1;
+	chunk = XNVME_MIN_U64(geo->mdts_nbytes / geo->lba_nbytes, UINT16_MAX + 1);
+
+	return nlbas > chunk ? nlbas : 0;
+}
+
+/**
+ * Fill 'out' with the part of the given iovecs covering [ofz, ofz + nbytes)
+ *
+ * @return The number of iovecs in 'out'
+ */
+static size_t
+_iov_slice(const struct iovec *vec, size_t vec_cnt, size_t ofz, size_t nbytes, struct iovec *out)
+{
+	size_t cnt = 0;
+
+	for (size_t i = 0; (i < vec_cnt) && nbytes; ++i) {
+		size_t len;
+
+		if (ofz >= vec[i].iov_len) {
+			ofz -= vec[i].iov_len;
+			continue;
+		}
+		len = XNVME_MIN_U64(vec[i].iov_len - ofz, nbytes);
+
+		out[cnt].iov_base = (uint8_t *)vec[i].iov_base + ofz;
+		out[cnt].iov_len = len;
+		cnt += 1;
+
+		nbytes -= len;
+		ofz = 0;
+	}
+
+	return cnt;
+}
+
+static void _split_child_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg);
+
+/**
+ * Allocate a split along with its children, one for sync. commands, and for async. commands as
+ * many as the queue can have in flight, bounded by the number of children of the split
+ */
+static struct xnvme_cmd_split *
+_split_alloc(struct xnvme_cmd_ctx *ctx, uint64_t nlbas, size_t dvec_cnt, size_t mvec_cnt)
+{
+	const struct xnvme_geo *geo = &ctx->dev->geo;
+	const uint32_t chunk = XNVME_MIN_U64(geo->mdts_nbytes / geo->lba_nbytes, UINT16_MAX + 1);
+	const size_t nvecs = dvec_cnt + mvec_cnt;
+	struct xnvme_cmd_split *split;
+	struct iovec *vecs;
+	uint64_t nchildren = 1;
+
+	if (ctx->opts & XNVME_CMD_ASYNC) {
+		nchildren = XNVME_MIN_U64((nlbas + chunk - 1) / chunk,
+					  ctx->async.queue->base.capacity);
+	}
+
+	split = calloc(1, sizeof(*split) + nchildren * sizeof(*split->child_storage) +
+				  nchildren * nvecs * sizeof(*vecs));
+	if (!split) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return NULL;
+	}
+	split->parent = ctx;
+	split->nlbas = nlbas;
+	split->chunk = chunk;
+
+	vecs = (struct iovec *)&split->child_storage[nchildren];
+	SLIST_INIT(&split->children);
+	for (uint64_t i = 0; i < nchildren; ++i) {
+		struct xnvme_cmd_split_child *child = &split->child_storage[i];
+
+		child->ctx = *ctx;
+		child->split = split;
+		child->vecs = &vecs[i * nvecs];
+		xnvme_cmd_ctx_set_cb(&child->ctx, _split_child_cb, child);
+
+		SLIST_INSERT_HEAD(&split->children, child, link);
+	}
+
+	return split;
+}
+
+/**
+ * Setup 'child' with the next, at most 'chunk', LBAs of the split and pass it
+ */
+static int
+_split_child_pass(struct xnvme_cmd_split *split, struct xnvme_cmd_split_child *child)
+{
+	const struct xnvme_geo *geo = &split->parent->dev->geo;
+	const uint64_t ofz = split->nsubmitted;
+	const uint32_t nlb = XNVME_MIN_U64(split->chunk, split->nlbas - ofz);
+	const size_t dofz = ofz * geo->lba_nbytes, dnbytes = (size_t)nlb * geo->lba_nbytes;
+	const size_t mofz = ofz * geo->nbytes_oob, mnbytes = (size_t)nlb * geo->nbytes_oob;
+	struct xnvme_cmd_ctx *ctx = &child->ctx;
+	int err;
+
+	ctx->cmd = split->parent->cmd;
+	ctx->cmd.nvm.slba = split->parent->cmd.nvm.slba + ofz;
+	ctx->cmd.nvm.nlb = nlb - 1;
+	memset(&ctx->cpl, 0, sizeof(ctx->cpl));
+
+	if (!split->dvec) {
+		err = xnvme_cmd_pass(ctx, split->dbuf + dofz, dnbytes,
+				     split->mbuf ? split->mbuf + mofz : NULL,
+				     split->mbuf ? mnbytes : 0);
+	} else {
+		struct iovec *dvec = child->vecs;
+		struct iovec *mvec = child->vecs + split->dvec_cnt;
+
+		child->dvec_cnt = _iov_slice(split->dvec, split->dvec_cnt, dofz, dnbytes, dvec);
+		child->mvec_cnt = _iov_slice(split->mvec, split->mvec_cnt, mofz, mnbytes, mvec);
+
+		err = xnvme_cmd_passv(ctx, dvec, child->dvec_cnt, dnbytes,
+				      child->mvec_cnt ? mvec : NULL, child->mvec_cnt,
+				      child->mvec_cnt ? mnbytes : 0);
+	}
+	if (!err) {
+		split->nsubmitted += nlb;
+	}
+
+	return err;
+}
+
+static int
+_split_sync(struct xnvme_cmd_split *split)
+{
+	struct xnvme_cmd_split_child *child = SLIST_FIRST(&split->children);
+	int err = 0;
+
+	while (split->nsubmitted < split->nlbas) {
+		err = _split_child_pass(split, child);
+		split->result += child->ctx.cpl.result;
+		split->parent->cpl = child->ctx.cpl;
+		if (err || xnvme_cmd_ctx_cpl_status(&child->ctx)) {
+			XNVME_DEBUG("FAILED: slba: 0x%lx, err: %d", child->ctx.cmd.nvm.slba, err);
+			break;
+		}
+	}
+	split->parent->cpl.result = split->result;
+
+	return err;
+}
+
+static void
+_split_complete(struct xnvme_cmd_split *split)
+{
+	struct xnvme_cmd_ctx *parent = split->parent;
+
+	parent->cpl = split->cpl;
+	parent->cpl.result = split->result;
+	free(split);
+
+	parent->async.cb(parent, parent->async.cb_arg);
+}
+
+static void
+_split_child_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct xnvme_cmd_split_child *child = cb_arg;
+	struct xnvme_cmd_split *split = child->split;
+
+	if (!split->failed) {
+		split->failed = xnvme_cmd_ctx_cpl_status(ctx);
+		split->cpl = ctx->cpl;
+	}
+	split->result += ctx->cpl.result;
+	split->noutstanding -= 1;
+	SLIST_INSERT_HEAD(&split->children, child, link);
+
+	if (!split->noutstanding && !split->queued) {
+		_split_complete(split);
+	}
+}
+
+/**
+ * Submit children of the split while the queue has room for them
+ *
+ * @return On success, 0 is returned, also when the queue is full. On error, negative errno is
+ * returned, and the split is marked as failed.
+ */
+static int
+_split_submit(struct xnvme_cmd_split *split)
+{
+	struct xnvme_queue *queue = split->parent->async.queue;
+
+	while ((split->nsubmitted < split->nlbas) && !split->failed) {
+		struct xnvme_cmd_split_child *child = SLIST_FIRST(&split->children);
+		int err;
+
+		if (!child || (xnvme_queue_get_outstanding(queue) == queue->base.capacity)) {
+			return 0;
+		}
+		SLIST_REMOVE_HEAD(&split->children, link);
+
+		err = _split_child_pass(split, child);
+		if (err) {
+			SLIST_INSERT_HEAD(&split->children, child, link);
+			if ((err == -EBUSY) || (err == -EAGAIN)) {
+				return 0;
+			}
+			XNVME_DEBUG("FAILED: _split_child_pass(), err: %d", err);
+			split->failed = 1;
+			return err;
+		}
+		split->noutstanding += 1;
+	}
+
+	return 0;
+}
+
+static int
+_split_async(struct xnvme_cmd_split *split)
+{
+	struct xnvme_queue *queue = split->parent->async.queue;
+	int err;
+
+	err = _split_submit(split);
+	if (!split->noutstanding) {
+		// Nothing is in flight, thus, the parent is not submitted
+		free(split);
+		return err ? err : -EBUSY;
+	}
+	if (split->failed) {
+		split->cpl.status.sc = -err;
+		split->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+		return 0;
+	}
+	if (split->nsubmitted == split->nlbas) {
+		return 0;
+	}
+
+	split->queued = 1;
+	TAILQ_INSERT_TAIL(&queue->splits, split, link);
+
+	return 0;
+}
+
+int
+xnvme_cmd_split_pass(struct xnvme_cmd_ctx *ctx, void *dbuf, void *mbuf, uint64_t nlbas)
+{
+	struct xnvme_cmd_split *split;
+	int err;
+
+	split = _split_alloc(ctx, nlbas, 0, 0);
+	if (!split) {
+		return -errno;
+	}
+	split->dbuf = dbuf;
+	split->mbuf = mbuf;
+
+	if (ctx->opts & XNVME_CMD_ASYNC) {
+		return _split_async(split);
+	}
+
+	err = _split_sync(split);
+	free(split);
+
+	return err;
+}
+
+int
+xnvme_cmd_split_passv(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+		      struct iovec *mvec, size_t mvec_cnt, uint64_t nlbas)
+{
+	struct xnvme_cmd_split *split;
+	int err;
+
+	split = _split_alloc(ctx, nlbas, dvec_cnt, mvec ? mvec_cnt : 0);
+	if (!split) {
+		return -errno;
+	}
+	split->dvec = dvec;
+	split->dvec_cnt = dvec_cnt;
+	split->mvec = mvec;
+	split->mvec_cnt = mvec ? mvec_cnt : 0;
+
+	if (ctx->opts & XNVME_CMD_ASYNC) {
+		return _split_async(split);
+	}
+
+	err = _split_sync(split);
+	free(split);
+
+	return err;
+}
+
+void
+xnvme_cmd_split_resume(struct xnvme_queue *queue)
+{
+	TAILQ_HEAD(, xnvme_cmd_split) done = TAILQ_HEAD_INITIALIZER(done);
+	struct xnvme_cmd_split *split, *next;
+
+	for (split = TAILQ_FIRST(&queue->splits); split; split = next) {
+		int err;
+
+		next = TAILQ_NEXT(split, link);
+
+		err = _split_submit(split);
+		if (err) {
+			split->cpl.status.sc = -err;
+			split->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+		}
+		if ((split->nsubmitted < split->nlbas) && !split->failed) {
+			continue;
+		}
+
+		TAILQ_REMOVE(&queue->splits, split, link);
+		split->queued = 0;
+		if (!split->noutstanding) {
+			TAILQ_INSERT_TAIL(&done, split, link);
+		}
+	}
+
+	// The callbacks are invoked after the walk, as they might submit another split
+	while ((split = TAILQ_FIRST(&done))) {
+		TAILQ_REMOVE(&done, split, link);
+		_split_complete(split);
+	}
+}
+
+void
+xnvme_cmd_split_term(struct xnvme_queue *queue)
+{
+	struct xnvme_cmd_split *split;
+
+	while ((split = TAILQ_FIRST(&queue->splits))) {
+		TAILQ_REMOVE(&queue->splits, split, link);
+		free(split);
+	}
+}
@@ -1,14 +1,22 @@
 // Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
 // SPDX-License-Identifier: Apache-2.0
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
 #include <libxnvme.h>
+#include <libxnvme_file.h>
+#include <libxnvme_znd.h>
 #include <xnvme_be.h>
 #include <xnvme_cmd.h>
 #include <xnvme_dev.h>
 #include <xnvme_geo.h>
+#include <xnvme_znd.h>
+#ifdef XNVME_BE_LINUX_ENABLED
+#include <sys/mman.h>
+#include <xnvme_be_linux.h>
+#endif
 
 int
 xnvme_dev_fpr(FILE *stream, const struct xnvme_dev *dev, int opts)
@@ -76,6 +84,15 @@ xnvme_dev_get_ctrlr(const struct xnvme_dev *dev)
 const struct xnvme_spec_idfy_ctrlr *
 xnvme_dev_get_ctrlr_css(const struct xnvme_dev *dev)
 {
+	if (__atomic_load_n(&dev->idcss_state, __ATOMIC_ACQUIRE)) {
+		int err = xnvme_be_dev_idfy_css((struct xnvme_dev *)dev);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_be_dev_idfy_css(), err: %d", err);
+			errno = -err;
+			return NULL;
+		}
+	}
+
 	return &dev->idcss.ctrlr;
 }
 
@@ -88,6 +105,15 @@ xnvme_dev_get_ns(const struct xnvme_dev *dev)
 const struct xnvme_spec_idfy_ns *
 xnvme_dev_get_ns_css(const struct xnvme_dev *dev)
 {
+	if (__atomic_load_n(&dev->idcss_state, __ATOMIC_ACQUIRE)) {
+		int err = xnvme_be_dev_idfy_css((struct xnvme_dev *)dev);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_be_dev_idfy_css(), err: %d", err);
+			errno = -err;
+			return NULL;
+		}
+	}
+
 	return &dev->idcss.ns;
 }
 
@@ -121,6 +147,68 @@ xnvme_dev_get_ssw(const struct xnvme_dev *dev)
 	return dev->geo.ssw;
 }
 
+int
+xnvme_dev_get_numa_node(const struct xnvme_dev *dev)
+{
+	return dev->numa_node;
+}
+
+#ifdef XNVME_BE_LINUX_ENABLED
+void
+xnvme_dev_numa_bind(const struct xnvme_dev *dev, void *addr, size_t nbytes)
+{
+	int node = dev ? xnvme_dev_numa_node_pref(dev) : -1;
+
+	if (node < 0) {
+		return;
+	}
+
+	xnvme_be_linux_numa_mbind(addr, nbytes, node);
+}
+
+void *
+xnvme_dev_numa_zalloc(const struct xnvme_dev *dev, size_t nbytes)
+{
+	void *addr;
+
+	addr = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED) {
+		XNVME_DEBUG("FAILED: mmap(), errno: %d", errno);
+		return NULL;
+	}
+	xnvme_dev_numa_bind(dev, addr, nbytes);
+
+	return addr;
+}
+
+void
+xnvme_dev_numa_free(void *addr, size_t nbytes)
+{
+	if (addr) {
+		munmap(addr, nbytes);
+	}
+}
+#else
+void
+xnvme_dev_numa_bind(const struct xnvme_dev *XNVME_UNUSED(dev), void *XNVME_UNUSED(addr),
+		    size_t XNVME_UNUSED(nbytes))
+{
+	return;
+}
+
+void *
+xnvme_dev_numa_zalloc(const struct xnvme_dev *XNVME_UNUSED(dev), size_t nbytes)
+{
+	return calloc(1, nbytes);
+}
+
+void
+xnvme_dev_numa_free(void *addr, size_t XNVME_UNUSED(nbytes))
+{
+	free(addr);
+}
+#endif
+
 const void *
 xnvme_dev_get_be_state(const struct xnvme_dev *dev)
 {
@@ -170,12 +258,170 @@ xnvme_dev_open(const char *dev_uri, struct xnvme_opts *opts)
 	return dev;
 }
 
+/**
+ * Devices opened via xnvme_dev_open_shared()
+ */
+static struct {
+	pthread_mutex_t mutex;
+	SLIST_HEAD(, xnvme_dev) devs;
+} g_shared = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.devs = SLIST_HEAD_INITIALIZER(g_shared.devs),
+};
+
+static int
+_shared_opt_match(const char *given, const char *opened)
+{
+	return !given || (opened && !strcmp(given, opened));
+}
+
+static int
+_shared_str_eq(const char *a, const char *b)
+{
+	return (a == b) || (a && b && !strcmp(a, b));
+}
+
+/**
+ * Normalize the given 'opts' for comparison with those of shared devices; the default open-mode
+ * is assigned, and "auto" is equivalent to not giving an async. interface
+ */
+static void
+_shared_opts_normalize(struct xnvme_opts *opts, uint32_t oflags)
+{
+	opts->oflags = oflags;
+	if (opts->async && !strcmp(opts->async, "auto")) {
+		opts->async = NULL;
+	}
+}
+
+/**
+ * Returns 1 when 'dev' is opened from the given 'ident' and 'opts'; the interfaces and nsid,
+ * when not given, match those that the device is opened with. The async. interface, and all other
+ * options, must equal those given when the device was opened, as they change the behavior of the
+ * handle, e.g. "auto" selection of the async. interface also enables the async_helper
+ */
+static int
+_shared_match(const struct xnvme_dev *dev, const struct xnvme_ident *ident,
+	      const struct xnvme_opts *opts)
+{
+	const struct xnvme_opts *opened = &dev->shared_opts;
+
+	return !strcmp(dev->ident.uri, ident->uri) && (opened->oflags == opts->oflags) &&
+	       (!opts->nsid || (opts->nsid == dev->ident.nsid)) &&
+	       _shared_opt_match(opts->be, dev->opts.be) &&
+	       _shared_opt_match(opts->mem, dev->opts.mem) &&
+	       _shared_opt_match(opts->admin, dev->opts.admin) &&
+	       _shared_opt_match(opts->sync, dev->opts.sync) &&
+	       _shared_str_eq(opts->async, opened->async) &&
+	       (opened->poll_io == opts->poll_io) && (opened->poll_sq == opts->poll_sq) &&
+	       (opened->register_files == opts->register_files) &&
+	       (opened->register_buffers == opts->register_buffers) &&
+	       (opened->split == opts->split) && (opened->async_helper == opts->async_helper) &&
+	       (opened->numa_node.given == opts->numa_node.given) &&
+	       (opened->numa_node.value == opts->numa_node.value) &&
+	       (opened->css.given == opts->css.given) && (opened->css.value == opts->css.value) &&
+	       (opened->use_cmb_sqs == opts->use_cmb_sqs) && (opened->shm_id == opts->shm_id) &&
+	       (opened->main_core == opts->main_core) &&
+	       _shared_str_eq(opts->core_mask, opened->core_mask) &&
+	       _shared_str_eq(opts->adrfam, opened->adrfam) &&
+	       _shared_str_eq(opts->subnqn, opened->subnqn) &&
+	       _shared_str_eq(opts->hostnqn, opened->hostnqn);
+}
+
+struct xnvme_dev *
+xnvme_dev_open_shared(const char *dev_uri, struct xnvme_opts *opts)
+{
+	struct xnvme_opts opts_default = xnvme_opts_default();
+	struct xnvme_ident ident = {0};
+	struct xnvme_dev *dev = NULL;
+	struct xnvme_opts given;
+	uint32_t oflags;
+	int err;
+
+	if (!opts) {
+		opts = &opts_default;
+	}
+	oflags = opts->oflags ? opts->oflags : opts_default.oflags;
+
+	err = xnvme_ident_from_uri(dev_uri, &ident);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_ident_from_uri(), err: %d", err);
+		errno = -err;
+		return NULL;
+	}
+
+	pthread_mutex_lock(&g_shared.mutex);
+
+	given = *opts;
+	_shared_opts_normalize(&given, oflags);
+
+	for (dev = SLIST_FIRST(&g_shared.devs); dev; dev = SLIST_NEXT(dev, shared)) {
+		if (_shared_match(dev, &ident, &given)) {
+			dev->refcount += 1;
+			goto exit;
+		}
+	}
+
+	dev = xnvme_dev_open(dev_uri, opts);
+	if (!dev) {
+		XNVME_DEBUG("FAILED: xnvme_dev_open(), errno: %d", errno);
+		goto exit;
+	}
+	dev->refcount = 1;
+	dev->shared_opts = given;
+	SLIST_INSERT_HEAD(&g_shared.devs, dev, shared);
+
+exit:
+	pthread_mutex_unlock(&g_shared.mutex);
+
+	return dev;
+}
+
+/**
+ * Drop a reference to the shared device, returns 1 when other references remain, and 0 when the
+ * device is no longer shared, thus, is to be closed
+ */
+static int
+_shared_put(struct xnvme_dev *dev)
+{
+	int remain;
+
+	pthread_mutex_lock(&g_shared.mutex);
+	dev->refcount -= 1;
+	remain = dev->refcount > 0;
+	if (!remain) {
+		SLIST_REMOVE(&g_shared.devs, dev, xnvme_dev, shared);
+	}
+	pthread_mutex_unlock(&g_shared.mutex);
+
+	return remain;
+}
+
+int
+xnvme_dev_teardown(struct xnvme_dev *dev)
+{
+	if (dev->refcount && _shared_put(dev)) {
+		return 1;
+	}
+
+	if (dev->file_ra) {
+		xnvme_file_readahead(dev, 0, 0);
+	}
+	xnvme_znd_cache_disable(dev);
+	xnvme_znd_report_queue_term(dev);
+
+	return 0;
+}
+
 void
 xnvme_dev_close(struct xnvme_dev *dev)
 {
 	if (!dev) {
 		return;
 	}
+	if (xnvme_dev_teardown(dev)) {
+		return;
+	}
 
 	dev->be.dev.dev_close(dev);
 	free(dev);
@@ -190,6 +436,7 @@ xnvme_dev_alloc(struct xnvme_dev **dev)
 		return -errno;
 	}
 	memset(*dev, 0, sizeof(**dev));
+	(*dev)->numa_node = -1;
 
 	return 0;
 }
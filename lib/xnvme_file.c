@@ -5,13 +5,51 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
+#include <libxnvme_adm.h>
 #include <libxnvme_file.h>
 #include <libxnvme_spec.h>
 #include <libxnvme_spec_fs.h>
+#include <xnvme_cmd.h>
+#include <xnvme_dev.h>
+#include <xnvme_pipeline.h>
 #include <xnvme_be_linux.h>
 
-int
-xnvme_file_pread(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offset)
+/**
+ * Number of consecutive sequential reads, served without readahead, before readahead starts
+ */
+#define XNVME_FILE_RA_NSEQ_MIN 2
+
+enum xnvme_file_ra_win_state {
+	XNVME_FILE_RA_WIN_IDLE     = 0x0,
+	XNVME_FILE_RA_WIN_INFLIGHT = 0x1,
+	XNVME_FILE_RA_WIN_DONE     = 0x2,
+};
+
+/**
+ * A readahead window, when done then 'buf' holds the file content at [offset, offset + nvalid)
+ */
+struct xnvme_file_ra_win {
+	void *buf;
+	off_t offset;
+	size_t nvalid;
+	int state;
+	int err;
+};
+
+struct xnvme_file_ra {
+	struct xnvme_queue *queue; ///< Queue on which the windows are read
+	size_t nbytes;             ///< Size of each window
+	uint32_t depth;            ///< Number of windows
+	uint32_t head;             ///< Index of the window with the lowest offset
+	uint32_t nseq;             ///< Number of consecutive sequential reads
+	off_t next;                ///< Offset at which the next sequential read starts
+	off_t ra_next;             ///< Offset of the next window to read
+	struct xnvme_file_ra_win wins[];
+};
+
+static int
+_pread(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offset)
 {
 	ctx->cmd.common.opcode = XNVME_SPEC_FS_OPC_READ;
 	ctx->cmd.common.nsid = xnvme_dev_get_nsid(ctx->dev);
@@ -20,9 +58,225 @@ xnvme_file_pread(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offse
 	return xnvme_cmd_pass(ctx, buf, count, NULL, 0);
 }
 
+static void
+_ra_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct xnvme_file_ra_win *win = cb_arg;
+
+	win->err = xnvme_cmd_ctx_cpl_status(ctx) ? -EIO : 0;
+	win->nvalid = win->err ? 0 : ctx->cpl.result;
+	win->state = XNVME_FILE_RA_WIN_DONE;
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+static int
+_ra_submit(struct xnvme_file_ra *ra, struct xnvme_file_ra_win *win)
+{
+	struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(ra->queue);
+	int err;
+
+	xnvme_cmd_ctx_set_cb(ctx, _ra_cb, win);
+	win->offset = ra->ra_next;
+	win->nvalid = 0;
+	win->err = 0;
+	win->state = XNVME_FILE_RA_WIN_INFLIGHT;
+
+	err = _pread(ctx, win->buf, ra->nbytes, win->offset);
+	if (err) {
+		XNVME_DEBUG("FAILED: _pread(offset: %jd), err: %d", (intmax_t)win->offset, err);
+		win->state = XNVME_FILE_RA_WIN_IDLE;
+		xnvme_queue_put_cmd_ctx(ra->queue, ctx);
+		return err;
+	}
+	ra->ra_next += ra->nbytes;
+
+	return 0;
+}
+
+/**
+ * Drop all windows, waiting for those in-flight, and restart sequential-read detection
+ */
+static void
+_ra_reset(struct xnvme_file_ra *ra)
+{
+	if (xnvme_queue_get_outstanding(ra->queue)) {
+		xnvme_queue_drain(ra->queue);
+	}
+	for (uint32_t i = 0; i < ra->depth; ++i) {
+		ra->wins[i].state = XNVME_FILE_RA_WIN_IDLE;
+	}
+	ra->head = 0;
+	ra->nseq = 0;
+}
+
+static int
+_ra_wait(struct xnvme_file_ra *ra, struct xnvme_file_ra_win *win)
+{
+	while (win->state == XNVME_FILE_RA_WIN_INFLIGHT) {
+		int err = xnvme_queue_poke(ra->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	return win->state == XNVME_FILE_RA_WIN_DONE ? win->err : -EINVAL;
+}
+
+/**
+ * Serve a synchronous read via the readahead of the file-handle. Reads are served directly until
+ * a sequential stream is detected, then all windows are read ahead of the stream, and each window
+ * is read again, further ahead, as soon as the stream has consumed it.
+ */
+static int
+_ra_pread(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offset)
+{
+	struct xnvme_file_ra *ra = ctx->dev->file_ra;
+	size_t nbytes = 0;
+	int err;
+
+	if (offset != ra->next) {
+		_ra_reset(ra);
+	}
+
+	if (ra->nseq < XNVME_FILE_RA_NSEQ_MIN) {
+		err = _pread(ctx, buf, count, offset);
+		if (err) {
+			return err;
+		}
+		ra->next = offset + ctx->cpl.result;
+		ra->nseq += 1;
+
+		if (ra->nseq == XNVME_FILE_RA_NSEQ_MIN) {
+			uint32_t lba_nbytes = ctx->dev->geo.lba_nbytes ? ctx->dev->geo.lba_nbytes : 1;
+
+			ra->ra_next = ra->next - (ra->next % lba_nbytes);
+			for (uint32_t i = 0; i < ra->depth; ++i) {
+				if (_ra_submit(ra, &ra->wins[i])) {
+					break;
+				}
+			}
+		}
+		return 0;
+	}
+
+	while (nbytes < count) {
+		struct xnvme_file_ra_win *win = &ra->wins[ra->head];
+		off_t pos = offset + nbytes;
+		off_t end;
+
+		err = _ra_wait(ra, win);
+		end = win->offset + win->nvalid;
+
+		if (!err && (pos >= win->offset) && (pos < end)) {
+			size_t len = XNVME_MIN_U64(count - nbytes, end - pos);
+
+			memcpy((uint8_t *)buf + nbytes, (uint8_t *)win->buf + (pos - win->offset), len);
+			nbytes += len;
+			continue;
+		}
+		if (!err && (pos >= end) && (win->nvalid == ra->nbytes)) {
+			win->state = XNVME_FILE_RA_WIN_IDLE;
+			_ra_submit(ra, win);
+			ra->head = (ra->head + 1) % ra->depth;
+			continue;
+		}
+
+		// On error, end-of-file or a miss then the rest is read directly
+		_ra_reset(ra);
+
+		err = _pread(ctx, (uint8_t *)buf + nbytes, count - nbytes, pos);
+		if (err) {
+			return err;
+		}
+		nbytes += ctx->cpl.result;
+		break;
+	}
+
+	ra->next = offset + nbytes;
+	ctx->cpl.result = nbytes;
+
+	return 0;
+}
+
+int
+xnvme_file_readahead(struct xnvme_dev *fh, uint32_t depth, size_t nbytes)
+{
+	struct xnvme_file_ra *ra = fh->file_ra;
+	int err;
+
+	if (depth && fh->refcount) {
+		XNVME_DEBUG("FAILED: readahead on a shared handle");
+		return -EINVAL;
+	}
+	if (ra) {
+		_ra_reset(ra);
+		xnvme_queue_term(ra->queue);
+		for (uint32_t i = 0; i < ra->depth; ++i) {
+			xnvme_buf_free(fh, ra->wins[i].buf);
+		}
+		free(ra);
+		fh->file_ra = NULL;
+	}
+	if (!depth) {
+		return 0;
+	}
+
+	nbytes = nbytes ? nbytes : fh->geo.mdts_nbytes;
+	if (!nbytes || (fh->geo.lba_nbytes && (nbytes % fh->geo.lba_nbytes))) {
+		XNVME_DEBUG("FAILED: invalid nbytes: %zu", nbytes);
+		return -EINVAL;
+	}
+
+	ra = calloc(1, sizeof(*ra) + depth * sizeof(*ra->wins));
+	if (!ra) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	ra->depth = depth;
+	ra->nbytes = nbytes;
+	ra->next = -1;
+
+	err = xnvme_queue_init(fh, depth, 0, &ra->queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_queue_init(), err: %d", err);
+		free(ra);
+		return err;
+	}
+
+	for (uint32_t i = 0; i < depth; ++i) {
+		ra->wins[i].buf = xnvme_buf_alloc(fh, nbytes);
+		if (!ra->wins[i].buf) {
+			err = -errno;
+			XNVME_DEBUG("FAILED: xnvme_buf_alloc(), err: %d", err);
+			fh->file_ra = ra;
+			xnvme_file_readahead(fh, 0, 0);
+			return err;
+		}
+	}
+	fh->file_ra = ra;
+
+	return 0;
+}
+
+int
+xnvme_file_pread(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offset)
+{
+	if (ctx->dev->file_ra && (ctx->opts & XNVME_CMD_SYNC)) {
+		return _ra_pread(ctx, buf, count, offset);
+	}
+
+	return _pread(ctx, buf, count, offset);
+}
+
 int
 xnvme_file_pwrite(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offset)
 {
+	if (ctx->dev->file_ra) {
+		_ra_reset(ctx->dev->file_ra);
+	}
+
 	ctx->cmd.common.opcode = XNVME_SPEC_FS_OPC_WRITE;
 	ctx->cmd.common.nsid = xnvme_dev_get_nsid(ctx->dev);
 	ctx->cmd.nvm.slba = offset;
@@ -30,6 +284,762 @@ xnvme_file_pwrite(struct xnvme_cmd_ctx *ctx, void *buf, size_t count, off_t offs
 	return xnvme_cmd_pass(ctx, buf, count, NULL, 0);
 }
 
+static size_t
+_iov_nbytes(const struct iovec *iov, size_t iovcnt)
+{
+	size_t nbytes = 0;
+
+	for (size_t i = 0; i < iovcnt; ++i) {
+		nbytes += iov[i].iov_len;
+	}
+
+	return nbytes;
+}
+
+int
+xnvme_file_preadv(struct xnvme_cmd_ctx *ctx, struct iovec *iov, size_t iovcnt, off_t offset)
+{
+	ctx->cmd.common.opcode = XNVME_SPEC_FS_OPC_READ;
+	ctx->cmd.common.nsid = xnvme_dev_get_nsid(ctx->dev);
+	ctx->cmd.nvm.slba = offset;
+
+	return xnvme_cmd_passv(ctx, iov, iovcnt, _iov_nbytes(iov, iovcnt), NULL, 0, 0);
+}
+
+int
+xnvme_file_pwritev(struct xnvme_cmd_ctx *ctx, struct iovec *iov, size_t iovcnt, off_t offset)
+{
+	if (ctx->dev->file_ra) {
+		_ra_reset(ctx->dev->file_ra);
+	}
+
+	ctx->cmd.common.opcode = XNVME_SPEC_FS_OPC_WRITE;
+	ctx->cmd.common.nsid = xnvme_dev_get_nsid(ctx->dev);
+	ctx->cmd.nvm.slba = offset;
+
+	return xnvme_cmd_passv(ctx, iov, iovcnt, _iov_nbytes(iov, iovcnt), NULL, 0, 0);
+}
+
+int
+xnvme_file_fallocate(struct xnvme_cmd_ctx *ctx, off_t offset, size_t nbytes, uint32_t mode)
+{
+	if (ctx->dev->file_ra) {
+		_ra_reset(ctx->dev->file_ra);
+	}
+
+	ctx->cmd.common.opcode = XNVME_SPEC_FS_OPC_FALLOCATE;
+	ctx->cmd.common.nsid = xnvme_dev_get_nsid(ctx->dev);
+	ctx->cmd.fs.offset = offset;
+	ctx->cmd.fs.nbytes = nbytes;
+	ctx->cmd.fs.mode = mode;
+
+	return xnvme_cmd_pass(ctx, NULL, 0, NULL, 0);
+}
+
+int
+xnvme_file_truncate(struct xnvme_cmd_ctx *ctx, off_t nbytes)
+{
+	if (ctx->dev->file_ra) {
+		_ra_reset(ctx->dev->file_ra);
+	}
+
+	ctx->cmd.common.opcode = XNVME_SPEC_FS_OPC_TRUNCATE;
+	ctx->cmd.common.nsid = xnvme_dev_get_nsid(ctx->dev);
+	ctx->cmd.fs.offset = nbytes;
+
+	return xnvme_cmd_pass(ctx, NULL, 0, NULL, 0);
+}
+
+int
+xnvme_file_fsync(struct xnvme_cmd_ctx *ctx)
+{
+	ctx->cmd.common.opcode = XNVME_SPEC_FS_OPC_FLUSH;
+	ctx->cmd.common.nsid = xnvme_dev_get_nsid(ctx->dev);
+
+	return xnvme_cmd_pass(ctx, NULL, 0, NULL, 0);
+}
+
+int
+xnvme_file_fdatasync(struct xnvme_cmd_ctx *ctx)
+{
+	ctx->cmd.common.opcode = XNVME_SPEC_FS_OPC_FDATASYNC;
+	ctx->cmd.common.nsid = xnvme_dev_get_nsid(ctx->dev);
+
+	return xnvme_cmd_pass(ctx, NULL, 0, NULL, 0);
+}
+
+struct xnvme_file_writer_chunk {
+	struct xnvme_file_writer *writer;
+	void *buf;
+	size_t nbytes; ///< Length of the chunk-write in flight
+	int inflight;
+};
+
+struct xnvme_file_writer {
+	struct xnvme_dev *fh;
+	struct xnvme_queue *queue; ///< Queue on which the chunks are written
+	size_t chunk_nbytes;       ///< Size of each chunk
+	uint32_t align;            ///< Alignment of the offset and length of writes
+	uint32_t nchunks;          ///< Number of chunks, the queue-depth plus the one being filled
+	uint32_t cur;              ///< Index of the chunk being filled
+	uint32_t padded;           ///< Whether padding has extended the file beyond 'size'
+	off_t size;                ///< Size of the file without padding; as opened, or as appended
+	off_t offset;              ///< Offset of the chunk being filled
+	size_t nbytes;             ///< Number of bytes appended to the chunk being filled
+	int err;                   ///< First error of a chunk-write
+	struct xnvme_file_writer_chunk chunks[];
+};
+
+static void
+_writer_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct xnvme_file_writer_chunk *chunk = cb_arg;
+
+	if ((xnvme_cmd_ctx_cpl_status(ctx) || (ctx->cpl.result != chunk->nbytes)) &&
+	    !chunk->writer->err) {
+		XNVME_DEBUG("FAILED: chunk-write, sc: 0x%x, result: %" PRIu64 " != nbytes: %zu",
+			    ctx->cpl.status.sc, ctx->cpl.result, chunk->nbytes);
+		chunk->writer->err = -EIO;
+	}
+	chunk->inflight = 0;
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+static int
+_writer_wait(struct xnvme_file_writer *writer, struct xnvme_file_writer_chunk *chunk)
+{
+	while (chunk->inflight) {
+		int err = xnvme_queue_poke(writer->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Write 'nbytes' of the chunk being filled at the offset of the chunk
+ */
+static int
+_writer_submit(struct xnvme_file_writer *writer, size_t nbytes)
+{
+	struct xnvme_file_writer_chunk *chunk = &writer->chunks[writer->cur];
+	struct xnvme_cmd_ctx *ctx;
+	int err;
+
+	while (xnvme_queue_get_outstanding(writer->queue) ==
+	       xnvme_queue_get_capacity(writer->queue)) {
+		err = xnvme_queue_poke(writer->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	ctx = xnvme_queue_get_cmd_ctx(writer->queue);
+	xnvme_cmd_ctx_set_cb(ctx, _writer_cb, chunk);
+
+	chunk->nbytes = nbytes;
+	chunk->inflight = 1;
+	err = xnvme_file_pwrite(ctx, chunk->buf, nbytes, writer->offset);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_file_pwrite(), err: %d", err);
+		chunk->inflight = 0;
+		xnvme_queue_put_cmd_ctx(writer->queue, ctx);
+		return err;
+	}
+
+	return 0;
+}
+
+/**
+ * Retrieve the current size of the file, via the file-system identify-namespace, since the
+ * geometry of the file-handle has its size as of when it was opened
+ */
+static int
+_file_size(struct xnvme_dev *fh, off_t *size)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(fh);
+	struct xnvme_spec_fs_idfy_ns *idfy;
+	int err;
+
+	idfy = xnvme_buf_alloc(fh, sizeof(*idfy));
+	if (!idfy) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc(), errno: %d", errno);
+		return -errno;
+	}
+	memset(idfy, 0, sizeof(*idfy));
+
+	err = xnvme_adm_idfy_ns_csi(&ctx, fh->ident.nsid, XNVME_SPEC_CSI_FS, (void *)idfy);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		XNVME_DEBUG("FAILED: xnvme_adm_idfy_ns_csi(CSI_FS), err: %d", err);
+		xnvme_buf_free(fh, idfy);
+		return err ? err : -EIO;
+	}
+	*size = idfy->nuse;
+	xnvme_buf_free(fh, idfy);
+
+	return 0;
+}
+
+int
+xnvme_file_writer_open(struct xnvme_dev *fh, off_t offset, uint32_t depth, size_t chunk_nbytes,
+		       struct xnvme_file_writer **writer)
+{
+	struct xnvme_file_writer *w;
+	uint32_t align = 1;
+	int err;
+
+	if (fh->opts.direct && fh->geo.lba_nbytes) {
+		align = fh->geo.lba_nbytes;
+	}
+	chunk_nbytes = chunk_nbytes ? chunk_nbytes : fh->geo.mdts_nbytes;
+	if (!depth || !chunk_nbytes || (chunk_nbytes % align) || (offset % align)) {
+		XNVME_DEBUG("FAILED: depth: %u, chunk_nbytes: %zu, offset: %jd, align: %u", depth,
+			    chunk_nbytes, (intmax_t)offset, align);
+		return -EINVAL;
+	}
+
+	w = calloc(1, sizeof(*w) + (depth + 1) * sizeof(*w->chunks));
+	if (!w) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	w->fh = fh;
+	w->chunk_nbytes = chunk_nbytes;
+	w->align = align;
+	w->nchunks = depth + 1;
+	w->offset = offset;
+
+	if (fh->ident.dtype == XNVME_DEV_TYPE_FS_FILE) {
+		err = _file_size(fh, &w->size);
+		if (err) {
+			XNVME_DEBUG("FAILED: _file_size(), err: %d", err);
+			free(w);
+			return err;
+		}
+	}
+
+	err = xnvme_queue_init(fh, depth, 0, &w->queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_queue_init(), err: %d", err);
+		free(w);
+		return err;
+	}
+
+	for (uint32_t i = 0; i < w->nchunks; ++i) {
+		w->chunks[i].writer = w;
+		w->chunks[i].buf = xnvme_buf_alloc(fh, chunk_nbytes);
+		if (!w->chunks[i].buf) {
+			err = -errno;
+			XNVME_DEBUG("FAILED: xnvme_buf_alloc(), err: %d", err);
+			xnvme_file_writer_close(w);
+			return err;
+		}
+	}
+	*writer = w;
+
+	return 0;
+}
+
+int
+xnvme_file_writer_append(struct xnvme_file_writer *writer, const void *buf, size_t nbytes)
+{
+	while (nbytes && !writer->err) {
+		struct xnvme_file_writer_chunk *chunk = &writer->chunks[writer->cur];
+		size_t len = XNVME_MIN_U64(nbytes, writer->chunk_nbytes - writer->nbytes);
+		int err;
+
+		memcpy((uint8_t *)chunk->buf + writer->nbytes, buf, len);
+		buf = (const uint8_t *)buf + len;
+		nbytes -= len;
+		writer->nbytes += len;
+
+		if (writer->nbytes < writer->chunk_nbytes) {
+			break;
+		}
+
+		err = _writer_submit(writer, writer->chunk_nbytes);
+		if (err) {
+			return err;
+		}
+		writer->offset += writer->chunk_nbytes;
+		writer->size = XNVME_MAX_S64(writer->size, writer->offset);
+		writer->nbytes = 0;
+		writer->cur = (writer->cur + 1) % writer->nchunks;
+
+		err = _writer_wait(writer, &writer->chunks[writer->cur]);
+		if (err) {
+			return err;
+		}
+	}
+
+	return writer->err;
+}
+
+/**
+ * Fill the padding of the unaligned tail, of the chunk being filled, with the content of the file
+ * in the block it pads, such that writing the padded tail does not overwrite existing data
+ */
+static int
+_writer_tail_fill(struct xnvme_file_writer *writer, size_t nbytes)
+{
+	struct xnvme_file_writer_chunk *chunk = &writer->chunks[writer->cur];
+	const size_t blk = nbytes - writer->align, ofz = writer->nbytes - blk;
+	struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(writer->fh);
+	uint8_t *buf;
+	int err;
+
+	buf = xnvme_buf_alloc(writer->fh, writer->align);
+	if (!buf) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc(), errno: %d", errno);
+		return -errno;
+	}
+
+	err = xnvme_file_pread(&ctx, buf, writer->align, writer->offset + blk);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		XNVME_DEBUG("FAILED: xnvme_file_pread(), err: %d", err);
+		xnvme_buf_free(writer->fh, buf);
+		return err ? err : -EIO;
+	}
+	if (ctx.cpl.result > ofz) {
+		memcpy((uint8_t *)chunk->buf + writer->nbytes, buf + ofz,
+		       XNVME_MIN_U64(ctx.cpl.result, writer->align) - ofz);
+	}
+	xnvme_buf_free(writer->fh, buf);
+
+	return 0;
+}
+
+int
+xnvme_file_writer_flush(struct xnvme_file_writer *writer)
+{
+	int err;
+
+	if (writer->nbytes && !writer->err) {
+		struct xnvme_file_writer_chunk *chunk = &writer->chunks[writer->cur];
+		size_t nbytes = writer->nbytes;
+
+		// The unaligned tail is padded, with zeroes beyond the end of the file, and is kept
+		// in the chunk, such that the following appends re-write it, at the same offset
+		if (nbytes % writer->align) {
+			nbytes += writer->align - (nbytes % writer->align);
+			memset((uint8_t *)chunk->buf + writer->nbytes, 0, nbytes - writer->nbytes);
+			if ((writer->offset + (off_t)writer->nbytes) < writer->size) {
+				err = _writer_tail_fill(writer, nbytes);
+				if (err) {
+					return err;
+				}
+			}
+			if ((writer->offset + (off_t)nbytes) > writer->size) {
+				writer->padded = 1;
+			}
+		}
+
+		err = _writer_submit(writer, nbytes);
+		if (err) {
+			return err;
+		}
+		writer->size = XNVME_MAX_S64(writer->size, writer->offset + writer->nbytes);
+	}
+
+	if (xnvme_queue_get_outstanding(writer->queue)) {
+		err = xnvme_queue_drain(writer->queue);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_drain(), err: %d", err);
+			return err;
+		}
+	}
+
+	return writer->err;
+}
+
+int
+xnvme_file_writer_close(struct xnvme_file_writer *writer)
+{
+	int err;
+
+	if (!writer) {
+		return 0;
+	}
+
+	err = xnvme_file_writer_flush(writer);
+
+	// Drop the padding extending the file, which is only possible for regular files
+	if (!err && writer->padded && (writer->fh->ident.dtype == XNVME_DEV_TYPE_FS_FILE)) {
+		struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(writer->fh);
+
+		err = xnvme_file_truncate(&ctx, writer->size);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_file_truncate(), err: %d", err);
+		}
+	}
+
+	xnvme_queue_term(writer->queue);
+	for (uint32_t i = 0; i < writer->nchunks; ++i) {
+		xnvme_buf_free(writer->fh, writer->chunks[i].buf);
+	}
+	free(writer);
+
+	return err;
+}
+
+#define XNVME_FILE_COPY_DEPTH_DEF  8
+#define XNVME_FILE_COPY_NBYTES_DEF (1024 * 1024)
+
+/**
+ * State of the read/write pipeline of xnvme_file_copy(); a chunk is read from 'src', on
+ * completion it is written to 'dst', and on completion of that, then the slot is free again
+ */
+struct xnvme_file_copy {
+	off_t src_offset;
+	off_t dst_offset;
+	size_t nbytes;
+	size_t ofz; ///< Number of bytes assigned to slots
+	size_t chunk_nbytes;
+	int eof; ///< Whether a read was short, that is, end-of-file of 'src' was reached
+};
+
+static int
+_copy_fill(struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_file_copy *copy = arg;
+	size_t len;
+
+	if (copy->eof || (copy->ofz >= copy->nbytes)) {
+		return 0;
+	}
+
+	// Chunks are aligned in 'dst', thus, with O_DIRECT, then only the first and the last can be
+	// unaligned, and they do not share blocks
+	len = copy->chunk_nbytes - ((copy->dst_offset + copy->ofz) % copy->chunk_nbytes);
+
+	slot->pos = copy->src_offset + copy->ofz;
+	slot->dpos = copy->dst_offset + copy->ofz;
+	slot->len = XNVME_MIN_U64(len, copy->nbytes - copy->ofz);
+	slot->payload = slot->buf;
+	copy->ofz += slot->len;
+
+	return 0;
+}
+
+static int
+_copy_submit(struct xnvme_cmd_ctx *ctx, struct xnvme_pipeline_slot *slot,
+	     void *XNVME_UNUSED(arg))
+{
+	return slot->stage ? xnvme_file_pwrite(ctx, slot->payload, slot->len, slot->dpos)
+			   : xnvme_file_pread(ctx, slot->payload, slot->len, slot->pos);
+}
+
+static int
+_copy_complete(struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_file_copy *copy = arg;
+
+	if (slot->stage) {
+		return (slot->result != slot->len) ? -EIO : 0;
+	}
+
+	if (slot->result < slot->len) {
+		copy->eof = 1;
+	}
+	slot->len = slot->result;
+
+	return 0;
+}
+
+static const struct xnvme_pipeline_ops g_copy_ops = {
+	.fill = _copy_fill,
+	.submit = _copy_submit,
+	.complete = _copy_complete,
+};
+
+static int
+_copy_pipeline(struct xnvme_dev *src, off_t src_offset, struct xnvme_dev *dst, off_t dst_offset,
+	       size_t nbytes, uint32_t depth, size_t chunk_nbytes)
+{
+	struct xnvme_dev *devs[] = {src, dst};
+	struct xnvme_file_copy copy = {
+		.src_offset = src_offset,
+		.dst_offset = dst_offset,
+		.nbytes = nbytes,
+		.chunk_nbytes = chunk_nbytes,
+	};
+
+	return xnvme_pipeline_run(devs, 2, &g_copy_ops, &copy, depth, chunk_nbytes);
+}
+
+/**
+ * Copy one chunk at a time via the sync. interface, reading from 'src' into a buffer and writing
+ * it to 'dst'; chunks are aligned in 'dst', as with the pipeline
+ */
+static int
+_copy_sync(struct xnvme_dev *src, off_t src_offset, struct xnvme_dev *dst, off_t dst_offset,
+	   size_t nbytes, size_t chunk_nbytes)
+{
+	size_t ofz = 0;
+	void *buf;
+	int err = 0;
+
+	buf = xnvme_buf_alloc(dst, chunk_nbytes);
+	if (!buf) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc(), errno: %d", errno);
+		return -errno;
+	}
+
+	while (ofz < nbytes) {
+		struct xnvme_cmd_ctx rctx = xnvme_file_get_cmd_ctx(src);
+		struct xnvme_cmd_ctx wctx = xnvme_file_get_cmd_ctx(dst);
+		size_t len = chunk_nbytes - ((dst_offset + ofz) % chunk_nbytes);
+
+		len = XNVME_MIN_U64(len, nbytes - ofz);
+
+		err = xnvme_file_pread(&rctx, buf, len, src_offset + ofz);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_file_pread(), err: %d", err);
+			break;
+		}
+		if (!rctx.cpl.result) {
+			break;
+		}
+
+		err = xnvme_file_pwrite(&wctx, buf, rctx.cpl.result, dst_offset + ofz);
+		if (err || (wctx.cpl.result != rctx.cpl.result)) {
+			XNVME_DEBUG("FAILED: xnvme_file_pwrite(), err: %d", err);
+			err = err ? err : -EIO;
+			break;
+		}
+		ofz += rctx.cpl.result;
+
+		if (rctx.cpl.result < len) {
+			break;
+		}
+	}
+
+	xnvme_buf_free(dst, buf);
+
+	return err;
+}
+
+int
+xnvme_file_copy(struct xnvme_dev *src, off_t src_offset, struct xnvme_dev *dst, off_t dst_offset,
+		size_t nbytes, uint32_t depth, size_t chunk_nbytes, int flags)
+{
+	size_t ncopied = 0;
+
+	if (depth && !(xnvme_is_pow2(depth) && (depth < 4096))) {
+		XNVME_DEBUG("FAILED: invalid depth: %u", depth);
+		return -EINVAL;
+	}
+	if (dst->file_ra) {
+		_ra_reset(dst->file_ra);
+	}
+
+#ifdef XNVME_BE_LINUX_ENABLED
+	if (!(flags & XNVME_FILE_COPY_NOOFFLOAD) && !strcmp(src->be.attr.name, "linux") &&
+	    !strcmp(dst->be.attr.name, "linux")) {
+		int err;
+
+		err = xnvme_be_linux_file_copy(src, src_offset, dst, dst_offset, nbytes, &ncopied);
+		if (!err) {
+			return 0;
+		}
+		XNVME_DEBUG("INFO: offload failed, err: %d, ncopied: %zu; using read/write", err,
+			    ncopied);
+	}
+#else
+	(void)flags;
+#endif
+
+	depth = depth ? depth : XNVME_FILE_COPY_DEPTH_DEF;
+	chunk_nbytes = chunk_nbytes ? chunk_nbytes : XNVME_FILE_COPY_NBYTES_DEF;
+
+	if (flags & XNVME_FILE_COPY_SYNC) {
+		return _copy_sync(src, src_offset + ncopied, dst, dst_offset + ncopied,
+				  nbytes - ncopied, chunk_nbytes);
+	}
+
+	return _copy_pipeline(src, src_offset + ncopied, dst, dst_offset + ncopied,
+			      nbytes - ncopied, depth, chunk_nbytes);
+}
+
+#define XNVME_FILE_RANGE_DEPTH_DEF  16
+#define XNVME_FILE_RANGE_NBYTES_DEF (1024 * 1024)
+
+/**
+ * State of xnvme_file_read_range() and xnvme_file_write_range(); the user-callback is invoked
+ * from the submission-loop of the pipeline, not from the completion-callbacks, thus, it can be any
+ * function
+ */
+struct xnvme_file_range {
+	int write;
+	off_t offset;
+	size_t nbytes;
+	size_t ofz; ///< Number of bytes assigned to slots
+	size_t io_nbytes;
+	void *buf;
+	xnvme_file_range_cb cb;
+	void *cb_arg;
+	int eof; ///< Whether a read was short, that is, end-of-file was reached
+};
+
+static int
+_range_fill(struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_file_range *range = arg;
+	size_t len;
+
+	if (range->eof || (range->ofz >= range->nbytes)) {
+		return 0;
+	}
+
+	// Aligned to 'io_nbytes' in the file, as done by xnvme_file_copy()
+	len = range->io_nbytes - ((range->offset + range->ofz) % range->io_nbytes);
+
+	slot->pos = range->offset + range->ofz;
+	slot->len = XNVME_MIN_U64(len, range->nbytes - range->ofz);
+	slot->payload = range->buf ? (uint8_t *)range->buf + range->ofz : slot->buf;
+	range->ofz += slot->len;
+
+	if (range->cb && range->write) {
+		return range->cb(slot->payload, slot->pos, slot->len, range->cb_arg);
+	}
+
+	return 0;
+}
+
+static int
+_range_submit(struct xnvme_cmd_ctx *ctx, struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_file_range *range = arg;
+
+	return range->write ? xnvme_file_pwrite(ctx, slot->payload, slot->len, slot->pos)
+			    : xnvme_file_pread(ctx, slot->payload, slot->len, slot->pos);
+}
+
+static int
+_range_complete(struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_file_range *range = arg;
+
+	if (range->write) {
+		return (slot->result != slot->len) ? -EIO : 0;
+	}
+
+	if (slot->result < slot->len) {
+		range->eof = 1;
+	}
+	if (range->cb && slot->result) {
+		return range->cb(slot->payload, slot->pos, slot->result, range->cb_arg);
+	}
+
+	return 0;
+}
+
+static const struct xnvme_pipeline_ops g_range_ops = {
+	.fill = _range_fill,
+	.submit = _range_submit,
+	.complete = _range_complete,
+};
+
+static int
+_range(struct xnvme_dev *fh, int write, off_t offset, size_t nbytes, void *buf,
+       xnvme_file_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth)
+{
+	struct xnvme_file_range range = {
+		.write = write,
+		.offset = offset,
+		.nbytes = nbytes,
+		.buf = buf,
+		.cb = cb,
+		.cb_arg = cb_arg,
+	};
+
+	if (!buf && !cb) {
+		XNVME_DEBUG("FAILED: neither buffer nor callback given");
+		return -EINVAL;
+	}
+	if (!nbytes) {
+		return 0;
+	}
+	if (fh->file_ra) {
+		_ra_reset(fh->file_ra);
+	}
+
+	range.io_nbytes = io_nbytes ? io_nbytes : XNVME_FILE_RANGE_NBYTES_DEF;
+	depth = depth ? depth : XNVME_FILE_RANGE_DEPTH_DEF;
+
+	return xnvme_pipeline_run(&fh, 1, &g_range_ops, &range, depth, buf ? 0 : range.io_nbytes);
+}
+
+int
+xnvme_file_read_range(struct xnvme_dev *fh, off_t offset, size_t nbytes, void *buf,
+		      xnvme_file_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth)
+{
+	return _range(fh, 0, offset, nbytes, buf, cb, cb_arg, io_nbytes, depth);
+}
+
+int
+xnvme_file_write_range(struct xnvme_dev *fh, off_t offset, size_t nbytes, const void *buf,
+		       xnvme_file_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth)
+{
+	return _range(fh, 1, offset, nbytes, (void *)buf, cb, cb_arg, io_nbytes, depth);
+}
+
+int
+xnvme_file_open_batch(const char **pathnames, uint32_t npaths, struct xnvme_opts *opts,
+		      struct xnvme_dev **fhs, int *errs)
+{
+	const struct xnvme_opts opts_default = xnvme_opts_default();
+	struct xnvme_opts given = opts ? *opts : opts_default;
+	int err_first = 0;
+
+	// The defaults are applied to a copy, the given 'opts' are left as-is
+	opts = &given;
+	if (!opts->oflags) {
+		opts->rdwr = opts_default.rdwr;
+	}
+	if (opts->create && !opts->create_mode) {
+		opts->create_mode = opts_default.create_mode;
+	}
+
+#ifdef XNVME_BE_LINUX_ENABLED
+	if (!opts->be || !strcmp(opts->be, "linux")) {
+		return xnvme_be_linux_file_open_batch(pathnames, npaths, opts, fhs, errs);
+	}
+#endif
+
+	for (uint32_t i = 0; i < npaths; ++i) {
+		int err;
+
+		fhs[i] = xnvme_file_open(pathnames[i], opts);
+		err = fhs[i] ? 0 : -errno;
+		if (errs) {
+			errs[i] = err;
+		}
+		err_first = err_first ? err_first : err;
+	}
+
+	return err_first;
+}
+
+int
+xnvme_file_close_batch(struct xnvme_dev **fhs, uint32_t nfhs)
+{
+#ifdef XNVME_BE_LINUX_ENABLED
+	return xnvme_be_linux_file_close_batch(fhs, nfhs);
+#else
+	for (uint32_t i = 0; i < nfhs; ++i) {
+		xnvme_file_close(fhs[i]);
+	}
+
+	return 0;
+#endif
+}
+
 int
 xnvme_file_close(struct xnvme_dev *fh)
 {
@@ -44,10 +1054,7 @@ xnvme_file_sync(struct xnvme_dev *fh)
 {
 	struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fh);
 
-	ctx.cmd.common.opcode = XNVME_SPEC_FS_OPC_FLUSH;
-	ctx.cmd.common.nsid = xnvme_dev_get_nsid(ctx.dev);
-
-	return xnvme_cmd_pass(&ctx, NULL, 0, NULL, 0);
+	return xnvme_file_fsync(&ctx);
 }
 
 struct xnvme_cmd_ctx
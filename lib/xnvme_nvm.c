@@ -6,7 +6,10 @@
 #include <errno.h>
 #include <libxnvme_nvm.h>
 #include <xnvme_be.h>
+#include <xnvme_cmd.h>
 #include <xnvme_dev.h>
+#include <xnvme_pipeline.h>
+#include <xnvme_be_linux.h>
 
 int
 xnvme_adm_format(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint8_t lbaf, uint8_t zf, uint8_t mset,
@@ -79,6 +82,58 @@ xnvme_nvm_write(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t slba, uint16_
 	return xnvme_cmd_pass(ctx, cdbuf, dbuf_nbytes, cmbuf, mbuf_nbytes);
 }
 
+/**
+ * Pass a read or write of 'nlbas' LBAs, as a single command when the NLB field can hold it,
+ * otherwise directly as a split, since the NLB field cannot express it
+ */
+static int
+_nvm_rw_nlbas(struct xnvme_cmd_ctx *ctx, uint8_t opcode, uint32_t nsid, uint64_t slba,
+	      uint64_t nlbas, void *dbuf, void *mbuf)
+{
+	const struct xnvme_geo *geo = &ctx->dev->geo;
+
+	if (!nlbas) {
+		XNVME_DEBUG("FAILED: nlbas: 0");
+		return -EINVAL;
+	}
+
+	ctx->cmd.common.opcode = opcode;
+	ctx->cmd.common.nsid = nsid;
+	ctx->cmd.nvm.slba = slba;
+
+	if (nlbas <= (UINT16_MAX + 1)) {
+		ctx->cmd.nvm.nlb = nlbas - 1;
+
+		return xnvme_cmd_pass(ctx, dbuf, dbuf ? geo->lba_nbytes * nlbas : 0, mbuf,
+				      mbuf ? geo->nbytes_oob * nlbas : 0);
+	}
+
+	if (!ctx->dev->opts.split || (ctx->opts & XNVME_CMD_MASK_UPLD) || !geo->lba_nbytes ||
+	    (geo->mdts_nbytes < geo->lba_nbytes)) {
+		XNVME_DEBUG("FAILED: nlbas: %" PRIu64 " exceeds a command, and cannot be split",
+			    nlbas);
+		return -EINVAL;
+	}
+	ctx->cmd.nvm.nlb = UINT16_MAX;
+
+	return xnvme_cmd_split_pass(ctx, dbuf, mbuf, nlbas);
+}
+
+int
+xnvme_nvm_read_nlbas(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t slba, uint64_t nlbas,
+		     void *dbuf, void *mbuf)
+{
+	return _nvm_rw_nlbas(ctx, XNVME_SPEC_NVM_OPC_READ, nsid, slba, nlbas, dbuf, mbuf);
+}
+
+int
+xnvme_nvm_write_nlbas(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t slba, uint64_t nlbas,
+		      const void *dbuf, const void *mbuf)
+{
+	return _nvm_rw_nlbas(ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, slba, nlbas, (void *)dbuf,
+			     (void *)mbuf);
+}
+
 int
 xnvme_nvm_write_uncorrectable(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t slba,
 			      uint16_t nlb)
@@ -174,3 +229,353 @@ xnvme_nvm_mgmt_send(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint8_t mo, uint16
 
 	return xnvme_cmd_pass(ctx, dbuf, dbuf_nbytes, NULL, 0x0);
 }
+
+#define XNVME_NVM_COPY_DEPTH_DEF  8
+#define XNVME_NVM_COPY_NBYTES_DEF (128 * 1024)
+
+/**
+ * Position in the source-ranges of xnvme_nvm_copy(); each of the copy-paths consume LBAs from the
+ * ranges, and on failure, then the next path continues from where the previous stopped
+ */
+struct xnvme_nvm_copy_cursor {
+	const struct xnvme_spec_nvm_scopy_fmt_zero *ranges;
+	uint32_t nranges;
+	uint32_t ridx; ///< Index of the range being copied
+	uint32_t rofz; ///< Number of LBAs of the range, which are copied
+	uint64_t dlba; ///< Destination of the next LBA
+};
+
+/**
+ * Get the next, at most 'nlb_max', LBAs to copy, without crossing a range
+ *
+ * @return The number of LBAs, 0 when all ranges are copied
+ */
+static uint32_t
+_copy_peek(struct xnvme_nvm_copy_cursor *cur, uint32_t nlb_max, uint64_t *slba)
+{
+	const struct xnvme_spec_nvm_scopy_fmt_zero *range;
+
+	if (cur->ridx >= cur->nranges) {
+		return 0;
+	}
+	range = &cur->ranges[cur->ridx];
+
+	*slba = range->slba + cur->rofz;
+
+	return XNVME_MIN_U64(nlb_max, (uint32_t)range->nlb + 1 - cur->rofz);
+}
+
+static void
+_copy_advance(struct xnvme_nvm_copy_cursor *cur, uint32_t nlb)
+{
+	cur->rofz += nlb;
+	cur->dlba += nlb;
+	if (cur->rofz == (uint32_t)cur->ranges[cur->ridx].nlb + 1) {
+		cur->ridx += 1;
+		cur->rofz = 0;
+	}
+}
+
+/**
+ * Copy using Simple-Copy commands, each filled with as many source-ranges as the limits of the
+ * namespace allows, splitting ranges longer than 'mssrl' and stopping at 'mcl'
+ */
+static int
+_copy_scopy(struct xnvme_dev *dev, struct xnvme_nvm_copy_cursor *cur)
+{
+	const struct xnvme_spec_nvm_idfy_ns *ns = (void *)xnvme_dev_get_ns(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint32_t mssrl = ns->mssrl ? ns->mssrl : UINT16_MAX + 1;
+	uint32_t mcl = ns->mcl ? ns->mcl : UINT32_MAX;
+	uint32_t nentries_max = XNVME_MIN(ns->msrc + 1, XNVME_SPEC_NVM_SCOPY_NENTRY_MAX);
+	struct xnvme_spec_nvm_scopy_source_range *range;
+	int err = 0;
+
+	range = xnvme_buf_alloc(dev, sizeof(*range));
+	if (!range) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc(), errno: %d", errno);
+		return -errno;
+	}
+
+	while (cur->ridx < cur->nranges) {
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+		struct xnvme_nvm_copy_cursor next = *cur;
+		uint32_t nentries = 0;
+		uint64_t nlbas = 0;
+
+		memset(range, 0, sizeof(*range));
+		while ((nentries < nentries_max) && (nlbas < mcl)) {
+			uint64_t slba;
+			uint32_t nlb;
+
+			nlb = _copy_peek(&next, XNVME_MIN_U64(mssrl, mcl - nlbas), &slba);
+			if (!nlb) {
+				break;
+			}
+			range->entry[nentries].slba = slba;
+			range->entry[nentries].nlb = nlb - 1;
+			nentries += 1;
+			nlbas += nlb;
+
+			_copy_advance(&next, nlb);
+		}
+
+		err = xnvme_nvm_scopy(&ctx, nsid, cur->dlba, range->entry, nentries - 1,
+				      XNVME_NVM_SCOPY_FMT_ZERO);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			XNVME_DEBUG("FAILED: xnvme_nvm_scopy(), err: %d", err);
+			err = err ? err : -EIO;
+			break;
+		}
+		*cur = next;
+	}
+
+	xnvme_buf_free(dev, range);
+
+	return err;
+}
+
+/**
+ * State of the read/write pipeline of xnvme_nvm_copy(); a chunk of a source-range is read, on
+ * completion it is written to the destination, and on completion of that, the slot is free again
+ */
+struct xnvme_nvm_copy {
+	struct xnvme_nvm_copy_cursor *cur;
+	uint32_t nsid;
+	uint32_t chunk_nlb;
+};
+
+static int
+_copy_fill(struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_nvm_copy *copy = arg;
+
+	slot->len = _copy_peek(copy->cur, copy->chunk_nlb, &slot->pos);
+	if (!slot->len) {
+		return 0;
+	}
+	slot->dpos = copy->cur->dlba;
+	slot->payload = slot->buf;
+	_copy_advance(copy->cur, slot->len);
+
+	return 0;
+}
+
+static int
+_copy_submit(struct xnvme_cmd_ctx *ctx, struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_nvm_copy *copy = arg;
+
+	return slot->stage ? xnvme_nvm_write(ctx, copy->nsid, slot->dpos, slot->len - 1,
+					     slot->payload, NULL)
+			   : xnvme_nvm_read(ctx, copy->nsid, slot->pos, slot->len - 1,
+					    slot->payload, NULL);
+}
+
+static const struct xnvme_pipeline_ops g_copy_ops = {
+	.fill = _copy_fill,
+	.submit = _copy_submit,
+};
+
+static int
+_copy_pipeline(struct xnvme_dev *dev, struct xnvme_nvm_copy_cursor *cur, uint32_t depth)
+{
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	size_t chunk_nbytes = XNVME_NVM_COPY_NBYTES_DEF;
+	struct xnvme_dev *devs[] = {dev, dev};
+	struct xnvme_nvm_copy copy = {
+		.cur = cur,
+		.nsid = xnvme_dev_get_nsid(dev),
+	};
+
+	if (geo->mdts_nbytes) {
+		chunk_nbytes = XNVME_MIN_U64(chunk_nbytes, geo->mdts_nbytes);
+	}
+	copy.chunk_nlb = XNVME_MAX_S64(chunk_nbytes / geo->lba_nbytes, 1);
+
+	return xnvme_pipeline_run(devs, 2, &g_copy_ops, &copy, depth,
+				  (size_t)copy.chunk_nlb * geo->lba_nbytes);
+}
+
+int
+xnvme_nvm_copy(struct xnvme_dev *dev, uint64_t sdlba,
+	       const struct xnvme_spec_nvm_scopy_fmt_zero *ranges, uint32_t nranges,
+	       uint32_t depth, int flags)
+{
+	const struct xnvme_spec_nvm_idfy_ctrlr *ctrlr = (void *)xnvme_dev_get_ctrlr(dev);
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	struct xnvme_nvm_copy_cursor cur = {
+		.ranges = ranges,
+		.nranges = nranges,
+		.dlba = sdlba,
+	};
+	int err;
+
+	if (!(flags & XNVME_NVM_COPY_NOOFFLOAD) && ctrlr && ctrlr->oncs.copy &&
+	    ctrlr->ocfs.copy_fmt0 && xnvme_dev_get_ns(dev)) {
+		err = _copy_scopy(dev, &cur);
+		if (err != -ENOSYS) {
+			return err;
+		}
+		XNVME_DEBUG("INFO: Simple-Copy is not supported by the backend; emulating");
+	}
+
+#ifdef XNVME_BE_LINUX_ENABLED
+	if (!(flags & XNVME_NVM_COPY_NOOFFLOAD) && !strcmp(dev->be.attr.name, "linux") &&
+	    ((dev->ident.dtype == XNVME_DEV_TYPE_FS_FILE) ||
+	     (dev->ident.dtype == XNVME_DEV_TYPE_BLOCK_DEVICE))) {
+		uint64_t slba;
+		uint32_t nlb;
+
+		while ((nlb = _copy_peek(&cur, UINT32_MAX, &slba))) {
+			size_t nbytes = (size_t)nlb * geo->lba_nbytes;
+			size_t ncopied = 0;
+
+			off_t src_offset = slba * geo->lba_nbytes;
+			off_t dst_offset = cur.dlba * geo->lba_nbytes;
+
+			err = xnvme_be_linux_file_copy(dev, src_offset, dev, dst_offset, nbytes,
+						       &ncopied);
+			_copy_advance(&cur, ncopied / geo->lba_nbytes);
+			if (err || (ncopied < nbytes)) {
+				XNVME_DEBUG("INFO: offload failed, err: %d; using read/write", err);
+				break;
+			}
+		}
+	}
+#endif
+
+	// The writes to a zoned namespace must be in order, thus, one at a time
+	depth = (geo->type == XNVME_GEO_ZONED) ? 1 : depth;
+	depth = depth ? depth : XNVME_NVM_COPY_DEPTH_DEF;
+
+	return _copy_pipeline(dev, &cur, depth);
+}
+
+#define XNVME_NVM_RANGE_DEPTH_DEF  16
+#define XNVME_NVM_RANGE_NBYTES_DEF (128 * 1024)
+
+/**
+ * State of xnvme_nvm_read_range() and xnvme_nvm_write_range(); the user-callback is invoked from
+ * the submission-loop of the pipeline, not from the completion-callbacks, thus, it can be any
+ * function
+ */
+struct xnvme_nvm_range {
+	uint8_t opcode;
+	uint32_t nsid;
+	uint64_t slba;
+	uint64_t nlbas;
+	uint64_t ofz; ///< Number of LBAs assigned to slots
+	uint32_t io_nlbas;
+	uint32_t lba_nbytes;
+	void *buf;
+	xnvme_nvm_range_cb cb;
+	void *cb_arg;
+};
+
+static int
+_range_fill(struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_nvm_range *range = arg;
+
+	if (range->ofz >= range->nlbas) {
+		return 0;
+	}
+	slot->pos = range->slba + range->ofz;
+	slot->len = XNVME_MIN_U64(range->io_nlbas, range->nlbas - range->ofz);
+	slot->payload = range->buf ? (uint8_t *)range->buf + range->ofz * range->lba_nbytes
+				   : slot->buf;
+	range->ofz += slot->len;
+
+	if (range->cb && (range->opcode == XNVME_SPEC_NVM_OPC_WRITE)) {
+		return range->cb(slot->payload, slot->pos, slot->len, range->cb_arg);
+	}
+
+	return 0;
+}
+
+static int
+_range_submit(struct xnvme_cmd_ctx *ctx, struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_nvm_range *range = arg;
+
+	return (range->opcode == XNVME_SPEC_NVM_OPC_WRITE)
+		       ? xnvme_nvm_write(ctx, range->nsid, slot->pos, slot->len - 1, slot->payload,
+					 NULL)
+		       : xnvme_nvm_read(ctx, range->nsid, slot->pos, slot->len - 1, slot->payload,
+					NULL);
+}
+
+static int
+_range_complete(struct xnvme_pipeline_slot *slot, void *arg)
+{
+	struct xnvme_nvm_range *range = arg;
+
+	if (range->cb && (range->opcode == XNVME_SPEC_NVM_OPC_READ)) {
+		return range->cb(slot->payload, slot->pos, slot->len, range->cb_arg);
+	}
+
+	return 0;
+}
+
+static const struct xnvme_pipeline_ops g_range_ops = {
+	.fill = _range_fill,
+	.submit = _range_submit,
+	.complete = _range_complete,
+};
+
+static int
+_range(struct xnvme_dev *dev, uint8_t opcode, uint64_t slba, uint64_t nlbas, void *buf,
+       xnvme_nvm_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth)
+{
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	struct xnvme_nvm_range range = {
+		.opcode = opcode,
+		.nsid = xnvme_dev_get_nsid(dev),
+		.slba = slba,
+		.nlbas = nlbas,
+		.lba_nbytes = geo->lba_nbytes,
+		.buf = buf,
+		.cb = cb,
+		.cb_arg = cb_arg,
+	};
+
+	if (!buf && !cb) {
+		XNVME_DEBUG("FAILED: neither buffer nor callback given");
+		return -EINVAL;
+	}
+	if (!nlbas) {
+		return 0;
+	}
+
+	io_nbytes = io_nbytes ? io_nbytes : XNVME_NVM_RANGE_NBYTES_DEF;
+	if (geo->mdts_nbytes) {
+		io_nbytes = XNVME_MIN_U64(io_nbytes, geo->mdts_nbytes);
+	}
+	range.io_nlbas = XNVME_MAX_S64(io_nbytes / geo->lba_nbytes, 1);
+	range.io_nlbas = XNVME_MIN_U64(range.io_nlbas, UINT16_MAX + 1);
+
+	// The writes to a zoned namespace must be in order, thus, one at a time
+	if ((opcode == XNVME_SPEC_NVM_OPC_WRITE) && (geo->type == XNVME_GEO_ZONED)) {
+		depth = 1;
+	}
+	depth = depth ? depth : XNVME_NVM_RANGE_DEPTH_DEF;
+
+	return xnvme_pipeline_run(&dev, 1, &g_range_ops, &range, depth,
+				  buf ? 0 : (size_t)range.io_nlbas * geo->lba_nbytes);
+}
+
+int
+xnvme_nvm_read_range(struct xnvme_dev *dev, uint64_t slba, uint64_t nlbas, void *buf,
+		     xnvme_nvm_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth)
+{
+	return _range(dev, XNVME_SPEC_NVM_OPC_READ, slba, nlbas, buf, cb, cb_arg, io_nbytes, depth);
+}
+
+int
+xnvme_nvm_write_range(struct xnvme_dev *dev, uint64_t slba, uint64_t nlbas, const void *buf,
+		      xnvme_nvm_range_cb cb, void *cb_arg, size_t io_nbytes, uint32_t depth)
+{
+	return _range(dev, XNVME_SPEC_NVM_OPC_WRITE, slba, nlbas, (void *)buf, cb, cb_arg,
+		      io_nbytes, depth);
+}
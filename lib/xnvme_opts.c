@@ -63,6 +63,9 @@ xnvme_opts_yaml(FILE *stream, const struct xnvme_opts *opts, int indent, const c
 	wrtn += fprintf(stream, "%*sregister_buffers: %d%s", indent, "", opts->register_buffers,
 			sep);
 
+	wrtn += fprintf(stream, "%*snuma_node.given: %d%s", indent, "", opts->numa_node.given, sep);
+	wrtn += fprintf(stream, "%*snuma_node.value: %d%s", indent, "", opts->numa_node.value, sep);
+
 	wrtn += fprintf(stream, "%*scss.given: %d%s", indent, "", opts->css.given, sep);
 	wrtn += fprintf(stream, "%*scss.value: 0x%x%s", indent, "", opts->css.value, sep);
 
@@ -0,0 +1,184 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#include <stdlib.h>
+#include <errno.h>
+#include <libxnvme.h>
+#include <xnvme_pipeline.h>
+
+struct xnvme_pipeline;
+
+struct xnvme_pipeline_entry {
+	struct xnvme_pipeline_slot slot;
+	struct xnvme_pipeline *pipeline;
+};
+
+struct xnvme_pipeline {
+	struct xnvme_queue *queues[XNVME_PIPELINE_STAGES_MAX];
+	uint32_t nstages;
+	uint32_t depth;
+	int err; ///< The first error of a command, or returned by 'ops'
+	struct xnvme_pipeline_entry entries[];
+};
+
+static void
+_pipeline_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct xnvme_pipeline_entry *entry = cb_arg;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		entry->pipeline->err = entry->pipeline->err ? entry->pipeline->err : -EIO;
+	}
+	entry->slot.result = ctx->cpl.result;
+	entry->slot.state = XNVME_PIPELINE_SLOT_DONE;
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+static int
+_pipeline_submit(struct xnvme_pipeline *pipeline, struct xnvme_pipeline_entry *entry,
+		 const struct xnvme_pipeline_ops *ops, void *arg)
+{
+	struct xnvme_queue *queue = pipeline->queues[entry->slot.stage];
+	struct xnvme_cmd_ctx *ctx;
+	int err;
+
+	ctx = xnvme_queue_get_cmd_ctx(queue);
+	xnvme_cmd_ctx_set_cb(ctx, _pipeline_cb, entry);
+
+	entry->slot.state = XNVME_PIPELINE_SLOT_INFLIGHT;
+	err = ops->submit(ctx, &entry->slot, arg);
+	if (err) {
+		XNVME_DEBUG("FAILED: ops->submit(), stage: %u, err: %d", entry->slot.stage, err);
+		entry->slot.state = XNVME_PIPELINE_SLOT_IDLE;
+		xnvme_queue_put_cmd_ctx(queue, ctx);
+	}
+
+	return err;
+}
+
+/**
+ * Advance the given slot; a completed stage is consumed, and the slot is passed to the next stage,
+ * or, when idle, assigned new work
+ */
+static int
+_pipeline_advance(struct xnvme_pipeline *pipeline, struct xnvme_pipeline_entry *entry,
+		  const struct xnvme_pipeline_ops *ops, void *arg)
+{
+	struct xnvme_pipeline_slot *slot = &entry->slot;
+	int err;
+
+	if (slot->state == XNVME_PIPELINE_SLOT_DONE) {
+		slot->state = XNVME_PIPELINE_SLOT_IDLE;
+		if (pipeline->err) {
+			return 0;
+		}
+
+		err = ops->complete ? ops->complete(slot, arg) : 0;
+		if (err) {
+			return err;
+		}
+		if (slot->len && ((slot->stage + 1) < pipeline->nstages)) {
+			slot->stage += 1;
+			return _pipeline_submit(pipeline, entry, ops, arg);
+		}
+	}
+	if ((slot->state != XNVME_PIPELINE_SLOT_IDLE) || pipeline->err) {
+		return 0;
+	}
+
+	slot->stage = 0;
+	slot->len = 0;
+	err = ops->fill(slot, arg);
+	if (err || !slot->len) {
+		return err;
+	}
+
+	return _pipeline_submit(pipeline, entry, ops, arg);
+}
+
+int
+xnvme_pipeline_run(struct xnvme_dev **devs, uint32_t nstages, const struct xnvme_pipeline_ops *ops,
+		   void *arg, uint32_t depth, size_t buf_nbytes)
+{
+	struct xnvme_pipeline *pipeline;
+	int err;
+
+	if (!nstages || (nstages > XNVME_PIPELINE_STAGES_MAX)) {
+		XNVME_DEBUG("FAILED: invalid nstages: %u", nstages);
+		return -EINVAL;
+	}
+
+	pipeline = calloc(1, sizeof(*pipeline) + depth * sizeof(*pipeline->entries));
+	if (!pipeline) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	pipeline->nstages = nstages;
+	pipeline->depth = depth;
+
+	for (uint32_t stage = 0; stage < nstages; ++stage) {
+		err = xnvme_queue_init(devs[stage], depth, 0, &pipeline->queues[stage]);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_queue_init(), stage: %u, err: %d", stage, err);
+			goto exit;
+		}
+	}
+	for (uint32_t i = 0; i < depth; ++i) {
+		pipeline->entries[i].pipeline = pipeline;
+		if (!buf_nbytes) {
+			continue;
+		}
+		pipeline->entries[i].slot.buf = xnvme_buf_alloc(devs[0], buf_nbytes);
+		if (!pipeline->entries[i].slot.buf) {
+			err = -errno;
+			XNVME_DEBUG("FAILED: xnvme_buf_alloc(), err: %d", err);
+			goto exit;
+		}
+	}
+
+	for (uint32_t nbusy = 0;; nbusy = 0) {
+		for (uint32_t i = 0; i < depth; ++i) {
+			struct xnvme_pipeline_entry *entry = &pipeline->entries[i];
+
+			err = _pipeline_advance(pipeline, entry, ops, arg);
+			if (err) {
+				pipeline->err = pipeline->err ? pipeline->err : err;
+			}
+			nbusy += entry->slot.state != XNVME_PIPELINE_SLOT_IDLE;
+		}
+		if (!nbusy) {
+			break;
+		}
+
+		for (uint32_t stage = 0; stage < nstages; ++stage) {
+			err = xnvme_queue_poke(pipeline->queues[stage], 0);
+			if (err < 0) {
+				XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+				pipeline->err = pipeline->err ? pipeline->err : err;
+				break;
+			}
+		}
+		if (err < 0) {
+			break;
+		}
+	}
+	err = pipeline->err;
+
+exit:
+	for (uint32_t stage = 0; stage < nstages; ++stage) {
+		if (pipeline->queues[stage]) {
+			xnvme_queue_drain(pipeline->queues[stage]);
+		}
+	}
+	for (uint32_t stage = nstages; stage-- > 0;) {
+		if (pipeline->queues[stage]) {
+			xnvme_queue_term(pipeline->queues[stage]);
+		}
+	}
+	for (uint32_t i = 0; i < depth; ++i) {
+		xnvme_buf_free(devs[0], pipeline->entries[i].slot.buf);
+	}
+	free(pipeline);
+
+	return err;
+}
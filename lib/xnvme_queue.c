@@ -8,6 +8,13 @@
 #include <xnvme_cmd.h>
 #include <xnvme_dev.h>
 #include <xnvme_queue.h>
+#include <xnvme_znd.h>
+
+static size_t
+_queue_nbytes(uint32_t capacity)
+{
+	return sizeof(struct xnvme_queue) + (capacity + 1) * sizeof(struct xnvme_cmd_ctx_entry);
+}
 
 int
 xnvme_queue_term(struct xnvme_queue *queue)
@@ -19,12 +26,16 @@ xnvme_queue_term(struct xnvme_queue *queue)
 		return -EINVAL;
 	}
 
+	xnvme_queue_helper_term(queue);
+	xnvme_cmd_split_term(queue);
+	xnvme_znd_cache_track_term(queue);
+
 	err = queue->base.dev ? queue->base.dev->be.async.term(queue) : 0;
 	if (err) {
 		XNVME_DEBUG("FAILED: backend queue-termination failed with err: %d", err);
 	}
 
-	free(queue);
+	xnvme_dev_numa_free(queue, _queue_nbytes(queue->base.capacity));
 
 	return err;
 }
@@ -32,7 +43,6 @@ xnvme_queue_term(struct xnvme_queue *queue)
 int
 xnvme_queue_init(struct xnvme_dev *dev, uint16_t capacity, int opts, struct xnvme_queue **queue)
 {
-	size_t queue_nbytes;
 	int err;
 
 	if (!dev) {
@@ -44,17 +54,16 @@ xnvme_queue_init(struct xnvme_dev *dev, uint16_t capacity, int opts, struct xnvm
 		return -EINVAL;
 	}
 
-	queue_nbytes = sizeof(**queue) + (capacity + 1) * sizeof(*((*queue)->pool_storage));
-
-	*queue = calloc(1, queue_nbytes);
+	*queue = xnvme_dev_numa_zalloc(dev, _queue_nbytes(capacity));
 	if (!*queue) {
-		XNVME_DEBUG("FAILED: calloc(queue), err: %s", strerror(errno));
+		XNVME_DEBUG("FAILED: xnvme_dev_numa_zalloc(queue), err: %s", strerror(errno));
 		return -errno;
 	}
 	(*queue)->base.capacity = capacity;
 	(*queue)->base.dev = dev;
 
 	SLIST_INIT(&(*queue)->base.pool);
+	TAILQ_INIT(&(*queue)->splits);
 
 	for (uint32_t i = 0; i <= (*queue)->base.capacity; ++i) {
 		(*queue)->pool_storage[i].dev = dev;
@@ -69,7 +78,7 @@ xnvme_queue_init(struct xnvme_dev *dev, uint16_t capacity, int opts, struct xnvm
 	err = dev->be.async.init(*queue, opts);
 	if (err) {
 		XNVME_DEBUG("FAILED: backend-queue initialization with err: %d", err);
-		free(*queue);
+		xnvme_dev_numa_free(*queue, _queue_nbytes(capacity));
 		*queue = NULL;
 		return err;
 	}
@@ -88,14 +97,65 @@ xnvme_queue_set_cb(struct xnvme_queue *queue, xnvme_queue_cb cb, void *cb_arg)
 	return 0;
 }
 
+/**
+ * Reap the completions of the helper-thread, and of the async. interface; the commands of the
+ * helper-thread are not counted in 'queue->base.outstanding', thus the backend poke only sees its
+ * own
+ */
+static int
+_poke_hybrid(struct xnvme_queue *queue, uint32_t max)
+{
+	int acc, err;
+
+	acc = xnvme_queue_helper_poke(queue, max);
+	if (acc < 0) {
+		XNVME_DEBUG("FAILED: xnvme_queue_helper_poke(), err: %d", acc);
+		return acc;
+	}
+	if (max && ((uint32_t)acc >= max)) {
+		goto exit;
+	}
+	max = max ? max - acc : 0;
+
+	if (queue->base.outstanding) {
+		err = XNVME_BE_ASYNC_POKE(queue->base.dev, queue, max);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: be.async.poke(), err: %d", err);
+			return err;
+		}
+		acc += err;
+	}
+
+exit:
+	if (!TAILQ_EMPTY(&queue->splits)) {
+		xnvme_cmd_split_resume(queue);
+	}
+
+	return acc;
+}
+
 int
 xnvme_queue_poke(struct xnvme_queue *queue, uint32_t max)
 {
-	if (!queue->base.outstanding) {
+	int err;
+
+	if (!xnvme_queue_get_outstanding(queue)) {
+		if (!TAILQ_EMPTY(&queue->splits)) {
+			xnvme_cmd_split_resume(queue);
+		}
 		return 0;
 	}
 
-	return queue->base.dev->be.async.poke(queue, max);
+	if (queue->helper) {
+		return _poke_hybrid(queue, max);
+	}
+
+	err = XNVME_BE_ASYNC_POKE(queue->base.dev, queue, max);
+	if ((err >= 0) && !TAILQ_EMPTY(&queue->splits)) {
+		xnvme_cmd_split_resume(queue);
+	}
+
+	return err;
 }
 
 int
@@ -111,9 +171,18 @@ xnvme_queue_drain(struct xnvme_queue *queue)
 {
 	int acc = 0;
 
-	while (queue->base.outstanding) {
+	while (xnvme_queue_get_outstanding(queue)) {
 		int err;
 
+		// Only commands on the helper-thread are left; wait for them instead of spinning
+		if (!queue->base.outstanding) {
+			err = xnvme_queue_helper_wait(queue);
+			if (err) {
+				XNVME_DEBUG("FAILED: xnvme_queue_helper_wait(), err: %d", err);
+				return err;
+			}
+		}
+
 		err = xnvme_queue_poke(queue, 0);
 		if (err < 0) {
 			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
@@ -135,7 +204,7 @@ xnvme_queue_get_capacity(struct xnvme_queue *queue)
 uint32_t
 xnvme_queue_get_outstanding(struct xnvme_queue *queue)
 {
-	return queue->base.outstanding;
+	return queue->base.outstanding + xnvme_queue_helper_outstanding(queue);
 }
 
 struct xnvme_cmd_ctx *
@@ -0,0 +1,77 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#include <errno.h>
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#include <xnvme_be_cbi.h>
+#include <xnvme_dev.h>
+#include <xnvme_queue.h>
+
+/**
+ * Commands which the async. interface of a queue cannot carry, are executed by a helper-thread
+ * via the sync. interface, and completed on the next poke of the queue; the helper is a
+ * queue-pair of the thread-pool with a single thread. Its commands are counted by the queue-pair,
+ * not in 'queue->base.outstanding', which is left to the async. interface of the queue
+ */
+static int
+_helper_submit(struct xnvme_cmd_ctx *ctx, void *data, size_t data_vec_cnt, size_t data_nbytes,
+	       void *meta, size_t meta_vec_cnt, size_t meta_nbytes, bool is_vectored)
+{
+	struct xnvme_queue *queue = ctx->async.queue;
+
+	if (!queue->helper) {
+		int err = xnvme_be_cbi_async_thrpool_qp_init(&queue->helper, queue->base.dev,
+							     queue->base.capacity, 1);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_be_cbi_async_thrpool_qp_init(), err: %d", err);
+			return err;
+		}
+	}
+
+	return xnvme_be_cbi_async_thrpool_qp_submit(queue->helper, ctx, data, data_vec_cnt,
+						    data_nbytes, meta, meta_vec_cnt, meta_nbytes,
+						    is_vectored, NULL);
+}
+
+int
+xnvme_queue_helper_pass(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			size_t mbuf_nbytes)
+{
+	return _helper_submit(ctx, dbuf, 0, dbuf_nbytes, mbuf, 0, mbuf_nbytes, false);
+}
+
+int
+xnvme_queue_helper_passv(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+			 size_t dvec_nbytes, struct iovec *mvec, size_t mvec_cnt, size_t mvec_nbytes)
+{
+	return _helper_submit(ctx, dvec, dvec_cnt, dvec_nbytes, mvec, mvec_cnt, mvec_nbytes, true);
+}
+
+uint32_t
+xnvme_queue_helper_outstanding(struct xnvme_queue *queue)
+{
+	return queue->helper ? xnvme_be_cbi_async_thrpool_qp_outstanding(queue->helper) : 0;
+}
+
+int
+xnvme_queue_helper_poke(struct xnvme_queue *queue, uint32_t max)
+{
+	if (!queue->helper) {
+		return 0;
+	}
+
+	return xnvme_be_cbi_async_thrpool_qp_reap(queue->helper, max, NULL);
+}
+
+int
+xnvme_queue_helper_wait(struct xnvme_queue *queue)
+{
+	return queue->helper ? xnvme_be_cbi_async_thrpool_qp_wait(queue->helper) : 0;
+}
+
+void
+xnvme_queue_helper_term(struct xnvme_queue *queue)
+{
+	xnvme_be_cbi_async_thrpool_qp_term(queue->helper);
+	queue->helper = NULL;
+}
@@ -4,13 +4,16 @@
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
 #include <libxnvme.h>
 #include <libxnvme_spec_pp.h>
 #include <libxnvme_adm.h>
 #include <libxnvme_znd.h>
 #include <xnvme_be.h>
 #include <xnvme_dev.h>
+#include <xnvme_queue.h>
 #include <xnvme_spec.h>
+#include <xnvme_znd.h>
 
 /**
  * TODO: there should be a bunch of boundary checks here, e.g. slba + limit >
@@ -24,15 +27,21 @@ znd_report_init(struct xnvme_dev *dev, uint64_t slba, size_t limit, uint8_t exte
 {
 	const struct xnvme_spec_idfy_ns *nvm = (void *)xnvme_dev_get_ns(dev);
 	const struct xnvme_spec_znd_idfy_ns *zns = (void *)xnvme_dev_get_ns_css(dev);
-	const size_t zdext_nbytes = zns->lbafe[nvm->flbas.format].zdes * 64;
 	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
 	const size_t zd_nbytes = sizeof(struct xnvme_spec_znd_descr);
+	size_t zdext_nbytes;
 	size_t nentries;
 	size_t zrent_nbytes;
 	size_t entries_nbytes;
 	size_t report_nbytes;
 	struct xnvme_znd_report *report;
 
+	if (!zns) {
+		XNVME_DEBUG("FAILED: xnvme_dev_get_ns_css(), errno: %d", errno);
+		return NULL;
+	}
+	zdext_nbytes = zns->lbafe[nvm->flbas.format].zdes * 64;
+
 	if (extended && (!zdext_nbytes)) {
 		XNVME_DEBUG("FAILED: device does not support extended report");
 		errno = ENOSYS;
@@ -81,6 +90,205 @@ znd_report_init(struct xnvme_dev *dev, uint64_t slba, size_t limit, uint8_t exte
 
 	return report;
 }
+#define XNVME_ZND_REPORT_QDEPTH 8
+
+/**
+ * A chunk of a report, that is, the zone-descriptors of a single Zone Management Receive
+ */
+struct _report_chunk {
+	struct xnvme_znd_report *report;
+	void *dbuf;
+	uint64_t idx;    ///< Index, in the report, of the first entry of the chunk
+	size_t nentries; ///< Number of entries in the chunk
+	int busy;
+	int err;
+};
+
+static void
+_report_chunk_store(struct _report_chunk *chunk)
+{
+	struct xnvme_znd_report *report = chunk->report;
+	struct xnvme_spec_znd_report_hdr *hdr = chunk->dbuf;
+
+	XNVME_DEBUG("INFO: hdr->nzones: %" PRIu64, hdr->nzones);
+
+	if (chunk->nentries > hdr->nzones) {
+		XNVME_DEBUG("ERR: invalid nentries");
+		return;
+	}
+
+	// Skip the header and copy the remainder
+	memcpy(report->storage + chunk->idx * report->zrent_nbytes,
+	       ((uint8_t *)chunk->dbuf) + sizeof(struct xnvme_spec_znd_report_hdr),
+	       report->zrent_nbytes * chunk->nentries);
+}
+
+static int
+_report_fetch_sync(struct xnvme_dev *dev, struct xnvme_znd_report *report,
+		   struct _report_chunk *chunk, size_t dbuf_nbytes, size_t dbuf_nentries_max)
+{
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	enum xnvme_spec_znd_cmd_mgmt_recv_action action;
+	int err;
+
+	action = report->extended ? XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT_EXTENDED
+				  : XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT;
+
+	for (uint64_t idx = 0; idx < report->nentries; idx += chunk->nentries) {
+		chunk->idx = idx;
+		chunk->nentries = XNVME_MIN(dbuf_nentries_max, report->nentries - idx);
+
+		err = xnvme_znd_mgmt_recv(&ctx, nsid, report->zslba + idx * geo->nsect, action,
+					  XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_ALL, 0x0, chunk->dbuf,
+					  dbuf_nbytes);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			XNVME_DEBUG("FAILED: xnvme_znd_mgmt_recv()");
+			return err ? err : -EIO;
+		}
+		_report_chunk_store(chunk);
+	}
+
+	return 0;
+}
+
+static void
+_report_chunk_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct _report_chunk *chunk = cb_arg;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		XNVME_DEBUG("FAILED: xnvme_znd_mgmt_recv()");
+		chunk->err = -EIO;
+	} else {
+		_report_chunk_store(chunk);
+	}
+	chunk->busy = 0;
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+static int
+_report_chunk_submit(struct xnvme_queue *queue, struct xnvme_znd_report *report,
+		     struct _report_chunk *chunk, size_t dbuf_nbytes)
+{
+	struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+	const uint64_t zslba = report->zslba + chunk->idx * ctx->dev->geo.nsect;
+	enum xnvme_spec_znd_cmd_mgmt_recv_action action;
+	int err;
+
+	action = report->extended ? XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT_EXTENDED
+				  : XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT;
+
+	xnvme_cmd_ctx_set_cb(ctx, _report_chunk_cb, chunk);
+
+	chunk->busy = 1;
+	err = xnvme_znd_mgmt_recv(ctx, xnvme_dev_get_nsid(ctx->dev), zslba, action,
+				  XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_ALL, 0x0, chunk->dbuf,
+				  dbuf_nbytes);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_znd_mgmt_recv(), err: %d", err);
+		chunk->busy = 0;
+		xnvme_queue_put_cmd_ctx(queue, ctx);
+	}
+
+	return err;
+}
+
+/**
+ * Take the queue kept by the device for fetching reports, or set up one when it is not kept, e.g.
+ * on the first report, or while another thread holds it
+ */
+static int
+_report_queue_get(struct xnvme_dev *dev, struct xnvme_queue **queue)
+{
+	*queue = __atomic_exchange_n(&dev->znd_queue, NULL, __ATOMIC_ACQUIRE);
+	if (*queue) {
+		return 0;
+	}
+
+	return xnvme_queue_init(dev, XNVME_ZND_REPORT_QDEPTH, 0, queue);
+}
+
+/**
+ * Keep the given, drained, queue for the next report, unless the device already keeps one
+ */
+static void
+_report_queue_put(struct xnvme_dev *dev, struct xnvme_queue *queue)
+{
+	struct xnvme_queue *expected = NULL;
+
+	if (!__atomic_compare_exchange_n(&dev->znd_queue, &expected, queue, false,
+					 __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		xnvme_queue_term(queue);
+	}
+}
+
+void
+xnvme_znd_report_queue_term(struct xnvme_dev *dev)
+{
+	struct xnvme_queue *queue = __atomic_exchange_n(&dev->znd_queue, NULL, __ATOMIC_ACQUIRE);
+
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+}
+
+/**
+ * Fetch the chunks of the report concurrently, with a Zone Management Receive in flight for each
+ * of the 'nchunks' buffers, on the queue kept by the device
+ */
+static int
+_report_fetch_async(struct xnvme_dev *dev, struct xnvme_znd_report *report,
+		    struct _report_chunk *chunks, uint32_t nchunks, size_t dbuf_nbytes,
+		    size_t dbuf_nentries_max)
+{
+	struct xnvme_queue *queue = NULL;
+	uint64_t idx = 0;
+	int err;
+
+	err = _report_queue_get(dev, &queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: _report_queue_get(), err: %d", err);
+		return err;
+	}
+
+	for (uint32_t nbusy = 1; nbusy;) {
+		nbusy = 0;
+
+		for (uint32_t i = 0; i < nchunks; ++i) {
+			struct _report_chunk *chunk = &chunks[i];
+
+			if (!chunk->busy && (idx < report->nentries) && !err && !chunk->err) {
+				chunk->idx = idx;
+				chunk->nentries =
+					XNVME_MIN(dbuf_nentries_max, report->nentries - idx);
+				err = _report_chunk_submit(queue, report, chunk, dbuf_nbytes);
+				idx += chunk->nentries;
+			}
+			err = err ? err : chunk->err;
+			nbusy += chunk->busy;
+		}
+		if (!nbusy) {
+			break;
+		}
+
+		if (xnvme_queue_poke(queue, 0) < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke()");
+			err = err ? err : -EIO;
+			break;
+		}
+	}
+
+	if (xnvme_queue_drain(queue) < 0) {
+		xnvme_queue_term(queue);
+		return err ? err : -EIO;
+	}
+	_report_queue_put(dev, queue);
+
+	return err;
+}
 
 /**
  * At this point then dev->geo has been filled and we can rely on the derived
@@ -92,19 +300,21 @@ znd_report_init(struct xnvme_dev *dev, uint64_t slba, size_t limit, uint8_t exte
  * zd_nbytes: Zone Descriptor Size in BYTES
  * zdext_nbytes: Zone Descriptor Extension Size in BYTES
  * zrent_nbytes: Size of an entry in the report, that is, descr + ext
+ *
+ * The report is fetched in chunks of MDTS, concurrently, on a queue; when the asynchronous
+ * interface of the device cannot do Zone Management Receive, e.g. "io_uring" or "libaio", then
+ * the chunks are fetched one at a time via the synchronous interface.
  */
-struct xnvme_znd_report *
-xnvme_znd_report_from_dev(struct xnvme_dev *dev, uint64_t slba, size_t limit, uint8_t extended)
+static struct xnvme_znd_report *
+_report_from_dev(struct xnvme_dev *dev, uint64_t slba, size_t limit, uint8_t extended)
 {
 	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
-	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
-	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	struct _report_chunk chunks[XNVME_ZND_REPORT_QDEPTH] = {0};
 	size_t dbuf_nentries_max;
 	size_t dbuf_nbytes;
-	void *dbuf;
+	uint32_t nchunks;
 
 	struct xnvme_znd_report *report = NULL;
-	enum xnvme_spec_znd_cmd_mgmt_recv_action action;
 
 	int err;
 
@@ -130,59 +340,624 @@ xnvme_znd_report_from_dev(struct xnvme_dev *dev, uint64_t slba, size_t limit, ui
 		return NULL;
 	}
 
-	// Allocate device buffer for mgmt-recv commands
+	nchunks = XNVME_MIN(XNVME_ZND_REPORT_QDEPTH,
+			    (report->nentries + dbuf_nentries_max - 1) / dbuf_nentries_max);
+
+	// Allocate device buffers for mgmt-recv commands
+	for (uint32_t i = 0; i < nchunks; ++i) {
+		chunks[i].report = report;
+		chunks[i].dbuf = xnvme_buf_alloc(dev, dbuf_nbytes);
+		if (!chunks[i].dbuf) {
+			XNVME_DEBUG("FAILED: xnvme_buf_alloc()");
+			err = -errno;
+			goto exit;
+		}
+	}
+
+	err = -ENOSYS;
+	if (nchunks > 1) {
+		err = _report_fetch_async(dev, report, chunks, nchunks, dbuf_nbytes,
+					  dbuf_nentries_max);
+	}
+	if (err) {
+		err = _report_fetch_sync(dev, report, &chunks[0], dbuf_nbytes, dbuf_nentries_max);
+	}
+
+exit:
+	for (uint32_t i = 0; i < nchunks; ++i) {
+		xnvme_buf_free(dev, chunks[i].dbuf);
+	}
+	if (err) {
+		xnvme_buf_virt_free(report);
+		errno = -err;
+		return NULL;
+	}
+
+	return report;
+}
+
+static int
+_descr_from_dev(struct xnvme_dev *dev, uint64_t slba, struct xnvme_spec_znd_descr *zdescr)
+{
+	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	struct xnvme_spec_znd_report_hdr *hdr;
+	size_t dbuf_nbytes;
+	void *dbuf;
+	int err;
+
+	dbuf_nbytes = sizeof(*hdr) + sizeof(*zdescr);
 	dbuf = xnvme_buf_alloc(dev, dbuf_nbytes);
 	if (!dbuf) {
 		XNVME_DEBUG("FAILED: xnvme_buf_alloc()");
-		xnvme_buf_virt_free(report);
-		return NULL;
+		return -errno;
 	}
+	memset(dbuf, 0, dbuf_nbytes);
 
-	// Determine Management Receive Action
-	action = report->extended ? XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT_EXTENDED
-				  : XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT;
+	err = xnvme_znd_mgmt_recv(&ctx, nsid, slba, XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT,
+				  XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_ALL, 0x0, dbuf, dbuf_nbytes);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		XNVME_DEBUG("FAILED: xnvme_znd_mgmt_recv()");
+		err = err ? err : -EIO;
+		goto exit;
+	}
 
-	for (uint64_t zslba = report->zslba; zslba <= report->zelba;) {
-		struct xnvme_spec_znd_report_hdr *hdr = (void *)dbuf;
-		size_t nentries =
-			XNVME_MIN(dbuf_nentries_max, ((report->zelba - zslba) / geo->nsect) + 1);
+	hdr = (void *)dbuf;
+	if (!hdr->nzones) {
+		XNVME_DEBUG("FAILED: hdr->nzones: %" PRIu64, hdr->nzones);
+		err = -EIO;
+		goto exit;
+	}
+	memcpy(zdescr, dbuf + sizeof(*hdr), sizeof(*zdescr));
 
-		XNVME_DEBUG("INFO: nentries: %" PRIu64, nentries);
-		if ((!nentries) || (nentries > dbuf_nentries_max)) {
-			XNVME_DEBUG("ERR: invalid nentries");
-			break;
+exit:
+	xnvme_buf_free(dev, dbuf);
+
+	return err;
+}
+
+/**
+ * When more zones than this are stale, then the cache is refreshed with a full report instead of
+ * fetching the descriptor of each stale zone
+ */
+#define XNVME_ZND_CACHE_NSTALE_MAX 8
+
+/**
+ * Zone-state cache of a device, see xnvme_znd_cache_enable()
+ */
+struct xnvme_znd_cache {
+	pthread_mutex_t lock;
+	uint64_t nzones;
+	uint64_t nstale; ///< Number of zones with a stale descriptor
+	uint8_t *stale;  ///< Per zone, non-zero when the descriptor must be re-fetched
+	struct xnvme_spec_znd_descr *descrs;
+};
+
+/**
+ * The callback, and argument, of an asynchronous command tracked by the cache
+ */
+struct xnvme_znd_cache_track {
+	xnvme_queue_cb cb;
+	void *cb_arg;
+	SLIST_ENTRY(xnvme_znd_cache_track) link;
+};
+
+/**
+ * The tracking-state of the commands of a queue; there is one per command that the queue can
+ * have outstanding, thus, tracking a command does not allocate
+ */
+struct xnvme_znd_cache_tracks {
+	SLIST_HEAD(, xnvme_znd_cache_track) free;
+	struct xnvme_znd_cache_track storage[];
+};
+
+static inline int
+_cache_tracks(const struct xnvme_cmd_ctx *ctx)
+{
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_WRITE:
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+	case XNVME_SPEC_ZND_OPC_APPEND:
+	case XNVME_SPEC_ZND_OPC_MGMT_SEND:
+		return 1;
+
+	default:
+		return 0;
+	}
+}
+
+static void
+_cache_mark_stale(struct xnvme_znd_cache *cache, uint64_t zidx)
+{
+	if (zidx >= cache->nzones) {
+		return;
+	}
+	cache->nstale += !cache->stale[zidx];
+	cache->stale[zidx] = 1;
+}
+
+static void
+_cache_mark_stale_all(struct xnvme_znd_cache *cache)
+{
+	memset(cache->stale, 1, cache->nzones);
+	cache->nstale = cache->nzones;
+}
+
+/**
+ * Apply the completion of the given write, append or management command to the cache; on error,
+ * or when the zone has a ZRWA, where the write pointer moves on flush, then the zone is marked
+ * stale instead
+ */
+static void
+_cache_apply(struct xnvme_cmd_ctx *ctx, int err)
+{
+	struct xnvme_znd_cache *cache = ctx->dev->znd_cache;
+	const uint64_t zsze = ctx->dev->geo.nsect;
+	struct xnvme_spec_znd_descr *zdescr;
+	uint64_t zidx, wp = 0;
+
+	if (!cache) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_WRITE:
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		zidx = ctx->cmd.nvm.slba / zsze;
+		wp = ctx->cmd.nvm.slba + ctx->cmd.nvm.nlb + 1;
+		break;
+
+	case XNVME_SPEC_ZND_OPC_APPEND:
+		zidx = ctx->cmd.znd.append.zslba / zsze;
+		wp = ctx->cpl.result + ctx->cmd.znd.append.nlb + 1;
+		break;
+
+	case XNVME_SPEC_ZND_OPC_MGMT_SEND:
+		if (ctx->cmd.znd.mgmt_send.select_all) {
+			_cache_mark_stale_all(cache);
+			goto exit;
 		}
+		zidx = ctx->cmd.znd.mgmt_send.slba / zsze;
+		break;
 
-		err = xnvme_znd_mgmt_recv(&ctx, nsid, zslba, action,
-					  XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_ALL, 0x0, dbuf,
-					  dbuf_nbytes);
-		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
-			XNVME_DEBUG("FAILED: xnvme_znd_mgmt_recv()");
-			xnvme_buf_virt_free(report);
-			xnvme_buf_free(dev, dbuf);
-			errno = err ? -err : EIO;
-			return NULL;
+	default:
+		goto exit;
+	}
+	if (zidx >= cache->nzones) {
+		goto exit;
+	}
+	zdescr = &cache->descrs[zidx];
+
+	if (err || xnvme_cmd_ctx_cpl_status(ctx) || zdescr->za.zrwav) {
+		_cache_mark_stale(cache, zidx);
+		goto exit;
+	}
+
+	if (ctx->cmd.common.opcode != XNVME_SPEC_ZND_OPC_MGMT_SEND) {
+		// Completions of writes to a zone can arrive out of order
+		zdescr->wp = XNVME_MAX(zdescr->wp, wp);
+		if ((zdescr->zs == XNVME_SPEC_ZND_STATE_EMPTY) ||
+		    (zdescr->zs == XNVME_SPEC_ZND_STATE_CLOSED)) {
+			zdescr->zs = XNVME_SPEC_ZND_STATE_IOPEN;
 		}
-		XNVME_DEBUG("INFO: hdr->nzones: %" PRIu64, hdr->nzones);
+		if (zdescr->wp >= zdescr->zslba + zdescr->zcap) {
+			zdescr->zs = XNVME_SPEC_ZND_STATE_FULL;
+		}
+		goto exit;
+	}
 
-		if (nentries > hdr->nzones) {
-			XNVME_DEBUG("ERR: invalid nentries");
-			break;
+	switch (ctx->cmd.znd.mgmt_send.zsa) {
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_CLOSE:
+		zdescr->zs = (zdescr->wp == zdescr->zslba) ? XNVME_SPEC_ZND_STATE_EMPTY
+							   : XNVME_SPEC_ZND_STATE_CLOSED;
+		break;
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_FINISH:
+		zdescr->zs = XNVME_SPEC_ZND_STATE_FULL;
+		zdescr->wp = zdescr->zslba + zdescr->zcap;
+		break;
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN:
+		zdescr->zs = XNVME_SPEC_ZND_STATE_EOPEN;
+		break;
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_RESET:
+		zdescr->zs = XNVME_SPEC_ZND_STATE_EMPTY;
+		zdescr->wp = zdescr->zslba;
+		zdescr->za.zfc = 0;
+		zdescr->za.zfr = 0;
+		zdescr->za.rzr = 0;
+		break;
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_OFFLINE:
+		zdescr->zs = XNVME_SPEC_ZND_STATE_OFFLINE;
+		break;
+
+	default:
+		_cache_mark_stale(cache, zidx);
+		break;
+	}
+
+exit:
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void
+xnvme_znd_cache_cpl(struct xnvme_cmd_ctx *ctx, int err)
+{
+	if (_cache_tracks(ctx)) {
+		_cache_apply(ctx, err);
+	}
+}
+
+static void
+_cache_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct xnvme_znd_cache_track *track = cb_arg;
+
+	ctx->async.cb = track->cb;
+	ctx->async.cb_arg = track->cb_arg;
+	SLIST_INSERT_HEAD(&ctx->async.queue->znd_tracks->free, track, link);
+
+	_cache_apply(ctx, 0);
+
+	ctx->async.cb(ctx, ctx->async.cb_arg);
+}
+
+static int
+_cache_tracks_init(struct xnvme_queue *queue)
+{
+	struct xnvme_znd_cache_tracks *tracks;
+
+	tracks = calloc(1, sizeof(*tracks) + queue->base.capacity * sizeof(*tracks->storage));
+	if (!tracks) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	SLIST_INIT(&tracks->free);
+	for (uint32_t i = 0; i < queue->base.capacity; ++i) {
+		SLIST_INSERT_HEAD(&tracks->free, &tracks->storage[i], link);
+	}
+
+	queue->znd_tracks = tracks;
+
+	return 0;
+}
+
+int
+xnvme_znd_cache_track(struct xnvme_cmd_ctx *ctx)
+{
+	struct xnvme_queue *queue = ctx->async.queue;
+	struct xnvme_znd_cache_track *track;
+
+	if (!_cache_tracks(ctx)) {
+		return 0;
+	}
+
+	if (!queue->znd_tracks) {
+		int err = _cache_tracks_init(queue);
+		if (err) {
+			XNVME_DEBUG("FAILED: _cache_tracks_init(), err: %d", err);
+			return err;
 		}
+	}
+
+	track = SLIST_FIRST(&queue->znd_tracks->free);
+	if (!track) {
+		return -EBUSY;
+	}
+	SLIST_REMOVE_HEAD(&queue->znd_tracks->free, link);
+
+	track->cb = ctx->async.cb;
+	track->cb_arg = ctx->async.cb_arg;
+
+	ctx->async.cb = _cache_cb;
+	ctx->async.cb_arg = track;
+
+	return 0;
+}
 
-		// Skip the header and copy the remainder
-		memcpy(report->storage + ((zslba - slba) / geo->nsect) * report->zrent_nbytes,
-		       ((uint8_t *)dbuf) + sizeof(struct xnvme_spec_znd_report_hdr),
-		       report->zrent_nbytes * nentries);
+void
+xnvme_znd_cache_untrack(struct xnvme_cmd_ctx *ctx)
+{
+	struct xnvme_znd_cache_track *track = ctx->async.cb_arg;
 
-		zslba += nentries * geo->nsect;
+	if (ctx->async.cb != _cache_cb) {
+		return;
 	}
 
-	xnvme_buf_free(dev, dbuf);
+	ctx->async.cb = track->cb;
+	ctx->async.cb_arg = track->cb_arg;
+	SLIST_INSERT_HEAD(&ctx->async.queue->znd_tracks->free, track, link);
+}
+
+void
+xnvme_znd_cache_track_term(struct xnvme_queue *queue)
+{
+	free(queue->znd_tracks);
+	queue->znd_tracks = NULL;
+}
+
+/**
+ * Returns the index of the first stale zone at, or after, 'zidx', and 'nzones' when there is none
+ */
+static uint64_t
+_cache_next_stale(struct xnvme_znd_cache *cache, uint64_t zidx)
+{
+	pthread_mutex_lock(&cache->lock);
+	while ((zidx < cache->nzones) && !cache->stale[zidx]) {
+		++zidx;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return zidx;
+}
+
+/**
+ * Re-fetch the descriptors of the stale zones; one at a time when few, otherwise via a report
+ */
+static int
+_cache_refresh(struct xnvme_dev *dev)
+{
+	struct xnvme_znd_cache *cache = dev->znd_cache;
+	struct xnvme_znd_report *report;
+	uint64_t nstale;
+
+	pthread_mutex_lock(&cache->lock);
+	nstale = cache->nstale;
+	pthread_mutex_unlock(&cache->lock);
+
+	if (!nstale) {
+		return 0;
+	}
+
+	if (nstale <= XNVME_ZND_CACHE_NSTALE_MAX) {
+		for (uint64_t zidx = 0; nstale; ++zidx) {
+			struct xnvme_spec_znd_descr zdescr;
+			int err;
+
+			zidx = _cache_next_stale(cache, zidx);
+			if (zidx >= cache->nzones) {
+				break;
+			}
+
+			err = _descr_from_dev(dev, zidx * dev->geo.nsect, &zdescr);
+			if (err) {
+				XNVME_DEBUG("FAILED: _descr_from_dev(), err: %d", err);
+				return err;
+			}
+
+			pthread_mutex_lock(&cache->lock);
+			cache->descrs[zidx] = zdescr;
+			cache->nstale -= cache->stale[zidx];
+			cache->stale[zidx] = 0;
+			pthread_mutex_unlock(&cache->lock);
+
+			--nstale;
+		}
+
+		return 0;
+	}
+
+	report = _report_from_dev(dev, 0, 0, 0);
+	if (!report) {
+		XNVME_DEBUG("FAILED: _report_from_dev(), errno: %d", errno);
+		return -errno;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	memcpy(cache->descrs, report->storage, cache->nzones * sizeof(*cache->descrs));
+	memset(cache->stale, 0, cache->nzones);
+	cache->nstale = 0;
+	pthread_mutex_unlock(&cache->lock);
+
+	xnvme_buf_virt_free(report);
+
+	return 0;
+}
+
+int
+xnvme_znd_cache_enable(struct xnvme_dev *dev)
+{
+	struct xnvme_znd_cache *cache;
+	int err;
+
+	if (dev->geo.type != XNVME_GEO_ZONED) {
+		XNVME_DEBUG("FAILED: device is not zoned");
+		return -EINVAL;
+	}
+	if (dev->refcount) {
+		XNVME_DEBUG("FAILED: zone-state cache on a shared handle");
+		return -EINVAL;
+	}
+	if (dev->znd_cache) {
+		return 0;
+	}
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	cache->nzones = dev->geo.nzone;
+	cache->descrs = calloc(cache->nzones, sizeof(*cache->descrs));
+	cache->stale = calloc(cache->nzones, sizeof(*cache->stale));
+	if (!cache->descrs || !cache->stale) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		err = -errno;
+		goto failed;
+	}
+	pthread_mutex_init(&cache->lock, NULL);
+
+	// Populated by the refresh of the zones, which are all stale
+	_cache_mark_stale_all(cache);
+	dev->znd_cache = cache;
+
+	err = _cache_refresh(dev);
+	if (err) {
+		XNVME_DEBUG("FAILED: _cache_refresh(), err: %d", err);
+		dev->znd_cache = NULL;
+		pthread_mutex_destroy(&cache->lock);
+		goto failed;
+	}
+
+	return 0;
+
+failed:
+	free(cache->descrs);
+	free(cache->stale);
+	free(cache);
+
+	return err;
+}
+
+void
+xnvme_znd_cache_disable(struct xnvme_dev *dev)
+{
+	struct xnvme_znd_cache *cache = dev->znd_cache;
+
+	if (!cache) {
+		return;
+	}
+	dev->znd_cache = NULL;
+
+	pthread_mutex_destroy(&cache->lock);
+	free(cache->descrs);
+	free(cache->stale);
+	free(cache);
+}
+
+int
+xnvme_znd_cache_sync(struct xnvme_dev *dev)
+{
+	struct xnvme_znd_cache *cache = dev->znd_cache;
+	struct xnvme_spec_znd_log_changes *log;
+
+	if (!cache) {
+		XNVME_DEBUG("FAILED: the zone-state cache is not enabled");
+		return -EINVAL;
+	}
+
+	log = xnvme_znd_log_changes_from_dev(dev);
+
+	pthread_mutex_lock(&cache->lock);
+	if (!log || (log->nidents == 0xFFFF)) {
+		XNVME_DEBUG("INFO: no changed-zones log, or it overflowed; refreshing all zones");
+		_cache_mark_stale_all(cache);
+	} else {
+		for (uint16_t i = 0; (i < log->nidents) && (i < ZND_CHANGES_LEN); ++i) {
+			_cache_mark_stale(cache, log->idents[i] / dev->geo.nsect);
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	xnvme_buf_free(dev, log);
+
+	return _cache_refresh(dev);
+}
+
+static struct xnvme_znd_report *
+_cache_report(struct xnvme_dev *dev, uint64_t slba, size_t limit)
+{
+	struct xnvme_znd_cache *cache = dev->znd_cache;
+	struct xnvme_znd_report *report;
+	uint64_t zidx = slba / dev->geo.nsect;
+	int err;
+
+	err = _cache_refresh(dev);
+	if (err) {
+		XNVME_DEBUG("FAILED: _cache_refresh(), err: %d", err);
+		errno = -err;
+		return NULL;
+	}
+
+	report = znd_report_init(dev, slba, limit, 0);
+	if (!report) {
+		XNVME_DEBUG("FAILED: znd_report_init()");
+		return NULL;
+	}
+	if (zidx >= cache->nzones) {
+		return report;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	memcpy(report->storage, &cache->descrs[zidx],
+	       XNVME_MIN(report->nentries, cache->nzones - zidx) * sizeof(*cache->descrs));
+	pthread_mutex_unlock(&cache->lock);
 
 	return report;
 }
 
+static int
+_cache_descr(struct xnvme_dev *dev, uint64_t slba, struct xnvme_spec_znd_descr *zdescr)
+{
+	struct xnvme_znd_cache *cache = dev->znd_cache;
+	uint64_t zidx = slba / dev->geo.nsect;
+	int err;
+
+	if (zidx >= cache->nzones) {
+		XNVME_DEBUG("FAILED: slba: 0x%" PRIx64 " is out of bounds", slba);
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	if (!cache->stale[zidx]) {
+		*zdescr = cache->descrs[zidx];
+		pthread_mutex_unlock(&cache->lock);
+		return 0;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	err = _descr_from_dev(dev, slba, zdescr);
+	if (err) {
+		XNVME_DEBUG("FAILED: _descr_from_dev(), err: %d", err);
+		return err;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	cache->descrs[zidx] = *zdescr;
+	cache->nstale -= cache->stale[zidx];
+	cache->stale[zidx] = 0;
+	pthread_mutex_unlock(&cache->lock);
+
+	return 0;
+}
+
+static int
+_cache_descr_in_state(struct xnvme_dev *dev, enum xnvme_spec_znd_state state,
+		      struct xnvme_spec_znd_descr *zdescr)
+{
+	struct xnvme_znd_cache *cache = dev->znd_cache;
+	int err;
+
+	err = _cache_refresh(dev);
+	if (err) {
+		XNVME_DEBUG("FAILED: _cache_refresh(), err: %d", err);
+		return err;
+	}
+
+	err = -EIO;
+	pthread_mutex_lock(&cache->lock);
+	for (uint64_t zidx = 0; zidx < cache->nzones; ++zidx) {
+		if (cache->descrs[zidx].zs == state) {
+			*zdescr = cache->descrs[zidx];
+			err = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return err;
+}
+
+struct xnvme_znd_report *
+xnvme_znd_report_from_dev(struct xnvme_dev *dev, uint64_t slba, size_t limit, uint8_t extended)
+{
+	if (dev->znd_cache && !extended) {
+		return _cache_report(dev, slba, limit);
+	}
+
+	return _report_from_dev(dev, slba, limit, extended);
+}
+
 int
 xnvme_znd_report_find_arbitrary(const struct xnvme_znd_report *report,
 				enum xnvme_spec_znd_state state, uint64_t *zlba, int opts)
@@ -211,41 +986,11 @@ xnvme_znd_report_find_arbitrary(const struct xnvme_znd_report *report,
 int
 xnvme_znd_descr_from_dev(struct xnvme_dev *dev, uint64_t slba, struct xnvme_spec_znd_descr *zdescr)
 {
-	const uint32_t nsid = xnvme_dev_get_nsid(dev);
-	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
-	struct xnvme_spec_znd_report_hdr *hdr;
-	size_t dbuf_nbytes;
-	void *dbuf;
-	int err;
-
-	dbuf_nbytes = sizeof(*hdr) + sizeof(*zdescr);
-	dbuf = xnvme_buf_alloc(dev, dbuf_nbytes);
-	if (!dbuf) {
-		XNVME_DEBUG("FAILED: xnvme_buf_alloc()");
-		return -errno;
-	}
-	memset(dbuf, 0, dbuf_nbytes);
-
-	err = xnvme_znd_mgmt_recv(&ctx, nsid, slba, XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT,
-				  XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_ALL, 0x0, dbuf, dbuf_nbytes);
-	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
-		XNVME_DEBUG("FAILED: xnvme_znd_mgmt_recv()");
-		err = err ? err : -EIO;
-		goto exit;
-	}
-
-	hdr = (void *)dbuf;
-	if (!hdr->nzones) {
-		XNVME_DEBUG("FAILED: hdr->nzones: %" PRIu64, hdr->nzones);
-		err = -EIO;
-		goto exit;
+	if (dev->znd_cache) {
+		return _cache_descr(dev, slba, zdescr);
 	}
-	memcpy(zdescr, dbuf + sizeof(*hdr), sizeof(*zdescr));
 
-exit:
-	xnvme_buf_free(dev, dbuf);
-
-	return err;
+	return _descr_from_dev(dev, slba, zdescr);
 }
 
 int
@@ -260,6 +1005,10 @@ xnvme_znd_descr_from_dev_in_state(struct xnvme_dev *dev, enum xnvme_spec_znd_sta
 	uint8_t sfield;
 	int err;
 
+	if (dev->znd_cache) {
+		return _cache_descr_in_state(dev, state, zdescr);
+	}
+
 	switch (state) {
 	case XNVME_SPEC_ZND_STATE_EMPTY:
 		sfield = XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_EMPTY;
@@ -396,12 +1145,162 @@ xnvme_znd_mgmt_send(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t zslba, bo
 		struct xnvme_spec_idfy_ns *nvm = (void *)xnvme_dev_get_ns(ctx->dev);
 		struct xnvme_spec_znd_idfy_ns *zns = (void *)xnvme_dev_get_ns_css(ctx->dev);
 
+		if (!zns) {
+			XNVME_DEBUG("FAILED: xnvme_dev_get_ns_css(), errno: %d", errno);
+			return -errno;
+		}
 		dbuf_nbytes = zns->lbafe[nvm->flbas.format].zdes * 64;
 	}
 
 	return xnvme_cmd_pass(ctx, dbuf, dbuf_nbytes, NULL, 0);
 }
 
+/**
+ * A command in flight of xnvme_znd_mgmt_send_range()
+ */
+struct _mgmt_range_slot {
+	uint8_t *done;
+	uint64_t idx; ///< Index, in 'zslbas', of the zone managed by the command
+	int busy;
+	int err;
+};
+
+static void
+_mgmt_range_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct _mgmt_range_slot *slot = cb_arg;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		XNVME_DEBUG("FAILED: xnvme_znd_mgmt_send(), idx: %" PRIu64, slot->idx);
+		slot->err = slot->err ? slot->err : -EIO;
+	} else if (slot->done) {
+		slot->done[slot->idx / 8] |= 1 << (slot->idx % 8);
+	}
+	slot->busy = 0;
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+static int
+_mgmt_range_sync(struct xnvme_dev *dev, const uint64_t *zslbas, uint64_t idx, uint64_t nzones,
+		 enum xnvme_spec_znd_cmd_mgmt_send_action action, uint8_t *done)
+{
+	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	int err_first = 0;
+
+	for (; idx < nzones; ++idx) {
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+		int err;
+
+		err = xnvme_znd_mgmt_send(&ctx, nsid, zslbas[idx], false, action, 0, NULL);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			XNVME_DEBUG("FAILED: xnvme_znd_mgmt_send(), idx: %" PRIu64 ", err: %d", idx,
+				    err);
+			err_first = err_first ? err_first : (err ? err : -EIO);
+			continue;
+		}
+		if (done) {
+			done[idx / 8] |= 1 << (idx % 8);
+		}
+	}
+
+	return err_first;
+}
+
+int
+xnvme_znd_mgmt_send_range(struct xnvme_dev *dev, const uint64_t *zslbas, uint64_t nzones,
+			  enum xnvme_spec_znd_cmd_mgmt_send_action action, uint32_t qdepth,
+			  uint8_t *done)
+{
+	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	struct _mgmt_range_slot *slots = NULL;
+	struct xnvme_queue *queue = NULL;
+	uint64_t idx = 0;
+	int nosys = 0;
+	int err;
+
+	if (done) {
+		memset(done, 0, (nzones + 7) / 8);
+	}
+	if (!nzones) {
+		return 0;
+	}
+	if (qdepth < 2) {
+		return _mgmt_range_sync(dev, zslbas, 0, nzones, action, done);
+	}
+
+	slots = calloc(qdepth, sizeof(*slots));
+	if (!slots) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	err = xnvme_queue_init(dev, qdepth, 0, &queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_queue_init(), err: %d", err);
+		free(slots);
+		return err;
+	}
+
+	for (uint32_t nbusy = 1; nbusy;) {
+		nbusy = 0;
+
+		for (uint32_t i = 0; i < qdepth; ++i) {
+			struct _mgmt_range_slot *slot = &slots[i];
+			struct xnvme_cmd_ctx *ctx;
+
+			if (!slot->busy && (idx < nzones) && !nosys) {
+				ctx = xnvme_queue_get_cmd_ctx(queue);
+				xnvme_cmd_ctx_set_cb(ctx, _mgmt_range_cb, slot);
+
+				slot->done = done;
+				slot->idx = idx;
+				slot->busy = 1;
+
+				err = xnvme_znd_mgmt_send(ctx, nsid, zslbas[idx], false, action, 0,
+							  NULL);
+				if (err) {
+					slot->busy = 0;
+					xnvme_queue_put_cmd_ctx(queue, ctx);
+				}
+				if (err == -ENOSYS) {
+					XNVME_DEBUG("INFO: nosys; sync. from idx: %" PRIu64, idx);
+					nosys = 1;
+				} else {
+					slot->err = slot->err ? slot->err : err;
+					idx += 1;
+				}
+			}
+			nbusy += slot->busy;
+		}
+		if (!nbusy) {
+			err = 0;
+			break;
+		}
+
+		err = xnvme_queue_poke(queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			break;
+		}
+	}
+	xnvme_queue_drain(queue);
+	xnvme_queue_term(queue);
+
+	err = err < 0 ? err : 0;
+	for (uint32_t i = 0; (i < qdepth) && !err; ++i) {
+		err = slots[i].err;
+	}
+	free(slots);
+
+	if (nosys) {
+		int err_sync = _mgmt_range_sync(dev, zslbas, idx, nzones, action, done);
+
+		err = err ? err : err_sync;
+	}
+
+	return err;
+}
+
 int
 xnvme_znd_mgmt_recv(struct xnvme_cmd_ctx *ctx, uint32_t nsid, uint64_t slba,
 		    enum xnvme_spec_znd_cmd_mgmt_recv_action action,
@@ -0,0 +1,1240 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <libxnvme.h>
+#include <libxnvme_nvm.h>
+#include <libxnvme_znd.h>
+#include <xnvme_dev.h>
+
+#define ZLOG_MAGIC     0x474c5a58 ///< "XZLG"
+#define ZLOG_TOMB      0x1        ///< Record flag, the record is a tombstone
+#define ZLOG_INDEX_MIN 1024
+#define ZLOG_NONE      UINT64_MAX
+
+/**
+ * Header of a record, followed by its payload, in the LBAs of the record
+ */
+struct _zlog_hdr {
+	uint32_t magic;
+	uint32_t crc; ///< CRC32C of the header, with 'crc' zeroed, and of the payload
+	uint64_t key;
+	uint64_t seq;    ///< Order of the record, among records of the log
+	uint32_t nbytes; ///< Size of the payload
+	uint16_t nlbas;  ///< Number of LBAs of the record
+	uint8_t flags;
+	uint8_t rsvd;
+};
+XNVME_STATIC_ASSERT(sizeof(struct _zlog_hdr) == 32, "Incorrect size")
+
+/**
+ * Entry of the index, the latest record of a key; unused when 'nlbas' is zero
+ */
+struct _zlog_entry {
+	uint64_t key;
+	uint64_t seq;
+	uint64_t lba   : 47;
+	uint64_t tomb  : 1;
+	uint64_t nlbas : 16;
+};
+
+enum _zlog_zone_state {
+	ZLOG_ZONE_FREE    = 0, ///< Empty, in the free-list
+	ZLOG_ZONE_ACTIVE  = 1, ///< Appended to
+	ZLOG_ZONE_SEALED  = 2, ///< No longer appended to, may be reclaimed
+	ZLOG_ZONE_OFFLINE = 3, ///< Not usable by the log
+};
+
+struct _zlog_zone {
+	uint64_t zslba;
+	uint64_t zcap;
+	uint64_t nused;     ///< Number of LBAs written, or reserved by appends in flight
+	uint64_t nlive;     ///< Number of LBAs of records referenced by the index
+	uint64_t seq_min;   ///< Lowest sequence number of the records in the zone
+	uint64_t scan;      ///< Recovery; the next LBA to scan
+	uint32_t ninflight; ///< Number of appends in flight
+	uint8_t finish;     ///< Whether the zone must be finished once drained
+	uint8_t torn;       ///< Recovery; whether a record is not intact
+	enum _zlog_zone_state state;
+};
+
+/**
+ * A buffer for a record, and the append, or recovery read, in flight using it
+ */
+struct _zlog_slot {
+	struct xnvme_znd_log *log;
+	void *buf;
+	uint64_t zidx;
+	uint64_t key;
+	uint64_t seq;
+	uint64_t lba;
+	uint16_t nlbas;
+	uint8_t tomb;
+	uint8_t busy;
+	struct _zlog_slot *next; ///< Next in the free-list
+};
+
+struct xnvme_znd_log {
+	struct xnvme_dev *dev;
+	struct xnvme_queue *queue;
+	struct xnvme_znd_log_opts opts;
+	uint32_t nsid;
+	uint32_t lba_nbytes;
+	uint32_t nlbas_max; ///< Maximum number of LBAs of a record
+	uint64_t zsze;      ///< Number of LBAs between the start of zones
+	uint64_t seq;       ///< Sequence number of the next record
+	int sync;           ///< Whether appends are done via the synchronous interface
+	int reclaiming;     ///< Whether the reclamation callback is running
+
+	struct _zlog_zone *zones;
+	uint64_t nzones;
+	uint64_t *free; ///< Ring of indexes of empty zones
+	uint64_t free_head;
+	uint64_t nfree;
+	uint32_t nfinish; ///< Number of zones to finish once drained
+
+	uint64_t *active; ///< Indexes of the zones appended to, ZLOG_NONE when unassigned
+	uint32_t cursor;  ///< Active zone to try first on the next append
+
+	struct _zlog_entry *index;
+	uint64_t index_cap; ///< Number of entries; a power of 2
+	uint64_t index_len; ///< Number of used entries
+
+	struct _zlog_slot *slots;
+	struct _zlog_slot *slots_free;
+
+	int err; ///< First error of a command
+	uint32_t crc_tbl[256];
+};
+
+static void
+_zlog_crc_init(struct xnvme_znd_log *log)
+{
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t crc = i;
+
+		for (int j = 0; j < 8; ++j) {
+			crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+		}
+		log->crc_tbl[i] = crc;
+	}
+}
+
+static uint32_t
+_zlog_crc(const struct xnvme_znd_log *log, uint32_t crc, const void *buf, size_t nbytes)
+{
+	const uint8_t *bytes = buf;
+
+	crc = ~crc;
+	for (size_t i = 0; i < nbytes; ++i) {
+		crc = log->crc_tbl[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
+
+/**
+ * Returns the CRC32C of the record in 'buf', that is, of the header with 'crc' zeroed and of the
+ * payload
+ */
+static uint32_t
+_zlog_rec_crc(const struct xnvme_znd_log *log, const struct _zlog_hdr *hdr)
+{
+	struct _zlog_hdr tmp = *hdr;
+	uint32_t crc;
+
+	tmp.crc = 0;
+	crc = _zlog_crc(log, 0, &tmp, sizeof(tmp));
+
+	return _zlog_crc(log, crc, hdr + 1, hdr->nbytes);
+}
+
+/**
+ * Whether the record in 'buf', at 'lba', with up to 'nlbas' LBAs read, is intact; returns 1 when
+ * intact, 0 when more LBAs must be read, and -1 when not intact
+ */
+static int
+_zlog_rec_check(const struct xnvme_znd_log *log, const struct _zlog_hdr *hdr, uint64_t lba,
+		uint64_t nlbas, uint64_t elba)
+{
+	if ((hdr->magic != ZLOG_MAGIC) || !hdr->nlbas || (hdr->nlbas > log->nlbas_max) ||
+	    ((lba + hdr->nlbas) > elba) ||
+	    ((sizeof(*hdr) + hdr->nbytes) > ((uint64_t)hdr->nlbas * log->lba_nbytes))) {
+		return -1;
+	}
+	if (hdr->nlbas > nlbas) {
+		return 0;
+	}
+
+	return (_zlog_rec_crc(log, hdr) == hdr->crc) ? 1 : -1;
+}
+
+static inline struct _zlog_zone *
+_zlog_zone_of(struct xnvme_znd_log *log, uint64_t lba)
+{
+	return &log->zones[(lba - log->zones[0].zslba) / log->zsze];
+}
+
+static inline uint64_t
+_zlog_hash(uint64_t key)
+{
+	key *= 0x9E3779B97F4A7C15ULL;
+
+	return key ^ (key >> 32);
+}
+
+/**
+ * Returns the entry of the given 'key', or the unused entry where it belongs
+ */
+static struct _zlog_entry *
+_zlog_index_slot(struct xnvme_znd_log *log, uint64_t key)
+{
+	const uint64_t mask = log->index_cap - 1;
+
+	for (uint64_t pos = _zlog_hash(key) & mask;; pos = (pos + 1) & mask) {
+		struct _zlog_entry *entry = &log->index[pos];
+
+		if (!entry->nlbas || (entry->key == key)) {
+			return entry;
+		}
+	}
+}
+
+static int
+_zlog_index_grow(struct xnvme_znd_log *log)
+{
+	struct _zlog_entry *prev = log->index;
+	const uint64_t prev_cap = log->index_cap;
+
+	log->index_cap = prev_cap ? prev_cap * 2 : ZLOG_INDEX_MIN;
+	log->index = calloc(log->index_cap, sizeof(*log->index));
+	if (!log->index) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		log->index = prev;
+		log->index_cap = prev_cap;
+		return -errno;
+	}
+	for (uint64_t i = 0; i < prev_cap; ++i) {
+		if (prev[i].nlbas) {
+			*_zlog_index_slot(log, prev[i].key) = prev[i];
+		}
+	}
+	free(prev);
+
+	return 0;
+}
+
+/**
+ * Remove the given entry, shifting back the entries following it in its probe-sequence
+ */
+static void
+_zlog_index_del(struct xnvme_znd_log *log, struct _zlog_entry *entry)
+{
+	const uint64_t mask = log->index_cap - 1;
+	uint64_t hole = entry - log->index;
+
+	for (uint64_t pos = (hole + 1) & mask; log->index[pos].nlbas; pos = (pos + 1) & mask) {
+		uint64_t home = _zlog_hash(log->index[pos].key) & mask;
+
+		// Move the entry into the hole, unless its home is cyclically within (hole, pos]
+		if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+			log->index[hole] = log->index[pos];
+			hole = pos;
+		}
+	}
+	memset(&log->index[hole], 0, sizeof(*log->index));
+	log->index_len -= 1;
+}
+
+/**
+ * Index the record, unless the key has a later record; the zones account for live LBAs
+ */
+static int
+_zlog_index_put(struct xnvme_znd_log *log, uint64_t key, uint64_t seq, uint64_t lba,
+		uint16_t nlbas, uint8_t tomb)
+{
+	struct _zlog_entry *entry;
+
+	if (((log->index_len + 1) * 4) > (log->index_cap * 3)) {
+		int err = _zlog_index_grow(log);
+		if (err) {
+			return err;
+		}
+	}
+
+	entry = _zlog_index_slot(log, key);
+	if (entry->nlbas) {
+		if (entry->seq >= seq) {
+			return 0;
+		}
+		_zlog_zone_of(log, entry->lba)->nlive -= entry->nlbas;
+	} else {
+		log->index_len += 1;
+	}
+
+	entry->key = key;
+	entry->seq = seq;
+	entry->lba = lba;
+	entry->tomb = tomb;
+	entry->nlbas = nlbas;
+
+	_zlog_zone_of(log, lba)->nlive += nlbas;
+
+	return 0;
+}
+
+static struct _zlog_entry *
+_zlog_index_get(struct xnvme_znd_log *log, uint64_t key)
+{
+	struct _zlog_entry *entry = _zlog_index_slot(log, key);
+
+	return entry->nlbas ? entry : NULL;
+}
+
+static void
+_zlog_free_push(struct xnvme_znd_log *log, uint64_t zidx)
+{
+	log->free[(log->free_head + log->nfree) % log->nzones] = zidx;
+	log->nfree += 1;
+	log->zones[zidx].state = ZLOG_ZONE_FREE;
+}
+
+static uint64_t
+_zlog_free_pop(struct xnvme_znd_log *log)
+{
+	uint64_t zidx;
+
+	if (!log->nfree) {
+		return ZLOG_NONE;
+	}
+	zidx = log->free[log->free_head];
+	log->free_head = (log->free_head + 1) % log->nzones;
+	log->nfree -= 1;
+
+	log->zones[zidx].state = ZLOG_ZONE_ACTIVE;
+
+	return zidx;
+}
+
+/**
+ * Finish the sealed zones, which are not full, once their appends have completed; thus, releasing
+ * their active and open resources
+ */
+static int
+_zlog_finish_drained(struct xnvme_znd_log *log)
+{
+	for (uint64_t zidx = 0; log->nfinish && (zidx < log->nzones); ++zidx) {
+		struct _zlog_zone *zone = &log->zones[zidx];
+		struct xnvme_cmd_ctx ctx;
+		int err;
+
+		if (!zone->finish || zone->ninflight) {
+			continue;
+		}
+
+		ctx = xnvme_cmd_ctx_from_dev(log->dev);
+		err = xnvme_znd_mgmt_send(&ctx, log->nsid, zone->zslba, false,
+					  XNVME_SPEC_ZND_CMD_MGMT_SEND_FINISH, 0, NULL);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			XNVME_DEBUG("FAILED: xnvme_znd_mgmt_send(FINISH), err: %d", err);
+			return err ? err : -EIO;
+		}
+		zone->finish = 0;
+		log->nfinish -= 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Seal the given zone, it is finished once drained, unless it is full
+ */
+static void
+_zlog_zone_seal(struct xnvme_znd_log *log, struct _zlog_zone *zone)
+{
+	zone->state = ZLOG_ZONE_SEALED;
+	if ((zone->nused > 0) && (zone->nused < zone->zcap)) {
+		zone->finish = 1;
+		log->nfinish += 1;
+	}
+}
+
+/**
+ * Find an active zone with room for 'nlbas', starting from the cursor; zones without room are
+ * sealed and replaced by empty zones
+ */
+static int
+_zlog_zone_get(struct xnvme_znd_log *log, uint64_t nlbas, uint64_t *zidx)
+{
+	int err;
+
+	err = _zlog_finish_drained(log);
+	if (err) {
+		return err;
+	}
+
+	for (uint32_t i = 0; i < log->opts.nactive; ++i) {
+		uint32_t aidx = (log->cursor + i) % log->opts.nactive;
+		struct _zlog_zone *zone;
+
+		if (log->active[aidx] == ZLOG_NONE) {
+			log->active[aidx] = _zlog_free_pop(log);
+		}
+		if (log->active[aidx] == ZLOG_NONE) {
+			continue;
+		}
+
+		zone = &log->zones[log->active[aidx]];
+		if ((zone->nused + nlbas) > zone->zcap) {
+			_zlog_zone_seal(log, zone);
+
+			log->active[aidx] = _zlog_free_pop(log);
+			if (log->active[aidx] == ZLOG_NONE) {
+				continue;
+			}
+			zone = &log->zones[log->active[aidx]];
+		}
+
+		log->cursor = (aidx + 1) % log->opts.nactive;
+		*zidx = log->active[aidx];
+		return 0;
+	}
+
+	XNVME_DEBUG("FAILED: no zone with room for nlbas: %" PRIu64, nlbas);
+	return -ENOSPC;
+}
+
+/**
+ * Account for the completion of the append in the given slot and return the slot to the
+ * free-list
+ */
+static void
+_zlog_append_cpl(struct _zlog_slot *slot, struct xnvme_cmd_ctx *ctx)
+{
+	struct xnvme_znd_log *log = slot->log;
+	struct _zlog_zone *zone = &log->zones[slot->zidx];
+
+	zone->ninflight -= 1;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		XNVME_DEBUG("FAILED: append, zslba: 0x%" PRIx64 ", sc: 0x%x", zone->zslba,
+			    ctx->cpl.status.sc);
+		log->err = log->err ? log->err : -EIO;
+	} else {
+		int err = _zlog_index_put(log, slot->key, slot->seq, ctx->cpl.result, slot->nlbas,
+					  slot->tomb);
+		if (err) {
+			log->err = log->err ? log->err : err;
+		}
+	}
+
+	slot->busy = 0;
+	slot->next = log->slots_free;
+	log->slots_free = slot;
+}
+
+static void
+_zlog_append_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	_zlog_append_cpl(cb_arg, ctx);
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+static int
+_zlog_append_submit(struct xnvme_znd_log *log, struct _zlog_slot *slot)
+{
+	const uint64_t zslba = log->zones[slot->zidx].zslba;
+	struct xnvme_cmd_ctx *ctx;
+	int err;
+
+	if (!log->sync) {
+		ctx = xnvme_queue_get_cmd_ctx(log->queue);
+		xnvme_cmd_ctx_set_cb(ctx, _zlog_append_cb, slot);
+
+		err = xnvme_znd_append(ctx, log->nsid, zslba, slot->nlbas - 1, slot->buf, NULL);
+		if (!err) {
+			return 0;
+		}
+		xnvme_queue_put_cmd_ctx(log->queue, ctx);
+		if (err != -ENOSYS) {
+			XNVME_DEBUG("FAILED: xnvme_znd_append(), err: %d", err);
+			return err;
+		}
+
+		XNVME_DEBUG("INFO: async. append is not supported; using sync.");
+		log->sync = 1;
+	}
+
+	{
+		struct xnvme_cmd_ctx sctx = xnvme_cmd_ctx_from_dev(log->dev);
+
+		err = xnvme_znd_append(&sctx, log->nsid, zslba, slot->nlbas - 1, slot->buf, NULL);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_znd_append(), err: %d", err);
+			return err;
+		}
+		_zlog_append_cpl(slot, &sctx);
+	}
+
+	return 0;
+}
+
+static int
+_zlog_append(struct xnvme_znd_log *log, uint64_t key, const void *buf, uint32_t nbytes,
+	     uint8_t tomb)
+{
+	const uint64_t nlbas = (sizeof(struct _zlog_hdr) + nbytes + log->lba_nbytes - 1) /
+			       log->lba_nbytes;
+	struct _zlog_slot *slot;
+	struct _zlog_hdr *hdr;
+	struct _zlog_zone *zone;
+	uint64_t zidx;
+	int err;
+
+	if (log->err) {
+		return log->err;
+	}
+	if (nbytes > xnvme_znd_log_get_nbytes_max(log)) {
+		XNVME_DEBUG("FAILED: nbytes: %u > max: %u", nbytes,
+			    xnvme_znd_log_get_nbytes_max(log));
+		return -EINVAL;
+	}
+
+	while (!log->slots_free) {
+		err = xnvme_queue_poke(log->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	err = _zlog_zone_get(log, nlbas, &zidx);
+	if (err) {
+		return err;
+	}
+	zone = &log->zones[zidx];
+
+	slot = log->slots_free;
+	log->slots_free = slot->next;
+
+	slot->zidx = zidx;
+	slot->key = key;
+	slot->seq = log->seq++;
+	slot->nlbas = nlbas;
+	slot->tomb = tomb;
+	slot->busy = 1;
+
+	hdr = slot->buf;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = ZLOG_MAGIC;
+	hdr->key = key;
+	hdr->seq = slot->seq;
+	hdr->nbytes = nbytes;
+	hdr->nlbas = nlbas;
+	hdr->flags = tomb ? ZLOG_TOMB : 0;
+	if (nbytes) {
+		memcpy(hdr + 1, buf, nbytes);
+	}
+	memset((uint8_t *)(hdr + 1) + nbytes, 0, nlbas * log->lba_nbytes - sizeof(*hdr) - nbytes);
+	hdr->crc = _zlog_rec_crc(log, hdr);
+
+	zone->nused += nlbas;
+	zone->ninflight += 1;
+	zone->seq_min = XNVME_MIN_U64(zone->seq_min, slot->seq);
+	if (zone->nused == zone->zcap) {
+		zone->state = ZLOG_ZONE_SEALED;
+		log->active[(log->cursor + log->opts.nactive - 1) % log->opts.nactive] = ZLOG_NONE;
+	}
+
+	err = _zlog_append_submit(log, slot);
+	if (err) {
+		zone->ninflight -= 1;
+		slot->busy = 0;
+		slot->next = log->slots_free;
+		log->slots_free = slot;
+		log->err = log->err ? log->err : err;
+		return err;
+	}
+
+	return 0;
+}
+
+int
+xnvme_znd_log_append(struct xnvme_znd_log *log, uint64_t key, const void *buf, uint32_t nbytes)
+{
+	if (log->opts.reclaim && !log->reclaiming && (log->nfree < log->opts.reclaim_nfree)) {
+		int err;
+
+		log->reclaiming = 1;
+		err = log->opts.reclaim(log, log->opts.reclaim_arg);
+		log->reclaiming = 0;
+		if (err) {
+			XNVME_DEBUG("FAILED: reclaim(), err: %d", err);
+			return err;
+		}
+	}
+
+	return _zlog_append(log, key, buf, nbytes, 0);
+}
+
+int
+xnvme_znd_log_delete(struct xnvme_znd_log *log, uint64_t key)
+{
+	return _zlog_append(log, key, NULL, 0, 1);
+}
+
+int
+xnvme_znd_log_drain(struct xnvme_znd_log *log)
+{
+	for (;;) {
+		uint32_t nbusy = 0;
+		int err;
+
+		for (uint32_t i = 0; i < log->opts.depth; ++i) {
+			nbusy += log->slots[i].busy;
+		}
+		if (!nbusy) {
+			break;
+		}
+
+		err = xnvme_queue_poke(log->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	if (!log->err) {
+		log->err = _zlog_finish_drained(log);
+	}
+
+	return log->err;
+}
+
+int
+xnvme_znd_log_lookup(struct xnvme_znd_log *log, uint64_t key, uint64_t *lba, uint32_t *nlbas)
+{
+	struct _zlog_entry *entry = _zlog_index_get(log, key);
+
+	if (!entry || entry->tomb) {
+		return -ENOENT;
+	}
+	if (lba) {
+		*lba = entry->lba;
+	}
+	if (nlbas) {
+		*nlbas = entry->nlbas;
+	}
+
+	return 0;
+}
+
+/**
+ * Read 'nlbas' from 'lba' into 'buf' via the synchronous interface
+ */
+static int
+_zlog_read_sync(struct xnvme_znd_log *log, uint64_t lba, uint64_t nlbas, void *buf)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(log->dev);
+	int err;
+
+	err = xnvme_nvm_read(&ctx, log->nsid, lba, nlbas - 1, buf, NULL);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		XNVME_DEBUG("FAILED: xnvme_nvm_read(), err: %d", err);
+		return err ? err : -EIO;
+	}
+
+	return 0;
+}
+
+int
+xnvme_znd_log_read(struct xnvme_znd_log *log, uint64_t key, void *buf, uint32_t buf_nbytes,
+		   uint32_t *nbytes)
+{
+	struct _zlog_hdr *hdr = NULL;
+	uint64_t lba;
+	uint32_t nlbas;
+	int err;
+
+	err = xnvme_znd_log_lookup(log, key, &lba, &nlbas);
+	if (err) {
+		return err;
+	}
+
+	hdr = xnvme_buf_alloc(log->dev, (size_t)nlbas * log->lba_nbytes);
+	if (!hdr) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc(), errno: %d", errno);
+		return -errno;
+	}
+
+	err = _zlog_read_sync(log, lba, nlbas, hdr);
+	if (err) {
+		goto exit;
+	}
+	if ((_zlog_rec_check(log, hdr, lba, nlbas, lba + nlbas) != 1) || (hdr->key != key)) {
+		XNVME_DEBUG("FAILED: record is not intact, lba: 0x%" PRIx64, lba);
+		err = -EIO;
+		goto exit;
+	}
+
+	memcpy(buf, hdr + 1, XNVME_MIN_U64(buf_nbytes, hdr->nbytes));
+	if (nbytes) {
+		*nbytes = hdr->nbytes;
+	}
+
+exit:
+	xnvme_buf_free(log->dev, hdr);
+
+	return err;
+}
+
+uint32_t
+xnvme_znd_log_get_nbytes_max(const struct xnvme_znd_log *log)
+{
+	return log->nlbas_max * log->lba_nbytes - sizeof(struct _zlog_hdr);
+}
+
+uint64_t
+xnvme_znd_log_get_nfree(const struct xnvme_znd_log *log)
+{
+	return log->nfree;
+}
+
+int
+xnvme_znd_log_victim(struct xnvme_znd_log *log, uint64_t *zslba, uint64_t *nlive)
+{
+	struct _zlog_zone *victim = NULL;
+
+	for (uint64_t zidx = 0; zidx < log->nzones; ++zidx) {
+		struct _zlog_zone *zone = &log->zones[zidx];
+
+		if ((zone->state != ZLOG_ZONE_SEALED) || zone->ninflight) {
+			continue;
+		}
+		if (!victim || (zone->nlive < victim->nlive)) {
+			victim = zone;
+		}
+	}
+	if (!victim) {
+		return -ENOENT;
+	}
+
+	*zslba = victim->zslba;
+	if (nlive) {
+		*nlive = victim->nlive;
+	}
+
+	return 0;
+}
+
+/**
+ * Returns the lowest sequence number of the records in zones other than 'skip'
+ */
+static uint64_t
+_zlog_seq_floor(struct xnvme_znd_log *log, const struct _zlog_zone *skip)
+{
+	uint64_t floor = UINT64_MAX;
+
+	for (uint64_t zidx = 0; zidx < log->nzones; ++zidx) {
+		const struct _zlog_zone *zone = &log->zones[zidx];
+
+		if ((zone != skip) && zone->nused && (zone->state != ZLOG_ZONE_OFFLINE)) {
+			floor = XNVME_MIN_U64(floor, zone->seq_min);
+		}
+	}
+
+	return floor;
+}
+
+int
+xnvme_znd_log_reclaim(struct xnvme_znd_log *log, uint64_t zslba)
+{
+	struct _zlog_zone *zone;
+	uint64_t seq_floor, pos, elba;
+	void *buf = NULL;
+	int err;
+
+	if ((zslba < log->zones[0].zslba) || ((zslba - log->zones[0].zslba) % log->zsze) ||
+	    (_zlog_zone_of(log, zslba) >= &log->zones[log->nzones])) {
+		XNVME_DEBUG("FAILED: invalid zslba: 0x%" PRIx64, zslba);
+		return -EINVAL;
+	}
+	zone = _zlog_zone_of(log, zslba);
+
+	err = xnvme_znd_log_drain(log);
+	if (err) {
+		return err;
+	}
+	if (zone->state != ZLOG_ZONE_SEALED) {
+		XNVME_DEBUG("FAILED: zone is not sealed, state: %d", zone->state);
+		return -EINVAL;
+	}
+
+	buf = xnvme_buf_alloc(log->dev, (size_t)log->nlbas_max * log->lba_nbytes);
+	if (!buf) {
+		XNVME_DEBUG("FAILED: xnvme_buf_alloc(), errno: %d", errno);
+		return -errno;
+	}
+
+	// Re-append the records of the zone which the index refers to
+	seq_floor = _zlog_seq_floor(log, zone);
+	elba = zone->zslba + zone->nused;
+	for (pos = zone->zslba; zone->nlive && (pos < elba);) {
+		const uint64_t nlbas = XNVME_MIN_U64(log->nlbas_max, elba - pos);
+		uint64_t off = 0;
+
+		err = _zlog_read_sync(log, pos, nlbas, buf);
+		if (err) {
+			goto exit;
+		}
+
+		while (off < nlbas) {
+			struct _zlog_hdr *hdr = (void *)((uint8_t *)buf + off * log->lba_nbytes);
+			struct _zlog_entry *entry;
+			int intact;
+
+			intact = _zlog_rec_check(log, hdr, pos + off, nlbas - off, elba);
+			if (intact <= 0) {
+				break;
+			}
+
+			entry = _zlog_index_get(log, hdr->key);
+			if (entry && (entry->lba == pos + off)) {
+				if (entry->tomb && (entry->seq < seq_floor)) {
+					zone->nlive -= entry->nlbas;
+					_zlog_index_del(log, entry);
+				} else {
+					err = _zlog_append(log, hdr->key, hdr + 1, hdr->nbytes,
+							   entry->tomb);
+					if (err) {
+						goto exit;
+					}
+				}
+			}
+			off += hdr->nlbas;
+		}
+		if (!off) {
+			// The remainder of the zone is not intact, thus not indexed
+			break;
+		}
+		pos += off;
+
+		// The re-appends copy from 'buf', thus it is free to re-use
+	}
+
+	err = xnvme_znd_log_drain(log);
+	if (err) {
+		goto exit;
+	}
+	if (zone->nlive) {
+		XNVME_DEBUG("FAILED: zone has nlive: %" PRIu64 " after relocation", zone->nlive);
+		err = -EIO;
+		goto exit;
+	}
+
+	{
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(log->dev);
+
+		err = xnvme_znd_mgmt_send(&ctx, log->nsid, zone->zslba, false,
+					  XNVME_SPEC_ZND_CMD_MGMT_SEND_RESET, 0, NULL);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			XNVME_DEBUG("FAILED: xnvme_znd_mgmt_send(RESET), err: %d", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+	}
+	if (zone->finish) {
+		zone->finish = 0;
+		log->nfinish -= 1;
+	}
+	zone->nused = 0;
+	zone->seq_min = UINT64_MAX;
+	zone->torn = 0;
+	_zlog_free_push(log, zone - log->zones);
+
+exit:
+	xnvme_buf_free(log->dev, buf);
+
+	return err;
+}
+
+int
+xnvme_znd_log_close(struct xnvme_znd_log *log)
+{
+	int err = 0;
+
+	if (!log) {
+		return 0;
+	}
+
+	if (log->queue) {
+		err = xnvme_znd_log_drain(log);
+		xnvme_queue_term(log->queue);
+	}
+	for (uint32_t i = 0; log->slots && (i < log->opts.depth); ++i) {
+		xnvme_buf_free(log->dev, log->slots[i].buf);
+	}
+	free(log->slots);
+	free(log->index);
+	free(log->active);
+	free(log->free);
+	free(log->zones);
+	free(log);
+
+	return err;
+}
+
+/**
+ * Index the intact records in the LBAs read into the given slot, and advance the scan of the zone
+ */
+static void
+_zlog_scan_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct _zlog_slot *slot = cb_arg;
+	struct xnvme_znd_log *log = slot->log;
+	struct _zlog_zone *zone = &log->zones[slot->zidx];
+	const uint64_t elba = zone->zslba + zone->nused;
+	uint64_t off = 0;
+
+	slot->busy = 0;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		XNVME_DEBUG("FAILED: read, lba: 0x%" PRIx64 ", sc: 0x%x", slot->lba,
+			    ctx->cpl.status.sc);
+		log->err = log->err ? log->err : -EIO;
+		goto exit;
+	}
+
+	while (off < slot->nlbas) {
+		struct _zlog_hdr *hdr = (void *)((uint8_t *)slot->buf + off * log->lba_nbytes);
+		int intact, err;
+
+		intact = _zlog_rec_check(log, hdr, slot->lba + off, slot->nlbas - off, elba);
+		if (intact < 0) {
+			XNVME_DEBUG("INFO: torn, lba: 0x%" PRIx64, slot->lba + off);
+			zone->torn = 1;
+			break;
+		}
+		if (!intact) {
+			break;
+		}
+
+		err = _zlog_index_put(log, hdr->key, hdr->seq, slot->lba + off, hdr->nlbas,
+				      hdr->flags & ZLOG_TOMB);
+		if (err) {
+			log->err = log->err ? log->err : err;
+			break;
+		}
+		zone->seq_min = XNVME_MIN_U64(zone->seq_min, hdr->seq);
+		log->seq = (hdr->seq >= log->seq) ? hdr->seq + 1 : log->seq;
+
+		off += hdr->nlbas;
+	}
+	zone->scan = slot->lba + off;
+
+exit:
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+static int
+_zlog_scan_submit(struct xnvme_znd_log *log, struct _zlog_slot *slot)
+{
+	struct _zlog_zone *zone = &log->zones[slot->zidx];
+	struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(log->queue);
+	int err;
+
+	slot->lba = zone->scan;
+	slot->nlbas = XNVME_MIN_U64(log->nlbas_max, zone->zslba + zone->nused - zone->scan);
+	slot->busy = 1;
+
+	xnvme_cmd_ctx_set_cb(ctx, _zlog_scan_cb, slot);
+
+	err = xnvme_nvm_read(ctx, log->nsid, slot->lba, slot->nlbas - 1, slot->buf, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_nvm_read(), err: %d", err);
+		slot->busy = 0;
+		xnvme_queue_put_cmd_ctx(log->queue, ctx);
+	}
+
+	return err;
+}
+
+/**
+ * Build the index by scanning the written zones, with a read in flight per slot; each slot scans
+ * one zone, from start to the first record which is not intact, or the write pointer
+ */
+static int
+_zlog_recover(struct xnvme_znd_log *log)
+{
+	uint64_t zidx_next = 0;
+	int err = 0;
+
+	for (uint32_t i = 0; i < log->opts.depth; ++i) {
+		log->slots[i].zidx = ZLOG_NONE;
+	}
+
+	for (;;) {
+		uint32_t nbusy = 0;
+
+		for (uint32_t i = 0; (i < log->opts.depth) && !log->err; ++i) {
+			struct _zlog_slot *slot = &log->slots[i];
+			struct _zlog_zone *zone;
+
+			if (slot->busy) {
+				nbusy += 1;
+				continue;
+			}
+
+			// Continue the zone of the slot, or take the next zone to scan
+			zone = (slot->zidx != ZLOG_NONE) ? &log->zones[slot->zidx] : NULL;
+			if (!zone || zone->torn || (zone->scan == zone->zslba + zone->nused)) {
+				slot->zidx = ZLOG_NONE;
+
+				for (; zidx_next < log->nzones; ++zidx_next) {
+					zone = &log->zones[zidx_next];
+
+					if ((zone->state != ZLOG_ZONE_OFFLINE) && zone->nused) {
+						slot->zidx = zidx_next++;
+						break;
+					}
+				}
+				if (slot->zidx == ZLOG_NONE) {
+					continue;
+				}
+			}
+
+			err = _zlog_scan_submit(log, slot);
+			if (err) {
+				return err;
+			}
+			nbusy += 1;
+		}
+		if (!nbusy || log->err) {
+			break;
+		}
+
+		err = xnvme_queue_poke(log->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	xnvme_queue_drain(log->queue);
+
+	return log->err;
+}
+
+/**
+ * Setup the zones of the log from a report, empty zones are free, and the other writable zones
+ * are scanned
+ */
+static int
+_zlog_zones_from_dev(struct xnvme_znd_log *log)
+{
+	struct xnvme_znd_report *report;
+
+	report = xnvme_znd_report_from_dev(log->dev, log->opts.slba, log->opts.nzones, 0);
+	if (!report) {
+		XNVME_DEBUG("FAILED: xnvme_znd_report_from_dev(), errno: %d", errno);
+		return -errno;
+	}
+
+	log->nzones = report->nentries;
+	log->zones = calloc(log->nzones, sizeof(*log->zones));
+	log->free = calloc(log->nzones, sizeof(*log->free));
+	if (!log->nzones || !log->zones || !log->free) {
+		XNVME_DEBUG("FAILED: calloc(), nzones: %" PRIu64, log->nzones);
+		xnvme_buf_virt_free(report);
+		return log->nzones ? -ENOMEM : -EINVAL;
+	}
+
+	for (uint64_t zidx = 0; zidx < log->nzones; ++zidx) {
+		struct xnvme_spec_znd_descr *zdescr = XNVME_ZND_REPORT_DESCR(report, zidx);
+		struct _zlog_zone *zone = &log->zones[zidx];
+
+		zone->zslba = zdescr->zslba;
+		zone->zcap = zdescr->zcap;
+		zone->seq_min = UINT64_MAX;
+		zone->state = ZLOG_ZONE_OFFLINE;
+
+		if ((zdescr->zt != XNVME_SPEC_ZND_TYPE_SEQWR) || !zdescr->zcap) {
+			continue;
+		}
+
+		switch (zdescr->zs) {
+		case XNVME_SPEC_ZND_STATE_EMPTY:
+			_zlog_free_push(log, zidx);
+			break;
+
+		case XNVME_SPEC_ZND_STATE_FULL:
+			zone->nused = zdescr->zcap;
+			zone->state = ZLOG_ZONE_SEALED;
+			break;
+
+		case XNVME_SPEC_ZND_STATE_IOPEN:
+		case XNVME_SPEC_ZND_STATE_EOPEN:
+		case XNVME_SPEC_ZND_STATE_CLOSED:
+			zone->nused = zdescr->wp - zdescr->zslba;
+			zone->state = ZLOG_ZONE_SEALED;
+			break;
+
+		default:
+			break;
+		}
+		zone->scan = zone->zslba;
+	}
+	xnvme_buf_virt_free(report);
+
+	return 0;
+}
+
+/**
+ * Assign the partially written, and intact, zones to the append front, the others are finished
+ */
+static void
+_zlog_active_from_recovery(struct xnvme_znd_log *log)
+{
+	uint32_t aidx = 0;
+
+	for (uint32_t i = 0; i < log->opts.nactive; ++i) {
+		log->active[i] = ZLOG_NONE;
+	}
+
+	for (uint64_t zidx = 0; zidx < log->nzones; ++zidx) {
+		struct _zlog_zone *zone = &log->zones[zidx];
+
+		if ((zone->state != ZLOG_ZONE_SEALED) || (zone->nused == zone->zcap)) {
+			continue;
+		}
+		if (!zone->torn && (aidx < log->opts.nactive)) {
+			zone->state = ZLOG_ZONE_ACTIVE;
+			log->active[aidx++] = zidx;
+			continue;
+		}
+		_zlog_zone_seal(log, zone);
+	}
+}
+
+int
+xnvme_znd_log_open(struct xnvme_dev *dev, const struct xnvme_znd_log_opts *opts,
+		   struct xnvme_znd_log **log)
+{
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	struct xnvme_spec_znd_idfy_ctrlr *zctrlr;
+	struct xnvme_spec_znd_idfy_ns *zns;
+	struct xnvme_znd_log *l;
+	uint64_t nbytes_max = geo->mdts_nbytes;
+	int err;
+
+	if ((geo->type != XNVME_GEO_ZONED) || !opts->nactive || !xnvme_is_pow2(opts->depth) ||
+	    (opts->depth >= 4096)) {
+		XNVME_DEBUG("FAILED: geo.type: %d, nactive: %u, depth: %u", geo->type,
+			    opts->nactive, opts->depth);
+		return -EINVAL;
+	}
+	zctrlr = (void *)xnvme_dev_get_ctrlr_css(dev);
+	zns = (void *)xnvme_dev_get_ns_css(dev);
+	if (!zctrlr || !zns) {
+		XNVME_DEBUG("FAILED: xnvme_dev_get_{ctrlr,ns}_css(), errno: %d", errno);
+		return -errno;
+	}
+
+	l = calloc(1, sizeof(*l));
+	if (!l) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	l->dev = dev;
+	l->opts = *opts;
+	l->nsid = xnvme_dev_get_nsid(dev);
+	l->lba_nbytes = geo->lba_nbytes;
+	l->zsze = geo->nsect;
+	_zlog_crc_init(l);
+
+	// Respect the open and active resource limits; these are zero-based
+	if (zns->mor != 0xFFFFFFFF) {
+		l->opts.nactive = XNVME_MIN(l->opts.nactive, zns->mor + 1);
+	}
+	if (zns->mar != 0xFFFFFFFF) {
+		l->opts.nactive = XNVME_MIN(l->opts.nactive, zns->mar + 1);
+	}
+
+	// A record is appended by a single command; bounded by the zone append size limit, in
+	// units of the minimum memory page size, assumed to be 4K
+	if (zctrlr->zasl) {
+		nbytes_max = XNVME_MIN_U64(nbytes_max, (1ULL << zctrlr->zasl) * 4096);
+	}
+	l->nlbas_max = XNVME_MIN_U64(nbytes_max / geo->lba_nbytes, UINT16_MAX);
+
+	err = _zlog_zones_from_dev(l);
+	if (err) {
+		XNVME_DEBUG("FAILED: _zlog_zones_from_dev(), err: %d", err);
+		xnvme_znd_log_close(l);
+		return err;
+	}
+	for (uint64_t zidx = 0; zidx < l->nzones; ++zidx) {
+		if (l->zones[zidx].state != ZLOG_ZONE_OFFLINE) {
+			l->nlbas_max = XNVME_MIN_U64(l->nlbas_max, l->zones[zidx].zcap);
+		}
+	}
+	if ((l->nlbas_max * geo->lba_nbytes) <= sizeof(struct _zlog_hdr)) {
+		XNVME_DEBUG("FAILED: nlbas_max: %u", l->nlbas_max);
+		xnvme_znd_log_close(l);
+		return -EINVAL;
+	}
+
+	l->active = calloc(l->opts.nactive, sizeof(*l->active));
+	l->slots = calloc(l->opts.depth, sizeof(*l->slots));
+	if (!l->active || !l->slots) {
+		err = -errno;
+		XNVME_DEBUG("FAILED: calloc(), err: %d", err);
+		xnvme_znd_log_close(l);
+		return err;
+	}
+	for (uint32_t i = 0; i < l->opts.depth; ++i) {
+		struct _zlog_slot *slot = &l->slots[i];
+
+		slot->log = l;
+		slot->buf = xnvme_buf_alloc(dev, (size_t)l->nlbas_max * geo->lba_nbytes);
+		if (!slot->buf) {
+			err = -errno;
+			XNVME_DEBUG("FAILED: xnvme_buf_alloc(), err: %d", err);
+			xnvme_znd_log_close(l);
+			return err;
+		}
+		slot->next = l->slots_free;
+		l->slots_free = slot;
+	}
+
+	err = _zlog_index_grow(l);
+	if (err) {
+		xnvme_znd_log_close(l);
+		return err;
+	}
+
+	err = xnvme_queue_init(dev, l->opts.depth, 0, &l->queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_queue_init(), err: %d", err);
+		xnvme_znd_log_close(l);
+		return err;
+	}
+
+	err = _zlog_recover(l);
+	if (err) {
+		XNVME_DEBUG("FAILED: _zlog_recover(), err: %d", err);
+		xnvme_znd_log_close(l);
+		return err;
+	}
+	_zlog_active_from_recovery(l);
+
+	XNVME_DEBUG("INFO: nzones: %" PRIu64 ", nfree: %" PRIu64 ", nkeys: %" PRIu64
+		    ", seq: %" PRIu64,
+		    l->nzones, l->nfree, l->index_len, l->seq);
+
+	*log = l;
+
+	return 0;
+}
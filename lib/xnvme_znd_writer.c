@@ -0,0 +1,680 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <libxnvme.h>
+#include <libxnvme_nvm.h>
+#include <libxnvme_znd.h>
+#include <xnvme_dev.h>
+
+enum _zwr_zone_state {
+	ZWR_ZONE_UNUSED  = 0, ///< No zone is assigned to the slot
+	ZWR_ZONE_ACTIVE  = 1, ///< Writes are assigned to the zone
+	ZWR_ZONE_RETIRED = 2, ///< No more writes are assigned, finish when drained
+};
+
+struct _zwr_zone;
+
+/**
+ * A write assigned to a zone; it is queued in the zone in LBA order, until it has completed
+ */
+struct _zwr_req {
+	struct xnvme_znd_writer *writer;
+	struct _zwr_zone *zone;
+	const void *dbuf;
+	uint64_t slba;
+	uint16_t nlb; ///< Zero-based number of LBAs
+	uint8_t done; ///< Whether the write has completed
+	xnvme_queue_cb cb;
+	void *cb_arg;
+	struct _zwr_req *next; ///< Next in zone, or in the free-list
+};
+
+/**
+ * A slot for an open zone; up to 'nactive' zones are written in parallel
+ */
+struct _zwr_zone {
+	struct xnvme_znd_writer *writer;
+	enum _zwr_zone_state state;
+	uint64_t zslba;
+	uint64_t zelba;     ///< The first LBA beyond the capacity of the zone
+	uint64_t wp;        ///< Next LBA to assign
+	uint64_t done;      ///< The writes to LBAs below this have completed
+	uint64_t flushed;   ///< With ZRWA, the LBAs below this have been committed
+	uint32_t ninflight; ///< Number of writes in flight
+	uint32_t mgmt;      ///< Whether a management command, or ZRWA flush, is in flight
+	uint32_t opened;    ///< With ZRWA, whether the explicit open has completed
+	struct _zwr_req *head; ///< Oldest write, not yet completed, of the zone
+	struct _zwr_req *tail; ///< Latest write assigned to the zone
+	struct _zwr_req *next; ///< Oldest write, not yet dispatched, of the zone
+};
+
+struct xnvme_znd_writer {
+	struct xnvme_dev *dev;
+	struct xnvme_queue *queue;
+	uint32_t nsid;
+	int flags;
+	uint32_t zrwas;   ///< With ZRWA, the size of the window in LBAs
+	uint32_t zrwafg;  ///< With ZRWA, the flush granularity in LBAs
+	uint64_t *empty;  ///< Start LBAs of the empty zones not yet assigned to a slot
+	uint64_t nempty;  ///< Number of entries in 'empty'
+	uint64_t iempty;  ///< Index of the next entry in 'empty' to assign
+	uint64_t zcap;    ///< Zone capacity shared by all zones in 'empty', others are skipped
+	uint32_t cursor;  ///< Slot to try first on the next write
+	uint32_t nactive; ///< Number of zone-slots
+	struct _zwr_req *free;
+	struct _zwr_req *reqs;
+	int err; ///< First error of a command
+	struct _zwr_zone zones[];
+};
+
+static void
+_zwr_progress(struct _zwr_zone *zone);
+
+static inline int
+_zwr_zrwa(const struct xnvme_znd_writer *writer)
+{
+	return writer->flags & XNVME_ZND_WRITER_ZRWA;
+}
+
+/**
+ * Assign the next empty zone, if any, to the given slot
+ */
+static void
+_zwr_zone_assign(struct _zwr_zone *zone)
+{
+	struct xnvme_znd_writer *writer = zone->writer;
+
+	if (writer->iempty >= writer->nempty) {
+		zone->state = ZWR_ZONE_UNUSED;
+		return;
+	}
+
+	zone->zslba = writer->empty[writer->iempty++];
+	zone->zelba = zone->zslba + writer->zcap;
+	zone->wp = zone->zslba;
+	zone->done = zone->zslba;
+	zone->flushed = zone->zslba;
+	zone->opened = !_zwr_zrwa(writer);
+	zone->state = ZWR_ZONE_ACTIVE;
+
+	XNVME_DEBUG("INFO: zslba: 0x%" PRIx64, zone->zslba);
+}
+
+static void
+_zwr_mgmt_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct _zwr_zone *zone = cb_arg;
+	struct xnvme_znd_writer *writer = zone->writer;
+
+	zone->mgmt = 0;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		XNVME_DEBUG("FAILED: opc: 0x%x, zslba: 0x%" PRIx64 ", sc: 0x%x",
+			    ctx->cmd.common.opcode, zone->zslba, ctx->cpl.status.sc);
+		writer->err = writer->err ? writer->err : -EIO;
+	}
+
+	switch (ctx->cmd.znd.mgmt_send.zsa) {
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN:
+		zone->opened = 1;
+		break;
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_FINISH:
+		_zwr_zone_assign(zone);
+		break;
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_FLUSH:
+		zone->flushed = ctx->cmd.znd.mgmt_send.slba + 1;
+		if ((zone->state == ZWR_ZONE_RETIRED) && (zone->flushed == zone->zelba)) {
+			_zwr_zone_assign(zone);
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+
+	_zwr_progress(zone);
+}
+
+static void
+_zwr_write_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct _zwr_req *req = cb_arg;
+	struct _zwr_zone *zone = req->zone;
+	struct xnvme_znd_writer *writer = req->writer;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		XNVME_DEBUG("FAILED: write, slba: 0x%" PRIx64 ", sc: 0x%x", req->slba,
+			    ctx->cpl.status.sc);
+		writer->err = writer->err ? writer->err : -EIO;
+	}
+	req->done = 1;
+	zone->ninflight -= 1;
+
+	if (req->cb) {
+		req->cb(ctx, req->cb_arg);
+	}
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+
+	// Advance the contiguous prefix of completed writes and recycle their requests
+	while (zone->head && zone->head->done) {
+		struct _zwr_req *done = zone->head;
+
+		zone->done = done->slba + done->nlb + 1;
+		zone->head = done->next;
+		if (!zone->head) {
+			zone->tail = NULL;
+		}
+		done->next = writer->free;
+		writer->free = done;
+	}
+
+	if ((zone->state == ZWR_ZONE_RETIRED) && !zone->head && !_zwr_zrwa(writer) &&
+	    (zone->done == zone->zelba)) {
+		_zwr_zone_assign(zone);
+	}
+
+	_zwr_progress(zone);
+}
+
+static int
+_zwr_mgmt_submit(struct _zwr_zone *zone, enum xnvme_spec_znd_cmd_mgmt_send_action action)
+{
+	struct xnvme_znd_writer *writer = zone->writer;
+	struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(writer->queue);
+	int err;
+
+	xnvme_cmd_ctx_set_cb(ctx, _zwr_mgmt_cb, zone);
+
+	zone->mgmt = 1;
+	err = xnvme_znd_mgmt_send(ctx, writer->nsid, zone->zslba, false, action,
+				  (action == XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN)
+					  ? XNVME_SPEC_ZND_MGMT_OPEN_WITH_ZRWA
+					  : 0,
+				  NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_znd_mgmt_send(), err: %d", err);
+		zone->mgmt = 0;
+		xnvme_queue_put_cmd_ctx(writer->queue, ctx);
+	}
+
+	return err;
+}
+
+static int
+_zwr_flush_submit(struct _zwr_zone *zone, uint64_t lba)
+{
+	struct xnvme_znd_writer *writer = zone->writer;
+	struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(writer->queue);
+	int err;
+
+	xnvme_cmd_ctx_set_cb(ctx, _zwr_mgmt_cb, zone);
+
+	zone->mgmt = 1;
+	err = xnvme_znd_zrwa_flush(ctx, writer->nsid, lba);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_znd_zrwa_flush(), err: %d", err);
+		zone->mgmt = 0;
+		xnvme_queue_put_cmd_ctx(writer->queue, ctx);
+	}
+
+	return err;
+}
+
+/**
+ * Fail the writes of the zone which are not dispatched, invoking their callbacks with 'err' as a
+ * vendor status, and retire the slot; the writes in flight complete as usual
+ */
+static void
+_zwr_zone_fail(struct _zwr_zone *zone, int err)
+{
+	struct xnvme_znd_writer *writer = zone->writer;
+	struct _zwr_req *req = zone->next;
+
+	if (zone->head == zone->next) {
+		zone->head = NULL;
+		zone->tail = NULL;
+	} else {
+		struct _zwr_req *prev = zone->head;
+
+		while (prev->next != zone->next) {
+			prev = prev->next;
+		}
+		prev->next = NULL;
+		zone->tail = prev;
+	}
+	zone->next = NULL;
+	zone->state = ZWR_ZONE_UNUSED;
+
+	while (req) {
+		struct _zwr_req *next = req->next;
+
+		if (req->cb) {
+			struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(writer->dev);
+
+			ctx.async.queue = writer->queue;
+			ctx.cmd.common.opcode = XNVME_SPEC_NVM_OPC_WRITE;
+			ctx.cmd.common.nsid = writer->nsid;
+			ctx.cmd.nvm.slba = req->slba;
+			ctx.cmd.nvm.nlb = req->nlb;
+			ctx.cpl.status.sc = -err;
+			ctx.cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+
+			req->cb(&ctx, req->cb_arg);
+		}
+		req->next = writer->free;
+		writer->free = req;
+		req = next;
+	}
+}
+
+/**
+ * Dispatch the writes of the zone which are allowed in flight; without ZRWA, then only one, with
+ * ZRWA, then those within the window. Followed by the ZRWA flush, or finish, of the zone.
+ */
+static void
+_zwr_progress(struct _zwr_zone *zone)
+{
+	struct xnvme_znd_writer *writer = zone->writer;
+	const int zrwa = _zwr_zrwa(writer);
+	int err = 0;
+
+	if (zone->state == ZWR_ZONE_UNUSED) {
+		return;
+	}
+	if (!zone->opened) {
+		if (!zone->mgmt && zone->head) {
+			err = _zwr_mgmt_submit(zone, XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN);
+		}
+		goto exit;
+	}
+
+	while (zone->next) {
+		struct _zwr_req *req = zone->next;
+		struct xnvme_cmd_ctx *ctx;
+
+		if (!zrwa && zone->ninflight) {
+			break;
+		}
+		if (zrwa && ((req->slba + req->nlb + 1) > (zone->flushed + writer->zrwas))) {
+			break;
+		}
+
+		ctx = xnvme_queue_get_cmd_ctx(writer->queue);
+		xnvme_cmd_ctx_set_cb(ctx, _zwr_write_cb, req);
+
+		err = xnvme_nvm_write(ctx, writer->nsid, req->slba, req->nlb, req->dbuf, NULL);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_nvm_write(), err: %d", err);
+			xnvme_queue_put_cmd_ctx(writer->queue, ctx);
+			goto exit;
+		}
+		zone->ninflight += 1;
+		zone->next = req->next;
+	}
+
+	if (zone->mgmt) {
+		return;
+	}
+
+	if (zrwa && (zone->done > zone->flushed)) {
+		uint64_t ncommit = zone->done - zone->zslba;
+
+		// Commit in units of the flush granularity, the remainder once the zone is full
+		if (zone->done != zone->zelba) {
+			ncommit -= ncommit % writer->zrwafg;
+		}
+		if ((zone->zslba + ncommit) > zone->flushed) {
+			err = _zwr_flush_submit(zone, zone->zslba + ncommit - 1);
+			goto exit;
+		}
+	}
+
+	if ((zone->state == ZWR_ZONE_RETIRED) && !zone->head && (zone->done < zone->zelba)) {
+		err = _zwr_mgmt_submit(zone, XNVME_SPEC_ZND_CMD_MGMT_SEND_FINISH);
+	}
+
+exit:
+	if (err) {
+		writer->err = writer->err ? writer->err : err;
+		_zwr_zone_fail(zone, err);
+	}
+}
+
+/**
+ * Wait for a write-request to become available, unless a command has failed and nothing remains
+ * in flight to free one
+ */
+static int
+_zwr_req_get(struct xnvme_znd_writer *writer, struct _zwr_req **req)
+{
+	while (!writer->free) {
+		int err;
+
+		if (writer->err && !xnvme_queue_get_outstanding(writer->queue)) {
+			return writer->err;
+		}
+
+		err = xnvme_queue_poke(writer->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+	*req = writer->free;
+	writer->free = (*req)->next;
+
+	return 0;
+}
+
+/**
+ * Find a slot with room for 'nlbas' in its zone, starting from the cursor; zones without room are
+ * retired, and their slots re-assigned, once drained, to the next empty zone
+ */
+static int
+_zwr_zone_get(struct xnvme_znd_writer *writer, uint64_t nlbas, struct _zwr_zone **zone)
+{
+	for (;;) {
+		uint32_t nbusy = 0;
+		int err;
+
+		for (uint32_t i = 0; i < writer->nactive; ++i) {
+			struct _zwr_zone *cand = &writer->zones[(writer->cursor + i) % writer->nactive];
+
+			switch (cand->state) {
+			case ZWR_ZONE_UNUSED:
+				continue;
+
+			case ZWR_ZONE_RETIRED:
+				nbusy += 1;
+				continue;
+
+			case ZWR_ZONE_ACTIVE:
+				break;
+			}
+
+			if ((cand->wp + nlbas) > cand->zelba) {
+				cand->state = ZWR_ZONE_RETIRED;
+				_zwr_progress(cand);
+				nbusy += 1;
+				continue;
+			}
+
+			writer->cursor = (writer->cursor + i + 1) % writer->nactive;
+			*zone = cand;
+			return 0;
+		}
+		if (!nbusy) {
+			XNVME_DEBUG("FAILED: no zone with room for nlbas: %" PRIu64, nlbas);
+			return -ENOSPC;
+		}
+
+		// Wait for a retired zone to drain and its slot to be re-assigned
+		err = xnvme_queue_poke(writer->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+		if (writer->err) {
+			return writer->err;
+		}
+	}
+}
+
+int
+xnvme_znd_writer_write(struct xnvme_znd_writer *writer, const void *dbuf, uint16_t nlb,
+		       uint64_t *slba, xnvme_queue_cb cb, void *cb_arg)
+{
+	const uint64_t nlbas = (uint64_t)nlb + 1;
+	struct _zwr_zone *zone = NULL;
+	struct _zwr_req *req = NULL;
+	int err;
+
+	if (writer->err) {
+		return writer->err;
+	}
+	if ((nlbas > writer->zcap) || (_zwr_zrwa(writer) && (nlbas > writer->zrwas))) {
+		XNVME_DEBUG("FAILED: nlbas: %" PRIu64 ", zcap: %" PRIu64 ", zrwas: %u", nlbas,
+			    writer->zcap, writer->zrwas);
+		return -EINVAL;
+	}
+
+	err = _zwr_req_get(writer, &req);
+	if (err) {
+		return err;
+	}
+	err = _zwr_zone_get(writer, nlbas, &zone);
+	if (err) {
+		req->next = writer->free;
+		writer->free = req;
+		return err;
+	}
+
+	req->writer = writer;
+	req->zone = zone;
+	req->dbuf = dbuf;
+	req->slba = zone->wp;
+	req->nlb = nlb;
+	req->done = 0;
+	req->cb = cb;
+	req->cb_arg = cb_arg;
+	req->next = NULL;
+
+	zone->wp += nlbas;
+	if (zone->tail) {
+		zone->tail->next = req;
+	} else {
+		zone->head = req;
+	}
+	zone->tail = req;
+	if (!zone->next) {
+		zone->next = req;
+	}
+	if (zone->wp == zone->zelba) {
+		zone->state = ZWR_ZONE_RETIRED;
+	}
+
+	if (slba) {
+		*slba = req->slba;
+	}
+
+	_zwr_progress(zone);
+
+	return writer->err;
+}
+
+int
+xnvme_znd_writer_poke(struct xnvme_znd_writer *writer)
+{
+	int err;
+
+	err = xnvme_queue_poke(writer->queue, 0);
+	if (err < 0) {
+		XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+		return err;
+	}
+
+	return writer->err;
+}
+
+int
+xnvme_znd_writer_drain(struct xnvme_znd_writer *writer)
+{
+	for (;;) {
+		uint32_t nbusy = 0;
+		int err;
+
+		for (uint32_t i = 0; i < writer->nactive; ++i) {
+			struct _zwr_zone *zone = &writer->zones[i];
+
+			nbusy += zone->head || zone->mgmt;
+		}
+		if (!nbusy) {
+			break;
+		}
+		if (writer->err && !xnvme_queue_get_outstanding(writer->queue)) {
+			break;
+		}
+
+		err = xnvme_queue_poke(writer->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	return writer->err;
+}
+
+int
+xnvme_znd_writer_close(struct xnvme_znd_writer *writer)
+{
+	int err = 0;
+
+	if (!writer) {
+		return 0;
+	}
+
+	if (writer->queue) {
+		err = xnvme_znd_writer_drain(writer);
+		xnvme_queue_term(writer->queue);
+	}
+	free(writer->empty);
+	free(writer->reqs);
+	free(writer);
+
+	return err;
+}
+
+/**
+ * Collect the start LBA of the empty sequential-write-required zones in [slba, slba + nzones)
+ */
+static int
+_zwr_empty_from_dev(struct xnvme_znd_writer *writer, uint64_t slba, uint64_t nzones)
+{
+	struct xnvme_znd_report *report;
+
+	report = xnvme_znd_report_from_dev(writer->dev, slba, nzones, 0);
+	if (!report) {
+		XNVME_DEBUG("FAILED: xnvme_znd_report_from_dev(), errno: %d", errno);
+		return -errno;
+	}
+
+	writer->empty = calloc(report->nentries, sizeof(*writer->empty));
+	if (!writer->empty) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		xnvme_buf_virt_free(report);
+		return -errno;
+	}
+
+	for (uint64_t idx = 0; idx < report->nentries; ++idx) {
+		struct xnvme_spec_znd_descr *zdescr = XNVME_ZND_REPORT_DESCR(report, idx);
+
+		if ((zdescr->zs != XNVME_SPEC_ZND_STATE_EMPTY) ||
+		    (zdescr->zt != XNVME_SPEC_ZND_TYPE_SEQWR) || !zdescr->zcap) {
+			continue;
+		}
+		// Zones are assumed to share the capacity of the first, as assumed by the geometry
+		if (!writer->zcap) {
+			writer->zcap = zdescr->zcap;
+		}
+		if (zdescr->zcap != writer->zcap) {
+			continue;
+		}
+		writer->empty[writer->nempty++] = zdescr->zslba;
+	}
+	xnvme_buf_virt_free(report);
+
+	XNVME_DEBUG("INFO: nempty: %" PRIu64 ", zcap: %" PRIu64, writer->nempty, writer->zcap);
+
+	return writer->nempty ? 0 : -ENOSPC;
+}
+
+int
+xnvme_znd_writer_open(struct xnvme_dev *dev, uint64_t slba, uint64_t nzones, uint32_t nactive,
+		      uint32_t depth, int flags, struct xnvme_znd_writer **writer)
+{
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	struct xnvme_spec_znd_idfy_ns *zns;
+	struct xnvme_znd_writer *w;
+	int err;
+
+	if ((geo->type != XNVME_GEO_ZONED) || !nactive || !xnvme_is_pow2(depth) ||
+	    (depth >= 2048)) {
+		XNVME_DEBUG("FAILED: geo.type: %d, nactive: %u, depth: %u", geo->type, nactive,
+			    depth);
+		return -EINVAL;
+	}
+	zns = (void *)xnvme_dev_get_ns_css(dev);
+	if (!zns) {
+		XNVME_DEBUG("FAILED: xnvme_dev_get_ns_css(), errno: %d", errno);
+		return -errno;
+	}
+	if ((flags & XNVME_ZND_WRITER_ZRWA) &&
+	    (!zns->ozcs.bits.zrwasup || !zns->zrwas || !zns->zrwafg)) {
+		XNVME_DEBUG("FAILED: ZRWA is not supported");
+		return -ENOTSUP;
+	}
+
+	// Respect the open, active and ZRWA resource limits; these are zero-based
+	if (zns->mor != 0xFFFFFFFF) {
+		nactive = XNVME_MIN(nactive, zns->mor + 1);
+	}
+	if (zns->mar != 0xFFFFFFFF) {
+		nactive = XNVME_MIN(nactive, zns->mar + 1);
+	}
+	if (flags & XNVME_ZND_WRITER_ZRWA) {
+		nactive = XNVME_MIN(nactive, zns->numzrwa + 1);
+	}
+	nactive = XNVME_MIN(nactive, depth);
+
+	w = calloc(1, sizeof(*w) + nactive * sizeof(*w->zones));
+	if (!w) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	w->dev = dev;
+	w->nsid = xnvme_dev_get_nsid(dev);
+	w->flags = flags;
+	w->zrwas = zns->zrwas;
+	w->zrwafg = zns->zrwafg;
+	w->nactive = nactive;
+
+	err = _zwr_empty_from_dev(w, slba, nzones);
+	if (err) {
+		XNVME_DEBUG("FAILED: _zwr_empty_from_dev(), err: %d", err);
+		xnvme_znd_writer_close(w);
+		return err;
+	}
+
+	w->reqs = calloc(depth, sizeof(*w->reqs));
+	if (!w->reqs) {
+		err = -errno;
+		XNVME_DEBUG("FAILED: calloc(), err: %d", err);
+		xnvme_znd_writer_close(w);
+		return err;
+	}
+	for (uint32_t i = 0; i < depth; ++i) {
+		w->reqs[i].next = w->free;
+		w->free = &w->reqs[i];
+	}
+
+	// Room for a write, and a management command, per request
+	err = xnvme_queue_init(dev, depth * 2, 0, &w->queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_queue_init(), err: %d", err);
+		xnvme_znd_writer_close(w);
+		return err;
+	}
+
+	for (uint32_t i = 0; i < nactive; ++i) {
+		w->zones[i].writer = w;
+		_zwr_zone_assign(&w->zones[i]);
+	}
+	*writer = w;
+
+	return 0;
+}
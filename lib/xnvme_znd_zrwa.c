@@ -0,0 +1,519 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <libxnvme.h>
+#include <libxnvme_nvm.h>
+#include <libxnvme_znd.h>
+#include <xnvme_dev.h>
+
+/**
+ * A write in flight
+ */
+struct _zrwa_req {
+	struct xnvme_znd_zrwa_writer *writer;
+	uint64_t slba;
+	uint16_t nlb; ///< Zero-based number of LBAs
+	uint8_t busy;
+	xnvme_queue_cb cb;
+	void *cb_arg;
+	struct _zrwa_req *next; ///< Next in the free-list
+};
+
+struct xnvme_znd_zrwa_writer {
+	struct xnvme_dev *dev;
+	struct xnvme_queue *queue;
+	uint32_t nsid;
+	int flags;
+	int expflush;       ///< Whether the namespace supports explicit ZRWA flush
+	uint32_t zrwas;     ///< Size of the window in LBAs
+	uint32_t zrwafg;    ///< Flush granularity in LBAs
+	uint64_t zslba;
+	uint64_t zelba;     ///< The first LBA beyond the capacity of the zone
+	uint64_t wp;        ///< Write pointer of the zone; the LBAs below it are committed
+	uint64_t wp_next;   ///< Write pointer once the ZRWA flush in flight has completed
+	uint64_t done;      ///< The LBAs in [wp, done) are written
+	uint32_t ninflight; ///< Number of writes in flight
+	uint32_t flushing;  ///< Whether an explicit ZRWA flush is in flight
+	uint32_t depth;
+	struct _zrwa_req *free;
+	struct _zrwa_req *reqs;
+	int err; ///< First error of a command
+	uint8_t written[]; ///< Bitmap of written LBAs in [wp, wp + 2 * zrwas), indexed modulo
+};
+
+static inline int
+_zrwa_implicit(const struct xnvme_znd_zrwa_writer *writer)
+{
+	return writer->flags & XNVME_ZND_ZRWA_WRITER_IMPLICIT;
+}
+
+static inline uint64_t
+_zrwa_bit(const struct xnvme_znd_zrwa_writer *writer, uint64_t lba)
+{
+	return (lba - writer->zslba) % (2 * (uint64_t)writer->zrwas);
+}
+
+static inline int
+_zrwa_written(const struct xnvme_znd_zrwa_writer *writer, uint64_t lba)
+{
+	uint64_t bit = _zrwa_bit(writer, lba);
+
+	return writer->written[bit / 8] & (1 << (bit % 8));
+}
+
+/**
+ * Advance the contiguous prefix of written LBAs
+ */
+static void
+_zrwa_done_advance(struct xnvme_znd_zrwa_writer *writer)
+{
+	const uint64_t bound = XNVME_MIN_U64(writer->zelba, writer->wp + 2 * writer->zrwas);
+
+	while ((writer->done < bound) && _zrwa_written(writer, writer->done)) {
+		writer->done += 1;
+	}
+}
+
+/**
+ * Advance the write pointer to 'wp', that is, the LBAs below it are committed
+ */
+static void
+_zrwa_wp_advance(struct xnvme_znd_zrwa_writer *writer, uint64_t wp)
+{
+	for (uint64_t lba = writer->wp; lba < wp; ++lba) {
+		uint64_t bit = _zrwa_bit(writer, lba);
+
+		writer->written[bit / 8] &= ~(1 << (bit % 8));
+	}
+	writer->wp = wp;
+	writer->wp_next = wp;
+
+	_zrwa_done_advance(writer);
+}
+
+static void
+_zrwa_write_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct _zrwa_req *req = cb_arg;
+	struct xnvme_znd_zrwa_writer *writer = req->writer;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		XNVME_DEBUG("FAILED: write, slba: 0x%" PRIx64 ", sc: 0x%x", req->slba,
+			    ctx->cpl.status.sc);
+		writer->err = writer->err ? writer->err : -EIO;
+	} else {
+		for (uint64_t lba = req->slba; lba <= req->slba + req->nlb; ++lba) {
+			uint64_t bit = _zrwa_bit(writer, lba);
+
+			writer->written[bit / 8] |= 1 << (bit % 8);
+		}
+		_zrwa_done_advance(writer);
+	}
+	writer->ninflight -= 1;
+
+	if (req->cb) {
+		req->cb(ctx, req->cb_arg);
+	}
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+
+	req->busy = 0;
+	req->next = writer->free;
+	writer->free = req;
+}
+
+static void
+_zrwa_flush_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct xnvme_znd_zrwa_writer *writer = cb_arg;
+
+	writer->flushing = 0;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		XNVME_DEBUG("FAILED: xnvme_znd_zrwa_flush(), lba: 0x%" PRIx64 ", sc: 0x%x",
+			    ctx->cmd.znd.mgmt_send.slba, ctx->cpl.status.sc);
+		writer->err = writer->err ? writer->err : -EIO;
+		writer->wp_next = writer->wp;
+	} else {
+		_zrwa_wp_advance(writer, ctx->cmd.znd.mgmt_send.slba + 1);
+	}
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+static int
+_zrwa_flush_submit(struct xnvme_znd_zrwa_writer *writer, uint64_t lba)
+{
+	struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(writer->queue);
+	int err;
+
+	xnvme_cmd_ctx_set_cb(ctx, _zrwa_flush_cb, writer);
+
+	writer->flushing = 1;
+	writer->wp_next = lba + 1;
+	err = xnvme_znd_zrwa_flush(ctx, writer->nsid, lba);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_znd_zrwa_flush(), err: %d", err);
+		writer->flushing = 0;
+		writer->wp_next = writer->wp;
+		xnvme_queue_put_cmd_ctx(writer->queue, ctx);
+	}
+
+	return err;
+}
+
+/**
+ * Returns the least write pointer, advanced by multiples of the flush granularity, for which the
+ * window fits the LBAs below 'elba'
+ */
+static uint64_t
+_zrwa_wp_needed(const struct xnvme_znd_zrwa_writer *writer, uint64_t elba)
+{
+	uint64_t rel = elba - writer->zslba - writer->zrwas;
+
+	rel = ((rel + writer->zrwafg - 1) / writer->zrwafg) * writer->zrwafg;
+
+	return XNVME_MIN_U64(writer->zslba + rel, writer->zelba);
+}
+
+/**
+ * Whether any write below 'lba' is in flight
+ */
+static int
+_zrwa_inflight_below(const struct xnvme_znd_zrwa_writer *writer, uint64_t lba)
+{
+	for (uint32_t i = 0; i < writer->depth; ++i) {
+		if (writer->reqs[i].busy && (writer->reqs[i].slba < lba)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Wait for the window to admit the LBAs in [slba, elba), advancing it when the LBAs to commit are
+ * written and no writes to them are in flight
+ */
+static int
+_zrwa_admit(struct xnvme_znd_zrwa_writer *writer, uint64_t slba, uint64_t elba)
+{
+	for (;;) {
+		uint64_t wp_needed;
+		int err;
+
+		if (writer->err) {
+			return writer->err;
+		}
+		if (slba < writer->wp_next) {
+			XNVME_DEBUG("FAILED: slba: 0x%" PRIx64 " is committed", slba);
+			return -EINVAL;
+		}
+		if (elba <= writer->wp + writer->zrwas) {
+			return 0;
+		}
+
+		wp_needed = _zrwa_wp_needed(writer, elba);
+		if (slba < wp_needed) {
+			XNVME_DEBUG("FAILED: slba: 0x%" PRIx64 " does not fit a window", slba);
+			return -EINVAL;
+		}
+
+		if (!writer->flushing && (writer->done >= wp_needed) &&
+		    !_zrwa_inflight_below(writer, wp_needed)) {
+			if (!_zrwa_implicit(writer)) {
+				err = _zrwa_flush_submit(writer, wp_needed - 1);
+				if (err) {
+					return err;
+				}
+			} else if (elba <= writer->wp + 2 * writer->zrwas) {
+				// The write lands in the implicit flush region; the device commits
+				_zrwa_wp_advance(writer, wp_needed);
+				return 0;
+			}
+		}
+		if (!writer->ninflight && !writer->flushing) {
+			XNVME_DEBUG("FAILED: LBAs below slba: 0x%" PRIx64 " unwritten", slba);
+			return -EAGAIN;
+		}
+
+		err = xnvme_queue_poke(writer->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+}
+
+int
+xnvme_znd_zrwa_writer_write(struct xnvme_znd_zrwa_writer *writer, uint64_t slba, uint16_t nlb,
+			    const void *dbuf, xnvme_queue_cb cb, void *cb_arg)
+{
+	const uint64_t elba = slba + nlb + 1;
+	struct xnvme_cmd_ctx *ctx;
+	struct _zrwa_req *req;
+	int err;
+
+	if (writer->err) {
+		return writer->err;
+	}
+	if (((uint64_t)nlb + 1 > writer->zrwas) || (slba < writer->zslba) ||
+	    (elba > writer->zelba)) {
+		XNVME_DEBUG("FAILED: slba: 0x%" PRIx64 ", nlb: %u, zrwas: %u", slba, nlb,
+			    writer->zrwas);
+		return -EINVAL;
+	}
+
+	while (!writer->free) {
+		err = xnvme_queue_poke(writer->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	err = _zrwa_admit(writer, slba, elba);
+	if (err) {
+		return err;
+	}
+
+	req = writer->free;
+	writer->free = req->next;
+
+	req->writer = writer;
+	req->slba = slba;
+	req->nlb = nlb;
+	req->busy = 1;
+	req->cb = cb;
+	req->cb_arg = cb_arg;
+	req->next = NULL;
+
+	ctx = xnvme_queue_get_cmd_ctx(writer->queue);
+	xnvme_cmd_ctx_set_cb(ctx, _zrwa_write_cb, req);
+
+	err = xnvme_nvm_write(ctx, writer->nsid, slba, nlb, dbuf, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_nvm_write(), err: %d", err);
+		xnvme_queue_put_cmd_ctx(writer->queue, ctx);
+		req->busy = 0;
+		req->next = writer->free;
+		writer->free = req;
+		return err;
+	}
+	writer->ninflight += 1;
+
+	return 0;
+}
+
+int
+xnvme_znd_zrwa_writer_poke(struct xnvme_znd_zrwa_writer *writer)
+{
+	int err;
+
+	err = xnvme_queue_poke(writer->queue, 0);
+	if (err < 0) {
+		XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+		return err;
+	}
+
+	return writer->err;
+}
+
+int
+xnvme_znd_zrwa_writer_drain(struct xnvme_znd_zrwa_writer *writer)
+{
+	while (writer->ninflight || writer->flushing) {
+		int err = xnvme_queue_poke(writer->queue, 0);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			return err;
+		}
+	}
+
+	return writer->err;
+}
+
+int
+xnvme_znd_zrwa_writer_commit(struct xnvme_znd_zrwa_writer *writer)
+{
+	uint64_t ncommit;
+	int err;
+
+	if (!writer->expflush) {
+		XNVME_DEBUG("FAILED: explicit ZRWA flush is not supported");
+		return -ENOTSUP;
+	}
+
+	err = xnvme_znd_zrwa_writer_drain(writer);
+	if (err) {
+		return err;
+	}
+
+	// Commit in units of the flush granularity, the remainder once the zone is written
+	ncommit = writer->done - writer->zslba;
+	if (writer->done != writer->zelba) {
+		ncommit -= ncommit % writer->zrwafg;
+	}
+	if ((writer->zslba + ncommit) <= writer->wp) {
+		return 0;
+	}
+
+	err = _zrwa_flush_submit(writer, writer->zslba + ncommit - 1);
+	if (err) {
+		return err;
+	}
+
+	return xnvme_znd_zrwa_writer_drain(writer);
+}
+
+uint64_t
+xnvme_znd_zrwa_writer_get_wp(const struct xnvme_znd_zrwa_writer *writer)
+{
+	return writer->wp;
+}
+
+int
+xnvme_znd_zrwa_writer_close(struct xnvme_znd_zrwa_writer *writer)
+{
+	int err = 0;
+
+	if (!writer) {
+		return 0;
+	}
+
+	if (writer->queue) {
+		err = xnvme_znd_zrwa_writer_drain(writer);
+		xnvme_queue_term(writer->queue);
+	}
+	free(writer->reqs);
+	free(writer);
+
+	return err;
+}
+
+/**
+ * Retrieve the zone at 'zslba', opening it with a ZRWA when it is empty
+ */
+static int
+_zrwa_zone_open(struct xnvme_znd_zrwa_writer *writer, uint64_t zslba)
+{
+	struct xnvme_spec_znd_descr zdescr = {0};
+	int err;
+
+	err = xnvme_znd_descr_from_dev(writer->dev, zslba, &zdescr);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_znd_descr_from_dev(), err: %d", err);
+		return err;
+	}
+	if ((zdescr.zslba != zslba) || (zdescr.zt != XNVME_SPEC_ZND_TYPE_SEQWR)) {
+		XNVME_DEBUG("FAILED: zslba: 0x%" PRIx64 ", zt: %d", zdescr.zslba, zdescr.zt);
+		return -EINVAL;
+	}
+
+	switch (zdescr.zs) {
+	case XNVME_SPEC_ZND_STATE_EMPTY: {
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(writer->dev);
+
+		err = xnvme_znd_mgmt_send(&ctx, writer->nsid, zslba, false,
+					  XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN,
+					  XNVME_SPEC_ZND_MGMT_OPEN_WITH_ZRWA, NULL);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			XNVME_DEBUG("FAILED: xnvme_znd_mgmt_send(), err: %d", err);
+			return err ? err : -EIO;
+		}
+	} break;
+
+	case XNVME_SPEC_ZND_STATE_IOPEN:
+	case XNVME_SPEC_ZND_STATE_EOPEN:
+	case XNVME_SPEC_ZND_STATE_CLOSED:
+		if (!zdescr.za.zrwav) {
+			XNVME_DEBUG("FAILED: zone has no ZRWA, zs: 0x%x", zdescr.zs);
+			return -EINVAL;
+		}
+		break;
+
+	default:
+		XNVME_DEBUG("FAILED: zone is not writable, zs: 0x%x", zdescr.zs);
+		return -EINVAL;
+	}
+
+	writer->zslba = zslba;
+	writer->zelba = zslba + zdescr.zcap;
+	writer->wp = zdescr.wp;
+	writer->wp_next = zdescr.wp;
+	writer->done = zdescr.wp;
+
+	return 0;
+}
+
+int
+xnvme_znd_zrwa_writer_open(struct xnvme_dev *dev, uint64_t zslba, uint32_t depth, int flags,
+			   struct xnvme_znd_zrwa_writer **writer)
+{
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	struct xnvme_spec_znd_idfy_ns *zns;
+	struct xnvme_znd_zrwa_writer *w;
+	int err;
+
+	if ((geo->type != XNVME_GEO_ZONED) || !xnvme_is_pow2(depth) || (depth >= 2048)) {
+		XNVME_DEBUG("FAILED: geo.type: %d, depth: %u", geo->type, depth);
+		return -EINVAL;
+	}
+	zns = (void *)xnvme_dev_get_ns_css(dev);
+	if (!zns) {
+		XNVME_DEBUG("FAILED: xnvme_dev_get_ns_css(), errno: %d", errno);
+		return -errno;
+	}
+	if (!zns->ozcs.bits.zrwasup || !zns->zrwas || !zns->zrwafg) {
+		XNVME_DEBUG("FAILED: ZRWA is not supported");
+		return -ENOTSUP;
+	}
+	if (!(flags & XNVME_ZND_ZRWA_WRITER_IMPLICIT) && !zns->zrwacap.bits.expflushsup) {
+		XNVME_DEBUG("FAILED: explicit ZRWA flush is not supported");
+		return -ENOTSUP;
+	}
+
+	w = calloc(1, sizeof(*w) + (2 * (size_t)zns->zrwas + 7) / 8);
+	if (!w) {
+		XNVME_DEBUG("FAILED: calloc(), errno: %d", errno);
+		return -errno;
+	}
+	w->dev = dev;
+	w->nsid = xnvme_dev_get_nsid(dev);
+	w->flags = flags;
+	w->expflush = zns->zrwacap.bits.expflushsup;
+	w->zrwas = zns->zrwas;
+	w->zrwafg = zns->zrwafg;
+	w->depth = depth;
+
+	err = _zrwa_zone_open(w, zslba);
+	if (err) {
+		XNVME_DEBUG("FAILED: _zrwa_zone_open(), err: %d", err);
+		xnvme_znd_zrwa_writer_close(w);
+		return err;
+	}
+
+	w->reqs = calloc(depth, sizeof(*w->reqs));
+	if (!w->reqs) {
+		err = -errno;
+		XNVME_DEBUG("FAILED: calloc(), err: %d", err);
+		xnvme_znd_zrwa_writer_close(w);
+		return err;
+	}
+	for (uint32_t i = 0; i < depth; ++i) {
+		w->reqs[i].next = w->free;
+		w->free = &w->reqs[i];
+	}
+
+	// Room for the writes and a ZRWA flush
+	err = xnvme_queue_init(dev, depth * 2, 0, &w->queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_queue_init(), err: %d", err);
+		xnvme_znd_zrwa_writer_close(w);
+		return err;
+	}
+	*writer = w;
+
+	return 0;
+}
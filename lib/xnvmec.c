@@ -834,6 +834,30 @@ static struct xnvmec_opt_attr xnvmec_opts[] = {
 		.name = "register_buffers",
 		.descr = "For async=io_uring, register buffers",
 	},
+	{
+		.opt = XNVMEC_OPT_SPLIT,
+		.vtype = XNVMEC_OPT_VTYPE_NUM,
+		.name = "split",
+		.descr = "Split reads and writes exceeding MDTS into multiple commands",
+	},
+	{
+		.opt = XNVMEC_OPT_ENUM_SYSFS,
+		.vtype = XNVMEC_OPT_VTYPE_NUM,
+		.name = "enum_sysfs",
+		.descr = "For be=linux, enumerate via sysfs only, without opening the devices",
+	},
+	{
+		.opt = XNVMEC_OPT_ASYNC_HELPER,
+		.vtype = XNVMEC_OPT_VTYPE_NUM,
+		.name = "async_helper",
+		.descr = "Pass commands not supported by the async. interface via a helper-thread",
+	},
+	{
+		.opt = XNVMEC_OPT_OFFLOAD,
+		.vtype = XNVMEC_OPT_VTYPE_NUM,
+		.name = "offload",
+		.descr = "For copies, offload to the kernel, e.g. via copy_file_range()",
+	},
 	{
 		.opt = XNVMEC_OPT_TRUNCATE,
 		.vtype = XNVMEC_OPT_VTYPE_NUM,
@@ -971,6 +995,12 @@ static struct xnvmec_opt_attr xnvmec_opts[] = {
 		.name = "pid",
 		.descr = "Placement identifier",
 	},
+	{
+		.opt = XNVMEC_OPT_NZONES,
+		.vtype = XNVMEC_OPT_VTYPE_NUM,
+		.name = "nzones",
+		.descr = "Number of zones",
+	},
 	{
 		.opt = XNVMEC_OPT_END,
 		.vtype = XNVMEC_OPT_VTYPE_NUM,
@@ -1518,6 +1548,18 @@ xnvmec_assign_arg(struct xnvmec *cli, struct xnvmec_opt_attr *opt_attr, char *ar
 	case XNVMEC_OPT_REGISTER_BUFFERS:
 		args->register_buffers = arg ? num : 0;
 		break;
+	case XNVMEC_OPT_SPLIT:
+		args->split = arg ? num : 1;
+		break;
+	case XNVMEC_OPT_ENUM_SYSFS:
+		args->enum_sysfs = arg ? num : 1;
+		break;
+	case XNVMEC_OPT_ASYNC_HELPER:
+		args->async_helper = arg ? num : 1;
+		break;
+	case XNVMEC_OPT_OFFLOAD:
+		args->offload = arg ? num : 1;
+		break;
 	case XNVMEC_OPT_TRUNCATE:
 		args->truncate = arg ? num : 0;
 		break;
@@ -1564,13 +1606,13 @@ xnvmec_assign_arg(struct xnvmec *cli, struct xnvmec_opt_attr *opt_attr, char *ar
 		args->nsr = num;
 		break;
 	case XNVMEC_OPT_AD:
-		args->ad = arg ? num : 0;
+		args->ad = arg ? num : 1;
 		break;
 	case XNVMEC_OPT_IDW:
-		args->idw = arg ? num : 0;
+		args->idw = arg ? num : 1;
 		break;
 	case XNVMEC_OPT_IDR:
-		args->idr = arg ? num : 0;
+		args->idr = arg ? num : 1;
 		break;
 	case XNVMEC_OPT_LSI:
 		args->lsi = num;
@@ -1578,6 +1620,9 @@ xnvmec_assign_arg(struct xnvmec *cli, struct xnvmec_opt_attr *opt_attr, char *ar
 	case XNVMEC_OPT_PID:
 		args->pid = num;
 		break;
+	case XNVMEC_OPT_NZONES:
+		args->nzones = num;
+		break;
 
 	case XNVMEC_OPT_POSA_TITLE:
 	case XNVMEC_OPT_NON_POSA_TITLE:
@@ -1981,6 +2026,11 @@ xnvmec_cli_to_opts(const struct xnvmec *cli, struct xnvme_opts *opts)
 	opts->register_buffers = cli->given[XNVMEC_OPT_REGISTER_BUFFERS]
 					 ? cli->args.register_buffers
 					 : opts->register_buffers;
+	opts->split = cli->given[XNVMEC_OPT_SPLIT] ? cli->args.split : opts->split;
+	opts->enum_sysfs =
+		cli->given[XNVMEC_OPT_ENUM_SYSFS] ? cli->args.enum_sysfs : opts->enum_sysfs;
+	opts->async_helper =
+		cli->given[XNVMEC_OPT_ASYNC_HELPER] ? cli->args.async_helper : opts->async_helper;
 
 	opts->css.value = cli->given[XNVMEC_OPT_CSS] ? cli->args.css.value : opts->css.value;
 	opts->css.given = cli->given[XNVMEC_OPT_CSS] ? cli->args.css.given : opts->css.given;
@@ -1,9 +1,13 @@
 // Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
 // SPDX-License-Identifier: Apache-2.0
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
+#include <pthread.h>
 #include <libxnvme.h>
 #include <libxnvme_adm.h>
+#include <libxnvme_file.h>
+#include <libxnvme_nvm.h>
 #include <libxnvmec.h>
 
 #define XNVME_TESTS_QDEPTH_MAX 512
@@ -95,6 +99,313 @@ exit:
 	return err;
 }
 
+struct _shared_worker {
+	struct xnvmec *cli;
+	struct xnvme_opts opts;
+	struct xnvme_dev *dev;
+	uint64_t idx;
+	int err;
+};
+
+static void
+_shared_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	int *err = cb_arg;
+
+	*err = xnvme_cmd_ctx_cpl_status(ctx) ? -EIO : 0;
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+/**
+ * Open the device shared, set up a queue of its own, and read an LBA via it
+ */
+static void *
+_shared_worker(void *arg)
+{
+	struct _shared_worker *worker = arg;
+	struct xnvmec *cli = worker->cli;
+	struct xnvme_queue *queue = NULL;
+	const struct xnvme_geo *geo;
+	void *buf = NULL;
+	int err;
+
+	worker->dev = xnvme_dev_open_shared(cli->args.uri, &worker->opts);
+	if (!worker->dev) {
+		worker->err = -errno;
+		xnvmec_perr("xnvme_dev_open_shared()", worker->err);
+		return NULL;
+	}
+	geo = xnvme_dev_get_geo(worker->dev);
+
+	err = xnvme_queue_init(worker->dev, cli->args.qdepth, 0, &queue);
+	if (err) {
+		xnvmec_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+	buf = xnvme_buf_alloc(worker->dev, geo->lba_nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+
+	err = xnvme_queue_set_cb(queue, _shared_cb, &worker->err);
+	if (err) {
+		xnvmec_perr("xnvme_queue_set_cb()", err);
+		goto exit;
+	}
+
+	{
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+		uint64_t slba = worker->idx % (geo->tbytes / geo->lba_nbytes);
+
+		err = xnvme_nvm_read(ctx, xnvme_dev_get_nsid(worker->dev), slba, 0, buf, NULL);
+		if (err) {
+			xnvmec_perr("xnvme_nvm_read()", err);
+			xnvme_queue_put_cmd_ctx(queue, ctx);
+			goto exit;
+		}
+		err = xnvme_queue_drain(queue);
+		if (err < 0) {
+			xnvmec_perr("xnvme_queue_drain()", err);
+			goto exit;
+		}
+		err = worker->err;
+	}
+
+exit:
+	xnvme_buf_free(worker->dev, buf);
+	if (queue) {
+		int err_term = xnvme_queue_term(queue);
+
+		err = err ? err : err_term;
+	}
+	worker->err = err;
+
+	return NULL;
+}
+
+static int
+test_shared(struct xnvmec *cli)
+{
+	uint64_t count = cli->args.count;
+	struct _shared_worker *workers = NULL;
+	pthread_t *threads = NULL;
+	uint64_t nstarted = 0;
+	int err = 0;
+
+	workers = calloc(count, sizeof(*workers));
+	threads = calloc(count, sizeof(*threads));
+	if (!workers || !threads) {
+		err = -errno;
+		xnvmec_perr("calloc()", err);
+		goto exit;
+	}
+
+	for (uint64_t i = 0; i < count; ++i) {
+		workers[i].cli = cli;
+		workers[i].idx = i;
+		err = xnvmec_cli_to_opts(cli, &workers[i].opts);
+		if (err) {
+			xnvmec_perr("xnvmec_cli_to_opts()", err);
+			goto exit;
+		}
+	}
+
+	for (; nstarted < count; ++nstarted) {
+		err = -pthread_create(&threads[nstarted], NULL, _shared_worker, &workers[nstarted]);
+		if (err) {
+			xnvmec_perr("pthread_create()", err);
+			break;
+		}
+	}
+	for (uint64_t i = 0; i < nstarted; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	for (uint64_t i = 0; i < nstarted; ++i) {
+		if (workers[i].err) {
+			xnvmec_pinf("worker: %zu, err: %d", i, workers[i].err);
+			err = err ? err : workers[i].err;
+		}
+		if (workers[i].dev != workers[0].dev) {
+			xnvmec_pinf("worker: %zu, did not get the shared handle", i);
+			err = err ? err : -EINVAL;
+		}
+	}
+	if (nstarted && workers[0].dev && (xnvme_file_readahead(workers[0].dev, 4, 0) != -EINVAL)) {
+		xnvmec_pinf("FAILED: readahead is not refused on the shared handle");
+		xnvme_file_readahead(workers[0].dev, 0, 0);
+		err = err ? err : -EINVAL;
+	}
+	if (!err) {
+		xnvmec_pinf("LGTM: %zu threads on one handle", nstarted);
+	}
+
+exit:
+	for (uint64_t i = 0; i < nstarted; ++i) {
+		xnvme_dev_close(workers[i].dev);
+	}
+	free(workers);
+	free(threads);
+
+	return err;
+}
+
+static void
+_helper_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	int *err = cb_arg;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		xnvme_cmd_ctx_pr(ctx, XNVME_PR_DEF);
+		*err = -EIO;
+	}
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+/**
+ * Submit reads and write-zeroes, interleaved, on a queue of 'qdepth' and verify that both are
+ * completed. With --async_helper, then the write-zeroes which the async. interface does not
+ * support, are carried by the helper-thread of the queue.
+ */
+static int
+test_helper(struct xnvmec *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = cli->args.geo;
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t count = XNVME_MIN_U64(cli->args.count, geo->tbytes / geo->lba_nbytes);
+	struct xnvme_queue *queue = NULL;
+	uint8_t *buf = NULL;
+	int cb_err = 0;
+	int err;
+
+	buf = xnvme_buf_alloc(dev, count * geo->lba_nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	memset(buf, 0xAB, count * geo->lba_nbytes);
+
+	for (uint64_t slba = 0; slba < count; ++slba) {
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+
+		err = xnvme_nvm_write(&ctx, nsid, slba, 0, buf + slba * geo->lba_nbytes, NULL);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_nvm_write()", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+	}
+	memset(buf, 0, count * geo->lba_nbytes);
+
+	err = xnvme_queue_init(dev, cli->args.qdepth, 0, &queue);
+	if (err) {
+		xnvmec_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+	xnvme_queue_set_cb(queue, _helper_cb, &cb_err);
+
+	for (uint64_t slba = 0; slba < count; ++slba) {
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+
+submit:
+		err = (slba % 2) ? xnvme_nvm_read(ctx, nsid, slba, 0,
+						  buf + slba * geo->lba_nbytes, NULL)
+				 : xnvme_nvm_write_zeroes(ctx, nsid, slba, 0);
+		switch (err) {
+		case 0:
+			break;
+
+		case -EBUSY:
+		case -EAGAIN:
+			xnvme_queue_poke(queue, 0);
+			goto submit;
+
+		default:
+			xnvmec_perr((slba % 2) ? "xnvme_nvm_read()" : "xnvme_nvm_write_zeroes()", err);
+			xnvme_queue_put_cmd_ctx(queue, ctx);
+			goto exit;
+		}
+	}
+	err = xnvme_queue_drain(queue);
+	if (err < 0) {
+		xnvmec_perr("xnvme_queue_drain()", err);
+		goto exit;
+	}
+	err = cb_err;
+	if (err) {
+		xnvmec_perr("completion", err);
+		goto exit;
+	}
+
+	for (uint64_t slba = 0; slba < count; ++slba) {
+		uint8_t *lba = buf + slba * geo->lba_nbytes;
+
+		if (!(slba % 2)) {
+			struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+
+			memset(lba, 0xAB, geo->lba_nbytes);
+			err = xnvme_nvm_read(&ctx, nsid, slba, 0, lba, NULL);
+			if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+				xnvmec_perr("xnvme_nvm_read()", err);
+				err = err ? err : -EIO;
+				goto exit;
+			}
+		}
+		for (uint32_t i = 0; i < geo->lba_nbytes; ++i) {
+			if (lba[i] != ((slba % 2) ? 0xAB : 0x0)) {
+				xnvmec_pinf("slba: %zu, offset: %u, unexpected: 0x%x", slba, i, lba[i]);
+				err = -EIO;
+				goto exit;
+			}
+		}
+	}
+
+	xnvmec_pinf("LGTM: %zu reads and write-zeroes", count);
+
+exit:
+	if (queue) {
+		int err_term = xnvme_queue_term(queue);
+
+		err = err ? err : err_term;
+	}
+	xnvme_buf_free(dev, buf);
+
+	return err;
+}
+
+/**
+ * Verify that the async. interface selected by default, or by "auto", is a concrete interface
+ * with the helper-thread enabled, then run the write-zeroes and reads of test_helper() on it
+ */
+static int
+test_auto(struct xnvmec *cli)
+{
+	const struct xnvme_opts *opts = xnvme_dev_get_opts(cli->args.dev);
+
+	if (cli->given[XNVMEC_OPT_ASYNC] && strcmp(cli->args.async, "auto")) {
+		xnvmec_pinf("FAILED: --async '%s' given, expected none or 'auto'", cli->args.async);
+		return -EINVAL;
+	}
+	if (!opts->async || !strcmp(opts->async, "auto")) {
+		xnvmec_pinf("FAILED: async: '%s', expected the selected interface",
+			    opts->async ? opts->async : "NULL");
+		return -EIO;
+	}
+	if (!opts->async_helper) {
+		xnvmec_pinf("FAILED: async: '%s' selected without async_helper", opts->async);
+		return -EIO;
+	}
+	xnvmec_pinf("async: '%s' with async_helper", opts->async);
+
+	return test_helper(cli);
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -113,6 +424,55 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_QDEPTH, XNVMEC_LREQ},
 			{XNVMEC_OPT_CLEAR, XNVMEC_LFLG},
 
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+	{
+		"shared",
+		"Open the device shared from 'count' threads, each with a queue of 'qdepth'",
+		"Open the device shared from 'count' threads, each with a queue of 'qdepth'",
+		test_shared,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_COUNT, XNVMEC_LREQ},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LREQ},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+	{
+		"helper",
+		"Interleave reads and write-zeroes on a queue, see --async_helper",
+		"Interleave reads and write-zeroes on a queue, see --async_helper",
+		test_helper,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_COUNT, XNVMEC_LREQ},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LREQ},
+			{XNVMEC_OPT_ASYNC_HELPER, XNVMEC_LFLG},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+	{
+		"auto",
+		"Verify the default async. interface, and run write-zeroes and reads on it",
+		"Verify the default async. interface, and run write-zeroes and reads on it",
+		test_auto,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_COUNT, XNVMEC_LREQ},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LREQ},
+
 			XNVMEC_ASYNC_OPTS,
 		},
 	},
@@ -80,6 +80,70 @@ test_virt_buf_alloc_free(struct xnvmec *cli)
 	return nerr ? -ENOMEM : 0;
 }
 
+static int
+test_buf_realloc(struct xnvmec *cli)
+{
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(cli->args.dev);
+	uint64_t count = cli->args.count;
+	size_t buf_nbytes = 1;
+	uint8_t *buf;
+	int err = 0;
+
+	xnvmec_pinf("count: %zu", count);
+
+	buf = xnvme_buf_alloc(cli->args.dev, buf_nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		return err;
+	}
+	buf[0] = 0;
+
+	for (uint64_t i = 1; i < count; ++i) {
+		size_t nbytes = (size_t)1 << i;
+		uint8_t *rebuf;
+
+		printf("\n");
+		xnvmec_pinf("[realloc] i: %zu, nbytes: %zu -> %zu", i, buf_nbytes, nbytes);
+
+		rebuf = xnvme_buf_realloc(cli->args.dev, buf, nbytes);
+		if (!rebuf) {
+			err = -errno;
+			xnvmec_perr("xnvme_buf_realloc()", err);
+			goto exit;
+		}
+		buf = rebuf;
+		xnvmec_pinf("buf: %p", (void *)buf);
+
+		if (geo->nbytes && ((uintptr_t)buf % geo->nbytes)) {
+			xnvmec_pinf("FAILED: buf: %p is not aligned to geo.nbytes: %u", (void *)buf,
+				    geo->nbytes);
+			err = -EINVAL;
+			goto exit;
+		}
+		for (size_t ofz = 0; ofz < buf_nbytes; ++ofz) {
+			if (buf[ofz] != (ofz % 251)) {
+				xnvmec_pinf("FAILED: content not preserved at ofz: %zu", ofz);
+				err = -EIO;
+				goto exit;
+			}
+		}
+		for (size_t ofz = buf_nbytes; ofz < nbytes; ++ofz) {
+			buf[ofz] = ofz % 251;
+		}
+		buf_nbytes = nbytes;
+	}
+
+	printf("\n");
+	xnvmec_pinf("LGMT: xnvme_buf_realloc");
+	printf("\n");
+
+exit:
+	xnvme_buf_free(cli->args.dev, buf);
+
+	return err;
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -99,6 +163,21 @@ static struct xnvmec_sub g_subs[] = {
 			XNVMEC_ADMIN_OPTS,
 		},
 	},
+	{
+		"buf_realloc",
+		"Grow a buffer from 1 byte to 2^count, checking alignment and content",
+		"Grow a buffer from 1 byte to 2^count, checking alignment and content",
+		test_buf_realloc,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_COUNT, XNVMEC_LREQ},
+
+			XNVMEC_ADMIN_OPTS,
+		},
+	},
 	{
 		"buf_virt_alloc_free",
 		"Allocate and free a buffer 'count' times of size [1, 2^count]",
@@ -117,8 +196,8 @@ static struct xnvmec_sub g_subs[] = {
 };
 
 static struct xnvmec g_cli = {
-	.title = "Test xNVMe basic buffer alloc/free",
-	.descr_short = "Test xNVMe basic buffer alloc/free",
+	.title = "Test xNVMe basic buffer alloc/realloc/free",
+	.descr_short = "Test xNVMe basic buffer alloc/realloc/free",
 	.subs = g_subs,
 	.nsubs = sizeof g_subs / sizeof(*g_subs),
 };
@@ -254,6 +254,7 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_SYS_URI, XNVMEC_LOPT},
 			{XNVMEC_OPT_COUNT, XNVMEC_LOPT},
 			{XNVMEC_OPT_VERBOSE, XNVMEC_LFLG},
+			{XNVMEC_OPT_ENUM_SYSFS, XNVMEC_LFLG},
 			XNVMEC_CORE_OPTS,
 		},
 	},
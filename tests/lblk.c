@@ -539,6 +539,273 @@ exit:
 	return err;
 }
 
+static void
+_split_cb(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	int *err = cb_arg;
+
+	*err = xnvme_cmd_ctx_cpl_status(ctx) ? -EIO : 0;
+	if (*err) {
+		xnvme_cmd_ctx_pr(ctx, XNVME_PR_DEF);
+	}
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+#define XNVME_SPLIT_QDEPTH 4
+
+/**
+ * Submit a single command of 'nlbas', exceeding MDTS, via a queue with less room than the number
+ * of commands it is split into, while holding every other command-context of the queue
+ */
+static int
+_split_async(struct xnvme_queue *queue, uint32_t nsid, uint64_t slba, uint64_t nlbas,
+	     uint8_t *buf, int write)
+{
+	struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+	struct xnvme_cmd_ctx *held[XNVME_SPLIT_QDEPTH];
+	uint32_t nheld = 0;
+	int cpl_err = -EIO;
+	int err;
+
+	while ((nheld < XNVME_SPLIT_QDEPTH) && (held[nheld] = xnvme_queue_get_cmd_ctx(queue))) {
+		nheld += 1;
+	}
+
+	xnvme_cmd_ctx_set_cb(ctx, _split_cb, &cpl_err);
+
+	err = write ? xnvme_nvm_write_nlbas(ctx, nsid, slba, nlbas, buf, NULL)
+		    : xnvme_nvm_read_nlbas(ctx, nsid, slba, nlbas, buf, NULL);
+	if (err) {
+		xnvmec_perr("xnvme_nvm_{read,write}_nlbas()", err);
+		xnvme_queue_put_cmd_ctx(queue, ctx);
+		goto exit;
+	}
+
+	err = xnvme_queue_drain(queue);
+	if (err < 0) {
+		xnvmec_perr("xnvme_queue_drain()", err);
+		goto exit;
+	}
+	err = cpl_err;
+
+exit:
+	for (uint32_t i = 0; i < nheld; ++i) {
+		xnvme_queue_put_cmd_ctx(queue, held[i]);
+	}
+
+	return err;
+}
+
+/**
+ * 0) Fill wbuf with a repeating sequence of letters A to Z
+ * 1) Write a single command of several times MDTS, synchronously
+ * 2) Read it back, asynchronously, and verify
+ * 3) Fill wbuf with random content, write it asynchronously, read synchronously, and verify
+ *
+ * The device must be opened with '--split'. The number of LBAs can be given via '--nlb', e.g. to
+ * exceed what the NLB field of a single command can hold
+ */
+static int
+test_split(struct xnvmec *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = cli->args.geo;
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t slba = cli->given[XNVMEC_OPT_SLBA] ? cli->args.slba : 0;
+	struct xnvme_queue *queue = NULL;
+	struct xnvme_cmd_ctx ctx;
+	uint8_t *wbuf = NULL, *rbuf = NULL;
+	uint64_t mdts_naddr, nlbas;
+	size_t buf_nbytes;
+	int err;
+
+	if (!xnvme_dev_get_opts(dev)->split) {
+		err = -EINVAL;
+		xnvmec_perr("--split not enabled", err);
+		return err;
+	}
+
+	mdts_naddr = XNVME_MAX_S64(geo->mdts_nbytes / geo->lba_nbytes, 1);
+	nlbas = cli->given[XNVMEC_OPT_NLB] ? (uint64_t)cli->args.nlb + 1 : mdts_naddr * 4 + 3;
+	buf_nbytes = nlbas * geo->lba_nbytes;
+
+	xnvmec_pinf("mdts_naddr: %zu, nlbas: %zu", mdts_naddr, nlbas);
+
+	wbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	rbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	if (!wbuf || !rbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+
+	err = xnvme_queue_init(dev, XNVME_SPLIT_QDEPTH, 0, &queue);
+	if (err) {
+		xnvmec_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+
+	xnvmec_pinf("Writing synchronously, reading asynchronously");
+	err = xnvmec_buf_fill(wbuf, buf_nbytes, "anum");
+	if (err) {
+		xnvmec_perr("xnvmec_buf_fill()", err);
+		goto exit;
+	}
+	ctx = xnvme_cmd_ctx_from_dev(dev);
+	err = xnvme_nvm_write_nlbas(&ctx, nsid, slba, nlbas, wbuf, NULL);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvmec_perr("xnvme_nvm_write_nlbas()", err);
+		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+	xnvmec_buf_clear(rbuf, buf_nbytes);
+	err = _split_async(queue, nsid, slba, nlbas, rbuf, 0);
+	if (err) {
+		goto exit;
+	}
+	if (xnvmec_buf_diff(wbuf, rbuf, buf_nbytes)) {
+		xnvmec_buf_diff_pr(wbuf, rbuf, buf_nbytes, XNVME_PR_DEF);
+		err = -EIO;
+		goto exit;
+	}
+
+	xnvmec_pinf("Writing asynchronously, reading synchronously");
+	err = xnvmec_buf_fill(wbuf, buf_nbytes, "rand-t");
+	if (err) {
+		xnvmec_perr("xnvmec_buf_fill()", err);
+		goto exit;
+	}
+	err = _split_async(queue, nsid, slba, nlbas, wbuf, 1);
+	if (err) {
+		goto exit;
+	}
+	xnvmec_buf_clear(rbuf, buf_nbytes);
+	ctx = xnvme_cmd_ctx_from_dev(dev);
+	err = xnvme_nvm_read_nlbas(&ctx, nsid, slba, nlbas, rbuf, NULL);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvmec_perr("xnvme_nvm_read_nlbas()", err);
+		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+	if (xnvmec_buf_diff(wbuf, rbuf, buf_nbytes)) {
+		xnvmec_buf_diff_pr(wbuf, rbuf, buf_nbytes, XNVME_PR_DEF);
+		err = -EIO;
+		goto exit;
+	}
+
+	xnvmec_pinf("LGTM");
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	xnvme_buf_free(dev, wbuf);
+	xnvme_buf_free(dev, rbuf);
+
+	return err;
+}
+
+struct range_verify {
+	const uint8_t *wbuf; ///< Content written to the range
+	uint64_t slba;       ///< Start of the range
+	uint32_t lba_nbytes;
+	uint64_t nlbas; ///< Number of LBAs verified
+};
+
+static int
+_range_verify_cb(void *buf, uint64_t slba, uint32_t nlbas, void *cb_arg)
+{
+	struct range_verify *verify = cb_arg;
+	const uint8_t *expected = verify->wbuf + (slba - verify->slba) * verify->lba_nbytes;
+	size_t nbytes = (size_t)nlbas * verify->lba_nbytes;
+
+	if (xnvmec_buf_diff(expected, buf, nbytes)) {
+		xnvmec_buf_diff_pr(expected, buf, nbytes, XNVME_PR_DEF);
+		return -EIO;
+	}
+	verify->nlbas += nlbas;
+
+	return 0;
+}
+
+/**
+ * 0) Fill wbuf with a repeating sequence of letters A to Z
+ * 1) Write the range from wbuf via xnvme_nvm_write_range()
+ * 2) Read the range into rbuf via xnvme_nvm_read_range(), and verify
+ * 3) Read the range via xnvme_nvm_read_range() using internal buffers, verifying in the callback
+ */
+static int
+test_range(struct xnvmec *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = cli->args.geo;
+	uint64_t slba = cli->given[XNVMEC_OPT_SLBA] ? cli->args.slba : 0;
+	uint32_t depth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : 0;
+	size_t io_nbytes = cli->given[XNVMEC_OPT_IOSIZE] ? cli->args.iosize : 0;
+	struct range_verify verify = {0};
+	uint8_t *wbuf = NULL, *rbuf = NULL;
+	uint64_t nlbas;
+	size_t buf_nbytes;
+	int err;
+
+	nlbas = XNVME_MAX_S64(geo->mdts_nbytes / geo->lba_nbytes, 1) * 4 + 3;
+	buf_nbytes = nlbas * geo->lba_nbytes;
+
+	xnvmec_pinf("slba: 0x%016lx, nlbas: %zu", slba, nlbas);
+
+	wbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	rbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	if (!wbuf || !rbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	err = xnvmec_buf_fill(wbuf, buf_nbytes, "anum");
+	if (err) {
+		xnvmec_perr("xnvmec_buf_fill()", err);
+		goto exit;
+	}
+
+	err = xnvme_nvm_write_range(dev, slba, nlbas, wbuf, NULL, NULL, io_nbytes, depth);
+	if (err) {
+		xnvmec_perr("xnvme_nvm_write_range()", err);
+		goto exit;
+	}
+
+	xnvmec_buf_clear(rbuf, buf_nbytes);
+	err = xnvme_nvm_read_range(dev, slba, nlbas, rbuf, NULL, NULL, io_nbytes, depth);
+	if (err) {
+		xnvmec_perr("xnvme_nvm_read_range(buf)", err);
+		goto exit;
+	}
+	if (xnvmec_buf_diff(wbuf, rbuf, buf_nbytes)) {
+		xnvmec_buf_diff_pr(wbuf, rbuf, buf_nbytes, XNVME_PR_DEF);
+		err = -EIO;
+		goto exit;
+	}
+
+	verify.wbuf = wbuf;
+	verify.slba = slba;
+	verify.lba_nbytes = geo->lba_nbytes;
+	err = xnvme_nvm_read_range(dev, slba, nlbas, NULL, _range_verify_cb, &verify, io_nbytes,
+				   depth);
+	if (err || (verify.nlbas != nlbas)) {
+		err = err ? err : -EIO;
+		xnvmec_perr("xnvme_nvm_read_range(cb)", err);
+		goto exit;
+	}
+
+	xnvmec_pinf("LGTM");
+
+exit:
+	xnvme_buf_free(dev, wbuf);
+	xnvme_buf_free(dev, rbuf);
+
+	return err;
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -605,6 +872,40 @@ static struct xnvmec_sub g_subs[] = {
 
 			XNVMEC_SYNC_OPTS,
 		},
+	},
+	{
+		"range",
+		"Write and read a range via the range helpers",
+		"Write and read a range via the range helpers, with and without a user-buffer",
+		test_range,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_SLBA, XNVMEC_LOPT},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_IOSIZE, XNVMEC_LOPT},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+	{
+		"split",
+		"Verify that a read or write exceeding MDTS is split",
+		"Verify that a read or write exceeding MDTS is split, also via a shallow queue",
+		test_split,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_SLBA, XNVMEC_LOPT},
+			{XNVMEC_OPT_NLB, XNVMEC_LOPT},
+			{XNVMEC_OPT_SPLIT, XNVMEC_LFLG},
+
+			XNVMEC_ASYNC_OPTS,
+		},
 	}};
 
 static struct xnvmec g_cli = {
@@ -1,6 +1,7 @@
 // Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
 // SPDX-License-Identifier: Apache-2.0
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <libxnvmec.h>
 #include <libxnvme_nvm.h>
@@ -324,6 +325,123 @@ sub_scopy_msrc(struct xnvmec *cli)
 	return _scopy_helper(cli, XNVME_MIN(ns->msrc + 1, ns->mcl));
 }
 
+/**
+ * Copy a handful of source-ranges, of different lengths and out of order, using xnvme_nvm_copy(),
+ * and verify the content of the destination; does not require Simple-Copy support
+ */
+static int
+_copy_helper(struct xnvmec *cli, int flags)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	struct xnvme_spec_nvm_scopy_fmt_zero ranges[] = {
+		{.slba = 40, .nlb = 19}, {.slba = 0, .nlb = 0}, {.slba = 8, .nlb = 2},
+		{.slba = 1, .nlb = 6},   {.slba = 16, .nlb = 23},
+	};
+	const uint32_t nranges = sizeof(ranges) / sizeof(*ranges);
+	const uint64_t sdlba = 64, tlbas = 60;
+	char *dbuf = NULL, *vbuf = NULL, *ebuf = NULL;
+	size_t buf_nbytes = tlbas * geo->lba_nbytes;
+	uint64_t ofz = 0;
+	int err;
+
+	if (geo->tbytes / geo->lba_nbytes < sdlba + tlbas) {
+		err = -EINVAL;
+		xnvmec_perr("geo.tbytes too small", -err);
+		return err;
+	}
+
+	dbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	vbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	ebuf = xnvme_buf_alloc(dev, buf_nbytes);
+	if (!dbuf || !vbuf || !ebuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(dbuf, buf_nbytes, "anum");
+	xnvmec_buf_fill(vbuf, buf_nbytes, "zero");
+	xnvmec_buf_fill(ebuf, buf_nbytes, "zero");
+
+	// Write the dbuf to the source LBAs, and the vbuf to the destination LBAs
+	for (uint64_t i = 0; i < tlbas; ++i) {
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+
+		err = xnvme_nvm_write(&ctx, nsid, i, 0, dbuf + i * geo->lba_nbytes, NULL);
+		if (!err && !xnvme_cmd_ctx_cpl_status(&ctx)) {
+			err = xnvme_nvm_write(&ctx, nsid, sdlba + i, 0,
+					      vbuf + i * geo->lba_nbytes, NULL);
+		}
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_nvm_write()", err);
+			xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+	}
+
+	// The expected content of the destination is the source-ranges, in order
+	for (uint32_t ridx = 0; ridx < nranges; ++ridx) {
+		size_t nbytes = (ranges[ridx].nlb + 1) * geo->lba_nbytes;
+
+		memcpy(ebuf + ofz, dbuf + ranges[ridx].slba * geo->lba_nbytes, nbytes);
+		ofz += nbytes;
+	}
+
+	err = xnvme_nvm_copy(dev, sdlba, ranges, nranges, cli->args.qdepth, flags);
+	if (err) {
+		xnvmec_perr("xnvme_nvm_copy()", err);
+		goto exit;
+	}
+
+	// Read destination LBAs into vbuf
+	for (uint64_t i = 0; i < tlbas; ++i) {
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+
+		err = xnvme_nvm_read(&ctx, nsid, sdlba + i, 0, vbuf + i * geo->lba_nbytes, NULL);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_nvm_read()", err);
+			xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+	}
+
+	{
+		size_t diff;
+
+		diff = xnvmec_buf_diff(ebuf, vbuf, buf_nbytes);
+		if (diff) {
+			xnvmec_pinf("verification failed, diff: %zu", diff);
+			xnvmec_buf_diff_pr(ebuf, vbuf, buf_nbytes, XNVME_PR_DEF);
+			err = -EIO;
+			goto exit;
+		}
+	}
+
+	xnvmec_pinf("LGTM");
+
+exit:
+	xnvme_buf_free(dev, dbuf);
+	xnvme_buf_free(dev, vbuf);
+	xnvme_buf_free(dev, ebuf);
+
+	return err;
+}
+
+static int
+sub_copy(struct xnvmec *cli)
+{
+	return _copy_helper(cli, 0);
+}
+
+static int
+sub_copy_emu(struct xnvmec *cli)
+{
+	return _copy_helper(cli, XNVME_NVM_COPY_NOOFFLOAD);
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -384,6 +502,36 @@ static struct xnvmec_sub g_subs[] = {
 			XNVMEC_SYNC_OPTS,
 		},
 	},
+	{
+		"copy",
+		"Copy ranges using xnvme_nvm_copy(), with Simple-Copy or offload when available",
+		"Copy ranges using xnvme_nvm_copy(), with Simple-Copy or offload when available",
+		sub_copy,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+	{
+		"copy-emu",
+		"Copy ranges using xnvme_nvm_copy(), with the read/write emulation",
+		"Copy ranges using xnvme_nvm_copy(), with the read/write emulation",
+		sub_copy_emu,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
 };
 
 static struct xnvmec g_cli = {
@@ -1,4 +1,8 @@
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <libxnvme_file.h>
 #include <libxnvmec.h>
 
@@ -133,6 +137,807 @@ test_file_trunc(struct xnvmec *cli)
 	return -EIO;
 }
 
+/**
+ * Writes a file using xnvme_file_pwritev() with a header and a payload, makes it durable using
+ * xnvme_file_fdatasync(), reads it back using xnvme_file_preadv() and verifies the content.
+ * Then punches a hole in the payload and verifies that it reads back as zeroes.
+ */
+int
+test_file_vectored(struct xnvmec *cli)
+{
+	struct xnvme_opts opts = {.create = 1, .rdwr = 1, .truncate = 1};
+	const char *output_path = cli->args.data_output;
+	const size_t hdr_nbytes = 512, pld_nbytes = 64 * 1024;
+	const size_t nbytes = hdr_nbytes + pld_nbytes;
+	struct xnvme_cmd_ctx ctx = {0};
+	struct xnvme_dev *fh;
+	struct iovec iov[2];
+	char *wbuf = NULL, *rbuf = NULL;
+	int err;
+
+	fh = xnvme_file_open(output_path, &opts);
+	if (fh == NULL) {
+		xnvmec_perr("xnvme_file_open()", errno);
+		return -errno;
+	}
+
+	wbuf = xnvme_buf_alloc(fh, nbytes);
+	rbuf = xnvme_buf_alloc(fh, nbytes);
+	if (!wbuf || !rbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(wbuf, nbytes, "anum");
+	memset(rbuf, 0, nbytes);
+
+	iov[0] = (struct iovec){.iov_base = wbuf, .iov_len = hdr_nbytes};
+	iov[1] = (struct iovec){.iov_base = wbuf + hdr_nbytes, .iov_len = pld_nbytes};
+
+	ctx = xnvme_file_get_cmd_ctx(fh);
+	err = xnvme_file_pwritev(&ctx, iov, 2, 0);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvmec_perr("xnvme_file_pwritev()", err);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+
+	ctx = xnvme_file_get_cmd_ctx(fh);
+	err = xnvme_file_fdatasync(&ctx);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvmec_perr("xnvme_file_fdatasync()", err);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+
+	iov[0] = (struct iovec){.iov_base = rbuf, .iov_len = hdr_nbytes};
+	iov[1] = (struct iovec){.iov_base = rbuf + hdr_nbytes, .iov_len = pld_nbytes};
+
+	ctx = xnvme_file_get_cmd_ctx(fh);
+	err = xnvme_file_preadv(&ctx, iov, 2, 0);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvmec_perr("xnvme_file_preadv()", err);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+	if (xnvmec_buf_diff(wbuf, rbuf, nbytes)) {
+		xnvmec_buf_diff_pr(wbuf, rbuf, nbytes, XNVME_PR_DEF);
+		err = -EIO;
+		goto exit;
+	}
+
+	ctx = xnvme_file_get_cmd_ctx(fh);
+	err = xnvme_file_fallocate(&ctx, hdr_nbytes, pld_nbytes,
+				   XNVME_SPEC_FS_FALLOCATE_PUNCH_HOLE |
+					   XNVME_SPEC_FS_FALLOCATE_KEEP_SIZE);
+	if ((err == -ENOSYS) || (err == -EOPNOTSUPP)) {
+		xnvmec_pinf("SKIPPED: xnvme_file_fallocate(), not supported");
+		err = 0;
+		goto exit;
+	}
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvmec_perr("xnvme_file_fallocate()", err);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+
+	memset(wbuf + hdr_nbytes, 0, pld_nbytes);
+
+	ctx = xnvme_file_get_cmd_ctx(fh);
+	err = xnvme_file_preadv(&ctx, iov, 2, 0);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvmec_perr("xnvme_file_preadv()", err);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+	if (xnvmec_buf_diff(wbuf, rbuf, nbytes)) {
+		xnvmec_buf_diff_pr(wbuf, rbuf, nbytes, XNVME_PR_DEF);
+		err = -EIO;
+		goto exit;
+	}
+
+exit:
+	xnvme_buf_free(fh, wbuf);
+	xnvme_buf_free(fh, rbuf);
+	xnvme_file_close(fh);
+	return err;
+}
+
+/**
+ * Writes a file, which does not end on a chunk boundary, then reads it in chunks of 64K with
+ * readahead enabled, and once more from an offset within it, verifying the content read
+ */
+int
+test_file_readahead(struct xnvmec *cli)
+{
+	struct xnvme_opts opts = {.rdonly = 1};
+	const char *output_path = cli->args.data_output;
+	const uint32_t depth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : 4;
+	const size_t chunk_nbytes = 64 * 1024, nbytes = 4 * 1024 * 1024 + 123;
+	const size_t buf_nbytes = nbytes + chunk_nbytes;
+	const off_t offsets[] = {0, 3 * chunk_nbytes};
+	struct xnvme_dev *fh;
+	char *wbuf = NULL, *rbuf = NULL;
+	int err;
+
+	opts.async = cli->args.async;
+	opts.direct = cli->args.direct;
+
+	fh = xnvme_file_open(output_path, &(struct xnvme_opts){.create = 1, .wronly = 1,
+								.truncate = 1,
+								.create_mode = 0600});
+	if (fh == NULL) {
+		xnvmec_perr("xnvme_file_open()", errno);
+		return -errno;
+	}
+	wbuf = xnvme_buf_alloc(fh, buf_nbytes);
+	if (!wbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		xnvme_file_close(fh);
+		return err;
+	}
+	xnvmec_buf_fill(wbuf, buf_nbytes, "anum");
+	{
+		struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fh);
+
+		err = xnvme_file_pwrite(&ctx, wbuf, nbytes, 0);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_file_pwrite()", err);
+			xnvme_buf_free(fh, wbuf);
+			xnvme_file_close(fh);
+			return err ? err : -EIO;
+		}
+	}
+	xnvme_buf_free(fh, wbuf);
+	xnvme_file_close(fh);
+
+	fh = xnvme_file_open(output_path, &opts);
+	if (fh == NULL) {
+		xnvmec_perr("xnvme_file_open()", errno);
+		return -errno;
+	}
+	wbuf = xnvme_buf_alloc(fh, buf_nbytes);
+	rbuf = xnvme_buf_alloc(fh, buf_nbytes);
+	if (!wbuf || !rbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(wbuf, buf_nbytes, "anum");
+
+	err = xnvme_file_readahead(fh, depth, 4 * chunk_nbytes);
+	if (err) {
+		xnvmec_perr("xnvme_file_readahead()", err);
+		goto exit;
+	}
+
+	for (size_t i = 0; i < sizeof offsets / sizeof *offsets; ++i) {
+		size_t nread = 0;
+
+		memset(rbuf, 0, buf_nbytes);
+
+		for (off_t ofz = offsets[i];; ofz += chunk_nbytes) {
+			struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fh);
+
+			err = xnvme_file_pread(&ctx, rbuf + ofz, chunk_nbytes, ofz);
+			if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+				xnvmec_perr("xnvme_file_pread()", err);
+				err = err ? err : -EIO;
+				goto exit;
+			}
+			if (!ctx.cpl.result) {
+				break;
+			}
+			nread += ctx.cpl.result;
+		}
+
+		if (nread != (nbytes - offsets[i])) {
+			xnvmec_pinf("FAILED: nread: %zu != %zu", nread, nbytes - offsets[i]);
+			err = -EIO;
+			goto exit;
+		}
+		if (xnvmec_buf_diff(wbuf + offsets[i], rbuf + offsets[i], nread)) {
+			xnvmec_buf_diff_pr(wbuf + offsets[i], rbuf + offsets[i], nread,
+					   XNVME_PR_DEF);
+			err = -EIO;
+			goto exit;
+		}
+	}
+
+exit:
+	xnvme_buf_free(fh, wbuf);
+	xnvme_buf_free(fh, rbuf);
+	xnvme_file_close(fh);
+	return err;
+}
+
+/**
+ * Appends records of 200 bytes, with a flush in the middle, using the stream-writer, then reads
+ * the file back verifying its size and content. Followed by overwriting the first few records via
+ * another stream-writer, which must leave the rest of the file as is.
+ */
+int
+test_file_writer(struct xnvmec *cli)
+{
+	struct xnvme_opts opts = {.create = 1, .rdwr = 1, .truncate = 1, .create_mode = 0600};
+	const char *output_path = cli->args.data_output;
+	const uint32_t depth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : 4;
+	const size_t rec_nbytes = 200, nrecs = 16 * 1024 + 1;
+	const size_t nbytes = rec_nbytes * nrecs;
+	struct xnvme_file_writer *writer = NULL;
+	struct xnvme_dev *fh;
+	char *wbuf = NULL, *rbuf = NULL;
+	int err;
+
+	opts.async = cli->args.async;
+	opts.direct = cli->args.direct;
+
+	fh = xnvme_file_open(output_path, &opts);
+	if (fh == NULL) {
+		xnvmec_perr("xnvme_file_open()", errno);
+		return -errno;
+	}
+	wbuf = xnvme_buf_alloc(fh, nbytes);
+	rbuf = xnvme_buf_alloc(fh, nbytes + 4096);
+	if (!wbuf || !rbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(wbuf, nbytes, "anum");
+	memset(rbuf, 0, nbytes + 4096);
+
+	err = xnvme_file_writer_open(fh, 0, depth, 64 * 1024, &writer);
+	if (err) {
+		xnvmec_perr("xnvme_file_writer_open()", err);
+		goto exit;
+	}
+	for (size_t i = 0; i < nrecs; ++i) {
+		err = xnvme_file_writer_append(writer, wbuf + i * rec_nbytes, rec_nbytes);
+		if (err) {
+			xnvmec_perr("xnvme_file_writer_append()", err);
+			goto exit;
+		}
+		if (i == nrecs / 3) {
+			err = xnvme_file_writer_flush(writer);
+			if (err) {
+				xnvmec_perr("xnvme_file_writer_flush()", err);
+				goto exit;
+			}
+		}
+	}
+	err = xnvme_file_writer_close(writer);
+	writer = NULL;
+	if (err) {
+		xnvmec_perr("xnvme_file_writer_close()", err);
+		goto exit;
+	}
+
+	{
+		struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fh);
+
+		err = xnvme_file_pread(&ctx, rbuf, nbytes + 4096, 0);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_file_pread()", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+		if (ctx.cpl.result != nbytes) {
+			xnvmec_pinf("FAILED: nread: %" PRIu64 " != %zu", ctx.cpl.result, nbytes);
+			err = -EIO;
+			goto exit;
+		}
+	}
+	if (xnvmec_buf_diff(wbuf, rbuf, nbytes)) {
+		xnvmec_buf_diff_pr(wbuf, rbuf, nbytes, XNVME_PR_DEF);
+		err = -EIO;
+		goto exit;
+	}
+
+	xnvmec_buf_fill(wbuf, rec_nbytes * 3, "rand-t");
+	err = xnvme_file_writer_open(fh, 0, depth, 64 * 1024, &writer);
+	if (err) {
+		xnvmec_perr("xnvme_file_writer_open()", err);
+		goto exit;
+	}
+	err = xnvme_file_writer_append(writer, wbuf, rec_nbytes * 3);
+	if (err) {
+		xnvmec_perr("xnvme_file_writer_append()", err);
+		goto exit;
+	}
+	err = xnvme_file_writer_close(writer);
+	writer = NULL;
+	if (err) {
+		xnvmec_perr("xnvme_file_writer_close()", err);
+		goto exit;
+	}
+
+	{
+		struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fh);
+
+		memset(rbuf, 0, nbytes + 4096);
+		err = xnvme_file_pread(&ctx, rbuf, nbytes + 4096, 0);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_file_pread()", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+		if (ctx.cpl.result != nbytes) {
+			xnvmec_pinf("FAILED: overwrite changed the size; nread: %" PRIu64 " != %zu",
+				    ctx.cpl.result, nbytes);
+			err = -EIO;
+			goto exit;
+		}
+	}
+	if (xnvmec_buf_diff(wbuf, rbuf, nbytes)) {
+		xnvmec_buf_diff_pr(wbuf, rbuf, nbytes, XNVME_PR_DEF);
+		err = -EIO;
+		goto exit;
+	}
+
+exit:
+	xnvme_file_writer_close(writer);
+	xnvme_buf_free(fh, wbuf);
+	xnvme_buf_free(fh, rbuf);
+	xnvme_file_close(fh);
+	return err;
+}
+
+/**
+ * Writes and reads at unaligned offsets, of unaligned lengths and from unaligned buffers, to a
+ * file opened with O_DIRECT, verifying the content and size of the file against a mirror
+ */
+int
+test_file_unaligned(struct xnvmec *cli)
+{
+	struct xnvme_opts opts = {.create = 1, .rdwr = 1, .truncate = 1, .direct = 1};
+	const char *output_path = cli->args.data_output;
+	const size_t max_nbytes = 1024 * 1024, io_nbytes_max = 20000;
+	const int nios = 256;
+	struct xnvme_dev *fh;
+	char *mirror = NULL, *buf = NULL, *data = NULL;
+	size_t fsize = 0;
+	int err = 0;
+
+	opts.async = cli->args.async;
+	srand(cli->given[XNVMEC_OPT_SEED] ? cli->args.seed : 1);
+
+	fh = xnvme_file_open(output_path, &opts);
+	if (fh == NULL) {
+		xnvmec_perr("xnvme_file_open()", errno);
+		return -errno;
+	}
+	mirror = calloc(1, max_nbytes);
+	buf = malloc(io_nbytes_max + 1);
+	data = malloc(max_nbytes);
+	if (!mirror || !buf || !data) {
+		err = -errno;
+		xnvmec_perr("malloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(data, max_nbytes, "anum");
+
+	for (int i = 0; i < nios; ++i) {
+		struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fh);
+		size_t nbytes = 1 + rand() % io_nbytes_max;
+		off_t offset = rand() % (max_nbytes - nbytes);
+		char *iobuf = buf + (rand() % 2);
+
+		if (i % 2) {
+			memcpy(iobuf, data + ((offset * 7) % (max_nbytes - nbytes)), nbytes);
+			memcpy(mirror + offset, iobuf, nbytes);
+
+			err = xnvme_file_pwrite(&ctx, iobuf, nbytes, offset);
+			if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+				xnvmec_perr("xnvme_file_pwrite()", err);
+				err = err ? err : -EIO;
+				goto exit;
+			}
+			fsize = XNVME_MAX_S64(fsize, offset + nbytes);
+			continue;
+		}
+
+		err = xnvme_file_pread(&ctx, iobuf, nbytes, offset);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_file_pread()", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+		if ((int64_t)ctx.cpl.result !=
+		    XNVME_MIN_S64(nbytes, XNVME_MAX_S64(0, (int64_t)fsize - offset))) {
+			xnvmec_pinf("FAILED: nread: %" PRIu64 ", fsize: %zu", ctx.cpl.result, fsize);
+			err = -EIO;
+			goto exit;
+		}
+		if (xnvmec_buf_diff(mirror + offset, iobuf, ctx.cpl.result)) {
+			xnvmec_buf_diff_pr(mirror + offset, iobuf, ctx.cpl.result, XNVME_PR_DEF);
+			err = -EIO;
+			goto exit;
+		}
+	}
+
+	xnvme_file_close(fh);
+	fh = xnvme_file_open(output_path, &(struct xnvme_opts){.rdonly = 1});
+	if (fh == NULL) {
+		err = -errno;
+		xnvmec_perr("xnvme_file_open()", err);
+		goto exit;
+	}
+	if (xnvme_dev_get_geo(fh)->tbytes != fsize) {
+		xnvmec_pinf("FAILED: tbytes: %zu != fsize: %zu", xnvme_dev_get_geo(fh)->tbytes,
+			    fsize);
+		err = -EIO;
+	}
+
+exit:
+	free(mirror);
+	free(buf);
+	free(data);
+	xnvme_file_close(fh);
+	return err;
+}
+
+/**
+ * Writes a range of a file and copies it, within the same file, via the kernel offload and via
+ * the read/write pipeline, verifying both copies
+ */
+int
+test_file_copy(struct xnvmec *cli)
+{
+	struct xnvme_opts opts = {.create = 1, .rdwr = 1, .truncate = 1, .create_mode = 0600};
+	const char *output_path = cli->args.data_output;
+	const uint32_t depth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : 4;
+	const size_t nbytes = 3 * 1024 * 1024 + 123;
+	const off_t dst_offsets[] = {nbytes + 4096, 2 * nbytes + 8192 + 7, 3 * nbytes + 12288 + 11};
+	const int flags[] = {0, XNVME_FILE_COPY_NOOFFLOAD,
+			     XNVME_FILE_COPY_NOOFFLOAD | XNVME_FILE_COPY_SYNC};
+	struct xnvme_dev *fh;
+	char *wbuf = NULL, *rbuf = NULL;
+	int err;
+
+	opts.async = cli->args.async;
+	opts.direct = cli->args.direct;
+
+	fh = xnvme_file_open(output_path, &opts);
+	if (fh == NULL) {
+		xnvmec_perr("xnvme_file_open()", errno);
+		return -errno;
+	}
+	wbuf = xnvme_buf_alloc(fh, nbytes);
+	rbuf = xnvme_buf_alloc(fh, nbytes);
+	if (!wbuf || !rbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(wbuf, nbytes, "anum");
+
+	{
+		struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fh);
+
+		err = xnvme_file_pwrite(&ctx, wbuf, nbytes, 0);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_file_pwrite()", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+	}
+
+	err = xnvme_file_copy(fh, 0, fh, dst_offsets[0], nbytes, 3, 64 * 1024, 0);
+	if (err != -EINVAL) {
+		xnvmec_pinf("FAILED: copy with depth: 3, err: %d != -EINVAL", err);
+		err = -EIO;
+		goto exit;
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fh);
+
+		xnvmec_pinf("copy: {dst_offset: %zu, flags: 0x%x}", (size_t)dst_offsets[i], flags[i]);
+
+		err = xnvme_file_copy(fh, 0, fh, dst_offsets[i], nbytes, depth, 64 * 1024, flags[i]);
+		if (err) {
+			xnvmec_perr("xnvme_file_copy()", err);
+			goto exit;
+		}
+
+		memset(rbuf, 0, nbytes);
+		err = xnvme_file_pread(&ctx, rbuf, nbytes, dst_offsets[i]);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_file_pread()", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+		if (xnvmec_buf_diff(wbuf, rbuf, nbytes)) {
+			xnvmec_buf_diff_pr(wbuf, rbuf, nbytes, XNVME_PR_DEF);
+			err = -EIO;
+			goto exit;
+		}
+	}
+
+exit:
+	xnvme_buf_free(fh, wbuf);
+	xnvme_buf_free(fh, rbuf);
+	xnvme_file_close(fh);
+	return err;
+}
+
+static uint8_t
+_range_byte(off_t offset)
+{
+	return (uint8_t)((offset * 31) ^ (offset >> 12));
+}
+
+static int
+_range_fill_cb(void *buf, off_t offset, size_t nbytes, void *XNVME_UNUSED(cb_arg))
+{
+	for (size_t i = 0; i < nbytes; ++i) {
+		((uint8_t *)buf)[i] = _range_byte(offset + i);
+	}
+
+	return 0;
+}
+
+static int
+_range_verify_cb(void *buf, off_t offset, size_t nbytes, void *cb_arg)
+{
+	size_t *nread = cb_arg;
+
+	for (size_t i = 0; i < nbytes; ++i) {
+		if (((uint8_t *)buf)[i] != _range_byte(offset + i)) {
+			xnvmec_pinf("mismatch at offset: %zu", (size_t)(offset + i));
+			return -EIO;
+		}
+	}
+	*nread += nbytes;
+
+	return 0;
+}
+
+/**
+ * Writes a file via xnvme_file_write_range() producing the data via the callback, then reads it
+ * back via xnvme_file_read_range() into a buffer, and via the callback, past end-of-file
+ */
+int
+test_file_range(struct xnvmec *cli)
+{
+	struct xnvme_opts opts = {.create = 1, .rdwr = 1, .truncate = 1, .create_mode = 0600};
+	const char *output_path = cli->args.data_output;
+	const uint32_t depth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : 0;
+	const size_t io_nbytes = cli->given[XNVMEC_OPT_IOSIZE] ? cli->args.iosize : 64 * 1024;
+	const size_t nbytes = 3 * 1024 * 1024 + 123;
+	struct xnvme_dev *fh;
+	uint8_t *rbuf = NULL;
+	size_t nread = 0;
+	int err;
+
+	opts.async = cli->args.async;
+	opts.direct = cli->args.direct;
+
+	fh = xnvme_file_open(output_path, &opts);
+	if (fh == NULL) {
+		xnvmec_perr("xnvme_file_open()", errno);
+		return -errno;
+	}
+	rbuf = xnvme_buf_alloc(fh, nbytes);
+	if (!rbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+
+	err = xnvme_file_write_range(fh, 0, nbytes, NULL, _range_fill_cb, NULL, io_nbytes, depth);
+	if (err) {
+		xnvmec_perr("xnvme_file_write_range()", err);
+		goto exit;
+	}
+
+	memset(rbuf, 0, nbytes);
+	err = xnvme_file_read_range(fh, 0, nbytes, rbuf, NULL, NULL, io_nbytes, depth);
+	if (err) {
+		xnvmec_perr("xnvme_file_read_range(buf)", err);
+		goto exit;
+	}
+	err = _range_verify_cb(rbuf, 0, nbytes, &nread);
+	if (err) {
+		goto exit;
+	}
+
+	nread = 0;
+	err = xnvme_file_read_range(fh, 4096, nbytes, NULL, _range_verify_cb, &nread, io_nbytes,
+				    depth);
+	if (err) {
+		xnvmec_perr("xnvme_file_read_range(cb)", err);
+		goto exit;
+	}
+	if (nread != nbytes - 4096) {
+		err = -EIO;
+		xnvmec_perr("read past end-of-file", err);
+		xnvmec_pinf("nread: %zu, expected: %zu", nread, nbytes - 4096);
+		goto exit;
+	}
+
+	xnvmec_pinf("LGTM");
+
+exit:
+	xnvme_buf_free(fh, rbuf);
+	xnvme_file_close(fh);
+	return err;
+}
+
+/**
+ * Verify that the handle 'fh' from the batched open has the geometry of a handle from a regular
+ * open of the same path, e.g. the LBA-size of a file opened with O_DIRECT
+ */
+static int
+_file_batch_geo_check(struct xnvme_dev *fh, const char *path, struct xnvme_opts *opts)
+{
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(fh);
+	const struct xnvme_geo *expected;
+	struct xnvme_dev *ref;
+	int err = 0;
+
+	ref = xnvme_file_open(path, opts);
+	if (!ref) {
+		err = -errno;
+		xnvmec_perr("xnvme_file_open()", err);
+		return err;
+	}
+	expected = xnvme_dev_get_geo(ref);
+
+	if ((geo->lba_nbytes != expected->lba_nbytes) ||
+	    (geo->mdts_nbytes != expected->mdts_nbytes) || (geo->ssw != expected->ssw) ||
+	    (geo->tbytes != expected->tbytes)) {
+		xnvmec_pinf("FAILED: geometry of '%s' differs from a regular open", path);
+		xnvme_geo_pr(geo, XNVME_PR_DEF);
+		xnvme_geo_pr(expected, XNVME_PR_DEF);
+		err = -EIO;
+	}
+	xnvme_file_close(ref);
+
+	return err;
+}
+
+/**
+ * Creates, writes, and reads back, a set of files using the batched open/close, verifying the
+ * size and content of each, and that a path which does not exist fails without failing the others.
+ * On builds with liburing, then the batched open is done via io_uring OPENAT and STATX, thus the
+ * geometry derived from these is verified against that of a regular open, and the given options
+ * must be left as-is.
+ */
+int
+test_file_batch(struct xnvmec *cli)
+{
+	struct xnvme_opts wopts = {.create = 1, .rdwr = 1, .truncate = 1, .create_mode = 0600};
+	struct xnvme_opts ropts = {.rdonly = 1};
+	struct xnvme_opts ropts_given;
+	const char *output_path = cli->args.data_output;
+	const uint32_t nfiles = 300;
+	const size_t nbytes_max = 8192;
+	struct xnvme_dev **fhs = NULL;
+	char **paths = NULL;
+	int *errs = NULL;
+	char *wbuf = NULL, *rbuf = NULL;
+	int err;
+
+	wopts.direct = ropts.direct = cli->args.direct;
+
+	paths = calloc(nfiles + 1, sizeof(*paths));
+	fhs = calloc(nfiles + 1, sizeof(*fhs));
+	errs = calloc(nfiles + 1, sizeof(*errs));
+	wbuf = malloc(nbytes_max + nfiles);
+	rbuf = malloc(nbytes_max);
+	if (!paths || !fhs || !errs || !wbuf || !rbuf) {
+		err = -errno;
+		xnvmec_perr("calloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(wbuf, nbytes_max + nfiles, "anum");
+
+	for (uint32_t i = 0; i < nfiles + 1; ++i) {
+		paths[i] = malloc(strlen(output_path) + 16);
+		if (!paths[i]) {
+			err = -errno;
+			xnvmec_perr("malloc()", err);
+			goto exit;
+		}
+		sprintf(paths[i], "%s.%u", output_path, i);
+	}
+
+	err = xnvme_file_open_batch((const char **)paths, nfiles, &wopts, fhs, errs);
+	if (err) {
+		xnvmec_perr("xnvme_file_open_batch(create)", err);
+		goto exit;
+	}
+	for (uint32_t i = 0; i < nfiles; ++i) {
+		struct xnvme_cmd_ctx ctx = xnvme_file_get_cmd_ctx(fhs[i]);
+
+		err = xnvme_file_pwrite(&ctx, wbuf + i, (i * 97) % nbytes_max, 0);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_file_pwrite()", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+	}
+	err = xnvme_file_close_batch(fhs, nfiles);
+	memset(fhs, 0, (nfiles + 1) * sizeof(*fhs));
+	if (err) {
+		xnvmec_perr("xnvme_file_close_batch()", err);
+		goto exit;
+	}
+
+	// The last path does not exist
+	ropts_given = ropts;
+	err = xnvme_file_open_batch((const char **)paths, nfiles + 1, &ropts, fhs, errs);
+	if ((err != -ENOENT) || (errs[nfiles] != -ENOENT) || fhs[nfiles]) {
+		xnvmec_pinf("FAILED: expected -ENOENT of the last path; err: %d", err);
+		err = -EIO;
+		goto exit;
+	}
+	if (memcmp(&ropts, &ropts_given, sizeof(ropts))) {
+		xnvmec_pinf("FAILED: xnvme_file_open_batch() changed the given opts");
+		err = -EIO;
+		goto exit;
+	}
+	for (uint32_t i = 0; i < nfiles; ++i) {
+		const size_t nbytes = (i * 97) % nbytes_max;
+		struct xnvme_cmd_ctx ctx;
+
+		if (errs[i] || !fhs[i]) {
+			xnvmec_pinf("FAILED: open('%s'), err: %d", paths[i], errs[i]);
+			err = errs[i] ? errs[i] : -EIO;
+			goto exit;
+		}
+		if (xnvme_dev_get_geo(fhs[i])->tbytes != nbytes) {
+			xnvmec_pinf("FAILED: tbytes: %zu != %zu", xnvme_dev_get_geo(fhs[i])->tbytes,
+				    nbytes);
+			err = -EIO;
+			goto exit;
+		}
+		if (!(i % 64)) {
+			err = _file_batch_geo_check(fhs[i], paths[i], &ropts);
+			if (err) {
+				goto exit;
+			}
+		}
+
+		ctx = xnvme_file_get_cmd_ctx(fhs[i]);
+		memset(rbuf, 0, nbytes_max);
+		err = xnvme_file_pread(&ctx, rbuf, nbytes, 0);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_file_pread()", err);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+		if (xnvmec_buf_diff(wbuf + i, rbuf, nbytes)) {
+			xnvmec_buf_diff_pr(wbuf + i, rbuf, nbytes, XNVME_PR_DEF);
+			err = -EIO;
+			goto exit;
+		}
+	}
+	err = 0;
+
+exit:
+	if (fhs) {
+		int err_close = xnvme_file_close_batch(fhs, nfiles + 1);
+
+		err = err ? err : err_close;
+	}
+	for (uint32_t i = 0; paths && (i < nfiles + 1); ++i) {
+		if (paths[i]) {
+			unlink(paths[i]);
+		}
+		free(paths[i]);
+	}
+	free(paths);
+	free(fhs);
+	free(errs);
+	free(wbuf);
+	free(rbuf);
+	return err;
+}
+
 static struct xnvmec_sub g_subs[] = {
 	{
 		"write-fsync",
@@ -156,6 +961,99 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
 		},
 	},
+	{
+		"file-vectored",
+		"Write and read a file using iovecs, fdatasync and punch a hole",
+		"Write and read a file using iovecs, fdatasync and punch a hole",
+		test_file_vectored,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_DATA_OUTPUT, XNVMEC_POSA},
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+		},
+	},
+	{
+		"file-readahead",
+		"Write a file and read it sequentially with readahead",
+		"Write a file and read it sequentially with readahead",
+		test_file_readahead,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_DATA_OUTPUT, XNVMEC_POSA},
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_DIRECT, XNVMEC_LOPT},
+			{XNVMEC_OPT_ASYNC, XNVMEC_LOPT},
+		},
+	},
+	{
+		"file-writer",
+		"Append small records to a file using the stream-writer",
+		"Append small records to a file using the stream-writer",
+		test_file_writer,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_DATA_OUTPUT, XNVMEC_POSA},
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_DIRECT, XNVMEC_LOPT},
+			{XNVMEC_OPT_ASYNC, XNVMEC_LOPT},
+		},
+	},
+	{
+		"file-unaligned",
+		"Unaligned reads and writes to a file opened with O_DIRECT",
+		"Unaligned reads and writes to a file opened with O_DIRECT",
+		test_file_unaligned,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_DATA_OUTPUT, XNVMEC_POSA},
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_SEED, XNVMEC_LOPT},
+			{XNVMEC_OPT_ASYNC, XNVMEC_LOPT},
+		},
+	},
+	{
+		"file-copy",
+		"Copy a range of a file with and without kernel offload",
+		"Copy a range of a file with and without kernel offload",
+		test_file_copy,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_DATA_OUTPUT, XNVMEC_POSA},
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_DIRECT, XNVMEC_LOPT},
+			{XNVMEC_OPT_ASYNC, XNVMEC_LOPT},
+		},
+	},
+	{
+		"file-range",
+		"Write and read a file using the range helpers",
+		"Write and read a file using the range helpers",
+		test_file_range,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_DATA_OUTPUT, XNVMEC_POSA},
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_IOSIZE, XNVMEC_LOPT},
+			{XNVMEC_OPT_DIRECT, XNVMEC_LOPT},
+			{XNVMEC_OPT_ASYNC, XNVMEC_LOPT},
+		},
+	},
+	{
+		"file-batch",
+		"Create, write and read many files using the batched open and close",
+		"Create, write and read many files using the batched open and close",
+		test_file_batch,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_DATA_OUTPUT, XNVMEC_POSA},
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_DIRECT, XNVMEC_LOPT},
+		},
+	},
 };
 
 static struct xnvmec g_cli = {
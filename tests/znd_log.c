@@ -0,0 +1,327 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <libxnvme.h>
+#include <libxnvme_spec_pp.h>
+#include <libxnvme_znd.h>
+#include <libxnvmec.h>
+
+#define QDEPTH_DEF  16
+#define NACTIVE_DEF 4
+#define NZONES_DEF  8
+#define COUNT_DEF   4096
+
+/**
+ * Fill the payload of the 'idx'th append, such that it can be verified
+ */
+static void
+_payload_fill(uint8_t *buf, uint32_t nbytes, uint64_t idx)
+{
+	for (uint32_t i = 0; i < nbytes; ++i) {
+		buf[i] = (uint8_t)(idx * 31 + i);
+	}
+}
+
+static uint32_t
+_payload_nbytes(struct xnvme_znd_log *log, uint64_t idx)
+{
+	return 1 + (idx * 7919) % xnvme_znd_log_get_nbytes_max(log);
+}
+
+/**
+ * Reset the zones of the log, thus, starting from an empty log
+ */
+static int
+_reset(struct xnvmec *cli, uint64_t slba, uint64_t nzones)
+{
+	const struct xnvme_geo *geo = cli->args.geo;
+	uint64_t *zslbas;
+	int err;
+
+	zslbas = calloc(nzones, sizeof(*zslbas));
+	if (!zslbas) {
+		err = -errno;
+		xnvmec_perr("calloc()", err);
+		return err;
+	}
+	for (uint64_t i = 0; i < nzones; ++i) {
+		zslbas[i] = slba + i * geo->nsect;
+	}
+
+	err = xnvme_znd_mgmt_send_range(cli->args.dev, zslbas, nzones,
+					XNVME_SPEC_ZND_CMD_MGMT_SEND_RESET, 8, NULL);
+	if (err) {
+		xnvmec_perr("xnvme_znd_mgmt_send_range()", err);
+	}
+	free(zslbas);
+
+	return err;
+}
+
+/**
+ * Verify that the 'nkeys' keys of the log have the payload of their latest append, as given by
+ * 'latest' and 'sizes', or are deleted when 'latest' is UINT64_MAX
+ */
+static int
+_verify(struct xnvme_znd_log *log, const uint64_t *latest, const uint32_t *sizes, uint64_t nkeys,
+	uint8_t *buf, uint8_t *expected)
+{
+	const uint32_t buf_nbytes = xnvme_znd_log_get_nbytes_max(log);
+
+	for (uint64_t key = 0; key < nkeys; ++key) {
+		uint32_t nbytes = 0;
+		int err;
+
+		err = xnvme_znd_log_read(log, key, buf, buf_nbytes, &nbytes);
+		if (latest[key] == UINT64_MAX) {
+			if (err != -ENOENT) {
+				xnvmec_pinf("key: %zu, is deleted, err: %d", key, err);
+				return -EIO;
+			}
+			continue;
+		}
+		if (err) {
+			xnvmec_perr("xnvme_znd_log_read()", err);
+			xnvmec_pinf("key: %zu", key);
+			return err;
+		}
+
+		_payload_fill(expected, sizes[key], latest[key]);
+		if ((nbytes != sizes[key]) || memcmp(buf, expected, nbytes)) {
+			xnvmec_pinf("key: %zu, verification failed, nbytes: %u", key, nbytes);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static int
+_reclaim_cb(struct xnvme_znd_log *log, void *cb_arg)
+{
+	uint64_t *nreclaimed = cb_arg;
+	uint64_t zslba;
+	int err;
+
+	err = xnvme_znd_log_victim(log, &zslba, NULL);
+	if (err) {
+		return (err == -ENOENT) ? 0 : err;
+	}
+
+	err = xnvme_znd_log_reclaim(log, zslba);
+	if (err) {
+		xnvmec_perr("xnvme_znd_log_reclaim()", err);
+		return err;
+	}
+	*nreclaimed += 1;
+
+	return 0;
+}
+
+/**
+ * Append 'count' records, over keys, and delete some of them, then verify the content before and
+ * after re-opening the log, that is, the index built by the recovery scan. With 'reclaim', then
+ * the records are as large as possible, and zones are reclaimed as the log runs out of empty
+ * zones.
+ */
+static int
+_log(struct xnvmec *cli, int reclaim)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	struct xnvme_znd_log_opts opts = {0};
+	struct xnvme_znd_log *log = NULL;
+	uint64_t count = cli->given[XNVMEC_OPT_COUNT] ? cli->args.count : COUNT_DEF;
+	uint64_t nkeys = reclaim ? 16 : count / 2;
+	uint64_t nreclaimed = 0;
+	uint64_t *latest = NULL;
+	uint32_t *sizes = NULL;
+	uint8_t *buf = NULL, *expected = NULL;
+	int err;
+
+	opts.slba = cli->args.slba;
+	opts.nzones = cli->given[XNVMEC_OPT_NZONES] ? cli->args.nzones : NZONES_DEF;
+	opts.nactive = cli->given[XNVMEC_OPT_LIMIT] ? cli->args.limit : NACTIVE_DEF;
+	opts.depth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : QDEPTH_DEF;
+	if (reclaim) {
+		opts.reclaim = _reclaim_cb;
+		opts.reclaim_arg = &nreclaimed;
+		opts.reclaim_nfree = 1;
+	}
+
+	err = _reset(cli, opts.slba, opts.nzones);
+	if (err) {
+		goto exit;
+	}
+
+	err = xnvme_znd_log_open(dev, &opts, &log);
+	if (err) {
+		xnvmec_perr("xnvme_znd_log_open()", err);
+		goto exit;
+	}
+
+	if (reclaim && !cli->given[XNVMEC_OPT_COUNT]) {
+		const struct xnvme_geo *geo = cli->args.geo;
+		uint64_t nlbas = (xnvme_znd_log_get_nbytes_max(log) + 32) / geo->lba_nbytes;
+
+		// Enough to write the zones of the log twice over
+		count = 2 * opts.nzones * geo->nsect / nlbas;
+	}
+
+	latest = calloc(nkeys, sizeof(*latest));
+	sizes = calloc(nkeys, sizeof(*sizes));
+	buf = malloc(xnvme_znd_log_get_nbytes_max(log));
+	expected = malloc(xnvme_znd_log_get_nbytes_max(log));
+	if (!latest || !sizes || !buf || !expected) {
+		err = -errno;
+		xnvmec_perr("alloc()", err);
+		goto exit;
+	}
+
+	xnvmec_timer_start(cli);
+
+	for (uint64_t idx = 0; idx < count; ++idx) {
+		uint64_t key = idx % nkeys;
+		uint32_t nbytes = reclaim ? xnvme_znd_log_get_nbytes_max(log)
+					  : _payload_nbytes(log, idx);
+
+		_payload_fill(buf, nbytes, idx);
+
+		err = xnvme_znd_log_append(log, key, buf, nbytes);
+		if (err) {
+			xnvmec_perr("xnvme_znd_log_append()", err);
+			goto exit;
+		}
+		latest[key] = idx;
+		sizes[key] = nbytes;
+	}
+	for (uint64_t key = 0; key < nkeys; key += 7) {
+		err = xnvme_znd_log_delete(log, key);
+		if (err) {
+			xnvmec_perr("xnvme_znd_log_delete()", err);
+			goto exit;
+		}
+		latest[key] = UINT64_MAX;
+	}
+	err = xnvme_znd_log_drain(log);
+	if (err) {
+		xnvmec_perr("xnvme_znd_log_drain()", err);
+		goto exit;
+	}
+
+	xnvmec_timer_stop(cli);
+	xnvme_timer_pr(&cli->timer, "Wall-clock");
+
+	xnvmec_pinf("count: %zu, nkeys: %zu, nfree: %zu, nreclaimed: %zu", count, nkeys,
+		    xnvme_znd_log_get_nfree(log), nreclaimed);
+
+	err = _verify(log, latest, sizes, nkeys, buf, expected);
+	if (err) {
+		goto exit;
+	}
+
+	xnvmec_pinf("Re-opening the log...");
+	err = xnvme_znd_log_close(log);
+	log = NULL;
+	if (err) {
+		xnvmec_perr("xnvme_znd_log_close()", err);
+		goto exit;
+	}
+	err = xnvme_znd_log_open(dev, &opts, &log);
+	if (err) {
+		xnvmec_perr("xnvme_znd_log_open()", err);
+		goto exit;
+	}
+
+	err = _verify(log, latest, sizes, nkeys, buf, expected);
+	if (err) {
+		goto exit;
+	}
+
+	xnvmec_pinf("LGTM");
+
+exit:
+	{
+		int err_exit = xnvme_znd_log_close(log);
+		if (err_exit) {
+			xnvmec_perr("xnvme_znd_log_close()", err_exit);
+		}
+	}
+	free(latest);
+	free(sizes);
+	free(buf);
+	free(expected);
+
+	return err;
+}
+
+static int
+cmd_verify(struct xnvmec *cli)
+{
+	return _log(cli, 0);
+}
+
+static int
+cmd_reclaim(struct xnvmec *cli)
+{
+	return _log(cli, 1);
+}
+
+//
+// Command-Line Interface (CLI) definition
+//
+static struct xnvmec_sub g_subs[] = {
+	{
+		"verify",
+		"Appends 'count' records, deletes some, and verifies, also after re-open",
+		"Appends 'count' records, deletes some, and verifies, also after re-open",
+		cmd_verify,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_SLBA, XNVMEC_LOPT},
+			{XNVMEC_OPT_NZONES, XNVMEC_LOPT},
+			{XNVMEC_OPT_COUNT, XNVMEC_LOPT},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_LIMIT, XNVMEC_LOPT},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+	{
+		"reclaim",
+		"Appends 'count' records, reclaiming zones as needed, and verifies",
+		"Appends 'count' records, reclaiming zones as needed, and verifies",
+		cmd_reclaim,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_SLBA, XNVMEC_LOPT},
+			{XNVMEC_OPT_NZONES, XNVMEC_LOPT},
+			{XNVMEC_OPT_COUNT, XNVMEC_LOPT},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_LIMIT, XNVMEC_LOPT},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+};
+
+static struct xnvmec g_cli = {
+	.title = "Tests for the append-only zoned log",
+	.descr_short = "Tests for the append-only zoned log",
+	.subs = g_subs,
+	.nsubs = sizeof g_subs / sizeof(*g_subs),
+};
+
+int
+main(int argc, char **argv)
+{
+	return xnvmec(&g_cli, argc, argv, XNVMEC_INIT_DEV_OPEN);
+}
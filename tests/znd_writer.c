@@ -0,0 +1,226 @@
+// Copyright (C) Simon A. F. Lund <simon.lund@samsung.com>
+// SPDX-License-Identifier: Apache-2.0
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <libxnvme.h>
+#include <libxnvme_spec_pp.h>
+#include <libxnvme_nvm.h>
+#include <libxnvme_znd.h>
+#include <libxnvmec.h>
+
+#define QDEPTH_DEF  16
+#define NACTIVE_DEF 4
+
+struct cb_args {
+	uint64_t *slbas;
+	uint32_t ecount;
+	uint32_t ecount_offset;
+	uint32_t completed;
+};
+
+struct cb_write {
+	struct cb_args *args;
+	uint64_t idx;
+};
+
+static void
+cb_check(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct cb_write *write = cb_arg;
+	struct cb_args *args = write->args;
+
+	args->completed += 1;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		xnvme_cmd_ctx_pr(ctx, XNVME_PR_DEF);
+		args->ecount += 1;
+	}
+	if (ctx->cmd.nvm.slba != args->slbas[write->idx]) {
+		xnvmec_pinf("ERR: slba: 0x%016lx != 0x%016lx", ctx->cmd.nvm.slba,
+			    args->slbas[write->idx]);
+		args->ecount_offset += 1;
+	}
+}
+
+/**
+ * Fill 'nactive' + 1 empty zones via the writer, one LBA at a time, thus exercising the rollover
+ * from full zones, then verify the LBAs assigned and the content written
+ */
+static int
+_verify(struct xnvmec *cli, int flags)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = cli->args.geo;
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint32_t qdepth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : QDEPTH_DEF;
+	uint32_t nactive = cli->given[XNVMEC_OPT_LIMIT] ? cli->args.limit : NACTIVE_DEF;
+	struct xnvme_znd_writer *writer = NULL;
+	struct xnvme_spec_znd_descr zone = {0};
+	struct cb_write *writes = NULL;
+	struct cb_args cb_args = {0};
+	uint64_t nwrites;
+	size_t buf_nbytes;
+	void *dbuf = NULL, *vbuf = NULL;
+	int err;
+
+	err = xnvme_znd_descr_from_dev_in_state(dev, XNVME_SPEC_ZND_STATE_EMPTY, &zone);
+	if (err) {
+		xnvmec_perr("xnvme_znd_descr_from_dev_in_state()", -err);
+		goto exit;
+	}
+	xnvmec_pinf("Writing from the following zone:");
+	xnvme_spec_znd_descr_pr(&zone, XNVME_PR_DEF);
+
+	nwrites = zone.zcap * (nactive + 1);
+	buf_nbytes = nwrites * geo->lba_nbytes;
+
+	xnvmec_pinf("Allocating buffers...");
+	dbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	vbuf = xnvme_buf_alloc(dev, geo->lba_nbytes);
+	cb_args.slbas = calloc(nwrites, sizeof(*cb_args.slbas));
+	writes = calloc(nwrites, sizeof(*writes));
+	if (!dbuf || !vbuf || !cb_args.slbas || !writes) {
+		err = -errno;
+		xnvmec_perr("alloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(dbuf, buf_nbytes, "anum");
+
+	err = xnvme_znd_writer_open(dev, zone.zslba, 0, nactive, qdepth, flags, &writer);
+	if (err) {
+		xnvmec_perr("xnvme_znd_writer_open()", -err);
+		goto exit;
+	}
+
+	xnvmec_timer_start(cli);
+
+	for (uint64_t idx = 0; idx < nwrites; ++idx) {
+		writes[idx].args = &cb_args;
+		writes[idx].idx = idx;
+
+		err = xnvme_znd_writer_write(writer, dbuf + idx * geo->lba_nbytes, 0,
+					     &cb_args.slbas[idx], cb_check, &writes[idx]);
+		if (err) {
+			xnvmec_perr("xnvme_znd_writer_write()", -err);
+			goto exit;
+		}
+	}
+	err = xnvme_znd_writer_drain(writer);
+	if (err) {
+		xnvmec_perr("xnvme_znd_writer_drain()", -err);
+		goto exit;
+	}
+
+	xnvmec_timer_stop(cli);
+	xnvmec_timer_bw_pr(cli, "Wall-clock", buf_nbytes);
+
+	if (cb_args.ecount || cb_args.ecount_offset || (cb_args.completed != nwrites)) {
+		err = -EIO;
+		xnvmec_perr("got completion errors", -err);
+		goto exit;
+	}
+
+	for (uint64_t idx = 0; idx < nwrites; ++idx) {
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+		size_t diff;
+
+		err = xnvme_nvm_read(&ctx, nsid, cb_args.slbas[idx], 0, vbuf, NULL);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_nvm_read()", err);
+			xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+
+		diff = xnvmec_buf_diff(dbuf + idx * geo->lba_nbytes, vbuf, geo->lba_nbytes);
+		if (diff) {
+			xnvmec_pinf("verification failed, slba: 0x%016lx, diff: %zu",
+				    cb_args.slbas[idx], diff);
+			err = -EIO;
+			goto exit;
+		}
+	}
+
+	xnvmec_pinf("LGTM");
+
+exit:
+	xnvmec_pinf("cb_args: {completed: %u, ecount: %u, ecount_offset: %u}", cb_args.completed,
+		    cb_args.ecount, cb_args.ecount_offset);
+
+	{
+		int err_exit = xnvme_znd_writer_close(writer);
+		if (err_exit) {
+			xnvmec_perr("xnvme_znd_writer_close()", -err_exit);
+		}
+	}
+	free(cb_args.slbas);
+	free(writes);
+	xnvme_buf_free(dev, dbuf);
+	xnvme_buf_free(dev, vbuf);
+
+	return err < 0 ? err : 0;
+}
+
+static int
+cmd_verify(struct xnvmec *cli)
+{
+	return _verify(cli, 0);
+}
+
+static int
+cmd_verify_zrwa(struct xnvmec *cli)
+{
+	return _verify(cli, XNVME_ZND_WRITER_ZRWA);
+}
+
+//
+// Command-Line Interface (CLI) definition
+//
+static struct xnvmec_sub g_subs[] = {
+	{
+		"verify",
+		"Fills 'limit' + 1 zones via the zone write scheduler and verifies",
+		"Fills 'limit' + 1 zones via the zone write scheduler and verifies",
+		cmd_verify,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_LIMIT, XNVMEC_LOPT},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+	{
+		"verify-zrwa",
+		"Fills 'limit' + 1 zones via the zone write scheduler, with ZRWA, and verifies",
+		"Fills 'limit' + 1 zones via the zone write scheduler, with ZRWA, and verifies",
+		cmd_verify_zrwa,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+			{XNVMEC_OPT_LIMIT, XNVMEC_LOPT},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+};
+
+static struct xnvmec g_cli = {
+	.title = "Tests for the zone write scheduler",
+	.descr_short = "Tests for the zone write scheduler",
+	.subs = g_subs,
+	.nsubs = sizeof g_subs / sizeof(*g_subs),
+};
+
+int
+main(int argc, char **argv)
+{
+	return xnvmec(&g_cli, argc, argv, XNVMEC_INIT_DEV_OPEN);
+}
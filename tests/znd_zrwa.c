@@ -336,6 +336,142 @@ exit:
 	return err;
 }
 
+/**
+ * Fill a zone via the ZRWA writer, writing each unit of the flush granularity in reverse order,
+ * and re-writing its first LBA, then commit what the writer has not, and verify the content
+ */
+static int
+_writer(struct xnvmec *cli, int flags)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = cli->args.geo;
+	struct xnvme_spec_znd_idfy_ns *zns = (void *)xnvme_dev_get_ns_css(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint32_t qdepth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : 16;
+	struct xnvme_znd_zrwa_writer *writer = NULL;
+	struct xnvme_spec_znd_descr zone = {0};
+	size_t buf_nbytes;
+	void *dbuf = NULL, *vbuf = NULL;
+	int err;
+
+	err = xnvme_znd_descr_from_dev_in_state(dev, XNVME_SPEC_ZND_STATE_EMPTY, &zone);
+	if (err) {
+		xnvmec_perr("xnvme_znd_descr_from_dev_in_state()", -err);
+		goto exit;
+	}
+	xnvmec_pinf("Using the following zone:");
+	xnvme_spec_znd_descr_pr(&zone, XNVME_PR_DEF);
+
+	buf_nbytes = zone.zcap * geo->lba_nbytes;
+
+	dbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	vbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	if (!dbuf || !vbuf) {
+		err = -errno;
+		xnvmec_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvmec_buf_fill(dbuf, buf_nbytes, "anum");
+	xnvmec_buf_clear(vbuf, buf_nbytes);
+
+	err = xnvme_znd_zrwa_writer_open(dev, zone.zslba, qdepth, flags, &writer);
+	if (err) {
+		xnvmec_perr("xnvme_znd_zrwa_writer_open()", -err);
+		goto exit;
+	}
+
+	xnvmec_timer_start(cli);
+
+	for (uint64_t unit = 0; unit < zone.zcap; unit += zns->zrwafg) {
+		uint64_t nlbas = XNVME_MIN_U64(zone.zcap - unit, zns->zrwafg);
+
+		for (uint64_t idx = unit + nlbas; idx-- > unit;) {
+			err = xnvme_znd_zrwa_writer_write(writer, zone.zslba + idx, 0,
+							  dbuf + idx * geo->lba_nbytes, NULL, NULL);
+			if (err) {
+				xnvmec_perr("xnvme_znd_zrwa_writer_write()", -err);
+				xnvmec_pinf("slba: 0x%016lx", zone.zslba + idx);
+				goto exit;
+			}
+		}
+		err = xnvme_znd_zrwa_writer_write(writer, zone.zslba + unit, 0,
+						  dbuf + unit * geo->lba_nbytes, NULL, NULL);
+		if (err) {
+			xnvmec_perr("xnvme_znd_zrwa_writer_write()", -err);
+			goto exit;
+		}
+	}
+
+	err = xnvme_znd_zrwa_writer_drain(writer);
+	if (err) {
+		xnvmec_perr("xnvme_znd_zrwa_writer_drain()", -err);
+		goto exit;
+	}
+
+	xnvmec_timer_stop(cli);
+	xnvmec_timer_bw_pr(cli, "Wall-clock", buf_nbytes);
+
+	xnvmec_pinf("wp: 0x%016lx", xnvme_znd_zrwa_writer_get_wp(writer));
+
+	if (zns->zrwacap.bits.expflushsup) {
+		err = xnvme_znd_zrwa_writer_commit(writer);
+		if (err) {
+			xnvmec_perr("xnvme_znd_zrwa_writer_commit()", -err);
+			goto exit;
+		}
+		if (xnvme_znd_zrwa_writer_get_wp(writer) != zone.zslba + zone.zcap) {
+			err = -EIO;
+			xnvmec_perr("wp != zslba + zcap", -err);
+			goto exit;
+		}
+	}
+
+	for (uint64_t idx = 0; idx < zone.zcap; ++idx) {
+		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+
+		err = xnvme_nvm_read(&ctx, nsid, zone.zslba + idx, 0, vbuf + idx * geo->lba_nbytes,
+				     NULL);
+		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+			xnvmec_perr("xnvme_nvm_read()", err);
+			xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+			err = err ? err : -EIO;
+			goto exit;
+		}
+	}
+	if (xnvmec_buf_diff(dbuf, vbuf, buf_nbytes)) {
+		err = -EIO;
+		xnvmec_buf_diff_pr(dbuf, vbuf, buf_nbytes, XNVME_PR_DEF);
+		xnvmec_perr("verification failed", -err);
+		goto exit;
+	}
+
+exit:
+	xnvmec_pinf("ZRWA-Writer: %s", err ? "FAILED" : "LGTM");
+
+	{
+		int err_exit = xnvme_znd_zrwa_writer_close(writer);
+		if (err_exit) {
+			xnvmec_perr("xnvme_znd_zrwa_writer_close()", -err_exit);
+		}
+	}
+	xnvme_buf_free(dev, dbuf);
+	xnvme_buf_free(dev, vbuf);
+
+	return err;
+}
+
+static int
+test_writer(struct xnvmec *cli)
+{
+	return _writer(cli, 0);
+}
+
+static int
+test_writer_implicit(struct xnvmec *cli)
+{
+	return _writer(cli, XNVME_ZND_ZRWA_WRITER_IMPLICIT);
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -442,6 +578,37 @@ static struct xnvmec_sub subs[] = {
 			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
 			{XNVMEC_OPT_SLBA, XNVMEC_LOPT},
 
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+	{
+		"writer",
+		"Fill a zone out-of-order via the ZRWA writer, with explicit flush, and verify",
+		"Fill a zone out-of-order via the ZRWA writer, with explicit flush, and verify",
+		test_writer,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+
+			XNVMEC_ASYNC_OPTS,
+		},
+	},
+
+	{
+		"writer-implicit",
+		"Fill a zone out-of-order via the ZRWA writer, with implicit flush, and verify",
+		"Fill a zone out-of-order via the ZRWA writer, with implicit flush, and verify",
+		test_writer_implicit,
+		{
+			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_URI, XNVMEC_POSA},
+
+			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
+
 			XNVMEC_ASYNC_OPTS,
 		},
 	},
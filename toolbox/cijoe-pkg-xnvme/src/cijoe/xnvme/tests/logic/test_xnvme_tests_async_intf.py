@@ -1,4 +1,6 @@
-from ..conftest import xnvme_parametrize
+import pytest
+
+from ..conftest import xnvme_parametrize, xnvme_setup_device
 
 
 @xnvme_parametrize(["dev"], opts=["be", "admin", "async"])
@@ -11,3 +13,33 @@ def test_init_term(cijoe, device, be_opts, cli_args):
             f"--count {count} --qdepth {qdepth}"
         )
         assert not err
+
+
+@xnvme_parametrize(["dev"], opts=["be", "admin", "async"])
+def test_shared(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(
+        f"xnvme_tests_async_intf shared {cli_args} --count 8 --qdepth 4"
+    )
+    assert not err
+
+
+@xnvme_parametrize(["dev"], opts=["be", "admin", "async"])
+def test_helper(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(
+        f"xnvme_tests_async_intf helper {cli_args} "
+        "--count 64 --qdepth 8 --async_helper"
+    )
+    assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_auto(cijoe, device):
+
+    err, _ = cijoe.run(
+        f"xnvme_tests_async_intf auto {device['uri']} --count 64 --qdepth 8"
+    )
+    assert not err
@@ -1,3 +1,5 @@
+import pytest
+
 from ..conftest import xnvme_parametrize
 
 
@@ -13,3 +15,13 @@ def test_buf_virt_alloc_free(cijoe, device, be_opts, cli_args):
 
     err, _ = cijoe.run(f"xnvme_tests_buf buf_virt_alloc_free {cli_args} --count 31")
     assert not err
+
+
+@xnvme_parametrize(["dev"], opts=["be", "mem"])
+def test_buf_realloc(cijoe, device, be_opts, cli_args):
+
+    if be_opts["be"] == "vfio":
+        pytest.skip(reason="[be=vfio] does not implement buf_realloc")
+
+    err, _ = cijoe.run(f"xnvme_tests_buf buf_realloc {cli_args} --count 28")
+    assert not err
@@ -45,6 +45,13 @@ def test_multi_all_be(cijoe):
     assert not err
 
 
+
+def test_multi_sysfs(cijoe):
+
+    XnvmeDriver.kernel_attach(cijoe)
+    err, _ = cijoe.run("xnvme_tests_enum multi --count 4 --be linux --enum_sysfs")
+    assert not err
+
 def test_backend(cijoe):
 
     XnvmeDriver.kernel_attach(cijoe)
@@ -33,8 +33,26 @@ def test_write_uncorrectable(cijoe, device, be_opts, cli_args):
 @xnvme_parametrize(labels=["write_zeroes"], opts=["be", "admin", "sync"])
 def test_write_zeroes(cijoe, device, be_opts, cli_args):
 
-    if be_opts["be"] == "linux" and be_opts["sync"] in ["block", "psync"]:
-        pytest.skip(reason=f"Not supported: write_zeroes via { be_opts['sync'] }")
-
     err, _ = cijoe.run(f"xnvme_tests_lblk write_zeroes {cli_args}")
     assert not err
+
+
+@xnvme_parametrize(labels=["dev"], opts=["be", "admin", "async"])
+def test_range(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_lblk range {cli_args}")
+    assert not err
+
+
+@xnvme_parametrize(labels=["dev"], opts=["be", "admin", "async"])
+def test_split(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_lblk split {cli_args} --split")
+    assert not err
+
+
+@xnvme_parametrize(labels=["dev"], opts=["be", "admin", "async"])
+def test_split_nlbas(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_lblk split {cli_args} --split --nlb 69999")
+    assert not err
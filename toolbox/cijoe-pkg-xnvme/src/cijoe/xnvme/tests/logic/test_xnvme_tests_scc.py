@@ -69,3 +69,17 @@ def test_scopy_msrc_clear(cijoe, device, be_opts, cli_args):
 
     err, _ = cijoe.run(f"xnvme_tests_scc scopy-msrc {cli_args} --clear")
     assert not err
+
+
+@xnvme_parametrize(labels=["dev"], opts=["be", "admin", "async"])
+def test_copy(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_scc copy {cli_args}")
+    assert not err
+
+
+@xnvme_parametrize(labels=["dev"], opts=["be", "admin", "async"])
+def test_copy_emu(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_scc copy-emu {cli_args}")
+    assert not err
@@ -19,3 +19,75 @@ def test_file_trunc(cijoe, device):
 
     err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-trunc {device['uri']}")
     assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_file_vectored(cijoe, device):
+
+    err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-vectored {device['uri']}")
+    assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_file_readahead(cijoe, device):
+
+    err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-readahead {device['uri']}")
+    assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_file_writer(cijoe, device):
+
+    err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-writer {device['uri']}")
+    assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_file_unaligned(cijoe, device):
+
+    err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-unaligned {device['uri']}")
+    assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_file_copy(cijoe, device):
+
+    err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-copy {device['uri']}")
+    assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_file_range(cijoe, device):
+
+    err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-range {device['uri']}")
+    assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_file_batch(cijoe, device):
+
+    err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-batch {device['uri']}")
+    assert not err
+
+
+@pytest.mark.parametrize(
+    "device", xnvme_setup_device(labels=["file"]), indirect=["device"]
+)
+def test_file_batch_direct(cijoe, device):
+
+    err, _ = cijoe.run(f"xnvme_tests_xnvme_file file-batch {device['uri']} --direct 1")
+    assert not err
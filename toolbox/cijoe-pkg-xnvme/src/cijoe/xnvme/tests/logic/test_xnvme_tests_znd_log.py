@@ -0,0 +1,15 @@
+from ..conftest import xnvme_parametrize
+
+
+@xnvme_parametrize(labels=["zns"], opts=["be", "admin", "async"])
+def test_verify(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_znd_log verify {cli_args}")
+    assert not err
+
+
+@xnvme_parametrize(labels=["zns"], opts=["be", "admin", "async"])
+def test_reclaim(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_znd_log reclaim {cli_args} --nzones 4")
+    assert not err
@@ -0,0 +1,20 @@
+import pytest
+
+from ..conftest import xnvme_parametrize
+
+
+@xnvme_parametrize(labels=["zns"], opts=["be", "admin", "async"])
+def test_verify(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_znd_writer verify {cli_args}")
+    assert not err
+
+
+@xnvme_parametrize(labels=["zrwa"], opts=["be", "admin", "async"])
+def test_verify_zrwa(cijoe, device, be_opts, cli_args):
+
+    if be_opts["be"] == "linux" and be_opts["async"] in ["io_uring", "libaio", "posix"]:
+        pytest.skip(reason="ENOSYS: async=[io_uring,libaio,posix] cannot do mgmt send")
+
+    err, _ = cijoe.run(f"xnvme_tests_znd_writer verify-zrwa {cli_args}")
+    assert not err
@@ -85,3 +85,20 @@ def test_flush_implicit(cijoe, device, be_opts, cli_args):
 
     err, _ = cijoe.run(f"xnvme_tests_znd_zrwa flush-implicit {cli_args}")
     assert not err
+
+
+@xnvme_parametrize(labels=["zrwa"], opts=["be", "admin", "async"])
+def test_writer(cijoe, device, be_opts, cli_args):
+
+    if be_opts["be"] == "linux" and be_opts["async"] in ["io_uring", "libaio", "posix"]:
+        pytest.skip(reason="ENOSYS: async=[io_uring,libaio,posix] cannot do mgmt send")
+
+    err, _ = cijoe.run(f"xnvme_tests_znd_zrwa writer {cli_args}")
+    assert not err
+
+
+@xnvme_parametrize(labels=["zrwa"], opts=["be", "admin", "async"])
+def test_writer_implicit(cijoe, device, be_opts, cli_args):
+
+    err, _ = cijoe.run(f"xnvme_tests_znd_zrwa writer-implicit {cli_args}")
+    assert not err
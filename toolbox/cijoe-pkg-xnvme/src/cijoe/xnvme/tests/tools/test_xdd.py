@@ -56,8 +56,21 @@ def test_xdd(cijoe):
             "xdd async --data-input test.0 --data-output test.1 --data-nbytes 1048576 --offset 1048576 --qdepth 32 --iosize 8192",
             "cmp --ignore-initial=1048576:0 test.0 test.1 && rm test.1",
         ),
+        (
+            "xdd sync --data-input test.0 --data-output test.1 --data-nbytes 1048577 --offset 1048575 --offload",
+            "cmp --ignore-initial=1048575:0 test.0 test.1 && rm test.1",
+        ),
+        (
+            "xdd async --data-input test.0 --data-output test.1 --data-nbytes 1048577 --offset 1048575 --offload",
+            "cmp --ignore-initial=1048575:0 test.0 test.1 && rm test.1",
+        ),
     ]
 
+    err, _ = cijoe.run(
+        "xdd async --data-input test.0 --data-output test.1 --data-nbytes 1048576 --qdepth 48"
+    )
+    assert err
+
     for xdd_command, cmp_command in commands:
         err, _ = cijoe.run(xdd_command)
         assert not err
@@ -151,3 +151,24 @@ def test_reset_open_report(cijoe, device, be_opts, cli_args):
 
     err, _ = cijoe.run(f"zoned report {cli_args} --slba {slba} --limit {limit}")
     assert not err
+
+
+@xnvme_parametrize(labels=["zns"], opts=["be", "admin", "async"])
+def test_reset_range_open_range(cijoe, device, be_opts, cli_args):
+
+    slba = "0x0"
+    nzones = "8"
+
+    err, _ = cijoe.run(f"zoned mgmt-reset {cli_args} --slba {slba} --nzones {nzones}")
+    assert not err
+
+    err, _ = cijoe.run(f"zoned mgmt-open {cli_args} --slba {slba} --nzones {nzones}")
+    assert not err
+
+    err, _ = cijoe.run(f"zoned report {cli_args} --slba {slba} --limit {nzones}")
+    assert not err
+
+    err, _ = cijoe.run(
+        f"zoned mgmt-reset {cli_args} --slba {slba} --nzones {nzones} --qdepth 4"
+    )
+    assert not err
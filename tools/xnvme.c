@@ -1073,6 +1073,7 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
 			{XNVMEC_OPT_SYS_URI, XNVMEC_LOPT},
 			{XNVMEC_OPT_FLAGS, XNVMEC_LOPT},
+			{XNVMEC_OPT_ENUM_SYSFS, XNVMEC_LFLG},
 
 			XNVMEC_CORE_OPTS,
 		},
@@ -1086,6 +1087,7 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
 			{XNVMEC_OPT_SYS_URI, XNVMEC_LOPT},
 			{XNVMEC_OPT_FLAGS, XNVMEC_LOPT},
+			{XNVMEC_OPT_ENUM_SYSFS, XNVMEC_LFLG},
 
 			XNVMEC_CORE_OPTS,
 		},
@@ -9,7 +9,6 @@
 #include <libxnvme_spec_fs.h>
 
 #define IOSIZE_DEF 4096
-#define QDEPTH_MAX 256
 #define QDEPTH_DEF 16
 
 struct cb_args {
@@ -34,41 +33,6 @@ cb_func(struct xnvme_cmd_ctx *ctx, void *cb_arg)
 	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
 }
 
-struct cb_args_copy {
-	uint64_t *nerrors;
-	uint64_t ncompletions;
-	uint64_t nsubmissions;
-
-	struct xnvme_cmd_ctx dst_ctx;
-	char *buf;
-};
-
-static void
-cb_func_copy(struct xnvme_cmd_ctx *ctx, void *cb_arg)
-{
-	struct cb_args_copy *work = cb_arg;
-
-	work->ncompletions += 1;
-
-	if (xnvme_cmd_ctx_cpl_status(ctx)) {
-		xnvmec_perr("cb_func_copy()", errno);
-		xnvme_cmd_ctx_pr(ctx, XNVME_PR_DEF);
-		*work->nerrors += 1;
-	} else {
-		ssize_t res;
-
-		res = xnvme_file_pwrite(&work->dst_ctx, work->buf, ctx->cpl.result,
-					ctx->cmd.nvm.slba);
-		if (res || xnvme_cmd_ctx_cpl_status(&work->dst_ctx)) {
-			xnvmec_perr("xnvme_file_pwrite(dst)", res);
-			xnvme_cmd_ctx_pr(&work->dst_ctx, XNVME_PR_DEF);
-			*work->nerrors += 1;
-		}
-	}
-
-	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
-}
-
 int
 read_write(struct xnvmec *cli)
 {
@@ -602,209 +566,89 @@ exit:
 	return 0;
 }
 
-int
-copy_file_sync(struct xnvmec *cli)
+/**
+ * Copy via xnvme_file_copy(); by read/write, via the sync. interface with XNVME_FILE_COPY_SYNC,
+ * or else a pipeline of 'qdepth', and only offloaded to the kernel when --offload is given
+ */
+static int
+copy_file(struct xnvmec *cli, const char *name, uint32_t qdepth, size_t iosize, int flags)
 {
 	struct xnvme_opts src_opts = {.rdonly = 1, .direct = cli->args.direct};
 	struct xnvme_opts dst_opts = {.create = 1, .wronly = 1, .direct = cli->args.direct};
 	struct xnvme_dev *src_fh, *dst_fh;
 	const char *src_fpath, *dst_fpath;
-	size_t buf_nbytes, tbytes, iosize;
-	char *buf = NULL;
+	size_t tbytes;
+	int err;
 
 	src_fpath = cli->args.data_input;
 	dst_fpath = cli->args.data_output;
-	iosize = cli->given[XNVMEC_OPT_IOSIZE] ? cli->args.iosize : IOSIZE_DEF;
 
 	src_fh = xnvme_file_open(src_fpath, &src_opts);
 	if (src_fh == NULL) {
-		xnvmec_perr("xnvme_file_open(src)", errno);
-		return errno;
+		err = -errno;
+		xnvmec_perr("xnvme_file_open(src)", err);
+		return err;
 	}
 	dst_fh = xnvme_file_open(dst_fpath, &dst_opts);
 	if (dst_fh == NULL) {
-		xnvmec_perr("xnvme_file_open(dst)", errno);
-		goto exit;
+		err = -errno;
+		xnvmec_perr("xnvme_file_open(dst)", err);
+		xnvme_file_close(src_fh);
+		return err;
 	}
 	tbytes = xnvme_dev_get_geo(src_fh)->tbytes;
 
-	buf_nbytes = iosize;
-	buf = xnvme_buf_alloc(src_fh, buf_nbytes);
-	if (!buf) {
-		xnvmec_perr("xnvme_buf_alloc()", errno);
-		goto exit;
-	}
-	xnvmec_buf_fill(buf, buf_nbytes, "zero");
+	flags |= cli->args.offload ? 0 : XNVME_FILE_COPY_NOOFFLOAD;
 
-	xnvmec_pinf("copy-sync: {src: %s, dst: %s, tbytes: %zu, buf_nbytes: %zu, iosize: %zu",
-		    src_fpath, dst_fpath, tbytes, buf_nbytes, iosize);
+	xnvmec_pinf("%s: {src: %s, dst: %s, tbytes: %zu, iosize: %zu, qdepth: %u, offload: %u}",
+		    name, src_fpath, dst_fpath, tbytes, iosize, qdepth, cli->args.offload);
 
 	xnvmec_timer_start(cli);
 
-	for (size_t ofz = 0; ofz < tbytes; ofz += iosize) {
-		struct xnvme_cmd_ctx src_ctx = xnvme_file_get_cmd_ctx(src_fh);
-		struct xnvme_cmd_ctx dst_ctx = xnvme_file_get_cmd_ctx(dst_fh);
-		size_t nbytes = XNVME_MIN_U64(iosize, tbytes - ofz);
-		ssize_t res;
-
-		res = xnvme_file_pread(&src_ctx, buf, nbytes, ofz);
-		if (res || xnvme_cmd_ctx_cpl_status(&src_ctx)) {
-			xnvmec_perr("xnvme_file_pread(src)", res);
-			xnvme_cmd_ctx_pr(&src_ctx, XNVME_PR_DEF);
-			goto exit;
-		}
-
-		res = xnvme_file_pwrite(&dst_ctx, buf, nbytes, ofz);
-		if (res || xnvme_cmd_ctx_cpl_status(&dst_ctx)) {
-			xnvmec_perr("xnvme_file_pwrite(dst)", res);
-			xnvme_cmd_ctx_pr(&dst_ctx, XNVME_PR_DEF);
-			goto exit;
-		}
+	err = xnvme_file_copy(src_fh, 0, dst_fh, 0, tbytes, qdepth, iosize, flags);
+	if (err) {
+		xnvmec_perr("xnvme_file_copy()", err);
+		goto exit;
 	}
 
 	xnvmec_timer_stop(cli);
 	xnvmec_timer_bw_pr(cli, "wall-clock", tbytes);
 
 exit:
-	xnvme_buf_free(src_fh, buf);
 	xnvme_file_close(src_fh);
 	xnvme_file_close(dst_fh);
-	return 0;
+	return err;
 }
 
 int
-copy_file_async(struct xnvmec *cli)
+copy_file_sync(struct xnvmec *cli)
 {
-	struct xnvme_opts src_opts = {.rdonly = 1, .direct = cli->args.direct};
-	struct xnvme_opts dst_opts = {.create = 1, .wronly = 1, .direct = cli->args.direct};
-	struct xnvme_dev *src_fh, *dst_fh;
-	const char *src_fpath, *dst_fpath;
-	size_t buf_nbytes, tbytes, iosize;
-	char *buf = NULL;
-
-	struct cb_args_copy cb_args_copy[QDEPTH_MAX] = {0};
-	uint64_t nerrors = 0, ncompletions = 0, nsubmissions = 0;
-	struct xnvme_queue *queue = NULL;
-	uint32_t qdepth;
-	int err;
+	size_t iosize = cli->given[XNVMEC_OPT_IOSIZE] ? cli->args.iosize : IOSIZE_DEF;
 
-	src_fpath = cli->args.data_input;
-	dst_fpath = cli->args.data_output;
-	iosize = cli->given[XNVMEC_OPT_IOSIZE] ? cli->args.iosize : IOSIZE_DEF;
 	if (!iosize) {
-		err = -EINVAL;
-		xnvmec_perr("iosize can't be set to 0", err);
-		return err;
+		xnvmec_perr("iosize can't be set to 0", -EINVAL);
+		return -EINVAL;
 	}
 
-	qdepth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : QDEPTH_DEF;
-	if (!qdepth) {
-		err = -EINVAL;
-		xnvmec_perr("qdepth can't be set to 0", err);
-		return err;
-	}
-
-	src_fh = xnvme_file_open(src_fpath, &src_opts);
-	if (src_fh == NULL) {
-		xnvmec_perr("xnvme_file_open(src)", errno);
-		return errno;
-	}
-	dst_fh = xnvme_file_open(dst_fpath, &dst_opts);
-	if (dst_fh == NULL) {
-		xnvmec_perr("xnvme_file_open(dst)", errno);
-		goto exit;
-	}
-	tbytes = xnvme_dev_get_geo(src_fh)->tbytes;
-
-	buf_nbytes = iosize * qdepth;
-	buf = xnvme_buf_alloc(src_fh, buf_nbytes);
-	if (!buf) {
-		xnvmec_perr("xnvme_buf_alloc()", errno);
-		goto exit;
-	}
-	xnvmec_buf_fill(buf, buf_nbytes, "zero");
-
-	err = xnvme_queue_init(src_fh, qdepth, 0, &queue);
-	if (err) {
-		xnvmec_perr("xnvme_queue_init()", err);
-		goto exit;
-	}
-	xnvme_queue_set_cb(queue, cb_func_copy, &cb_args_copy);
-
-	xnvmec_pinf("copy-async: "
-		    "{src: %s, dst: %s, tbytes: %zu, buf_nbytes: %zu, iosize: %zu, qdepth: %u}",
-		    src_fpath, dst_fpath, tbytes, buf_nbytes, iosize, qdepth);
-
-	xnvmec_timer_start(cli);
-
-	for (uint32_t i = 0; i < qdepth; ++i) {
-		struct cb_args_copy *work = &cb_args_copy[i];
-
-		work->nerrors = &nerrors;
-		work->buf = buf + (i * iosize);
-		work->dst_ctx = xnvme_file_get_cmd_ctx(dst_fh);
-	}
-
-	for (size_t ofz = 0; (ofz < tbytes) && !nerrors;) {
-		struct cb_args_copy *work = &cb_args_copy[(ofz / iosize) % qdepth];
-		struct xnvme_cmd_ctx *src_ctx = xnvme_cmd_ctx_from_queue(queue);
-		size_t nbytes = XNVME_MIN_U64(iosize, tbytes - ofz);
-		ssize_t res;
-
-		src_ctx->async.cb_arg = work;
-
-submit:
-		res = xnvme_file_pread(src_ctx, work->buf, nbytes, ofz);
-		switch (res) {
-		case 0:
-			work->nsubmissions += 1;
-			goto next;
-
-		case -EBUSY:
-		case -EAGAIN:
-			xnvme_queue_poke(queue, 0);
-			goto submit;
-
-		default:
-			xnvmec_perr("submission-error", err);
-			xnvme_queue_put_cmd_ctx(queue, src_ctx);
-			goto exit;
-		}
-
-next:
-		ofz += iosize;
-	}
-
-	err = xnvme_queue_drain(queue);
-	if (err < 0) {
-		xnvmec_perr("xnvme_queue_drain()", err);
-		goto exit;
-	}
-
-	xnvmec_timer_stop(cli);
-	xnvmec_timer_bw_pr(cli, "wall-clock", tbytes);
+	return copy_file(cli, "copy-sync", 1, iosize, XNVME_FILE_COPY_SYNC);
+}
 
-exit:
-	for (uint32_t i = 0; i < qdepth; ++i) {
-		struct cb_args_copy *work = &cb_args_copy[i];
+int
+copy_file_async(struct xnvmec *cli)
+{
+	size_t iosize = cli->given[XNVMEC_OPT_IOSIZE] ? cli->args.iosize : IOSIZE_DEF;
+	uint32_t qdepth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : QDEPTH_DEF;
 
-		nsubmissions += work->nsubmissions;
-		ncompletions += work->ncompletions;
+	if (!iosize) {
+		xnvmec_perr("iosize can't be set to 0", -EINVAL);
+		return -EINVAL;
 	}
-	xnvmec_pinf("cb_args_copy: {nsubmissions: %zu, ncompletions: %zu, nerrors: %zu}",
-		    nsubmissions, ncompletions, nerrors);
-
-	if (queue) {
-		int err_exit = xnvme_queue_term(queue);
-		if (err_exit) {
-			xnvmec_perr("xnvme_queue_term()", err_exit);
-		}
+	if (!(xnvme_is_pow2(qdepth) && (qdepth < 4096))) {
+		xnvmec_perr("qdepth must be a power of 2 below 4096", -EINVAL);
+		return -EINVAL;
 	}
 
-	xnvme_buf_free(src_fh, buf);
-	xnvme_file_close(src_fh);
-	xnvme_file_close(dst_fh);
-	return 0;
+	return copy_file(cli, "copy-async", qdepth, iosize, 0);
 }
 
 static struct xnvmec_sub g_subs[] = {
@@ -932,6 +776,7 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_NON_POSA_TITLE, XNVMEC_SKIP},
 			{XNVMEC_OPT_IOSIZE, XNVMEC_LOPT},
 			{XNVMEC_OPT_DIRECT, XNVMEC_LFLG},
+			{XNVMEC_OPT_OFFLOAD, XNVMEC_LFLG},
 		},
 	},
 	{
@@ -948,6 +793,7 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_IOSIZE, XNVMEC_LOPT},
 			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
 			{XNVMEC_OPT_DIRECT, XNVMEC_LFLG},
+			{XNVMEC_OPT_OFFLOAD, XNVMEC_LFLG},
 		},
 	},
 };
@@ -463,6 +463,66 @@ exit:
 	return err;
 }
 
+static int
+_cmd_mgmt_range(struct xnvmec *cli, uint8_t action)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = cli->args.geo;
+	const uint64_t nzones = cli->args.nzones;
+	uint32_t qdepth = cli->given[XNVMEC_OPT_QDEPTH] ? cli->args.qdepth : 16;
+	uint64_t *zslbas = NULL;
+	uint8_t *done = NULL;
+	uint64_t nfailed = 0;
+	int err;
+
+	xnvmec_pinf("MGMT: zslba: 0x%016lx, nzones: %zu, action: 0x%x, str: %s", cli->args.slba,
+		    nzones, action, xnvme_spec_znd_cmd_mgmt_send_action_str(action));
+
+	if ((action == XNVME_SPEC_ZND_CMD_MGMT_SEND_DESCRIPTOR) || cli->given[XNVMEC_OPT_ALL]) {
+		xnvmec_perr("--nzones with 'descriptor' or --all", -EINVAL);
+		return -EINVAL;
+	}
+	if ((cli->args.slba % geo->nsect) || (cli->args.slba / geo->nsect + nzones > geo->nzone)) {
+		xnvmec_perr("invalid range of zones", -EINVAL);
+		return -EINVAL;
+	}
+
+	zslbas = calloc(nzones, sizeof(*zslbas));
+	done = calloc((nzones + 7) / 8, sizeof(*done));
+	if (!zslbas || !done) {
+		err = -errno;
+		xnvmec_perr("calloc()", err);
+		goto exit;
+	}
+	for (uint64_t i = 0; i < nzones; ++i) {
+		zslbas[i] = cli->args.slba + i * geo->nsect;
+	}
+
+	xnvmec_timer_start(cli);
+
+	err = xnvme_znd_mgmt_send_range(dev, zslbas, nzones, action, qdepth, done);
+
+	xnvmec_timer_stop(cli);
+	xnvme_timer_pr(&cli->timer, "Wall-clock");
+
+	for (uint64_t i = 0; i < nzones; ++i) {
+		if (!(done[i / 8] & (1 << (i % 8)))) {
+			xnvmec_pinf("FAILED: zslba: 0x%016lx", zslbas[i]);
+			nfailed += 1;
+		}
+	}
+	xnvmec_pinf("nzones: %zu, nfailed: %zu", nzones, nfailed);
+	if (err) {
+		xnvmec_perr("xnvme_znd_mgmt_send_range()", err);
+	}
+
+exit:
+	free(zslbas);
+	free(done);
+
+	return err;
+}
+
 static int
 _cmd_mgmt(struct xnvmec *cli, uint8_t action)
 {
@@ -478,6 +538,10 @@ _cmd_mgmt(struct xnvmec *cli, uint8_t action)
 
 	int err;
 
+	if (cli->given[XNVMEC_OPT_NZONES]) {
+		return _cmd_mgmt_range(cli, action);
+	}
+
 	select_all = cli->given[XNVMEC_OPT_ALL] ? true : false;
 	if (!cli->given[XNVMEC_OPT_NSID]) {
 		nsid = xnvme_dev_get_nsid(cli->args.dev);
@@ -690,8 +754,8 @@ static struct xnvmec_sub g_subs[] = {
 	},
 	{
 		"mgmt-open",
-		"Open a Zone",
-		"Open a Zone",
+		"Open a Zone, or 'nzones' Zones from 'slba'",
+		"Open a Zone, or 'nzones' Zones from 'slba'",
 		cmd_mgmt_open,
 		{
 			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
@@ -701,14 +765,16 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_SLBA, XNVMEC_LREQ},
 			{XNVMEC_OPT_NSID, XNVMEC_LOPT},
 			{XNVMEC_OPT_ALL, XNVMEC_LFLG},
+			{XNVMEC_OPT_NZONES, XNVMEC_LOPT},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
 
-			XNVMEC_SYNC_OPTS,
+			XNVMEC_ASYNC_OPTS,
 		},
 	},
 	{
 		"mgmt-close",
-		"Close a Zone",
-		"Close a Zone",
+		"Close a Zone, or 'nzones' Zones from 'slba'",
+		"Close a Zone, or 'nzones' Zones from 'slba'",
 		cmd_mgmt_close,
 		{
 			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
@@ -718,14 +784,16 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_SLBA, XNVMEC_LREQ},
 			{XNVMEC_OPT_NSID, XNVMEC_LOPT},
 			{XNVMEC_OPT_ALL, XNVMEC_LFLG},
+			{XNVMEC_OPT_NZONES, XNVMEC_LOPT},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
 
-			XNVMEC_SYNC_OPTS,
+			XNVMEC_ASYNC_OPTS,
 		},
 	},
 	{
 		"mgmt-finish",
-		"Finish a Zone",
-		"Finish a Zone",
+		"Finish a Zone, or 'nzones' Zones from 'slba'",
+		"Finish a Zone, or 'nzones' Zones from 'slba'",
 		cmd_mgmt_finish,
 		{
 			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
@@ -735,14 +803,16 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_SLBA, XNVMEC_LREQ},
 			{XNVMEC_OPT_NSID, XNVMEC_LOPT},
 			{XNVMEC_OPT_ALL, XNVMEC_LFLG},
+			{XNVMEC_OPT_NZONES, XNVMEC_LOPT},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
 
-			XNVMEC_SYNC_OPTS,
+			XNVMEC_ASYNC_OPTS,
 		},
 	},
 	{
 		"mgmt-reset",
-		"Reset a Zone",
-		"Reset a Zone",
+		"Reset a Zone, or 'nzones' Zones from 'slba'",
+		"Reset a Zone, or 'nzones' Zones from 'slba'",
 		cmd_mgmt_reset,
 		{
 			{XNVMEC_OPT_POSA_TITLE, XNVMEC_SKIP},
@@ -752,8 +822,10 @@ static struct xnvmec_sub g_subs[] = {
 			{XNVMEC_OPT_SLBA, XNVMEC_LREQ},
 			{XNVMEC_OPT_NSID, XNVMEC_LOPT},
 			{XNVMEC_OPT_ALL, XNVMEC_LFLG},
+			{XNVMEC_OPT_NZONES, XNVMEC_LOPT},
+			{XNVMEC_OPT_QDEPTH, XNVMEC_LOPT},
 
-			XNVMEC_SYNC_OPTS,
+			XNVMEC_ASYNC_OPTS,
 		},
 	},
 	{